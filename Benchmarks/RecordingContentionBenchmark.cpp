@@ -0,0 +1,203 @@
+/**
+ * @file RecordingContentionBenchmark.cpp
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ *
+ * Standalone benchmark of the recording path: N threads simulate N streams saving frames in their own recording
+ * context through RecordingManagement::SaveDataAndIncreaseInputNumber. Each run is done twice:
+ * - "global lock": RecordingManagement::ProtectAccess is taken around each save, as it was before recording contexts
+ *   were published as a lock-free snapshot (all streams contend on it);
+ * - "context lock": current path, only the recording context of the stream is locked.
+ *
+ * Build it with the Kinect sources and Omiscid, for instance:
+ *   g++ -O2 -std=c++11 -I.. -I<Omiscid include> RecordingContentionBenchmark.cpp ../RecordingManagement.cpp
+ *       ../RecordingContextFactory.cpp ../KinectStreamStatistics.cpp ../KinectClock.cpp -l<Omiscid>
+ * Usage: RecordingContentionBenchmark [NbStreams=4] [FramesPerStream=1000] [FrameSize=65536] [SessionFolder=ContentionBenchmark]
+ */
+
+#include "../RecordingManagement.h"
+#include "../KinectClock.h"
+#include "../KinectStreamStatistics.h"
+
+#include <System/Thread.h>
+#include <System/Event.h>
+#include <System/LockManagement.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace {
+
+/**
+ * @class StreamSimulator RecordingContentionBenchmark.cpp
+ * @brief Thread saving frames of one stream as fast as possible.
+ */
+class StreamSimulator : public Omiscid::Thread
+{
+public:
+	StreamSimulator(RecordingManagement& _Manager, KinectRecording& _Context, std::atomic<bool>& _Go, std::atomic<int>& _NbReady, int _NbFrames, bool _UseGlobalLock)
+		: Manager(_Manager), Context(_Context), Go(_Go), NbReady(_NbReady)
+	{
+		NbFrames = _NbFrames;
+		UseGlobalLock = _UseGlobalLock;
+	}
+
+	virtual void FUNCTION_CALL_TYPE Run()
+	{
+		KinectTimestamp HostTimestamp;
+
+		// Spin until all threads are ready, they start saving together
+		NbReady++;
+		while( Go == false ) {}
+
+		for( int f = 0; f < NbFrames; f++ )
+		{
+			// 30 fps device time
+			Context.LastFrameTime = (TIMESPAN)(f+1)*333333;
+			KinectClock::GetTimestamp(HostTimestamp);
+
+			const long long int SaveStart = KinectClock::GetMonotonicTime();
+			if ( UseGlobalLock == true )
+			{
+				Omiscid::SmartLocker ProtectAccess_SL(Manager.ProtectAccess);
+				Manager.SaveDataAndIncreaseInputNumber( Context, HostTimestamp, nullptr );
+			}
+			else
+			{
+				Manager.SaveDataAndIncreaseInputNumber( Context, HostTimestamp, nullptr );
+			}
+			SaveTime.Record( KinectClock::GetMonotonicTime() - SaveStart );
+		}
+
+		Done.Signal();
+	}
+
+	LatencyHistogram SaveTime;		/*!< @brief Duration of each save (ns). */
+	Omiscid::Event Done;			/*!< @brief Signaled when all frames are saved. */
+
+protected:
+	RecordingManagement& Manager;
+	KinectRecording& Context;
+	std::atomic<bool>& Go;
+	std::atomic<int>& NbReady;
+	int NbFrames;
+	bool UseGlobalLock;
+};
+
+/** @brief Run all streams once.
+ *
+ * @return wall time of the run in ns.
+ */
+long long int RunStreams(RecordingManagement& Manager, const char * SessionFolder, int NbFrames, bool UseGlobalLock, LatencyHistogramSnapshot& SaveTimes)
+{
+	if ( Manager.StartRecording( SessionFolder ) == false )
+	{
+		fprintf( stderr, "Could not start recording in '%s'\n", SessionFolder );
+		exit( -1 );
+	}
+
+	std::shared_ptr<const KinectRecordingList> Contexts = Manager.GetRecContexts();
+
+	std::atomic<bool> Go(false);
+	std::atomic<int> NbReady(0);
+	std::vector< std::unique_ptr<StreamSimulator> > Streams;
+	for( size_t s = 0; s < Contexts->size(); s++ )
+	{
+		Streams.push_back( std::unique_ptr<StreamSimulator>(new StreamSimulator( Manager, *(*Contexts)[s], Go, NbReady, NbFrames, UseGlobalLock )) );
+		Streams.back()->StartThread();
+	}
+
+	while( NbReady < (int)Streams.size() )
+	{
+		Omiscid::Thread::Sleep(1);
+	}
+	const long long int Start = KinectClock::GetMonotonicTime();
+	Go = true;
+	for( size_t s = 0; s < Streams.size(); s++ )
+	{
+		Streams[s]->Done.Wait();
+	}
+	const long long int Duration = KinectClock::GetMonotonicTime() - Start;
+
+	// Merge per-stream histograms
+	LatencyHistogramSnapshot StreamSaveTimes;
+	SaveTimes = LatencyHistogramSnapshot();
+	for( size_t s = 0; s < Streams.size(); s++ )
+	{
+		Streams[s]->StopThread();
+		Streams[s]->SaveTime.GetSnapshot( StreamSaveTimes );
+		if ( StreamSaveTimes.Count != 0 && (SaveTimes.Count == 0 || StreamSaveTimes.Min < SaveTimes.Min) )
+		{
+			SaveTimes.Min = StreamSaveTimes.Min;
+		}
+		SaveTimes.Max = StreamSaveTimes.Max > SaveTimes.Max ? StreamSaveTimes.Max : SaveTimes.Max;
+		SaveTimes.Count += StreamSaveTimes.Count;
+		SaveTimes.Sum += StreamSaveTimes.Sum;
+		for( int i = 0; i < LatencyHistogramSnapshot::NumberOfBuckets; i++ )
+		{
+			SaveTimes.Buckets[i] += StreamSaveTimes.Buckets[i];
+		}
+	}
+
+	Manager.StopRecording();
+	return Duration;
+}
+
+void PrintResult(const char * Mode, int NbStreams, int NbFrames, long long int Duration, const LatencyHistogramSnapshot& SaveTimes)
+{
+	printf( "%-13s %d streams: %8.0f frames/s, save time (us) mean %7.1f P50 %7.1f P99 %8.1f max %8.1f\n",
+		Mode, NbStreams, (double)NbStreams*(double)NbFrames*1.0e9/(double)Duration, SaveTimes.GetMean()/1000.0,
+		(double)SaveTimes.GetValueAtPercentile(50.0)/1000.0, (double)SaveTimes.GetValueAtPercentile(99.0)/1000.0,
+		(double)SaveTimes.Max/1000.0 );
+}
+
+} // namespace
+
+int main(int argc, char * argv[])
+{
+	const int NbStreams = argc > 1 ? atoi(argv[1]) : 4;
+	const int NbFrames = argc > 2 ? atoi(argv[2]) : 1000;
+	const int FrameSize = argc > 3 ? atoi(argv[3]) : 65536;
+	const char * SessionFolder = argc > 4 ? argv[4] : "ContentionBenchmark";
+
+	if ( NbStreams <= 0 || NbFrames <= 0 || FrameSize <= 0 || FrameSize > 5*1024*1024 )
+	{
+		fprintf( stderr, "Usage: %s [NbStreams=4] [FramesPerStream=1000] [FrameSize=65536 (at most 5 MiB)] [SessionFolder=ContentionBenchmark]\n", argv[0] );
+		return -1;
+	}
+
+	RecordingManagement Manager;
+	for( int s = 0; s < NbStreams; s++ )
+	{
+		char Prefix[32];
+		sprintf( Prefix, "stream%d", s );
+		KinectRecording * pContext = Manager.AddRecContext( Prefix, "UINT8", RecordingContextFactory::VideoRecContext );
+		if ( pContext == (KinectRecording*)nullptr )
+		{
+			fprintf( stderr, "Could not create recording context '%s'\n", Prefix );
+			return -1;
+		}
+		memset( pContext->BufferData, s, FrameSize );
+		pContext->BufferSize = FrameSize;
+	}
+
+	LatencyHistogramSnapshot SaveTimes;
+	long long int Duration;
+
+	// Warm up file system cache
+	RunStreams( Manager, SessionFolder, NbFrames/10 + 1, false, SaveTimes );
+
+	Duration = RunStreams( Manager, SessionFolder, NbFrames, true, SaveTimes );
+	PrintResult( "global lock", NbStreams, NbFrames, Duration, SaveTimes );
+
+	Duration = RunStreams( Manager, SessionFolder, NbFrames, false, SaveTimes );
+	PrintResult( "context lock", NbStreams, NbFrames, Duration, SaveTimes );
+
+	return 0;
+}
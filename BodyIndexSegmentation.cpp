@@ -0,0 +1,251 @@
+/**
+ * @file BodyIndexSegmentation.cpp
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#include "BodyIndexSegmentation.h"
+
+#ifdef KINECT_2
+
+#include "KinectBody.h"
+
+using namespace MobileRGBD::Kinect2;
+
+namespace {
+
+/** @brief Sums of one body during a pass.
+ */
+class SegmentAccumulator
+{
+public:
+	SegmentAccumulator()
+	{
+		NbPixels = NbPoints = 0;
+		Left = DepthWidth; Top = DepthHeight; Right = -1; Bottom = -1;
+		SumU = SumV = 0.0;
+		SumX = SumY = SumZ = 0.0;
+	}
+
+	unsigned int NbPixels, NbPoints;
+	int Left, Top, Right, Bottom;
+	double SumU, SumV;
+	double SumX, SumY, SumZ;
+};
+
+} // namespace
+
+BodyIndexSegmentation::BodyIndexSegmentation(const DepthFrameToCameraSpaceTable& _Table) : Table(_Table)
+{
+}
+
+int BodyIndexSegmentation::Process(const unsigned char * BodyIndex, const unsigned short * Depth, const KinectBodies * Bodies /* = nullptr */, bool KeepPixels /* = true */)
+{
+	for( int b = 0; b < BODY_COUNT; b++ )
+	{
+		Segments[b].Clear();
+	}
+
+	if ( BodyIndex == nullptr || Depth == nullptr )
+	{
+		return 0;
+	}
+
+	const PointF * Entries = Table.GetTable();
+	SegmentAccumulator Accumulators[BODY_COUNT];
+
+	for( int v = 0; v < DepthHeight; v++ )
+	{
+		const int RowStart = v*DepthWidth;
+		int u = 0;
+		while( u < DepthWidth )
+		{
+#ifdef KINECT_SSE2
+			// Skip 16 background pixels at once, most of the frame
+			if ( u + 16 <= DepthWidth )
+			{
+				__m128i Values = _mm_loadu_si128( (const __m128i*)&BodyIndex[RowStart+u] );
+				if ( _mm_movemask_epi8( _mm_cmpeq_epi8(Values, _mm_set1_epi8((char)NoBody)) ) == 0xFFFF )
+				{
+					u += 16;
+					continue;
+				}
+			}
+#endif
+			const int i = RowStart + u;
+			const unsigned char b = BodyIndex[i];
+			if ( b < BODY_COUNT )
+			{
+				SegmentAccumulator& Acc = Accumulators[b];
+				Acc.NbPixels++;
+				Acc.Left = u < Acc.Left ? u : Acc.Left;
+				Acc.Right = u > Acc.Right ? u : Acc.Right;
+				Acc.Top = v < Acc.Top ? v : Acc.Top;
+				Acc.Bottom = v;
+				Acc.SumU += u;
+				Acc.SumV += v;
+
+				if ( Depth[i] != 0 )
+				{
+					Acc.NbPoints++;
+					if ( Entries != nullptr )
+					{
+						float Z = (float)Depth[i]*0.001f;
+						Acc.SumX += Entries[i].X*Z;
+						Acc.SumY += Entries[i].Y*Z;
+						Acc.SumZ += Z;
+					}
+					if ( KeepPixels == true )
+					{
+						Segments[b].Pixels.push_back( i );
+					}
+				}
+			}
+			u++;
+		}
+	}
+
+	int NbBodies = 0;
+	for( int b = 0; b < BODY_COUNT; b++ )
+	{
+		const SegmentAccumulator& Acc = Accumulators[b];
+		BodySegment& Segment = Segments[b];
+		if ( Acc.NbPixels == 0 )
+		{
+			continue;
+		}
+
+		NbBodies++;
+		Segment.NbPixels = Acc.NbPixels;
+		Segment.NbPoints = Acc.NbPoints;
+		Segment.BoundingBox.Left = Acc.Left;
+		Segment.BoundingBox.Top = Acc.Top;
+		Segment.BoundingBox.Right = Acc.Right;
+		Segment.BoundingBox.Bottom = Acc.Bottom;
+		Segment.PixelCentroid.X = (float)(Acc.SumU/Acc.NbPixels);
+		Segment.PixelCentroid.Y = (float)(Acc.SumV/Acc.NbPixels);
+		if ( Acc.NbPoints != 0 && Entries != nullptr )
+		{
+			Segment.Centroid.X = (float)(Acc.SumX/Acc.NbPoints);
+			Segment.Centroid.Y = (float)(Acc.SumY/Acc.NbPoints);
+			Segment.Centroid.Z = (float)(Acc.SumZ/Acc.NbPoints);
+		}
+	}
+
+	// Body slots are the index of bodies in the original Kinect data, known only for live bodies
+	if ( Bodies != nullptr )
+	{
+		bool HasSlot[BODY_COUNT] = { false };
+		bool AllHaveSlot = true;
+		for( unsigned int NumBody = 0; NumBody < Bodies->ActualNbBody && NumBody < BODY_COUNT; NumBody++ )
+		{
+			int Slot = Bodies->InitialBodyIndex[NumBody];
+			if ( Slot >= 0 && Slot < BODY_COUNT && Segments[Slot].NumBody == -1 )
+			{
+				Segments[Slot].NumBody = (int)NumBody;
+				HasSlot[NumBody] = true;
+			}
+			else
+			{
+				AllHaveSlot = false;
+			}
+		}
+
+		if ( AllHaveSlot == false )
+		{
+			AssociateBodiesWithoutSlot( *Bodies, HasSlot );
+		}
+	}
+
+	return NbBodies;
+}
+
+void BodyIndexSegmentation::AssociateBodiesWithoutSlot(const KinectBodies& Bodies, const bool * HasSlot)
+{
+	const int NbBodies = Bodies.ActualNbBody < BODY_COUNT ? (int)Bodies.ActualNbBody : BODY_COUNT;
+
+	for(;;)
+	{
+		// Closest (body, segment) pair still free, SpineBase must be in the bounding box of the segment
+		int BestBody = -1;
+		int BestSlot = -1;
+		float BestDistance = 0.0f;
+		for( int NumBody = 0; NumBody < NbBodies; NumBody++ )
+		{
+			if ( HasSlot[NumBody] == true || GetSegmentOfBody(NumBody) != nullptr )
+			{
+				continue;
+			}
+
+			const PixelPosition& SpineBase = Bodies.BodiesInformation[NumBody].JointsInDepthSpace[JointType_SpineBase];
+			for( int b = 0; b < BODY_COUNT; b++ )
+			{
+				const BodySegment& Segment = Segments[b];
+				if ( Segment.IsPresent() == false || Segment.NumBody != -1 ||
+					 SpineBase.x < (float)Segment.BoundingBox.Left || SpineBase.x > (float)Segment.BoundingBox.Right ||
+					 SpineBase.y < (float)Segment.BoundingBox.Top || SpineBase.y > (float)Segment.BoundingBox.Bottom )
+				{
+					continue;
+				}
+
+				float dx = SpineBase.x - Segment.PixelCentroid.X;
+				float dy = SpineBase.y - Segment.PixelCentroid.Y;
+				float Distance = dx*dx + dy*dy;
+				if ( BestBody == -1 || Distance < BestDistance )
+				{
+					BestBody = NumBody;
+					BestSlot = b;
+					BestDistance = Distance;
+				}
+			}
+		}
+
+		if ( BestBody == -1 )
+		{
+			return;
+		}
+		Segments[BestSlot].NumBody = BestBody;
+	}
+}
+
+const BodySegment * BodyIndexSegmentation::GetSegmentOfBody(int NumBody) const
+{
+	if ( NumBody < 0 )
+	{
+		return nullptr;
+	}
+
+	for( int b = 0; b < BODY_COUNT; b++ )
+	{
+		if ( Segments[b].NumBody == NumBody && Segments[b].IsPresent() == true )
+		{
+			return &Segments[b];
+		}
+	}
+	return nullptr;
+}
+
+void BodyIndexSegmentation::GetBodyPoints(int BodySlot, const unsigned short * Depth, std::vector<CameraSpacePoint>& Points) const
+{
+	Points.clear();
+
+	const PointF * Entries = Table.GetTable();
+	if ( BodySlot < 0 || BodySlot >= BODY_COUNT || Depth == nullptr || Entries == nullptr )
+	{
+		return;
+	}
+
+	const std::vector<int>& Pixels = Segments[BodySlot].Pixels;
+	Points.resize( Pixels.size() );
+	for( size_t k = 0; k < Pixels.size(); k++ )
+	{
+		int i = Pixels[k];
+		float Z = (float)Depth[i]*0.001f;
+		Points[k].X = Entries[i].X*Z;
+		Points[k].Y = Entries[i].Y*Z;
+		Points[k].Z = Z;
+	}
+}
+
+#endif // KINECT_2
@@ -0,0 +1,143 @@
+/**
+ * @file BodyIndexSegmentation.h
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#ifndef __BODY_INDEX_SEGMENTATION_H__
+#define __BODY_INDEX_SEGMENTATION_H__
+
+#ifdef KINECT_2
+
+#include "KinectBasics.h"
+#include "DepthFrameToCameraSpaceTable.h"
+
+#include <vector>
+
+namespace MobileRGBD { namespace Kinect2 {
+
+class KinectBodies;
+
+/**
+ * @class BodySegment BodyIndexSegmentation.cpp BodyIndexSegmentation.h
+ * @brief Pixels of one body in a body index frame and their statistics.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class BodySegment
+{
+public:
+	/** @brief constructor. Empty segment.
+	 */
+	BodySegment()
+	{
+		Clear();
+	}
+
+	/** @brief Virtual destructor, always.
+	 */
+	virtual ~BodySegment() {}
+
+	/** @brief Empty segment, keep memory of Pixels.
+	 */
+	void Clear()
+	{
+		NumBody = -1;
+		NbPixels = 0;
+		NbPoints = 0;
+		BoundingBox.Left = BoundingBox.Top = BoundingBox.Right = BoundingBox.Bottom = 0;
+		PixelCentroid.X = PixelCentroid.Y = 0.0f;
+		Centroid.X = Centroid.Y = Centroid.Z = 0.0f;
+		Pixels.clear();
+	}
+
+	/** @brief Is there a body?
+	 */
+	bool IsPresent() const
+	{
+		return NbPixels != 0;
+	}
+
+	int NumBody;						/*!< @brief Index of the body in KinectBodies (BodiesInformation), -1 if unknown. */
+	unsigned int NbPixels;				/*!< @brief Number of pixels of the body. */
+	unsigned int NbPoints;				/*!< @brief Number of pixels with a valid depth. */
+	RectI BoundingBox;					/*!< @brief Bounding box in depth image (Right and Bottom included). */
+	PointF PixelCentroid;				/*!< @brief Mean position of pixels in depth image. */
+	CameraSpacePoint Centroid;			/*!< @brief Mean of the body points in camera space (meters). */
+	std::vector<int> Pixels;			/*!< @brief Index (y*DepthWidth+x) of the body pixels with a valid depth, if kept. */
+};
+
+/**
+ * @class BodyIndexSegmentation BodyIndexSegmentation.cpp BodyIndexSegmentation.h
+ * @brief Split a depth frame into bodies using the body index frame (body_index.raw, one byte per depth pixel,
+ * body slot 0 to BODY_COUNT-1 or 255 for background). One pass computes, for every body, pixel count, bounding box,
+ * centroids and optionally the list of its pixels. Background is skipped 16 pixels at a time with SSE2 when
+ * available (define KINECT_NO_SSE2 to disable). Segments are linked to KinectBodies through InitialBodyIndex when
+ * bodies come from the sensor. InitialBodyIndex is not saved in skeleton.raw, so bodies read from a recording are linked
+ * to the segment whose pixel centroid is the closest to their SpineBase in depth image.
+ * One segmentation is used by one thread, memory is kept between frames.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class BodyIndexSegmentation
+{
+public:
+	enum { NoBody = 255 };
+
+	/** @brief constructor.
+	 *
+	 * @param Table [in] lookup table of the sensor/session, for camera space centroids and points.
+	 */
+	BodyIndexSegmentation(const DepthFrameToCameraSpaceTable& Table);
+
+	/** @brief Virtual destructor, always.
+	 */
+	virtual ~BodyIndexSegmentation() {}
+
+	/** @brief Segment a frame.
+	 *
+	 * @param BodyIndex [in] body index frame (DepthWidth*DepthHeight bytes).
+	 * @param Depth [in] depth frame (DepthWidth*DepthHeight values in mm).
+	 * @param Bodies [in] bodies of the same time to fill NumBody of segments, may be nullptr. Bodies without valid
+	 * InitialBodyIndex go to the closest segment (pixel centroid to SpineBase in depth image) containing their SpineBase.
+	 * @param KeepPixels [in] fill Pixels of each segment.
+	 * @return number of bodies in the frame.
+	 */
+	int Process(const unsigned char * BodyIndex, const unsigned short * Depth, const KinectBodies * Bodies = nullptr, bool KeepPixels = true);
+
+	/** @brief Segment of a body slot (value in the body index frame).
+	 */
+	const BodySegment& GetSegment(int BodySlot) const
+	{
+		return Segments[BodySlot];
+	}
+
+	/** @brief Segment of a body of KinectBodies, nullptr if it is not in the frame.
+	 *
+	 * @param NumBody [in] index in KinectBodies::BodiesInformation.
+	 */
+	const BodySegment * GetSegmentOfBody(int NumBody) const;
+
+	/** @brief Point cloud of a body (needs KeepPixels in Process).
+	 *
+	 * @param BodySlot [in] value in the body index frame.
+	 * @param Depth [in] depth frame given to Process.
+	 * @param Points [out] camera space points (meters).
+	 */
+	void GetBodyPoints(int BodySlot, const unsigned short * Depth, std::vector<CameraSpacePoint>& Points) const;
+
+protected:
+	/** @brief Link bodies without body slot to the closest free segment of their SpineBase, closest pairs first.
+	 */
+	void AssociateBodiesWithoutSlot(const KinectBodies& Bodies, const bool * HasSlot);
+
+	DepthFrameToCameraSpaceTable Table;			/*!< @brief Unprojection table. */
+	BodySegment Segments[BODY_COUNT];			/*!< @brief One segment per body slot. */
+};
+
+}} // namespace MobileRGBD::Kinect2
+
+#endif // KINECT_2
+
+#endif // __BODY_INDEX_SEGMENTATION_H__
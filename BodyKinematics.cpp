@@ -0,0 +1,225 @@
+/**
+ * @file BodyKinematics.cpp
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#include "BodyKinematics.h"
+
+#ifdef KINECT_2
+
+#include "KinectBody.h"
+
+#include <math.h>
+#include <string.h>
+
+using namespace MobileRGBD::Kinect2;
+
+namespace {
+
+// Parent of each joint, in JointType order
+const int ParentJoints[JointType_Count] = {
+	-1,							// SpineBase
+	JointType_SpineBase,		// SpineMid
+	JointType_SpineShoulder,	// Neck
+	JointType_Neck,				// Head
+	JointType_SpineShoulder,	// ShoulderLeft
+	JointType_ShoulderLeft,		// ElbowLeft
+	JointType_ElbowLeft,		// WristLeft
+	JointType_WristLeft,		// HandLeft
+	JointType_SpineShoulder,	// ShoulderRight
+	JointType_ShoulderRight,	// ElbowRight
+	JointType_ElbowRight,		// WristRight
+	JointType_WristRight,		// HandRight
+	JointType_SpineBase,		// HipLeft
+	JointType_HipLeft,			// KneeLeft
+	JointType_KneeLeft,			// AnkleLeft
+	JointType_AnkleLeft,		// FootLeft
+	JointType_SpineBase,		// HipRight
+	JointType_HipRight,			// KneeRight
+	JointType_KneeRight,		// AnkleRight
+	JointType_AnkleRight,		// FootRight
+	JointType_SpineMid,			// SpineShoulder
+	JointType_HandLeft,			// HandTipLeft
+	JointType_HandLeft,			// ThumbLeft
+	JointType_HandRight,		// HandTipRight
+	JointType_HandRight			// ThumbRight
+};
+
+// Bone angles: joint, then its 2 neighbours
+const int BoneAngles[BodyFeatures::NumberOfBoneAngles][3] = {
+	{ JointType_ElbowLeft, JointType_ShoulderLeft, JointType_WristLeft },
+	{ JointType_ElbowRight, JointType_ShoulderRight, JointType_WristRight },
+	{ JointType_KneeLeft, JointType_HipLeft, JointType_AnkleLeft },
+	{ JointType_KneeRight, JointType_HipRight, JointType_AnkleRight },
+	{ JointType_ShoulderLeft, JointType_SpineShoulder, JointType_ElbowLeft },
+	{ JointType_ShoulderRight, JointType_SpineShoulder, JointType_ElbowRight },
+	{ JointType_HipLeft, JointType_SpineBase, JointType_KneeLeft },
+	{ JointType_HipRight, JointType_SpineBase, JointType_KneeRight },
+	{ JointType_WristLeft, JointType_ElbowLeft, JointType_HandLeft },
+	{ JointType_WristRight, JointType_ElbowRight, JointType_HandRight },
+	{ JointType_AnkleLeft, JointType_KneeLeft, JointType_FootLeft },
+	{ JointType_AnkleRight, JointType_KneeRight, JointType_FootRight },
+	{ JointType_SpineMid, JointType_SpineBase, JointType_SpineShoulder },
+	{ JointType_Neck, JointType_SpineShoulder, JointType_Head }
+};
+
+/** @brief Angle between 2 quaternions, 0 if one is not set (leaf joints have no orientation).
+ */
+static inline float QuaternionAngle(const Vector4& a, const Vector4& b)
+{
+	const float NormA = a.x*a.x + a.y*a.y + a.z*a.z + a.w*a.w;
+	const float NormB = b.x*b.x + b.y*b.y + b.z*b.z + b.w*b.w;
+	if ( NormA < 1e-6f || NormB < 1e-6f )
+	{
+		return 0.0f;
+	}
+
+	float Cosine = fabsf( a.x*b.x + a.y*b.y + a.z*b.z + a.w*b.w )/sqrtf( NormA*NormB );
+	Cosine = Cosine > 1.0f ? 1.0f : Cosine;
+	return 2.0f*acosf( Cosine );
+}
+
+} // namespace
+
+BodyKinematics::BodyKinematics(float _MaxFrameGap /* = 0.5f */)
+{
+	MaxFrameGap = _MaxFrameGap;
+	Reset();
+}
+
+void BodyKinematics::Reset()
+{
+	States.Clear();
+	NbBodies = 0;
+}
+
+/* static */ int BodyKinematics::GetParentJoint(int Joint)
+{
+	return ParentJoints[Joint];
+}
+
+/* static */ int BodyKinematics::GetBoneAngleJoint(int Index)
+{
+	return BoneAngles[Index][0];
+}
+
+/* static */ void BodyKinematics::GetBoneAngleNeighbours(int Index, int& First, int& Second)
+{
+	First = BoneAngles[Index][1];
+	Second = BoneAngles[Index][2];
+}
+
+int BodyKinematics::Update(const KinectBodies& Bodies, TIMESPAN RelativeTime)
+{
+	const int NbInputBodies = (int)(Bodies.ActualNbBody > (unsigned int)BODY_COUNT ? BODY_COUNT : Bodies.ActualNbBody);
+
+	// Forget bodies not in this frame first, their states are free for new bodies
+	States.ReleaseMissing( Bodies );
+
+	NbBodies = 0;
+	for( int b = 0; b < NbInputBodies; b++ )
+	{
+		const KinectBody& Body = Bodies.BodiesInformation[b];
+		bool IsNew;
+		const int Slot = States.Acquire( *Body.trackingId, IsNew );
+		if ( Slot < 0 )
+		{
+			continue;
+		}
+
+		BodyState * State = &States.Get(Slot);
+		if ( IsNew == true )
+		{
+			State->LastTime = 0;
+			State->NbFrames = 0;
+		}
+
+		const float dt = (float)((double)(RelativeTime - State->LastTime)*1e-7);
+		if ( State->NbFrames == 0 || dt <= 0.0f || dt > MaxFrameGap )
+		{
+			// Restart derivatives
+			State->NbFrames = 0;
+			memset( State->Valid, 0, sizeof(State->Valid) );
+		}
+		const float InvDt = State->NbFrames == 0 ? 0.0f : 1.0f/dt;
+		State->LastTime = RelativeTime;
+		State->NbFrames++;
+
+		BodyFeatures& Current = Features[NbBodies++];
+		Current.TrackingId = States.GetTrackingId(Slot);
+		Current.RelativeTime = RelativeTime;
+		Current.NumBody = b;
+		Current.NbFrames = State->NbFrames;
+		memset( Current.Values, 0, sizeof(Current.Values) );
+
+		// Derivatives
+		float * Velocities = &Current.Values[BodyFeatures::VelocityOffset];
+		float * Accelerations = &Current.Values[BodyFeatures::AccelerationOffset];
+		for( int j = 0; j < JointType_Count; j++ )
+		{
+			const Joint& CurrentJoint = Body.Joints[j];
+			if ( CurrentJoint.TrackingState == TrackingState_NotTracked )
+			{
+				State->Valid[j] = 0;
+				continue;
+			}
+
+			const float Position[3] = { CurrentJoint.Position.X, CurrentJoint.Position.Y, CurrentJoint.Position.Z };
+			for( int Axis = 0; Axis < 3; Axis++ )
+			{
+				float Velocity = 0.0f;
+				if ( State->Valid[j] >= 1 )
+				{
+					Velocity = (Position[Axis] - State->Position[Axis][j])*InvDt;
+					if ( State->Valid[j] >= 2 )
+					{
+						Accelerations[3*j+Axis] = (Velocity - State->Velocity[Axis][j])*InvDt;
+					}
+				}
+				Velocities[3*j+Axis] = Velocity;
+				State->Position[Axis][j] = Position[Axis];
+				State->Velocity[Axis][j] = Velocity;
+			}
+			State->Valid[j] = State->Valid[j] < 3 ? State->Valid[j] + 1 : 3;
+		}
+
+		// Angles between bones
+		for( int i = 0; i < BodyFeatures::NumberOfBoneAngles; i++ )
+		{
+			const Joint& Center = Body.Joints[BoneAngles[i][0]];
+			const Joint& First = Body.Joints[BoneAngles[i][1]];
+			const Joint& Second = Body.Joints[BoneAngles[i][2]];
+			if ( Center.TrackingState == TrackingState_NotTracked || First.TrackingState == TrackingState_NotTracked || Second.TrackingState == TrackingState_NotTracked )
+			{
+				continue;
+			}
+
+			const float u[3] = { First.Position.X - Center.Position.X, First.Position.Y - Center.Position.Y, First.Position.Z - Center.Position.Z };
+			const float v[3] = { Second.Position.X - Center.Position.X, Second.Position.Y - Center.Position.Y, Second.Position.Z - Center.Position.Z };
+			const float Cross[3] = { u[1]*v[2] - u[2]*v[1], u[2]*v[0] - u[0]*v[2], u[0]*v[1] - u[1]*v[0] };
+			const float Dot = u[0]*v[0] + u[1]*v[1] + u[2]*v[2];
+			const float CrossNorm = sqrtf( Cross[0]*Cross[0] + Cross[1]*Cross[1] + Cross[2]*Cross[2] );
+			if ( CrossNorm == 0.0f && Dot == 0.0f )
+			{
+				continue;
+			}
+			Current.Values[BodyFeatures::BoneAngleOffset + i] = atan2f( CrossNorm, Dot );
+		}
+
+		// Orientations relative to parents
+		for( int j = 1; j < JointType_Count; j++ )
+		{
+			if ( Body.Joints[j].TrackingState == TrackingState_NotTracked || Body.Joints[ParentJoints[j]].TrackingState == TrackingState_NotTracked )
+			{
+				continue;
+			}
+			Current.Values[BodyFeatures::OrientationAngleOffset + j] = QuaternionAngle( Body.JointOrientations[ParentJoints[j]].Orientation, Body.JointOrientations[j].Orientation );
+		}
+	}
+
+	return NbBodies;
+}
+
+#endif // KINECT_2
@@ -0,0 +1,159 @@
+/**
+ * @file BodyKinematics.h
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#ifndef __BODY_KINEMATICS_H__
+#define __BODY_KINEMATICS_H__
+
+#ifdef KINECT_2
+
+#include "KinectBasics.h"
+#include "TrackingIdSlotTable.h"
+
+namespace MobileRGBD { namespace Kinect2 {
+
+/**
+ * @class BodyFeatures BodyKinematics.cpp BodyKinematics.h
+ * @brief Kinematic features of one body in one frame, as one flat float vector:
+ * joint velocities (m/s, X Y Z per joint), joint accelerations (m/s^2, X Y Z per joint), angles between bones
+ * at main joints (radians, see BodyKinematics::GetBoneAngleJoint) and rotation of each joint orientation relative
+ * to its parent orientation (radians). Values that cannot be computed (joint not tracked, first frames) are 0.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class BodyFeatures
+{
+public:
+	enum { NumberOfBoneAngles = 14 };
+	enum {
+		VelocityOffset = 0,
+		AccelerationOffset = VelocityOffset + 3*JointType_Count,
+		BoneAngleOffset = AccelerationOffset + 3*JointType_Count,
+		OrientationAngleOffset = BoneAngleOffset + NumberOfBoneAngles,
+		FeatureSize = OrientationAngleOffset + JointType_Count
+	};
+
+	/** @brief Velocity of a joint (3 values).
+	 */
+	const float * GetVelocity(int Joint) const
+	{
+		return &Values[VelocityOffset + 3*Joint];
+	}
+
+	/** @brief Acceleration of a joint (3 values).
+	 */
+	const float * GetAcceleration(int Joint) const
+	{
+		return &Values[AccelerationOffset + 3*Joint];
+	}
+
+	/** @brief Angle between bones, Index in [0;NumberOfBoneAngles[.
+	 */
+	float GetBoneAngle(int Index) const
+	{
+		return Values[BoneAngleOffset + Index];
+	}
+
+	/** @brief Rotation of a joint relative to its parent (0 for the root and leaf joints).
+	 */
+	float GetOrientationAngle(int Joint) const
+	{
+		return Values[OrientationAngleOffset + Joint];
+	}
+
+	UINT64 TrackingId;				/*!< @brief Tracking id of the body. */
+	TIMESPAN RelativeTime;			/*!< @brief Device time of the frame (100 ns ticks). */
+	int NumBody;					/*!< @brief Index of the body in KinectBodies::BodiesInformation. */
+	int NbFrames;					/*!< @brief Number of consecutive frames of this body (velocities from 2, accelerations from 3). */
+	float Values[FeatureSize];		/*!< @brief Feature vector. */
+};
+
+/**
+ * @class BodyKinematics BodyKinematics.cpp BodyKinematics.h
+ * @brief Incremental kinematics of tracked bodies: for each new body frame, velocities and accelerations of joints
+ * are updated by finite differences with the previous frame of the same tracking id using device time, and angles
+ * are computed from Joints and JointOrientations of the frame. Cost is constant per frame, only the previous
+ * positions and velocities of each body are kept. A body whose tracking id disappears is forgotten, a gap longer
+ * than MaxFrameGap restarts its derivatives. Frames must be given in order, one engine is used by one thread.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class BodyKinematics
+{
+public:
+	/** @brief constructor.
+	 *
+	 * @param MaxFrameGap [in] longest time (seconds) between 2 frames of a body to compute derivatives.
+	 */
+	BodyKinematics(float MaxFrameGap = 0.5f);
+
+	/** @brief Virtual destructor, always.
+	 */
+	virtual ~BodyKinematics() {}
+
+	/** @brief Forget all bodies.
+	 */
+	void Reset();
+
+	/** @brief Update with a new body frame.
+	 *
+	 * @param Bodies [in] bodies of the frame (ActualNbBody bodies).
+	 * @param RelativeTime [in] device time of the frame (100 ns ticks).
+	 * @return number of bodies with features.
+	 */
+	int Update(const KinectBodies& Bodies, TIMESPAN RelativeTime);
+
+	/** @brief Number of bodies of the last Update.
+	 */
+	int GetNumberOfBodies() const
+	{
+		return NbBodies;
+	}
+
+	/** @brief Features of the last Update.
+	 *
+	 * @param Index [in] in [0;GetNumberOfBodies()[, features of body Features[Index].NumBody.
+	 */
+	const BodyFeatures& GetFeatures(int Index) const
+	{
+		return Features[Index];
+	}
+
+	/** @brief Parent of a joint in the Kinect v2 skeleton hierarchy (-1 for SpineBase).
+	 */
+	static int GetParentJoint(int Joint);
+
+	/** @brief Joint where a bone angle is measured, between bones to its 2 neighbours (see GetBoneAngleNeighbours).
+	 */
+	static int GetBoneAngleJoint(int Index);
+
+	/** @brief The 2 neighbour joints defining a bone angle.
+	 */
+	static void GetBoneAngleNeighbours(int Index, int& First, int& Second);
+
+protected:
+	/** @brief Previous frame of one body.
+	 */
+	struct BodyState
+	{
+		TIMESPAN LastTime;						/*!< @brief Time of the last frame. */
+		int NbFrames;							/*!< @brief Number of consecutive frames. */
+		float Position[3][JointType_Count];		/*!< @brief Last X, Y, Z of joints. */
+		float Velocity[3][JointType_Count];		/*!< @brief Last velocities of joints. */
+		unsigned char Valid[JointType_Count];	/*!< @brief Number of consecutive tracked frames of joints (max 3). */
+	};
+
+	float MaxFrameGap;								/*!< @brief Longest gap for derivatives (seconds). */
+	TrackingIdSlotTable<BodyState> States;			/*!< @brief One state per tracked body. */
+	BodyFeatures Features[BODY_COUNT];				/*!< @brief Features of the last frame. */
+	int NbBodies;									/*!< @brief Number of bodies in Features. */
+};
+
+}} // namespace MobileRGBD::Kinect2
+
+#endif // KINECT_2
+
+#endif // __BODY_KINEMATICS_H__
@@ -0,0 +1,413 @@
+/**
+ * @file CompactRecord.cpp
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#include "CompactRecord.h"
+
+#ifdef KINECT_2
+
+#include "KinectBody.h"
+#include "KinectFace.h"
+#include "LittleEndianRecord.h"
+#include "TimestampFileReader.h"
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+using namespace MobileRGBD::Kinect2;
+
+namespace {
+
+const char CompactMagic[4] = { 'K', 'C', 'R', 'F' };
+
+// Quantization scales
+const float PositionScale = 1000.0f;		// mm
+const float UnitScale = 32767.0f;			// quaternions, lean
+const float PixelScale = 8.0f;				// 1/8 pixel
+
+/** @brief Size of a legacy record of this platform.
+ */
+static int GetLegacyRecordSize(int Kind)
+{
+	if ( Kind == CompactRecord::Bodies )
+	{
+		KinectBody Body;
+		Body.Set( nullptr );
+		return KinectBody::BodySize;
+	}
+
+	KinectFace Face;
+	Face.Set( nullptr );
+	return KinectFace::FaceSize;
+}
+
+} // namespace
+
+/* static */ int CompactRecord::GetRecordSize(int Kind, int Flags)
+{
+	const int ValueSize = (Flags & Quantized) != 0 ? 2 : 4;
+	if ( Kind == Bodies )
+	{
+		// Tracking id, 8 states, lean, joint states, positions, orientations, color and depth pixels
+		return 8 + 8 + 2*ValueSize + JointType_Count + JointType_Count*(3 + 4 + 2 + 2)*ValueSize;
+	}
+
+	// Tracking id, quaternion, 2 boxes, color and infrared points, properties
+	return 8 + 4*ValueSize + 2*4*ValueSize + 2*2*FacePointType_Count*ValueSize + FaceProperty_Count;
+}
+
+/* static */ void CompactRecord::EncodeBody(const KinectBody& Body, int Flags, unsigned char * Record)
+{
+	const bool IsQuantized = (Flags & Quantized) != 0;
+	RecordWriter w = { Record };
+
+	w.U64( (unsigned long long int)*Body.trackingId );
+	w.U8( (unsigned int)*Body.Engaged );
+	w.U8( (unsigned int)Body.HandsTrackingConfidence[KinectBody::HandLeft] );
+	w.U8( (unsigned int)Body.HandsTrackingConfidence[KinectBody::HandRight] );
+	w.U8( (unsigned int)Body.HandsState[KinectBody::HandLeft] );
+	w.U8( (unsigned int)Body.HandsState[KinectBody::HandRight] );
+	w.U8( (unsigned int)*Body.LeanTrackingState );
+	w.U8( (unsigned int)*Body.IsRestricted );
+	w.U8( 0 );
+	w.Value( Body.Lean->X, IsQuantized, UnitScale );
+	w.Value( Body.Lean->Y, IsQuantized, UnitScale );
+
+	for( int j = 0; j < JointType_Count; j++ )
+	{
+		w.U8( (unsigned int)Body.Joints[j].TrackingState );
+	}
+	for( int j = 0; j < JointType_Count; j++ )
+	{
+		w.Value( Body.Joints[j].Position.X, IsQuantized, PositionScale );
+		w.Value( Body.Joints[j].Position.Y, IsQuantized, PositionScale );
+		w.Value( Body.Joints[j].Position.Z, IsQuantized, PositionScale );
+	}
+	for( int j = 0; j < JointType_Count; j++ )
+	{
+		const Vector4& q = Body.JointOrientations[j].Orientation;
+		w.Value( q.x, IsQuantized, UnitScale );
+		w.Value( q.y, IsQuantized, UnitScale );
+		w.Value( q.z, IsQuantized, UnitScale );
+		w.Value( q.w, IsQuantized, UnitScale );
+	}
+	for( int j = 0; j < JointType_Count; j++ )
+	{
+		w.Value( Body.JointsInColorSpace[j].x, IsQuantized, PixelScale );
+		w.Value( Body.JointsInColorSpace[j].y, IsQuantized, PixelScale );
+	}
+	for( int j = 0; j < JointType_Count; j++ )
+	{
+		w.Value( Body.JointsInDepthSpace[j].x, IsQuantized, PixelScale );
+		w.Value( Body.JointsInDepthSpace[j].y, IsQuantized, PixelScale );
+	}
+}
+
+/* static */ void CompactRecord::DecodeBody(const unsigned char * Record, int Flags, KinectBody& Body)
+{
+	const bool IsQuantized = (Flags & Quantized) != 0;
+	RecordReader r = { Record };
+
+	*Body.trackingId = (UINT64)r.U64();
+	*Body.Engaged = (DetectionResult)r.U8();
+	Body.HandsTrackingConfidence[KinectBody::HandLeft] = (TrackingConfidence)r.U8();
+	Body.HandsTrackingConfidence[KinectBody::HandRight] = (TrackingConfidence)r.U8();
+	Body.HandsState[KinectBody::HandLeft] = (HandState)r.U8();
+	Body.HandsState[KinectBody::HandRight] = (HandState)r.U8();
+	*Body.LeanTrackingState = (tTrackingState)r.U8();
+	*Body.IsRestricted = (unsigned char)r.U8();
+	r.U8();
+	Body.Lean->X = r.Value( IsQuantized, UnitScale );
+	Body.Lean->Y = r.Value( IsQuantized, UnitScale );
+
+	for( int j = 0; j < JointType_Count; j++ )
+	{
+		Body.Joints[j].JointType = (tJointType)j;
+		Body.Joints[j].TrackingState = (tTrackingState)r.U8();
+	}
+	for( int j = 0; j < JointType_Count; j++ )
+	{
+		Body.Joints[j].Position.X = r.Value( IsQuantized, PositionScale );
+		Body.Joints[j].Position.Y = r.Value( IsQuantized, PositionScale );
+		Body.Joints[j].Position.Z = r.Value( IsQuantized, PositionScale );
+	}
+	for( int j = 0; j < JointType_Count; j++ )
+	{
+		Vector4& q = Body.JointOrientations[j].Orientation;
+		Body.JointOrientations[j].JointType = (tJointType)j;
+		q.x = r.Value( IsQuantized, UnitScale );
+		q.y = r.Value( IsQuantized, UnitScale );
+		q.z = r.Value( IsQuantized, UnitScale );
+		q.w = r.Value( IsQuantized, UnitScale );
+	}
+	for( int j = 0; j < JointType_Count; j++ )
+	{
+		Body.JointsInColorSpace[j].x = r.Value( IsQuantized, PixelScale );
+		Body.JointsInColorSpace[j].y = r.Value( IsQuantized, PixelScale );
+	}
+	for( int j = 0; j < JointType_Count; j++ )
+	{
+		Body.JointsInDepthSpace[j].x = r.Value( IsQuantized, PixelScale );
+		Body.JointsInDepthSpace[j].y = r.Value( IsQuantized, PixelScale );
+	}
+}
+
+/* static */ void CompactRecord::EncodeFace(const KinectFace& Face, int Flags, unsigned char * Record)
+{
+	const bool IsQuantized = (Flags & Quantized) != 0;
+	RecordWriter w = { Record };
+
+	w.U64( (unsigned long long int)*Face.TrackingId );
+	w.Value( Face.RotationQuaternion->x, IsQuantized, UnitScale );
+	w.Value( Face.RotationQuaternion->y, IsQuantized, UnitScale );
+	w.Value( Face.RotationQuaternion->z, IsQuantized, UnitScale );
+	w.Value( Face.RotationQuaternion->w, IsQuantized, UnitScale );
+
+	const RectI * Boxes[2] = { Face.BoundingBoxInColorSpace, Face.BoundingBoxInInfraredSpace };
+	for( int b = 0; b < 2; b++ )
+	{
+		const int Coordinates[4] = { Boxes[b]->Left, Boxes[b]->Top, Boxes[b]->Right, Boxes[b]->Bottom };
+		for( int c = 0; c < 4; c++ )
+		{
+			if ( IsQuantized == true )
+			{
+				w.Q16( (float)Coordinates[c], 1.0f );
+			}
+			else
+			{
+				w.U32( (unsigned int)Coordinates[c] );
+			}
+		}
+	}
+
+	const PointF * Points[2] = { Face.FacePointsInColorSpace, Face.FacePointsInInfraredSpace };
+	for( int p = 0; p < 2; p++ )
+	{
+		for( int i = 0; i < FacePointType_Count; i++ )
+		{
+			w.Value( Points[p][i].X, IsQuantized, PixelScale );
+			w.Value( Points[p][i].Y, IsQuantized, PixelScale );
+		}
+	}
+
+	for( int i = 0; i < FaceProperty_Count; i++ )
+	{
+		w.U8( (unsigned int)Face.FaceProperties[i] );
+	}
+}
+
+/* static */ void CompactRecord::DecodeFace(const unsigned char * Record, int Flags, KinectFace& Face)
+{
+	const bool IsQuantized = (Flags & Quantized) != 0;
+	RecordReader r = { Record };
+
+	*Face.TrackingId = (UINT64)r.U64();
+	Face.RotationQuaternion->x = r.Value( IsQuantized, UnitScale );
+	Face.RotationQuaternion->y = r.Value( IsQuantized, UnitScale );
+	Face.RotationQuaternion->z = r.Value( IsQuantized, UnitScale );
+	Face.RotationQuaternion->w = r.Value( IsQuantized, UnitScale );
+
+	RectI * Boxes[2] = { Face.BoundingBoxInColorSpace, Face.BoundingBoxInInfraredSpace };
+	for( int b = 0; b < 2; b++ )
+	{
+		INT32 * Coordinates[4] = { &Boxes[b]->Left, &Boxes[b]->Top, &Boxes[b]->Right, &Boxes[b]->Bottom };
+		for( int c = 0; c < 4; c++ )
+		{
+			*Coordinates[c] = IsQuantized == true ? (INT32)(short)r.U16() : (INT32)r.U32();
+		}
+	}
+
+	PointF * Points[2] = { Face.FacePointsInColorSpace, Face.FacePointsInInfraredSpace };
+	for( int p = 0; p < 2; p++ )
+	{
+		for( int i = 0; i < FacePointType_Count; i++ )
+		{
+			Points[p][i].X = r.Value( IsQuantized, PixelScale );
+			Points[p][i].Y = r.Value( IsQuantized, PixelScale );
+		}
+	}
+
+	for( int i = 0; i < FaceProperty_Count; i++ )
+	{
+		Face.FaceProperties[i] = (DetectionResult)r.U8();
+	}
+}
+
+/* static */ bool CompactRecord::WriteHeader(FILE * f, int Kind, int Flags)
+{
+	unsigned char Header[HeaderSize];
+	memcpy( Header, CompactMagic, sizeof(CompactMagic) );
+	RecordWriter w = { Header + sizeof(CompactMagic) };
+	w.U16( CurrentVersion );
+	w.U16( (unsigned int)Flags );
+	w.U8( (unsigned int)Kind );
+	w.U8( 0 );
+	w.U8( 0 );
+	w.U8( 0 );
+	w.U32( (unsigned int)GetRecordSize( Kind, Flags ) );
+
+	return fwrite( Header, HeaderSize, 1, f ) == 1;
+}
+
+/* static */ bool CompactRecord::ReadHeader(FILE * f, int& Kind, int& Flags)
+{
+	unsigned char Header[HeaderSize];
+	if ( fread( Header, HeaderSize, 1, f ) != 1 || memcmp( Header, CompactMagic, sizeof(CompactMagic) ) != 0 )
+	{
+		return false;
+	}
+
+	RecordReader r = { Header + sizeof(CompactMagic) };
+	const unsigned int Version = r.U16();
+	Flags = (int)r.U16();
+	Kind = (int)r.U8();
+	r.U8();
+	r.U8();
+	r.U8();
+	const int RecordSize = (int)r.U32();
+
+	return Version == CurrentVersion && (Kind == Bodies || Kind == Faces) && RecordSize == GetRecordSize( Kind, Flags );
+}
+
+/* static */ long long int CompactRecord::ConvertFromLegacy(const char * LegacyFileName, const char * CompactFileName, int Kind, int Flags /* = 0 */)
+{
+	FILE * fIn = fopen( LegacyFileName, "rb" );
+	if ( fIn == (FILE*)nullptr )
+	{
+		fprintf( stderr, "Could not open '%s' raw file\n", LegacyFileName );
+		return -1;
+	}
+
+	FILE * fOut = fopen( CompactFileName, "wb" );
+	if ( fOut == (FILE*)nullptr )
+	{
+		fprintf( stderr, "Could not create '%s' compact file\n", CompactFileName );
+		fclose(fIn);
+		return -1;
+	}
+
+	std::vector<unsigned char> Legacy( GetLegacyRecordSize( Kind ) );
+	std::vector<unsigned char> Compact( GetRecordSize( Kind, Flags ) );
+	KinectBody Body;
+	KinectFace Face;
+	Body.Set( &Legacy[0] );
+	Face.Set( &Legacy[0] );
+
+	long long int NbRecords = WriteHeader( fOut, Kind, Flags ) == true ? 0 : -1;
+	while( NbRecords >= 0 && fread( &Legacy[0], Legacy.size(), 1, fIn ) == 1 )
+	{
+		if ( Kind == Bodies )
+		{
+			EncodeBody( Body, Flags, &Compact[0] );
+		}
+		else
+		{
+			EncodeFace( Face, Flags, &Compact[0] );
+		}
+
+		if ( fwrite( &Compact[0], Compact.size(), 1, fOut ) != 1 )
+		{
+			NbRecords = -1;
+			break;
+		}
+		NbRecords++;
+	}
+
+	if ( NbRecords < 0 )
+	{
+		fprintf( stderr, "Could not write '%s' compact file\n", CompactFileName );
+	}
+
+	fclose(fIn);
+	fclose(fOut);
+
+	return NbRecords;
+}
+
+/* static */ long long int CompactRecord::ConvertToLegacy(const char * CompactFileName, const char * LegacyFileName)
+{
+	FILE * fIn = fopen( CompactFileName, "rb" );
+	if ( fIn == (FILE*)nullptr )
+	{
+		fprintf( stderr, "Could not open '%s' compact file\n", CompactFileName );
+		return -1;
+	}
+
+	int Kind, Flags;
+	if ( ReadHeader( fIn, Kind, Flags ) == false )
+	{
+		fprintf( stderr, "'%s' is not a compact record file\n", CompactFileName );
+		fclose(fIn);
+		return -1;
+	}
+
+	FILE * fOut = fopen( LegacyFileName, "wb" );
+	if ( fOut == (FILE*)nullptr )
+	{
+		fprintf( stderr, "Could not create '%s' raw file\n", LegacyFileName );
+		fclose(fIn);
+		return -1;
+	}
+
+	std::vector<unsigned char> Legacy( GetLegacyRecordSize( Kind ) );
+	std::vector<unsigned char> Compact( GetRecordSize( Kind, Flags ) );
+	KinectBody Body;
+	KinectFace Face;
+	Body.Set( &Legacy[0] );
+	Face.Set( &Legacy[0] );
+
+	long long int NbRecords = 0;
+	while( fread( &Compact[0], Compact.size(), 1, fIn ) == 1 )
+	{
+		if ( Kind == Bodies )
+		{
+			DecodeBody( &Compact[0], Flags, Body );
+		}
+		else
+		{
+			DecodeFace( &Compact[0], Flags, Face );
+		}
+
+		if ( fwrite( &Legacy[0], Legacy.size(), 1, fOut ) != 1 )
+		{
+			fprintf( stderr, "Could not write '%s' raw file\n", LegacyFileName );
+			NbRecords = -1;
+			break;
+		}
+		NbRecords++;
+	}
+
+	fclose(fIn);
+	fclose(fOut);
+
+	return NbRecords;
+}
+
+/* static */ bool CompactRecord::ConvertSession(const char * SessionFolder, int Flags /* = 0 */)
+{
+	const char * Prefixes[2] = { "skeleton", "face" };
+	const int Kinds[2] = { Bodies, Faces };
+
+	bool Res = true;
+	for( int s = 0; s < 2; s++ )
+	{
+		std::string LegacyFileName = TimestampFileReader::GetStreamFileName( SessionFolder, Prefixes[s], "raw" );
+		if ( TimestampFileReader::GetFileSize( LegacyFileName.c_str() ) < 0 )
+		{
+			continue;
+		}
+
+		if ( ConvertFromLegacy( LegacyFileName.c_str(), TimestampFileReader::GetStreamFileName( SessionFolder, Prefixes[s], "craw" ).c_str(), Kinds[s], Flags ) < 0 )
+		{
+			Res = false;
+		}
+	}
+
+	return Res;
+}
+
+#endif // KINECT_2
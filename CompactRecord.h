@@ -0,0 +1,122 @@
+/**
+ * @file CompactRecord.h
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#ifndef __COMPACT_RECORD_H__
+#define __COMPACT_RECORD_H__
+
+#ifdef KINECT_2
+
+#include "KinectBasics.h"
+
+#include <stdio.h>
+
+namespace MobileRGBD { namespace Kinect2 {
+
+class KinectBody;
+class KinectFace;
+
+/**
+ * @class CompactRecord CompactRecord.cpp CompactRecord.h
+ * @brief Portable file format for body and face records. Legacy skeleton.raw/face.raw files are KinectBody/KinectFace
+ * buffers, their layout depends on sizeof of enums, structs and UINT64 of the platform. Compact files have an explicit
+ * little-endian layout, whatever the platform:
+ * - a 16 bytes header: "KCRF", version (16 bits), flags (16 bits), kind (8 bits, Bodies or Faces), 3 zero bytes,
+ *   record size (32 bits);
+ * - then records, in the same order as in the legacy file (the timestamp file of the stream is unchanged).
+ *
+ * A body record is: tracking id (64 bits), Engaged, 2 hand confidences, 2 hand states, lean tracking state,
+ * IsRestricted, one zero byte (8 bits each), lean X/Y, tracking states of joints (8 bits each), joint positions,
+ * joint orientations, joints in color space and joints in depth space (X Y [Z W] per joint).
+ * A face record is: tracking id, rotation quaternion, bounding boxes in color and infrared space, face points in color
+ * and infrared space, face properties (8 bits each).
+ * Without flags, values are 32 bits floats/integers and conversion is lossless (JointType of joints is their index,
+ * as in Kinect data). With Quantized flag, values are 16 bits: positions in mm, quaternions and lean scaled by 32767,
+ * pixel positions in 1/8 pixel (clamped to +/-4095 pixels), boxes in pixels.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class CompactRecord
+{
+public:
+	enum { Bodies, Faces };							/*!< @brief Kind of records. */
+	enum { Quantized = 0x0001 };					/*!< @brief Flags. */
+	enum { CurrentVersion = 1, HeaderSize = 16 };
+
+	/** @brief Size of one record.
+	 *
+	 * @param Kind [in] Bodies or Faces.
+	 * @param Flags [in] format flags.
+	 */
+	static int GetRecordSize(int Kind, int Flags);
+
+	/** @brief Encode a body.
+	 *
+	 * @param Body [in] body set on a legacy buffer.
+	 * @param Flags [in] format flags.
+	 * @param Record [out] GetRecordSize(Bodies, Flags) bytes.
+	 */
+	static void EncodeBody(const KinectBody& Body, int Flags, unsigned char * Record);
+
+	/** @brief Decode a body.
+	 *
+	 * @param Record [in] encoded body.
+	 * @param Flags [in] format flags.
+	 * @param Body [out] body set on a legacy buffer.
+	 */
+	static void DecodeBody(const unsigned char * Record, int Flags, KinectBody& Body);
+
+	/** @brief Encode a face.
+	 */
+	static void EncodeFace(const KinectFace& Face, int Flags, unsigned char * Record);
+
+	/** @brief Decode a face.
+	 */
+	static void DecodeFace(const unsigned char * Record, int Flags, KinectFace& Face);
+
+	/** @brief Write a file header.
+	 */
+	static bool WriteHeader(FILE * f, int Kind, int Flags);
+
+	/** @brief Read and check a file header.
+	 *
+	 * @return false if not a compact file or unknown version.
+	 */
+	static bool ReadHeader(FILE * f, int& Kind, int& Flags);
+
+	/** @brief Convert a legacy raw file (skeleton.raw or face.raw) into a compact file.
+	 *
+	 * @param LegacyFileName [in] legacy raw file.
+	 * @param CompactFileName [in] compact file to create.
+	 * @param Kind [in] Bodies or Faces.
+	 * @param Flags [in] format flags.
+	 * @return number of records, -1 on error.
+	 */
+	static long long int ConvertFromLegacy(const char * LegacyFileName, const char * CompactFileName, int Kind, int Flags = 0);
+
+	/** @brief Convert a compact file back into a legacy raw file of this platform.
+	 *
+	 * @param CompactFileName [in] compact file.
+	 * @param LegacyFileName [in] legacy raw file to create.
+	 * @return number of records, -1 on error.
+	 */
+	static long long int ConvertToLegacy(const char * CompactFileName, const char * LegacyFileName);
+
+	/** @brief Convert skeleton and face streams of a session ("SessionFolder/skeleton/skeleton.raw" to
+	 * "SessionFolder/skeleton/skeleton.craw", same for face). Missing streams are ignored.
+	 *
+	 * @param SessionFolder [in] session folder.
+	 * @param Flags [in] format flags.
+	 * @return false if a stream could not be converted.
+	 */
+	static bool ConvertSession(const char * SessionFolder, int Flags = 0);
+};
+
+}} // namespace MobileRGBD::Kinect2
+
+#endif // KINECT_2
+
+#endif // __COMPACT_RECORD_H__
@@ -6,3 +6,38 @@
  */
 
 #include "DepthCameraIntrinsics.h"
+
+#ifdef KINECT_2
+
+#include "SerializableFile.h"
+#include "TimestampFileReader.h"
+
+bool DepthCameraIntrinsics::Save(const char * FileName) const
+{
+	return SerializableFile::Save( FileName, *this );
+}
+
+bool DepthCameraIntrinsics::Load(const char * FileName)
+{
+	// Load in a copy, keep current values if something is missing
+	DepthCameraIntrinsics NewValues;
+	if ( SerializableFile::Load( FileName, NewValues ) == false )
+	{
+		return false;
+	}
+
+	IntrinsicsParameters = NewValues.IntrinsicsParameters;
+	return true;
+}
+
+bool DepthCameraIntrinsics::SaveInSession(const char * SessionFolder) const
+{
+	return Save( TimestampFileReader::GetStreamFileName( SessionFolder, "depth", "intrinsics" ).c_str() );
+}
+
+bool DepthCameraIntrinsics::LoadFromSession(const char * SessionFolder)
+{
+	return Load( TimestampFileReader::GetStreamFileName( SessionFolder, "depth", "intrinsics" ).c_str() );
+}
+
+#endif // KINECT_2
@@ -12,12 +12,21 @@
 
 #include "KinectBasics.h"
 
+#include <string.h>
+
 // Add Serialization facilities
 #include <Messaging/Serializable.h>
 
 class DepthCameraIntrinsics : public Omiscid::Serializable
 {
 public:
+	// Kinect SDK type when live, our own definition otherwise
+#ifdef KINECT_LIVE
+	typedef ::CameraIntrinsics IntrinsicsType;
+#else
+	typedef MobileRGBD::Kinect2::CameraIntrinsics IntrinsicsType;
+#endif
+
 	DepthCameraIntrinsics() :
 		FocalLengthX(IntrinsicsParameters.FocalLengthX),
 		FocalLengthY(IntrinsicsParameters.FocalLengthY),
@@ -26,10 +35,46 @@ public:
 		RadialDistortionSecondOrder(IntrinsicsParameters.RadialDistortionSecondOrder),
 		RadialDistortionFourthOrder(IntrinsicsParameters.RadialDistortionFourthOrder),
 		RadialDistortionSixthOrder(IntrinsicsParameters.RadialDistortionSixthOrder)
-	{};
+	{
+		memset( &IntrinsicsParameters, 0, sizeof(IntrinsicsParameters) );
+	};
+
+	// References must point to our own values, not to the copied object ones (serialization mapping is not copied either)
+	DepthCameraIntrinsics(const DepthCameraIntrinsics& ToCopy) :
+		Omiscid::Serializable(),
+		FocalLengthX(IntrinsicsParameters.FocalLengthX),
+		FocalLengthY(IntrinsicsParameters.FocalLengthY),
+		PrincipalPointX(IntrinsicsParameters.PrincipalPointX),
+		PrincipalPointY(IntrinsicsParameters.PrincipalPointY),
+		RadialDistortionSecondOrder(IntrinsicsParameters.RadialDistortionSecondOrder),
+		RadialDistortionFourthOrder(IntrinsicsParameters.RadialDistortionFourthOrder),
+		RadialDistortionSixthOrder(IntrinsicsParameters.RadialDistortionSixthOrder)
+	{
+		IntrinsicsParameters = ToCopy.IntrinsicsParameters;
+	};
+
+	DepthCameraIntrinsics& operator=(const DepthCameraIntrinsics& ToCopy)
+	{
+		IntrinsicsParameters = ToCopy.IntrinsicsParameters;
+		return *this;
+	}
 
 	virtual ~DepthCameraIntrinsics() {};
 
+	// Are intrinsics set (focal length can not be 0)?
+	bool IsValid() const
+	{
+		return IntrinsicsParameters.FocalLengthX != 0.0f && IntrinsicsParameters.FocalLengthY != 0.0f;
+	}
+
+	// Save/Load intrinsics as a JSON object (same fields as serialization)
+	bool Save(const char * FileName) const;
+	bool Load(const char * FileName);
+
+	// Save/Load in a session folder ("SessionFolder/depth/depth.intrinsics")
+	bool SaveInSession(const char * SessionFolder) const;
+	bool LoadFromSession(const char * SessionFolder);
+
 	// To (Un)serialize data, declare JSON mapping 
 	virtual void DeclareSerializeMapping()
 	{
@@ -53,7 +98,7 @@ public:
 
 public:
 	// Internal value from the Kinect
-	CameraIntrinsics IntrinsicsParameters;
+	IntrinsicsType IntrinsicsParameters;
 };
 
 #endif // KINECT_2
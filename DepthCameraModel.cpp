@@ -0,0 +1,205 @@
+/**
+ * @file DepthCameraModel.cpp
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#include "DepthCameraModel.h"
+
+#ifdef KINECT_2
+
+#include "KinectBody.h"
+
+#include <System/Mutex.h>
+#include <System/LockManagement.h>
+
+#include <string.h>
+#include <vector>
+
+using namespace MobileRGBD::Kinect2;
+
+namespace {
+
+// Number of iterations to invert distortion, enough for Kinect v2 distortion values
+static const int UndistortIterations = 20;
+
+} // namespace
+
+DepthCameraModel::DepthCameraModel(const DepthCameraIntrinsics& _Intrinsics) : Intrinsics(_Intrinsics)
+{
+	if ( Intrinsics.IsValid() == false )
+	{
+		return;
+	}
+
+	// Compute undistorted position of all pixels once
+	std::vector<PointF> Table( DepthFrameToCameraSpaceTable::NumberOfEntries );
+	for( int v = 0; v < DepthHeight; v++ )
+	{
+		for( int u = 0; u < DepthWidth; u++ )
+		{
+			PointF& Entry = Table[v*DepthWidth+u];
+			UndistortPixel( (float)u, (float)v, Entry.X, Entry.Y );
+		}
+	}
+	UnprojectionTable.Set( &Table[0], (unsigned int)Table.size() );
+}
+
+/* static */ std::shared_ptr<const DepthCameraModel> DepthCameraModel::GetModel(const DepthCameraIntrinsics& Intrinsics)
+{
+	static Omiscid::Mutex CacheProtection;
+	static std::vector< std::shared_ptr<const DepthCameraModel> > Cache;
+
+	if ( Intrinsics.IsValid() == false )
+	{
+		return std::shared_ptr<const DepthCameraModel>();
+	}
+
+	Omiscid::SmartLocker SL_CacheProtection(CacheProtection);
+
+	// Few different intrinsics are used at once, linear search on all values
+	for( size_t i = 0; i < Cache.size(); i++ )
+	{
+		if ( memcmp( &Cache[i]->Intrinsics.IntrinsicsParameters, &Intrinsics.IntrinsicsParameters, sizeof(Intrinsics.IntrinsicsParameters) ) == 0 )
+		{
+			return Cache[i];
+		}
+	}
+
+	std::shared_ptr<const DepthCameraModel> NewModel = std::make_shared<const DepthCameraModel>( Intrinsics );
+	Cache.push_back( NewModel );
+	return NewModel;
+}
+
+/* static */ bool DepthCameraModel::GetSessionUnprojectionTable(const char * SessionFolder, DepthFrameToCameraSpaceTable& Table)
+{
+	// SDK table is the reference
+	if ( Table.LoadFromSession( SessionFolder ) == true )
+	{
+		return true;
+	}
+
+	// Fallback to intrinsics
+	DepthCameraIntrinsics Intrinsics;
+	if ( Intrinsics.LoadFromSession( SessionFolder ) == false )
+	{
+		return false;
+	}
+
+	std::shared_ptr<const DepthCameraModel> Model = GetModel( Intrinsics );
+	if ( Model == nullptr || Model->GetUnprojectionTable().IsValid() == false )
+	{
+		return false;
+	}
+
+	Table = Model->GetUnprojectionTable();
+	return true;
+}
+
+void DepthCameraModel::UndistortPixel(float u, float v, float& x, float& y) const
+{
+	const DepthCameraIntrinsics::IntrinsicsType& Params = Intrinsics.IntrinsicsParameters;
+
+	float xd = (u - Params.PrincipalPointX)/Params.FocalLengthX;
+	float yd = (Params.PrincipalPointY - v)/Params.FocalLengthY;
+
+	// Fixed point iteration on x = xd/d(r2(x,y))
+	x = xd;
+	y = yd;
+	for( int i = 0; i < UndistortIterations; i++ )
+	{
+		float r2 = x*x + y*y;
+		float d = 1.0f + r2*(Params.RadialDistortionSecondOrder + r2*(Params.RadialDistortionFourthOrder + r2*Params.RadialDistortionSixthOrder));
+		x = xd/d;
+		y = yd/d;
+	}
+}
+
+void DepthCameraModel::DistortPoint(float x, float y, float& u, float& v) const
+{
+	const DepthCameraIntrinsics::IntrinsicsType& Params = Intrinsics.IntrinsicsParameters;
+
+	float r2 = x*x + y*y;
+	float d = 1.0f + r2*(Params.RadialDistortionSecondOrder + r2*(Params.RadialDistortionFourthOrder + r2*Params.RadialDistortionSixthOrder));
+	u = Params.PrincipalPointX + Params.FocalLengthX*x*d;
+	v = Params.PrincipalPointY - Params.FocalLengthY*y*d;
+}
+
+int DepthCameraModel::ProjectPoints(const CameraSpacePoint * Points, int NbPoints, PixelPosition * Pixels) const
+{
+	int NbValid = 0;
+	for( int i = 0; i < NbPoints; i++ )
+	{
+		if ( Points[i].Z <= 0.0f )
+		{
+			Pixels[i].x = -1.0f;
+			Pixels[i].y = -1.0f;
+			continue;
+		}
+
+		float InvZ = 1.0f/Points[i].Z;
+		DistortPoint( Points[i].X*InvZ, Points[i].Y*InvZ, Pixels[i].x, Pixels[i].y );
+		NbValid++;
+	}
+	return NbValid;
+}
+
+bool DepthCameraModel::InterpolateMap(float u, float v, float& x, float& y) const
+{
+	const PointF * Table = UnprojectionTable.GetTable();
+	if ( Table == nullptr || u < 0.0f || v < 0.0f || u > (float)(DepthWidth-1) || v > (float)(DepthHeight-1) )
+	{
+		return false;
+	}
+
+	int u0 = (int)u;
+	int v0 = (int)v;
+	int u1 = u0 < DepthWidth-1 ? u0+1 : u0;
+	int v1 = v0 < DepthHeight-1 ? v0+1 : v0;
+	float au = u - (float)u0;
+	float av = v - (float)v0;
+
+	const PointF& p00 = Table[v0*DepthWidth+u0];
+	const PointF& p01 = Table[v0*DepthWidth+u1];
+	const PointF& p10 = Table[v1*DepthWidth+u0];
+	const PointF& p11 = Table[v1*DepthWidth+u1];
+
+	x = (1.0f-av)*((1.0f-au)*p00.X + au*p01.X) + av*((1.0f-au)*p10.X + au*p11.X);
+	y = (1.0f-av)*((1.0f-au)*p00.Y + au*p01.Y) + av*((1.0f-au)*p10.Y + au*p11.Y);
+	return true;
+}
+
+void DepthCameraModel::UnprojectPixels(const PixelPosition * Pixels, const float * Depths, int NbPoints, CameraSpacePoint * Points) const
+{
+	for( int i = 0; i < NbPoints; i++ )
+	{
+		float x, y;
+		if ( InterpolateMap( Pixels[i].x, Pixels[i].y, x, y ) == false )
+		{
+			UndistortPixel( Pixels[i].x, Pixels[i].y, x, y );
+		}
+
+		Points[i].X = x*Depths[i];
+		Points[i].Y = y*Depths[i];
+		Points[i].Z = Depths[i];
+	}
+}
+
+int DepthCameraModel::ProjectJoints(const KinectBody& Body, PixelPosition * JointsInDepth) const
+{
+	if ( Body.Joints == (Joint*)nullptr )
+	{
+		return 0;
+	}
+
+	CameraSpacePoint Positions[JointType_Count];
+	for( int i = 0; i < JointType_Count; i++ )
+	{
+		Positions[i] = Body.Joints[i].Position;
+	}
+
+	return ProjectPoints( Positions, JointType_Count, JointsInDepth );
+}
+
+#endif // KINECT_2
@@ -0,0 +1,130 @@
+/**
+ * @file DepthCameraModel.h
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#ifndef __DEPTH_CAMERA_MODEL_H__
+#define __DEPTH_CAMERA_MODEL_H__
+
+#ifdef KINECT_2
+
+#include "KinectBasics.h"
+#include "DepthCameraIntrinsics.h"
+#include "DepthFrameToCameraSpaceTable.h"
+
+#include <memory>
+
+namespace MobileRGBD { namespace Kinect2 {
+
+class KinectBody;
+
+/**
+ * @class DepthCameraModel DepthCameraModel.cpp DepthCameraModel.h
+ * @brief Pinhole model of the depth camera with radial distortion, built from DepthCameraIntrinsics.
+ * Pixel (u,v) and camera space point (X,Y,Z) are related by x = X/Z, y = Y/Z, r2 = x*x+y*y,
+ * d = 1 + k2*r2 + k4*r2^2 + k6*r2^3, u = cx + fx*x*d, v = cy - fy*y*d (Y axis up as in Kinect camera space).
+ * The undistortion of every depth pixel is computed once at construction and stored as a
+ * DepthFrameToCameraSpaceTable, so depth frames can be unprojected with DepthToPointCloud when the
+ * session has no SDK lookup table. Models are immutable and shared through GetModel.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class DepthCameraModel
+{
+public:
+	/** @brief constructor. Compute undistortion map.
+	 *
+	 * @param Intrinsics [in] intrinsics of the depth camera.
+	 */
+	DepthCameraModel(const DepthCameraIntrinsics& Intrinsics);
+
+	/** @brief Virtual destructor, always.
+	 */
+	virtual ~DepthCameraModel() {}
+
+	/** @brief Get model for these intrinsics. Models are cached using intrinsics values as key,
+	 * maps are only computed the first time.
+	 *
+	 * @param Intrinsics [in] intrinsics of the depth camera.
+	 * @return the shared model, nullptr if intrinsics are not valid.
+	 */
+	static std::shared_ptr<const DepthCameraModel> GetModel(const DepthCameraIntrinsics& Intrinsics);
+
+	/** @brief Get the unprojection table of a recorded session: the SDK table (depth/depth.table)
+	 * if present, otherwise the one computed from depth/depth.intrinsics.
+	 *
+	 * @param SessionFolder [in] session folder.
+	 * @param Table [out] unprojection table.
+	 * @return false if the session has neither table nor intrinsics.
+	 */
+	static bool GetSessionUnprojectionTable(const char * SessionFolder, DepthFrameToCameraSpaceTable& Table);
+
+	/** @brief Intrinsics of this model.
+	 */
+	const DepthCameraIntrinsics& GetIntrinsics() const
+	{
+		return Intrinsics;
+	}
+
+	/** @brief Undistorted (X/Z, Y/Z) of each depth pixel, compatible with DepthToPointCloud.
+	 */
+	const DepthFrameToCameraSpaceTable& GetUnprojectionTable() const
+	{
+		return UnprojectionTable;
+	}
+
+	/** @brief Undistort a pixel position (iterative inversion of the distortion).
+	 *
+	 * @param u [in] column.
+	 * @param v [in] row.
+	 * @param x [out] X/Z.
+	 * @param y [out] Y/Z.
+	 */
+	void UndistortPixel(float u, float v, float& x, float& y) const;
+
+	/** @brief Pixel position of a normalized point (X/Z, Y/Z).
+	 */
+	void DistortPoint(float x, float y, float& u, float& v) const;
+
+	/** @brief Project camera space points to depth image.
+	 *
+	 * @param Points [in] camera space points (meters).
+	 * @param NbPoints [in] number of points.
+	 * @param Pixels [out] depth image positions, (-1,-1) if Z <= 0.
+	 * @return number of points in front of the camera.
+	 */
+	int ProjectPoints(const CameraSpacePoint * Points, int NbPoints, PixelPosition * Pixels) const;
+
+	/** @brief Unproject depth pixels. Interpolate the precomputed map inside the image, invert distortion outside.
+	 *
+	 * @param Pixels [in] depth image positions.
+	 * @param Depths [in] depth of each pixel in meters.
+	 * @param NbPoints [in] number of points.
+	 * @param Points [out] camera space points.
+	 */
+	void UnprojectPixels(const PixelPosition * Pixels, const float * Depths, int NbPoints, CameraSpacePoint * Points) const;
+
+	/** @brief Project all joints of a body in the depth image (as JointsInDepthSpace does with the SDK).
+	 *
+	 * @param Body [in] body.
+	 * @param JointsInDepth [out] JointType_Count positions.
+	 * @return number of joints in front of the camera.
+	 */
+	int ProjectJoints(const KinectBody& Body, PixelPosition * JointsInDepth) const;
+
+protected:
+	/** @brief Normalized position (X/Z, Y/Z) of a pixel using the precomputed map (bilinear interpolation).
+	 */
+	bool InterpolateMap(float u, float v, float& x, float& y) const;
+
+	DepthCameraIntrinsics Intrinsics;						/*!< @brief Intrinsics of the model. */
+	DepthFrameToCameraSpaceTable UnprojectionTable;			/*!< @brief Undistortion map of depth pixels. */
+};
+
+}} // namespace MobileRGBD::Kinect2
+
+#endif // KINECT_2
+
+#endif // __DEPTH_CAMERA_MODEL_H__
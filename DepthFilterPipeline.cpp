@@ -0,0 +1,485 @@
+/**
+ * @file DepthFilterPipeline.cpp
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#include "DepthFilterPipeline.h"
+
+#ifdef KINECT_2
+
+#include "TimestampFileReader.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+
+using namespace MobileRGBD::Kinect2;
+
+namespace {
+
+static inline unsigned short AbsDiff(unsigned short a, unsigned short b)
+{
+	return a > b ? a - b : b - a;
+}
+
+static inline unsigned short Max3(unsigned short a, unsigned short b, unsigned short c)
+{
+	unsigned short m = a > b ? a : b;
+	return m > c ? m : c;
+}
+
+/** @brief Is pixel p far from both neighbours on its row (l, r) or on its column (u, d)? 0 means no neighbour.
+ */
+static inline bool IsFlyingPixel(unsigned short p, unsigned short l, unsigned short r, unsigned short u, unsigned short d, unsigned short Threshold)
+{
+	if ( p == 0 )
+	{
+		return false;
+	}
+	bool OnRow = l != 0 && r != 0 && AbsDiff(p, l) > Threshold && AbsDiff(p, r) > Threshold;
+	bool OnColumn = u != 0 && d != 0 && AbsDiff(p, u) > Threshold && AbsDiff(p, d) > Threshold;
+	return OnRow || OnColumn;
+}
+
+/** @brief Edge preserving recursive step: move Current toward Previous if both are valid and close.
+ */
+static inline float SpatialStep(float Current, float Previous, float Alpha, float Delta)
+{
+	if ( Current > 0.0f && Previous > 0.0f && fabsf(Current - Previous) < Delta )
+	{
+		return Previous + Alpha*(Current - Previous);
+	}
+	return Current;
+}
+
+#ifdef KINECT_SSE2
+
+// SSE2 has no unsigned 16 bits max/compare, use saturated arithmetics
+
+static inline __m128i MaxU16(__m128i a, __m128i b)
+{
+	return _mm_adds_epu16( _mm_subs_epu16(a, b), b );
+}
+
+static inline __m128i AbsDiffU16(__m128i a, __m128i b)
+{
+	return _mm_or_si128( _mm_subs_epu16(a, b), _mm_subs_epu16(b, a) );
+}
+
+static inline __m128i IsZeroU16(__m128i a)
+{
+	return _mm_cmpeq_epi16( a, _mm_setzero_si128() );
+}
+
+// 0xFFFF where a > b
+static inline __m128i GreaterU16(__m128i a, __m128i b)
+{
+	return _mm_andnot_si128( IsZeroU16(_mm_subs_epu16(a, b)), _mm_set1_epi16(-1) );
+}
+
+static inline __m128 SelectPs(__m128 Mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps( _mm_and_ps(Mask, a), _mm_andnot_ps(Mask, b) );
+}
+
+// Load 8 depth values as 2x4 floats
+static inline void LoadU16AsFloat(const unsigned short * In, __m128& Low, __m128& High)
+{
+	__m128i Values = _mm_loadu_si128( (const __m128i*)In );
+	Low = _mm_cvtepi32_ps( _mm_unpacklo_epi16(Values, _mm_setzero_si128()) );
+	High = _mm_cvtepi32_ps( _mm_unpackhi_epi16(Values, _mm_setzero_si128()) );
+}
+
+// Store 2x4 positive floats as 8 rounded depth values (unsigned pack through a signed one)
+static inline void StoreFloatAsU16(__m128 Low, __m128 High, unsigned short * Out)
+{
+	const __m128 Half = _mm_set1_ps(0.5f);
+	const __m128i Bias32 = _mm_set1_epi32(32768);
+	const __m128i Bias16 = _mm_set1_epi16(-32768);
+	__m128i l = _mm_sub_epi32( _mm_cvttps_epi32(_mm_add_ps(Low, Half)), Bias32 );
+	__m128i h = _mm_sub_epi32( _mm_cvttps_epi32(_mm_add_ps(High, Half)), Bias32 );
+	_mm_storeu_si128( (__m128i*)Out, _mm_xor_si128(_mm_packs_epi32(l, h), Bias16) );
+}
+
+#endif // KINECT_SSE2
+
+} // namespace
+
+DepthFilterPipeline::DepthFilterPipeline(const DepthFilterConfiguration& _Configuration /* = DepthFilterConfiguration() */) :
+	Configuration(_Configuration),
+	WorkA(NumberOfPixels), WorkB(NumberOfPixels), RowMax(NumberOfPixels),
+	SpatialBuffer(NumberOfPixels), TemporalState(NumberOfPixels), TemporalAge(NumberOfPixels)
+{
+	Reset();
+}
+
+void DepthFilterPipeline::SetConfiguration(const DepthFilterConfiguration& _Configuration)
+{
+	Configuration = _Configuration;
+	Reset();
+}
+
+void DepthFilterPipeline::Reset()
+{
+	memset( &TemporalState[0], 0, NumberOfPixels*sizeof(float) );
+	memset( &TemporalAge[0], 0, NumberOfPixels*sizeof(float) );
+}
+
+void DepthFilterPipeline::Filter(const unsigned short * Depth, unsigned short * FilteredDepth)
+{
+	if ( Depth == nullptr || FilteredDepth == nullptr )
+	{
+		return;
+	}
+
+	unsigned short * Current = &WorkA[0];
+	unsigned short * Next = &WorkB[0];
+	unsigned short * Swap;
+
+	CheckRange( Depth, Current );
+
+	if ( Configuration.FlyingPixelRemoval == true )
+	{
+		RemoveFlyingPixels( Current, Next );
+		Swap = Current; Current = Next; Next = Swap;
+	}
+
+	if ( Configuration.SpatialFilter == true )
+	{
+		SpatialFilter( Current );
+	}
+
+	if ( Configuration.TemporalFilter == true )
+	{
+		TemporalFilter( Current, Next );
+		Swap = Current; Current = Next; Next = Swap;
+	}
+
+	if ( Configuration.HoleFilling == true )
+	{
+		for( int Iteration = 0; Iteration < Configuration.HoleFillingIterations; Iteration++ )
+		{
+			FillHoles( Current, Next );
+			Swap = Current; Current = Next; Next = Swap;
+		}
+	}
+
+	memcpy( FilteredDepth, Current, NumberOfPixels*sizeof(unsigned short) );
+}
+
+void DepthFilterPipeline::CheckRange(const unsigned short * In, unsigned short * Out) const
+{
+	int i = 0;
+#ifdef KINECT_SSE2
+	const __m128i Min = _mm_set1_epi16( (short)Configuration.MinDepth );
+	const __m128i Max = _mm_set1_epi16( (short)Configuration.MaxDepth );
+	for( ; i + 8 <= NumberOfPixels; i += 8 )
+	{
+		__m128i d = _mm_loadu_si128( (const __m128i*)&In[i] );
+		__m128i Keep = _mm_and_si128( IsZeroU16(_mm_subs_epu16(Min, d)), IsZeroU16(_mm_subs_epu16(d, Max)) );
+		_mm_storeu_si128( (__m128i*)&Out[i], _mm_and_si128(d, Keep) );
+	}
+#endif
+	for( ; i < NumberOfPixels; i++ )
+	{
+		Out[i] = (In[i] >= Configuration.MinDepth && In[i] <= Configuration.MaxDepth) ? In[i] : 0;
+	}
+}
+
+void DepthFilterPipeline::RemoveFlyingPixels(const unsigned short * In, unsigned short * Out) const
+{
+	const unsigned short Threshold = Configuration.FlyingPixelThreshold;
+
+	for( int y = 0; y < DepthHeight; y++ )
+	{
+		const unsigned short * Row = &In[y*DepthWidth];
+		const unsigned short * Up = y > 0 ? Row - DepthWidth : nullptr;
+		const unsigned short * Down = y < DepthHeight-1 ? Row + DepthWidth : nullptr;
+		unsigned short * OutRow = &Out[y*DepthWidth];
+
+		int x = 0;
+#ifdef KINECT_SSE2
+		if ( Up != nullptr && Down != nullptr )
+		{
+			// Pixel 0 has no left neighbour, test it alone. The SIMD loop reads Row[x+8], so the last pixels
+			// of the row are left to the scalar code below
+			OutRow[0] = IsFlyingPixel( Row[0], 0, Row[1], Up[0], Down[0], Threshold ) ? 0 : Row[0];
+
+			const __m128i T = _mm_set1_epi16( (short)Threshold );
+			for( x = 1; x + 8 < DepthWidth; x += 8 )
+			{
+				__m128i p = _mm_loadu_si128( (const __m128i*)&Row[x] );
+				__m128i l = _mm_loadu_si128( (const __m128i*)&Row[x-1] );
+				__m128i r = _mm_loadu_si128( (const __m128i*)&Row[x+1] );
+				__m128i u = _mm_loadu_si128( (const __m128i*)&Up[x] );
+				__m128i d = _mm_loadu_si128( (const __m128i*)&Down[x] );
+
+				__m128i OnRow = _mm_andnot_si128( _mm_or_si128(IsZeroU16(l), IsZeroU16(r)),
+					_mm_and_si128(GreaterU16(AbsDiffU16(p, l), T), GreaterU16(AbsDiffU16(p, r), T)) );
+				__m128i OnColumn = _mm_andnot_si128( _mm_or_si128(IsZeroU16(u), IsZeroU16(d)),
+					_mm_and_si128(GreaterU16(AbsDiffU16(p, u), T), GreaterU16(AbsDiffU16(p, d), T)) );
+
+				_mm_storeu_si128( (__m128i*)&OutRow[x], _mm_andnot_si128(_mm_or_si128(OnRow, OnColumn), p) );
+			}
+		}
+#endif
+		for( ; x < DepthWidth; x++ )
+		{
+			unsigned short l = x > 0 ? Row[x-1] : 0;
+			unsigned short r = x < DepthWidth-1 ? Row[x+1] : 0;
+			unsigned short u = Up != nullptr ? Up[x] : 0;
+			unsigned short d = Down != nullptr ? Down[x] : 0;
+			OutRow[x] = IsFlyingPixel( Row[x], l, r, u, d, Threshold ) ? 0 : Row[x];
+		}
+	}
+}
+
+void DepthFilterPipeline::SpatialFilter(unsigned short * InOut)
+{
+	const float Alpha = Configuration.SpatialAlpha;
+	const float Delta = (float)Configuration.SpatialDelta;
+	float * Image = &SpatialBuffer[0];
+
+	int i = 0;
+#ifdef KINECT_SSE2
+	for( ; i + 8 <= NumberOfPixels; i += 8 )
+	{
+		__m128 Low, High;
+		LoadU16AsFloat( &InOut[i], Low, High );
+		_mm_storeu_ps( &Image[i], Low );
+		_mm_storeu_ps( &Image[i+4], High );
+	}
+#endif
+	for( ; i < NumberOfPixels; i++ )
+	{
+		Image[i] = (float)InOut[i];
+	}
+
+	for( int Iteration = 0; Iteration < Configuration.SpatialIterations; Iteration++ )
+	{
+		// Rows: dependency along x, scalar
+		for( int y = 0; y < DepthHeight; y++ )
+		{
+			float * Row = &Image[y*DepthWidth];
+			for( int x = 1; x < DepthWidth; x++ )
+			{
+				Row[x] = SpatialStep( Row[x], Row[x-1], Alpha, Delta );
+			}
+			for( int x = DepthWidth-2; x >= 0; x-- )
+			{
+				Row[x] = SpatialStep( Row[x], Row[x+1], Alpha, Delta );
+			}
+		}
+
+		// Columns: dependency along y, vectorized on x
+		for( int Pass = 0; Pass < 2; Pass++ )
+		{
+			int FirstRow = Pass == 0 ? 1 : DepthHeight-2;
+			int Step = Pass == 0 ? 1 : -1;
+			for( int y = FirstRow; y >= 0 && y < DepthHeight; y += Step )
+			{
+				float * Row = &Image[y*DepthWidth];
+				const float * Previous = Row - Step*DepthWidth;
+
+				int x = 0;
+#ifdef KINECT_SSE2
+				const __m128 a = _mm_set1_ps( Alpha );
+				const __m128 dt = _mm_set1_ps( Delta );
+				const __m128 Zero = _mm_setzero_ps();
+				const __m128 SignMask = _mm_set1_ps( -0.0f );
+				for( ; x + 4 <= DepthWidth; x += 4 )
+				{
+					__m128 c = _mm_loadu_ps( &Row[x] );
+					__m128 p = _mm_loadu_ps( &Previous[x] );
+					__m128 Diff = _mm_sub_ps( c, p );
+					__m128 Mix = _mm_and_ps( _mm_and_ps(_mm_cmpgt_ps(c, Zero), _mm_cmpgt_ps(p, Zero)),
+						_mm_cmplt_ps(_mm_andnot_ps(SignMask, Diff), dt) );
+					_mm_storeu_ps( &Row[x], SelectPs(Mix, _mm_add_ps(p, _mm_mul_ps(a, Diff)), c) );
+				}
+#endif
+				for( ; x < DepthWidth; x++ )
+				{
+					Row[x] = SpatialStep( Row[x], Previous[x], Alpha, Delta );
+				}
+			}
+		}
+	}
+
+	i = 0;
+#ifdef KINECT_SSE2
+	for( ; i + 8 <= NumberOfPixels; i += 8 )
+	{
+		StoreFloatAsU16( _mm_loadu_ps(&Image[i]), _mm_loadu_ps(&Image[i+4]), &InOut[i] );
+	}
+#endif
+	for( ; i < NumberOfPixels; i++ )
+	{
+		InOut[i] = (unsigned short)(Image[i] + 0.5f);
+	}
+}
+
+void DepthFilterPipeline::TemporalFilter(const unsigned short * In, unsigned short * Out)
+{
+	const float Alpha = Configuration.TemporalAlpha;
+	const float Delta = (float)Configuration.TemporalDelta;
+	const float Persistence = (float)Configuration.TemporalPersistence;
+	float * State = &TemporalState[0];
+	float * Age = &TemporalAge[0];
+
+	int i = 0;
+#ifdef KINECT_SSE2
+	const __m128 a = _mm_set1_ps( Alpha );
+	const __m128 dt = _mm_set1_ps( Delta );
+	const __m128 MaxAge = _mm_set1_ps( Persistence );
+	const __m128 One = _mm_set1_ps( 1.0f );
+	const __m128 Zero = _mm_setzero_ps();
+	const __m128 SignMask = _mm_set1_ps( -0.0f );
+	for( ; i + 8 <= NumberOfPixels; i += 8 )
+	{
+		__m128 Depths[2];
+		__m128 NewStates[2];
+		LoadU16AsFloat( &In[i], Depths[0], Depths[1] );
+		for( int k = 0; k < 2; k++ )
+		{
+			__m128 d = Depths[k];
+			__m128 s = _mm_loadu_ps( &State[i+4*k] );
+			__m128 Diff = _mm_sub_ps( d, s );
+
+			// Valid pixel: average if close to state, restart from current value otherwise
+			__m128 Average = _mm_and_ps( _mm_cmpgt_ps(s, Zero), _mm_cmple_ps(_mm_andnot_ps(SignMask, Diff), dt) );
+			__m128 Updated = SelectPs( Average, _mm_add_ps(s, _mm_mul_ps(a, Diff)), d );
+
+			// Missing pixel: keep state until it is too old
+			__m128 Valid = _mm_cmpgt_ps( d, Zero );
+			__m128 NewAge = _mm_andnot_ps( Valid, _mm_min_ps(_mm_add_ps(_mm_loadu_ps(&Age[i+4*k]), One), _mm_add_ps(MaxAge, One)) );
+			__m128 Kept = _mm_andnot_ps( _mm_cmpgt_ps(NewAge, MaxAge), s );
+
+			NewStates[k] = SelectPs( Valid, Updated, Kept );
+			_mm_storeu_ps( &State[i+4*k], NewStates[k] );
+			_mm_storeu_ps( &Age[i+4*k], NewAge );
+		}
+		StoreFloatAsU16( NewStates[0], NewStates[1], &Out[i] );
+	}
+#endif
+	for( ; i < NumberOfPixels; i++ )
+	{
+		float d = (float)In[i];
+		float s = State[i];
+		if ( d > 0.0f )
+		{
+			s = (s > 0.0f && fabsf(d - s) <= Delta) ? s + Alpha*(d - s) : d;
+			Age[i] = 0.0f;
+		}
+		else
+		{
+			Age[i] = Age[i] + 1.0f < Persistence + 1.0f ? Age[i] + 1.0f : Persistence + 1.0f;
+			if ( Age[i] > Persistence )
+			{
+				s = 0.0f;
+			}
+		}
+		State[i] = s;
+		Out[i] = (unsigned short)(s + 0.5f);
+	}
+}
+
+void DepthFilterPipeline::FillHoles(const unsigned short * In, unsigned short * Out)
+{
+	unsigned short * Max = &RowMax[0];
+
+	// Max on 3 pixels of each row (missing pixels are 0 and never win)
+	for( int y = 0; y < DepthHeight; y++ )
+	{
+		const unsigned short * Row = &In[y*DepthWidth];
+		unsigned short * MaxRow = &Max[y*DepthWidth];
+
+		MaxRow[0] = Row[0] > Row[1] ? Row[0] : Row[1];
+		int x = 1;
+#ifdef KINECT_SSE2
+		for( ; x + 8 < DepthWidth; x += 8 )
+		{
+			__m128i m = MaxU16( _mm_loadu_si128((const __m128i*)&Row[x-1]), _mm_loadu_si128((const __m128i*)&Row[x]) );
+			_mm_storeu_si128( (__m128i*)&MaxRow[x], MaxU16(m, _mm_loadu_si128((const __m128i*)&Row[x+1])) );
+		}
+#endif
+		for( ; x < DepthWidth-1; x++ )
+		{
+			MaxRow[x] = Max3( Row[x-1], Row[x], Row[x+1] );
+		}
+		MaxRow[DepthWidth-1] = Row[DepthWidth-2] > Row[DepthWidth-1] ? Row[DepthWidth-2] : Row[DepthWidth-1];
+	}
+
+	// Missing pixels get the max of the 3x3 neighbourhood, i.e. the farthest one (background)
+	for( int y = 0; y < DepthHeight; y++ )
+	{
+		const unsigned short * Row = &In[y*DepthWidth];
+		const unsigned short * MaxRow = &Max[y*DepthWidth];
+		const unsigned short * MaxUp = y > 0 ? MaxRow - DepthWidth : MaxRow;
+		const unsigned short * MaxDown = y < DepthHeight-1 ? MaxRow + DepthWidth : MaxRow;
+		unsigned short * OutRow = &Out[y*DepthWidth];
+
+		int x = 0;
+#ifdef KINECT_SSE2
+		for( ; x + 8 <= DepthWidth; x += 8 )
+		{
+			__m128i p = _mm_loadu_si128( (const __m128i*)&Row[x] );
+			__m128i m = MaxU16( MaxU16(_mm_loadu_si128((const __m128i*)&MaxUp[x]), _mm_loadu_si128((const __m128i*)&MaxRow[x])),
+				_mm_loadu_si128((const __m128i*)&MaxDown[x]) );
+			__m128i Missing = IsZeroU16( p );
+			_mm_storeu_si128( (__m128i*)&OutRow[x], _mm_or_si128(p, _mm_and_si128(Missing, m)) );
+		}
+#endif
+		for( ; x < DepthWidth; x++ )
+		{
+			OutRow[x] = Row[x] != 0 ? Row[x] : Max3( MaxUp[x], MaxRow[x], MaxDown[x] );
+		}
+	}
+}
+
+int DepthFilterPipeline::FilterRawFile(const char * InputFileName, const char * OutputFileName)
+{
+	FILE * fIn = fopen( InputFileName, "rb" );
+	if ( fIn == (FILE*)nullptr )
+	{
+		fprintf( stderr, "Could not open '%s' depth file\n", InputFileName );
+		return -1;
+	}
+
+	FILE * fOut = fopen( OutputFileName, "wb" );
+	if ( fOut == (FILE*)nullptr )
+	{
+		fprintf( stderr, "Could not create '%s' depth file\n", OutputFileName );
+		fclose(fIn);
+		return -1;
+	}
+
+	Reset();
+
+	std::vector<unsigned short> Frame( NumberOfPixels );
+	int NbFrames = 0;
+	while( fread( &Frame[0], sizeof(unsigned short), NumberOfPixels, fIn ) == (size_t)NumberOfPixels )
+	{
+		Filter( &Frame[0], &Frame[0] );
+		if ( fwrite( &Frame[0], sizeof(unsigned short), NumberOfPixels, fOut ) != (size_t)NumberOfPixels )
+		{
+			fprintf( stderr, "Could not write '%s' depth file\n", OutputFileName );
+			NbFrames = -1;
+			break;
+		}
+		NbFrames++;
+	}
+
+	fclose(fIn);
+	fclose(fOut);
+
+	return NbFrames;
+}
+
+int DepthFilterPipeline::FilterSessionDepth(const char * SessionFolder, const char * OutputFileName)
+{
+	return FilterRawFile( TimestampFileReader::GetStreamFileName( SessionFolder, "depth", "raw" ).c_str(), OutputFileName );
+}
+
+#endif // KINECT_2
@@ -0,0 +1,158 @@
+/**
+ * @file DepthFilterPipeline.h
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#ifndef __DEPTH_FILTER_PIPELINE_H__
+#define __DEPTH_FILTER_PIPELINE_H__
+
+#ifdef KINECT_2
+
+#include "KinectBasics.h"
+
+#include <vector>
+
+namespace MobileRGBD { namespace Kinect2 {
+
+/**
+ * @class DepthFilterConfiguration DepthFilterPipeline.cpp DepthFilterPipeline.h
+ * @brief Stages and parameters of a DepthFilterPipeline. Depths are in mm.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class DepthFilterConfiguration
+{
+public:
+	/** @brief constructor. All stages active with values suited to Kinect v2 depth at 30 fps.
+	 */
+	DepthFilterConfiguration()
+	{
+		MinDepth = 500;
+		MaxDepth = 8000;
+
+		FlyingPixelRemoval = true;
+		FlyingPixelThreshold = 100;
+
+		SpatialFilter = true;
+		SpatialAlpha = 0.5f;
+		SpatialDelta = 50;
+		SpatialIterations = 2;
+
+		TemporalFilter = true;
+		TemporalAlpha = 0.4f;
+		TemporalDelta = 100;
+		TemporalPersistence = 3;
+
+		HoleFilling = true;
+		HoleFillingIterations = 2;
+	}
+
+	unsigned short MinDepth;				/*!< @brief Depth below is invalid (set to 0). */
+	unsigned short MaxDepth;				/*!< @brief Depth above is invalid (set to 0). */
+
+	bool FlyingPixelRemoval;				/*!< @brief Remove pixels far from both neighbours on a row or a column. */
+	unsigned short FlyingPixelThreshold;	/*!< @brief Distance to neighbours of a flying pixel. */
+
+	bool SpatialFilter;						/*!< @brief Edge preserving recursive filter (both directions on rows then on columns). */
+	float SpatialAlpha;						/*!< @brief Weight of the current pixel in [0;1], lower is smoother. */
+	unsigned short SpatialDelta;			/*!< @brief Neighbours farther than this are an edge and are not mixed. */
+	int SpatialIterations;					/*!< @brief Number of passes. */
+
+	bool TemporalFilter;					/*!< @brief Per pixel exponential moving average. */
+	float TemporalAlpha;					/*!< @brief Weight of the current frame in [0;1], lower is smoother. */
+	unsigned short TemporalDelta;			/*!< @brief Larger changes are motion, the pixel restarts from the new value. */
+	int TemporalPersistence;				/*!< @brief Number of frames a pixel keeps its last value when depth is missing. */
+
+	bool HoleFilling;						/*!< @brief Fill missing pixels with the farthest valid neighbour (background). */
+	int HoleFillingIterations;				/*!< @brief Number of 3x3 passes, i.e. max hole half-size filled. */
+};
+
+/**
+ * @class DepthFilterPipeline DepthFilterPipeline.cpp DepthFilterPipeline.h
+ * @brief Streaming filter for Kinect v2 depth frames (DepthWidth*DepthHeight, 16 bits in mm as in depth.raw).
+ * Stages, in order and each one enabled by the DepthFilterConfiguration: range check, flying pixel removal,
+ * edge preserving spatial filter, temporal filter and hole filling. Stages use SSE2 when available
+ * (define KINECT_NO_SSE2 to disable). All buffers are allocated once in the constructor.
+ * The temporal stage keeps state between frames: frames must be given in order, call Reset when the
+ * sequence changes. One pipeline is used by one thread.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class DepthFilterPipeline
+{
+public:
+	enum { NumberOfPixels = DepthWidth*DepthHeight };
+
+	/** @brief constructor.
+	 *
+	 * @param Configuration [in] stages and parameters.
+	 */
+	DepthFilterPipeline(const DepthFilterConfiguration& Configuration = DepthFilterConfiguration());
+
+	/** @brief Virtual destructor, always.
+	 */
+	virtual ~DepthFilterPipeline() {}
+
+	/** @brief Change configuration and reset temporal state.
+	 */
+	void SetConfiguration(const DepthFilterConfiguration& Configuration);
+
+	/** @brief Current configuration.
+	 */
+	const DepthFilterConfiguration& GetConfiguration() const
+	{
+		return Configuration;
+	}
+
+	/** @brief Forget previous frames (temporal state).
+	 */
+	void Reset();
+
+	/** @brief Filter a depth frame.
+	 *
+	 * @param Depth [in] depth frame (NumberOfPixels values in mm).
+	 * @param FilteredDepth [out] filtered frame (NumberOfPixels values), can be Depth itself.
+	 */
+	void Filter(const unsigned short * Depth, unsigned short * FilteredDepth);
+
+	/** @brief Filter a whole depth file (as depth.raw), frame by frame after a Reset.
+	 *
+	 * @param InputFileName [in] raw depth file.
+	 * @param OutputFileName [in] filtered raw depth file to create.
+	 * @return number of filtered frames, -1 if files cannot be opened.
+	 */
+	int FilterRawFile(const char * InputFileName, const char * OutputFileName);
+
+	/** @brief Filter depth of a recorded session ("SessionFolder/depth/depth.raw").
+	 *
+	 * @param SessionFolder [in] session folder.
+	 * @param OutputFileName [in] filtered raw depth file to create.
+	 * @return number of filtered frames, -1 if files cannot be opened.
+	 */
+	int FilterSessionDepth(const char * SessionFolder, const char * OutputFileName);
+
+protected:
+	/** @brief Stages. Input and output are different buffers, FillHoles is one 3x3 pass.
+	 */
+	void CheckRange(const unsigned short * In, unsigned short * Out) const;
+	void RemoveFlyingPixels(const unsigned short * In, unsigned short * Out) const;
+	void SpatialFilter(unsigned short * InOut);
+	void TemporalFilter(const unsigned short * In, unsigned short * Out);
+	void FillHoles(const unsigned short * In, unsigned short * Out);
+
+	DepthFilterConfiguration Configuration;		/*!< @brief Stages and parameters. */
+	std::vector<unsigned short> WorkA;			/*!< @brief Ping-pong buffer between stages. */
+	std::vector<unsigned short> WorkB;			/*!< @brief Ping-pong buffer between stages. */
+	std::vector<unsigned short> RowMax;			/*!< @brief Horizontal 3 pixels max for hole filling. */
+	std::vector<float> SpatialBuffer;			/*!< @brief Float image for spatial filter. */
+	std::vector<float> TemporalState;			/*!< @brief Filtered depth of each pixel, 0 if none. */
+	std::vector<float> TemporalAge;				/*!< @brief Frames since last valid depth of each pixel. */
+};
+
+}} // namespace MobileRGBD::Kinect2
+
+#endif // KINECT_2
+
+#endif // __DEPTH_FILTER_PIPELINE_H__
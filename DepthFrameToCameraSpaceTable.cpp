@@ -0,0 +1,89 @@
+/**
+ * @file DepthFrameToCameraSpaceTable.cpp
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#include "DepthFrameToCameraSpaceTable.h"
+
+#ifdef KINECT_2
+
+#include "TimestampFileReader.h"
+
+#include <cstdio>
+#include <cstring>
+
+using namespace MobileRGBD::Kinect2;
+
+bool DepthFrameToCameraSpaceTable::Set(const PointF * Entries, unsigned int NbEntries)
+{
+	if ( Entries == nullptr || NbEntries != (unsigned int)NumberOfEntries )
+	{
+		Table.clear();
+		return false;
+	}
+
+	Table.resize( NumberOfEntries );
+	memcpy( &Table[0], Entries, NumberOfEntries*sizeof(PointF) );
+	return true;
+}
+
+bool DepthFrameToCameraSpaceTable::Save(const char * FileName) const
+{
+	if ( IsValid() == false )
+	{
+		return false;
+	}
+
+	FILE * f = fopen( FileName, "wb" );
+	if ( f == (FILE*)nullptr )
+	{
+		fprintf( stderr, "Could not create '%s' table file\n", FileName );
+		return false;
+	}
+
+	bool Res = fwrite( &Table[0], sizeof(PointF), Table.size(), f ) == Table.size();
+	fclose(f);
+
+	return Res;
+}
+
+bool DepthFrameToCameraSpaceTable::SaveInSession(const char * SessionFolder) const
+{
+	return Save( TimestampFileReader::GetStreamFileName( SessionFolder, "depth", "table" ).c_str() );
+}
+
+bool DepthFrameToCameraSpaceTable::Load(const char * FileName)
+{
+	Table.clear();
+
+	if ( TimestampFileReader::GetFileSize( FileName ) != (long long int)(NumberOfEntries*sizeof(PointF)) )
+	{
+		return false;
+	}
+
+	FILE * f = fopen( FileName, "rb" );
+	if ( f == (FILE*)nullptr )
+	{
+		return false;
+	}
+
+	Table.resize( NumberOfEntries );
+	bool Res = fread( &Table[0], sizeof(PointF), Table.size(), f ) == Table.size();
+	fclose(f);
+
+	if ( Res == false )
+	{
+		Table.clear();
+	}
+
+	return Res;
+}
+
+bool DepthFrameToCameraSpaceTable::LoadFromSession(const char * SessionFolder)
+{
+	return Load( TimestampFileReader::GetStreamFileName( SessionFolder, "depth", "table" ).c_str() );
+}
+
+#endif // KINECT_2
@@ -0,0 +1,92 @@
+/**
+ * @file DepthFrameToCameraSpaceTable.h
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#ifndef __DEPTH_FRAME_TO_CAMERA_SPACE_TABLE_H__
+#define __DEPTH_FRAME_TO_CAMERA_SPACE_TABLE_H__
+
+#ifdef KINECT_2
+
+#include "KinectBasics.h"
+
+#include <vector>
+
+namespace MobileRGBD { namespace Kinect2 {
+
+/**
+ * @class DepthFrameToCameraSpaceTable DepthFrameToCameraSpaceTable.cpp DepthFrameToCameraSpaceTable.h
+ * @brief Copy of the SDK DepthFrameToCameraSpace lookup table: for each depth pixel, X and Y of the point
+ * in camera space at 1 meter. It is saved in each session as "depth/depth.table" (raw PointF array,
+ * DepthWidth*DepthHeight entries, row order) so depth frames can be unprojected exactly offline.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class DepthFrameToCameraSpaceTable
+{
+public:
+	enum { NumberOfEntries = DepthWidth*DepthHeight };
+
+	/** @brief constructor.
+	 */
+	DepthFrameToCameraSpaceTable() {}
+
+	/** @brief Virtual destructor, always.
+	 */
+	virtual ~DepthFrameToCameraSpaceTable() {}
+
+	/** @brief Set table content.
+	 *
+	 * @param Entries [in] table entries.
+	 * @param NbEntries [in] number of entries (must be NumberOfEntries).
+	 * @return false if the number of entries is wrong.
+	 */
+	bool Set(const PointF * Entries, unsigned int NbEntries);
+
+	/** @brief Is the table filled?
+	 */
+	bool IsValid() const
+	{
+		return Table.size() == (size_t)NumberOfEntries;
+	}
+
+	/** @brief Get table entries (nullptr if not valid).
+	 */
+	const PointF * GetTable() const
+	{
+		return IsValid() ? &Table[0] : (const PointF*)nullptr;
+	}
+
+	/** @brief Save table in a file.
+	 *
+	 * @param FileName [in] output file name.
+	 * @return true if saved.
+	 */
+	bool Save(const char * FileName) const;
+
+	/** @brief Save table in a session folder ("SessionFolder/depth/depth.table").
+	 */
+	bool SaveInSession(const char * SessionFolder) const;
+
+	/** @brief Load table from a file.
+	 *
+	 * @param FileName [in] input file name.
+	 * @return true if loaded with the right size.
+	 */
+	bool Load(const char * FileName);
+
+	/** @brief Load table from a session folder ("SessionFolder/depth/depth.table").
+	 */
+	bool LoadFromSession(const char * SessionFolder);
+
+protected:
+	std::vector<PointF> Table;		/*!< @brief Table entries. */
+};
+
+}} // namespace MobileRGBD::Kinect2
+
+#endif // KINECT_2
+
+#endif // __DEPTH_FRAME_TO_CAMERA_SPACE_TABLE_H__
@@ -0,0 +1,241 @@
+/**
+ * @file DepthNormalEstimator.cpp
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#include "DepthNormalEstimator.h"
+
+#ifdef KINECT_2
+
+#include "KinectWorkerPool.h"
+
+#include <math.h>
+#include <atomic>
+
+using namespace MobileRGBD::Kinect2;
+
+namespace {
+
+#ifdef KINECT_SSE2
+
+// 4 depth values in meters
+static inline __m128 LoadDepth4(const unsigned short * Depth)
+{
+	__m128i Values = _mm_unpacklo_epi16( _mm_loadl_epi64((const __m128i*)Depth), _mm_setzero_si128() );
+	return _mm_mul_ps( _mm_cvtepi32_ps(Values), _mm_set1_ps(0.001f) );
+}
+
+// All lanes where Neighbour is valid and not behind a discontinuity
+static inline __m128 IsContinuous(__m128 Center, __m128 Neighbour, __m128 MaxChange)
+{
+	const __m128 SignMask = _mm_set1_ps( -0.0f );
+	__m128 Change = _mm_andnot_ps( SignMask, _mm_sub_ps(Neighbour, Center) );
+	return _mm_and_ps( _mm_cmpgt_ps(Neighbour, _mm_setzero_ps()), _mm_cmple_ps(Change, _mm_mul_ps(MaxChange, Center)) );
+}
+
+#endif // KINECT_SSE2
+
+} // namespace
+
+DepthNormalEstimator::DepthNormalEstimator(const DepthFrameToCameraSpaceTable& Table, int _Step /* = 2 */, float _MaxRelativeDepthChange /* = 0.05f */) :
+	Step(_Step < 1 ? 1 : (_Step > 8 ? 8 : _Step)), MaxRelativeDepthChange(_MaxRelativeDepthChange),
+	NormalX(NumberOfPixels), NormalY(NumberOfPixels), NormalZ(NumberOfPixels), Curvature(NumberOfPixels), Valid(NumberOfPixels)
+{
+	const PointF * Entries = Table.GetTable();
+	if ( Entries == nullptr )
+	{
+		return;
+	}
+
+	// Split table in 2 planes for SSE loads
+	TableX.resize( NumberOfPixels );
+	TableY.resize( NumberOfPixels );
+	for( int i = 0; i < NumberOfPixels; i++ )
+	{
+		TableX[i] = Entries[i].X;
+		TableY[i] = Entries[i].Y;
+	}
+}
+
+int DepthNormalEstimator::Compute(const unsigned short * Depth, KinectWorkerPool * Pool /* = nullptr */)
+{
+	if ( Depth == nullptr || IsValid() == false )
+	{
+		return 0;
+	}
+
+	if ( Pool == nullptr )
+	{
+		return ComputeRows( Depth, 0, DepthHeight );
+	}
+
+	std::atomic<int> NbValid(0);
+	Pool->ParallelFor( DepthHeight, [&](int FirstRow, int LastRow)
+	{
+		NbValid += ComputeRows( Depth, FirstRow, LastRow );
+	}, 16 );
+	return NbValid;
+}
+
+bool DepthNormalEstimator::ComputePixel(const unsigned short * Depth, int i)
+{
+	const int u = i % DepthWidth;
+	const int v = i / DepthWidth;
+	if ( u < Step || u >= DepthWidth-Step || v < Step || v >= DepthHeight-Step )
+	{
+		SetInvalid(i);
+		return false;
+	}
+
+	const int Neighbours[4] = { i - Step, i + Step, i - Step*DepthWidth, i + Step*DepthWidth };	// left, right, up, down
+	const float zc = (float)Depth[i]*0.001f;
+	if ( zc <= 0.0f )
+	{
+		SetInvalid(i);
+		return false;
+	}
+
+	float P[4][3];
+	for( int k = 0; k < 4; k++ )
+	{
+		const int n = Neighbours[k];
+		const float z = (float)Depth[n]*0.001f;
+		if ( z <= 0.0f || fabsf(z - zc) > MaxRelativeDepthChange*zc )
+		{
+			SetInvalid(i);
+			return false;
+		}
+		P[k][0] = TableX[n]*z;
+		P[k][1] = TableY[n]*z;
+		P[k][2] = z;
+	}
+
+	const float Pc[3] = { TableX[i]*zc, TableY[i]*zc, zc };
+	const float a[3] = { P[1][0]-P[0][0], P[1][1]-P[0][1], P[1][2]-P[0][2] };	// right - left
+	const float b[3] = { P[2][0]-P[3][0], P[2][1]-P[3][1], P[2][2]-P[3][2] };	// up - down
+
+	float nx = a[1]*b[2] - a[2]*b[1];
+	float ny = a[2]*b[0] - a[0]*b[2];
+	float nz = a[0]*b[1] - a[1]*b[0];
+	float Length = sqrtf( nx*nx + ny*ny + nz*nz );
+	if ( Length <= 0.0f )
+	{
+		SetInvalid(i);
+		return false;
+	}
+
+	// Toward the camera
+	if ( nx*Pc[0] + ny*Pc[1] + nz*Pc[2] > 0.0f )
+	{
+		Length = -Length;
+	}
+	nx /= Length; ny /= Length; nz /= Length;
+
+	const float Offset[3] = { Pc[0] - 0.25f*(P[0][0]+P[1][0]+P[2][0]+P[3][0]),
+		Pc[1] - 0.25f*(P[0][1]+P[1][1]+P[2][1]+P[3][1]),
+		Pc[2] - 0.25f*(P[0][2]+P[1][2]+P[2][2]+P[3][2]) };
+	const float Spacing = 0.25f*( sqrtf(a[0]*a[0]+a[1]*a[1]+a[2]*a[2]) + sqrtf(b[0]*b[0]+b[1]*b[1]+b[2]*b[2]) );
+
+	NormalX[i] = nx;
+	NormalY[i] = ny;
+	NormalZ[i] = nz;
+	Curvature[i] = fabsf( nx*Offset[0] + ny*Offset[1] + nz*Offset[2] )/Spacing;
+	Valid[i] = 1;
+	return true;
+}
+
+int DepthNormalEstimator::ComputeRows(const unsigned short * Depth, int FirstRow, int LastRow)
+{
+	int NbValid = 0;
+	for( int v = FirstRow; v < LastRow; v++ )
+	{
+		const int RowStart = v*DepthWidth;
+		if ( v < Step || v >= DepthHeight-Step )
+		{
+			for( int u = 0; u < DepthWidth; u++ )
+			{
+				SetInvalid( RowStart + u );
+			}
+			continue;
+		}
+
+		int u = 0;
+		for( ; u < Step; u++ )
+		{
+			SetInvalid( RowStart + u );
+		}
+
+#ifdef KINECT_SSE2
+		const __m128 MaxChange = _mm_set1_ps( MaxRelativeDepthChange );
+		const __m128 Zero = _mm_setzero_ps();
+		const __m128 Quarter = _mm_set1_ps( 0.25f );
+		const __m128 SignMask = _mm_set1_ps( -0.0f );
+		for( ; u + 4 <= DepthWidth-Step; u += 4 )
+		{
+			const int i = RowStart + u;
+			const int Neighbours[4] = { i - Step, i + Step, i - Step*DepthWidth, i + Step*DepthWidth };	// left, right, up, down
+
+			__m128 zc = LoadDepth4( &Depth[i] );
+			__m128 Mask = _mm_cmpgt_ps( zc, Zero );
+
+			__m128 Px[4], Py[4], Pz[4];
+			for( int k = 0; k < 4; k++ )
+			{
+				const int n = Neighbours[k];
+				Pz[k] = LoadDepth4( &Depth[n] );
+				Mask = _mm_and_ps( Mask, IsContinuous(zc, Pz[k], MaxChange) );
+				Px[k] = _mm_mul_ps( _mm_loadu_ps(&TableX[n]), Pz[k] );
+				Py[k] = _mm_mul_ps( _mm_loadu_ps(&TableY[n]), Pz[k] );
+			}
+
+			__m128 ax = _mm_sub_ps( Px[1], Px[0] ), ay = _mm_sub_ps( Py[1], Py[0] ), az = _mm_sub_ps( Pz[1], Pz[0] );
+			__m128 bx = _mm_sub_ps( Px[2], Px[3] ), by = _mm_sub_ps( Py[2], Py[3] ), bz = _mm_sub_ps( Pz[2], Pz[3] );
+
+			__m128 nx = _mm_sub_ps( _mm_mul_ps(ay, bz), _mm_mul_ps(az, by) );
+			__m128 ny = _mm_sub_ps( _mm_mul_ps(az, bx), _mm_mul_ps(ax, bz) );
+			__m128 nz = _mm_sub_ps( _mm_mul_ps(ax, by), _mm_mul_ps(ay, bx) );
+			__m128 Length = _mm_sqrt_ps( _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz)) );
+			Mask = _mm_and_ps( Mask, _mm_cmpgt_ps(Length, Zero) );
+
+			// Toward the camera: flip sign where n.Pc > 0
+			__m128 pcx = _mm_mul_ps( _mm_loadu_ps(&TableX[i]), zc );
+			__m128 pcy = _mm_mul_ps( _mm_loadu_ps(&TableY[i]), zc );
+			__m128 Dot = _mm_add_ps( _mm_add_ps(_mm_mul_ps(nx, pcx), _mm_mul_ps(ny, pcy)), _mm_mul_ps(nz, zc) );
+			__m128 InvLength = _mm_xor_ps( _mm_div_ps(_mm_set1_ps(1.0f), Length), _mm_and_ps(_mm_cmpgt_ps(Dot, Zero), SignMask) );
+			nx = _mm_mul_ps( nx, InvLength );
+			ny = _mm_mul_ps( ny, InvLength );
+			nz = _mm_mul_ps( nz, InvLength );
+
+			__m128 ox = _mm_sub_ps( pcx, _mm_mul_ps(Quarter, _mm_add_ps(_mm_add_ps(Px[0], Px[1]), _mm_add_ps(Px[2], Px[3]))) );
+			__m128 oy = _mm_sub_ps( pcy, _mm_mul_ps(Quarter, _mm_add_ps(_mm_add_ps(Py[0], Py[1]), _mm_add_ps(Py[2], Py[3]))) );
+			__m128 oz = _mm_sub_ps( zc, _mm_mul_ps(Quarter, _mm_add_ps(_mm_add_ps(Pz[0], Pz[1]), _mm_add_ps(Pz[2], Pz[3]))) );
+			__m128 Spacing = _mm_mul_ps( Quarter, _mm_add_ps(
+				_mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, ax), _mm_mul_ps(ay, ay)), _mm_mul_ps(az, az))),
+				_mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(bx, bx), _mm_mul_ps(by, by)), _mm_mul_ps(bz, bz)))) );
+			__m128 Curv = _mm_div_ps( _mm_andnot_ps(SignMask, _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, ox), _mm_mul_ps(ny, oy)), _mm_mul_ps(nz, oz))), Spacing );
+
+			// Invalid lanes may hold NaN/Inf, masked to 0
+			_mm_storeu_ps( &NormalX[i], _mm_and_ps(Mask, nx) );
+			_mm_storeu_ps( &NormalY[i], _mm_and_ps(Mask, ny) );
+			_mm_storeu_ps( &NormalZ[i], _mm_and_ps(Mask, nz) );
+			_mm_storeu_ps( &Curvature[i], _mm_and_ps(Mask, Curv) );
+
+			int Bits = _mm_movemask_ps( Mask );
+			for( int k = 0; k < 4; k++ )
+			{
+				Valid[i+k] = (unsigned char)((Bits >> k) & 1);
+			}
+			NbValid += (Bits & 1) + ((Bits >> 1) & 1) + ((Bits >> 2) & 1) + ((Bits >> 3) & 1);
+		}
+#endif
+		for( ; u < DepthWidth; u++ )
+		{
+			NbValid += ComputePixel( Depth, RowStart + u ) == true ? 1 : 0;
+		}
+	}
+	return NbValid;
+}
+
+#endif // KINECT_2
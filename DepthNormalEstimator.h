@@ -0,0 +1,115 @@
+/**
+ * @file DepthNormalEstimator.h
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#ifndef __DEPTH_NORMAL_ESTIMATOR_H__
+#define __DEPTH_NORMAL_ESTIMATOR_H__
+
+#ifdef KINECT_2
+
+#include "KinectBasics.h"
+#include "DepthFrameToCameraSpaceTable.h"
+
+#include <vector>
+
+class KinectWorkerPool;
+
+namespace MobileRGBD { namespace Kinect2 {
+
+/**
+ * @class DepthNormalEstimator DepthNormalEstimator.cpp DepthNormalEstimator.h
+ * @brief Surface normals and curvature of depth frames using the image grid (organized point cloud): the normal
+ * of a pixel is the cross product of (right - left) and (up - down) neighbours at Step pixels, unprojected with
+ * the DepthFrameToCameraSpace table, oriented toward the camera. A normal is valid if the pixel and its 4
+ * neighbours have a depth and no neighbour is behind a depth discontinuity. Curvature is the distance, along the
+ * normal, between the pixel and the mean of its neighbours divided by the mean neighbour distance (0 on a plane).
+ * Results are stored as planes (X, Y, Z, curvature, validity mask). Computation uses SSE2 when available
+ * (define KINECT_NO_SSE2 to disable) and can be split by rows on a KinectWorkerPool.
+ * Results are kept by the estimator until next Compute, one estimator is used by one thread at a time.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class DepthNormalEstimator
+{
+public:
+	enum { NumberOfPixels = DepthWidth*DepthHeight };
+
+	/** @brief constructor.
+	 *
+	 * @param Table [in] lookup table of the sensor/session.
+	 * @param Step [in] distance in pixels of the neighbours (1 to 8), larger is smoother.
+	 * @param MaxRelativeDepthChange [in] a neighbour farther in depth than this ratio of the pixel depth is a discontinuity.
+	 */
+	DepthNormalEstimator(const DepthFrameToCameraSpaceTable& Table, int Step = 2, float MaxRelativeDepthChange = 0.05f);
+
+	/** @brief Virtual destructor, always.
+	 */
+	virtual ~DepthNormalEstimator() {}
+
+	/** @brief Is the estimator ready (valid table)?
+	 */
+	bool IsValid() const
+	{
+		return TableX.size() == (size_t)NumberOfPixels;
+	}
+
+	/** @brief Compute normals of a depth frame.
+	 *
+	 * @param Depth [in] depth frame (DepthWidth*DepthHeight values in mm).
+	 * @param Pool [in] optional worker pool to split the frame between threads.
+	 * @return number of valid normals.
+	 */
+	int Compute(const unsigned short * Depth, KinectWorkerPool * Pool = nullptr);
+
+	/** @brief Normal planes of the last Compute (0 where not valid).
+	 */
+	const float * GetNormalX() const { return &NormalX[0]; }
+	const float * GetNormalY() const { return &NormalY[0]; }
+	const float * GetNormalZ() const { return &NormalZ[0]; }
+
+	/** @brief Curvature of the last Compute (0 where not valid).
+	 */
+	const float * GetCurvature() const { return &Curvature[0]; }
+
+	/** @brief Validity mask of the last Compute (1 valid, 0 otherwise).
+	 */
+	const unsigned char * GetValidityMask() const { return &Valid[0]; }
+
+protected:
+	/** @brief Compute rows [FirstRow;LastRow[.
+	 *
+	 * @return number of valid normals.
+	 */
+	int ComputeRows(const unsigned short * Depth, int FirstRow, int LastRow);
+
+	/** @brief Compute one pixel (scalar code, borders and remainders).
+	 */
+	bool ComputePixel(const unsigned short * Depth, int i);
+
+	/** @brief Set a pixel as not valid.
+	 */
+	inline void SetInvalid(int i)
+	{
+		NormalX[i] = NormalY[i] = NormalZ[i] = Curvature[i] = 0.0f;
+		Valid[i] = 0;
+	}
+
+	int Step;								/*!< @brief Neighbour distance in pixels. */
+	float MaxRelativeDepthChange;			/*!< @brief Discontinuity threshold. */
+	std::vector<float> TableX;				/*!< @brief X entries of the table. */
+	std::vector<float> TableY;				/*!< @brief Y entries of the table. */
+	std::vector<float> NormalX;				/*!< @brief Normals, X plane. */
+	std::vector<float> NormalY;				/*!< @brief Normals, Y plane. */
+	std::vector<float> NormalZ;				/*!< @brief Normals, Z plane. */
+	std::vector<float> Curvature;			/*!< @brief Curvature plane. */
+	std::vector<unsigned char> Valid;		/*!< @brief Validity mask. */
+};
+
+}} // namespace MobileRGBD::Kinect2
+
+#endif // KINECT_2
+
+#endif // __DEPTH_NORMAL_ESTIMATOR_H__
@@ -0,0 +1,234 @@
+/**
+ * @file DepthPyramid.cpp
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#include "DepthPyramid.h"
+
+#ifdef KINECT_2
+
+using namespace MobileRGBD::Kinect2;
+
+namespace {
+
+/** @brief Downsample 2x2 block a, b, c, d ignoring zeros.
+ */
+static inline unsigned short Min2x2(unsigned short a, unsigned short b, unsigned short c, unsigned short d)
+{
+	// 0 becomes 65535 with unsigned wrap, never the min unless all are 0
+	unsigned short m = (unsigned short)(a-1);
+	m = (unsigned short)(b-1) < m ? (unsigned short)(b-1) : m;
+	m = (unsigned short)(c-1) < m ? (unsigned short)(c-1) : m;
+	m = (unsigned short)(d-1) < m ? (unsigned short)(d-1) : m;
+	return (unsigned short)(m+1);
+}
+
+static inline unsigned short Max2x2(unsigned short a, unsigned short b, unsigned short c, unsigned short d)
+{
+	unsigned short m = a > b ? a : b;
+	m = c > m ? c : m;
+	return d > m ? d : m;
+}
+
+static inline unsigned short Median2x2(unsigned short a, unsigned short b, unsigned short c, unsigned short d)
+{
+	unsigned short v[4];
+	int n = 0;
+	if ( a != 0 ) v[n++] = a;
+	if ( b != 0 ) v[n++] = b;
+	if ( c != 0 ) v[n++] = c;
+	if ( d != 0 ) v[n++] = d;
+
+	// Insertion sort of at most 4 values
+	for( int i = 1; i < n; i++ )
+	{
+		unsigned short Value = v[i];
+		int j = i - 1;
+		for( ; j >= 0 && v[j] > Value; j-- )
+		{
+			v[j+1] = v[j];
+		}
+		v[j+1] = Value;
+	}
+
+	switch( n )
+	{
+		case 1: return v[0];
+		case 2: return (unsigned short)(((unsigned int)v[0] + v[1] + 1)/2);
+		case 3: return v[1];
+		case 4: return (unsigned short)(((unsigned int)v[1] + v[2] + 1)/2);
+		default: return 0;
+	}
+}
+
+} // namespace
+
+DepthPyramid::DepthPyramid()
+{
+	SetFrame( nullptr );
+}
+
+void DepthPyramid::SetFrame(const unsigned short * Depth)
+{
+	Frame = Depth;
+	for( int Mode = 0; Mode < NumberOfModes; Mode++ )
+	{
+		for( int Level = 0; Level < MaxLevels; Level++ )
+		{
+			LevelIsBuilt[Mode][Level] = false;
+		}
+	}
+	IntegralIsBuilt = false;
+}
+
+const unsigned short * DepthPyramid::GetLevel(int Level, int Mode /* = MedianOfValid */)
+{
+	if ( Frame == nullptr || Level < 0 || Level >= MaxLevels || Mode < 0 || Mode >= NumberOfModes )
+	{
+		return nullptr;
+	}
+
+	if ( Level == 0 )
+	{
+		return Frame;
+	}
+
+	if ( LevelIsBuilt[Mode][Level] == false )
+	{
+		// Build missing levels from the lowest one
+		for( int l = 1; l <= Level; l++ )
+		{
+			if ( LevelIsBuilt[Mode][l] == false )
+			{
+				BuildLevel( l, Mode );
+			}
+		}
+	}
+
+	return &Levels[Mode][Level][0];
+}
+
+void DepthPyramid::BuildLevel(int Level, int Mode)
+{
+	const unsigned short * Source = Level == 1 ? Frame : &Levels[Mode][Level-1][0];
+	const int SourceWidth = GetLevelWidth(Level-1);
+	const int Width = GetLevelWidth(Level);
+	const int Height = GetLevelHeight(Level);
+
+	std::vector<unsigned short>& Destination = Levels[Mode][Level];
+	Destination.resize( Width*Height );
+
+	for( int y = 0; y < Height; y++ )
+	{
+		const unsigned short * Row0 = &Source[(2*y)*SourceWidth];
+		const unsigned short * Row1 = Row0 + SourceWidth;
+		unsigned short * Out = &Destination[y*Width];
+
+		switch( Mode )
+		{
+			case MinOfValid:
+				for( int x = 0; x < Width; x++ )
+				{
+					Out[x] = Min2x2( Row0[2*x], Row0[2*x+1], Row1[2*x], Row1[2*x+1] );
+				}
+				break;
+
+			case MaxOfValid:
+				for( int x = 0; x < Width; x++ )
+				{
+					Out[x] = Max2x2( Row0[2*x], Row0[2*x+1], Row1[2*x], Row1[2*x+1] );
+				}
+				break;
+
+			default:
+				for( int x = 0; x < Width; x++ )
+				{
+					Out[x] = Median2x2( Row0[2*x], Row0[2*x+1], Row1[2*x], Row1[2*x+1] );
+				}
+				break;
+		}
+	}
+
+	LevelIsBuilt[Mode][Level] = true;
+}
+
+bool DepthPyramid::PrepareRegion(int& Left, int& Top, int& Right, int& Bottom)
+{
+	if ( Frame == nullptr )
+	{
+		return false;
+	}
+
+	Left = Left < 0 ? 0 : Left;
+	Top = Top < 0 ? 0 : Top;
+	Right = Right > DepthWidth ? DepthWidth : Right;
+	Bottom = Bottom > DepthHeight ? DepthHeight : Bottom;
+	if ( Left >= Right || Top >= Bottom )
+	{
+		return false;
+	}
+
+	if ( IntegralIsBuilt == false )
+	{
+		IntegralDepth.assign( IntegralWidth*IntegralHeight, 0 );
+		IntegralCount.assign( IntegralWidth*IntegralHeight, 0 );
+
+		for( int y = 0; y < DepthHeight; y++ )
+		{
+			const unsigned short * Row = &Frame[y*DepthWidth];
+			const unsigned int * PreviousSum = &IntegralDepth[y*IntegralWidth];
+			const unsigned int * PreviousCount = &IntegralCount[y*IntegralWidth];
+			unsigned int * Sum = &IntegralDepth[(y+1)*IntegralWidth];
+			unsigned int * Count = &IntegralCount[(y+1)*IntegralWidth];
+
+			unsigned int RowSum = 0;
+			unsigned int RowCount = 0;
+			for( int x = 0; x < DepthWidth; x++ )
+			{
+				RowSum += Row[x];
+				RowCount += Row[x] != 0 ? 1 : 0;
+				Sum[x+1] = PreviousSum[x+1] + RowSum;
+				Count[x+1] = PreviousCount[x+1] + RowCount;
+			}
+		}
+		IntegralIsBuilt = true;
+	}
+
+	return true;
+}
+
+unsigned long long int DepthPyramid::GetRegionSum(int Left, int Top, int Right, int Bottom)
+{
+	if ( PrepareRegion( Left, Top, Right, Bottom ) == false )
+	{
+		return 0;
+	}
+
+	const unsigned int * I = &IntegralDepth[0];
+	return (unsigned long long int)(unsigned int)(I[Bottom*IntegralWidth+Right] - I[Top*IntegralWidth+Right] - I[Bottom*IntegralWidth+Left] + I[Top*IntegralWidth+Left]);
+}
+
+unsigned int DepthPyramid::GetRegionCount(int Left, int Top, int Right, int Bottom)
+{
+	if ( PrepareRegion( Left, Top, Right, Bottom ) == false )
+	{
+		return 0;
+	}
+
+	const unsigned int * I = &IntegralCount[0];
+	return I[Bottom*IntegralWidth+Right] - I[Top*IntegralWidth+Right] - I[Bottom*IntegralWidth+Left] + I[Top*IntegralWidth+Left];
+}
+
+float DepthPyramid::GetRegionMean(int Left, int Top, int Right, int Bottom)
+{
+	unsigned int Count = GetRegionCount( Left, Top, Right, Bottom );
+	if ( Count == 0 )
+	{
+		return 0.0f;
+	}
+	return (float)GetRegionSum( Left, Top, Right, Bottom )/(float)Count;
+}
+
+#endif // KINECT_2
@@ -0,0 +1,111 @@
+/**
+ * @file DepthPyramid.h
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#ifndef __DEPTH_PYRAMID_H__
+#define __DEPTH_PYRAMID_H__
+
+#ifdef KINECT_2
+
+#include "KinectBasics.h"
+
+#include <vector>
+
+namespace MobileRGBD { namespace Kinect2 {
+
+/**
+ * @class DepthPyramid DepthPyramid.cpp DepthPyramid.h
+ * @brief Multi-scale views of one depth frame (DepthWidth*DepthHeight, mm), built only when first requested:
+ * - pyramid levels, each one half size of the previous one, using min, max or median of the valid (non zero)
+ *   depths of 2x2 blocks (0 if none);
+ * - integral images of depth and of valid pixel count, to get sum/count/mean of any rectangle in O(1).
+ * SetFrame only keeps a pointer on the frame and invalidates previous results, frame must stay available while
+ * the pyramid is used. Memory is kept from one frame to the next. One pyramid is used by one thread.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class DepthPyramid
+{
+public:
+	enum DownsamplingMode { MinOfValid, MaxOfValid, MedianOfValid, NumberOfModes };
+	enum { MaxLevels = 5 };		/*!< @brief Level 0 is the frame, level 4 is 32x26. */
+
+	/** @brief constructor. No frame.
+	 */
+	DepthPyramid();
+
+	/** @brief Virtual destructor, always.
+	 */
+	virtual ~DepthPyramid() {}
+
+	/** @brief Use a new depth frame, previous levels and integral images are invalidated.
+	 *
+	 * @param Depth [in] depth frame, not copied.
+	 */
+	void SetFrame(const unsigned short * Depth);
+
+	/** @brief Width of a level.
+	 */
+	static int GetLevelWidth(int Level)
+	{
+		return DepthWidth >> Level;
+	}
+
+	/** @brief Height of a level.
+	 */
+	static int GetLevelHeight(int Level)
+	{
+		return DepthHeight >> Level;
+	}
+
+	/** @brief Get a level, built with all levels below it if needed.
+	 *
+	 * @param Level [in] level in [0;MaxLevels[.
+	 * @param Mode [in] downsampling mode.
+	 * @return GetLevelWidth(Level)*GetLevelHeight(Level) depths, nullptr if no frame or bad parameters.
+	 */
+	const unsigned short * GetLevel(int Level, int Mode = MedianOfValid);
+
+	/** @brief Sum of valid depths in [Left;Right[ x [Top;Bottom[ (clipped to the frame).
+	 */
+	unsigned long long int GetRegionSum(int Left, int Top, int Right, int Bottom);
+
+	/** @brief Number of valid depths in [Left;Right[ x [Top;Bottom[ (clipped to the frame).
+	 */
+	unsigned int GetRegionCount(int Left, int Top, int Right, int Bottom);
+
+	/** @brief Mean of valid depths in [Left;Right[ x [Top;Bottom[ (clipped to the frame), 0 if none.
+	 */
+	float GetRegionMean(int Left, int Top, int Right, int Bottom);
+
+protected:
+	enum { IntegralWidth = DepthWidth+1, IntegralHeight = DepthHeight+1 };
+
+	/** @brief Build one level from the level below.
+	 */
+	void BuildLevel(int Level, int Mode);
+
+	/** @brief Build integral images if needed, clip rectangle.
+	 *
+	 * @return false if the rectangle is empty or there is no frame.
+	 */
+	bool PrepareRegion(int& Left, int& Top, int& Right, int& Bottom);
+
+	const unsigned short * Frame;									/*!< @brief Current frame (level 0). */
+	std::vector<unsigned short> Levels[NumberOfModes][MaxLevels];	/*!< @brief Levels 1 to MaxLevels-1 of each mode. */
+	bool LevelIsBuilt[NumberOfModes][MaxLevels];					/*!< @brief Is a level up to date? */
+
+	// 32 bits sums: region sums are exact (modulo arithmetic) as long as they are under 2^32, i.e. always for Kinect depth
+	std::vector<unsigned int> IntegralDepth;						/*!< @brief Sum of depth above and left of each pixel. */
+	std::vector<unsigned int> IntegralCount;						/*!< @brief Number of valid pixels above and left of each pixel. */
+	bool IntegralIsBuilt;											/*!< @brief Are integral images up to date? */
+};
+
+}} // namespace MobileRGBD::Kinect2
+
+#endif // KINECT_2
+
+#endif // __DEPTH_PYRAMID_H__
@@ -0,0 +1,346 @@
+/**
+ * @file DepthToPointCloud.cpp
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#include "DepthToPointCloud.h"
+
+#ifdef KINECT_2
+
+#include "KinectWorkerPool.h"
+
+#include <cstring>
+#include <limits>
+
+using namespace MobileRGBD::Kinect2;
+
+DepthToPointCloud::DepthToPointCloud(const DepthFrameToCameraSpaceTable& Table, int _Layout /* = StructureOfArrays */, int _Precision /* = FloatPrecision */)
+{
+	Layout = _Layout;
+	Precision = _Precision;
+
+	SetBodyMask( AllBodies );
+
+	const PointF * Entries = Table.GetTable();
+	if ( Entries == nullptr )
+	{
+		return;
+	}
+
+	// Split table in 2 planes for vectorization
+	TableX.resize( NumberOfPoints );
+	TableY.resize( NumberOfPoints );
+	for( int i = 0; i < NumberOfPoints; i++ )
+	{
+		TableX[i] = Entries[i].X;
+		TableY[i] = Entries[i].Y;
+	}
+}
+
+void DepthToPointCloud::SetBodyMask(unsigned char BodyMask)
+{
+	for( int i = 0; i < 256; i++ )
+	{
+		KeepPixel[i] = (i < 6 && (BodyMask & (1 << i)) != 0) ? 1 : 0;
+	}
+}
+
+/* static */ unsigned short DepthToPointCloud::FloatToHalf(float Value)
+{
+	// Round to nearest even, from F. Giesen public domain code
+	const unsigned int f32infty = 255u << 23;
+	const unsigned int f16max = (127u + 16u) << 23;
+	const unsigned int DenormMagicBits = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+	float DenormMagic;
+	memcpy( &DenormMagic, &DenormMagicBits, sizeof(float) );
+
+	unsigned int Bits;
+	memcpy( &Bits, &Value, sizeof(float) );
+
+	unsigned int Sign = Bits & 0x80000000u;
+	Bits ^= Sign;
+
+	unsigned short Res;
+	if ( Bits >= f16max )
+	{
+		// Inf or NaN
+		Res = (Bits > f32infty) ? 0x7e00 : 0x7c00;
+	}
+	else if ( Bits < (113u << 23) )
+	{
+		// Denormalized half
+		float Tmp;
+		memcpy( &Tmp, &Bits, sizeof(float) );
+		Tmp += DenormMagic;
+		memcpy( &Bits, &Tmp, sizeof(float) );
+		Res = (unsigned short)(Bits - DenormMagicBits);
+	}
+	else
+	{
+		unsigned int MantissaOdd = (Bits >> 13) & 1;
+		Bits += ((unsigned int)(15 - 127) << 23) + 0xfff;
+		Bits += MantissaOdd;
+		Res = (unsigned short)(Bits >> 13);
+	}
+
+	return Res | (unsigned short)(Sign >> 16);
+}
+
+/* static */ float DepthToPointCloud::HalfToFloat(unsigned short Value)
+{
+	const unsigned int ShiftedExp = 0x7c00u << 13;
+	const unsigned int MagicBits = 113u << 23;
+	float Magic;
+	memcpy( &Magic, &MagicBits, sizeof(float) );
+
+	unsigned int Bits = ((unsigned int)Value & 0x7fffu) << 13;
+	unsigned int Exp = ShiftedExp & Bits;
+	Bits += (unsigned int)(127 - 15) << 23;
+
+	if ( Exp == ShiftedExp )
+	{
+		// Inf or NaN
+		Bits += (unsigned int)(128 - 16) << 23;
+	}
+	else if ( Exp == 0 )
+	{
+		// Zero or denormalized
+		Bits += 1u << 23;
+		float Tmp;
+		memcpy( &Tmp, &Bits, sizeof(float) );
+		Tmp -= Magic;
+		memcpy( &Bits, &Tmp, sizeof(float) );
+	}
+
+	Bits |= ((unsigned int)Value & 0x8000u) << 16;
+
+	float Res;
+	memcpy( &Res, &Bits, sizeof(float) );
+	return Res;
+}
+
+int DepthToPointCloud::Convert(const unsigned short * Depth, const unsigned char * BodyIndex, void * Output, KinectWorkerPool * Pool /* = nullptr */) const
+{
+	if ( IsValid() == false || Depth == nullptr || Output == nullptr )
+	{
+		return 0;
+	}
+
+	if ( Pool == nullptr || Pool->GetNumberOfThreads() == 1 )
+	{
+		return ConvertRange( Depth, BodyIndex, Output, 0, NumberOfPoints );
+	}
+
+	// Split by groups of rows (DepthWidth is a multiple of 4)
+	int NbValidPoints[64];
+	memset( NbValidPoints, 0, sizeof(NbValidPoints) );
+	Pool->ParallelFor( DepthHeight, [&](int FirstRow, int LastRow)
+	{
+		int NumRange = (FirstRow*64)/DepthHeight;
+		NbValidPoints[NumRange] = ConvertRange( Depth, BodyIndex, Output, FirstRow*DepthWidth, LastRow*DepthWidth );
+	}, (DepthHeight+63)/64 );
+
+	int Res = 0;
+	for( int i = 0; i < 64; i++ )
+	{
+		Res += NbValidPoints[i];
+	}
+	return Res;
+}
+
+#ifdef KINECT_SSE2
+namespace {
+
+/** @brief SSE2 version of FloatToHalf, result in the low 16 bits of each 32 bits value.
+ */
+inline __m128i FloatToHalf4(__m128 Value)
+{
+	const __m128i SignMask = _mm_set1_epi32( (int)0x80000000u );
+	const __m128i F16Max = _mm_set1_epi32( (127 + 16) << 23 );
+	const __m128i NaNBit = _mm_set1_epi32( 0x200 );
+	const __m128i InfinityAsHalf = _mm_set1_epi32( 0x7c00 );
+	const __m128i MinNormal = _mm_set1_epi32( (127 - 14) << 23 );
+	const __m128i DenormMagic = _mm_set1_epi32( ((127 - 15) + (23 - 10) + 1) << 23 );
+	const __m128i NormalBias = _mm_set1_epi32( 0xfff - ((127 - 15) << 23) );
+
+	__m128 Sign = _mm_and_ps( Value, _mm_castsi128_ps(SignMask) );
+	__m128 Abs = _mm_xor_ps( Value, Sign );
+	__m128i AbsInt = _mm_castps_si128( Abs );
+
+	__m128i IsNaN = _mm_castps_si128( _mm_cmpunord_ps( Abs, Abs ) );
+	__m128i IsRegular = _mm_cmpgt_epi32( F16Max, AbsInt );
+	__m128i InfOrNaN = _mm_or_si128( _mm_and_si128( IsNaN, NaNBit ), InfinityAsHalf );
+
+	// Denormalized halves
+	__m128i IsDenorm = _mm_cmpgt_epi32( MinNormal, AbsInt );
+	__m128i Denorm = _mm_sub_epi32( _mm_castps_si128( _mm_add_ps( Abs, _mm_castsi128_ps(DenormMagic) ) ), DenormMagic );
+
+	// Normalized halves, round to nearest even
+	__m128i MantissaOdd = _mm_srai_epi32( _mm_slli_epi32( AbsInt, 31 - 13 ), 31 );
+	__m128i Normal = _mm_srli_epi32( _mm_sub_epi32( _mm_add_epi32( AbsInt, NormalBias ), MantissaOdd ), 13 );
+
+	__m128i NonSpecial = _mm_or_si128( _mm_and_si128( IsDenorm, Denorm ), _mm_andnot_si128( IsDenorm, Normal ) );
+	__m128i Joined = _mm_or_si128( _mm_and_si128( IsRegular, NonSpecial ), _mm_andnot_si128( IsRegular, InfOrNaN ) );
+
+	// Sign extended so that _mm_packs_epi32 keeps the 16 bits unchanged
+	return _mm_or_si128( Joined, _mm_srai_epi32( _mm_castps_si128(Sign), 16 ) );
+}
+
+} // namespace
+#endif
+
+int DepthToPointCloud::ConvertRange(const unsigned short * Depth, const unsigned char * BodyIndex, void * Output, int Begin, int End) const
+{
+	const float NaN = std::numeric_limits<float>::quiet_NaN();
+	const unsigned short HalfNaN = 0x7e00;
+	const float * TX = &TableX[0];
+	const float * TY = &TableY[0];
+	int NbValid = 0;
+	int i = Begin;
+
+	float * Out = (float*)Output;
+	unsigned short * OutHalf = (unsigned short*)Output;
+
+#ifdef KINECT_SSE2
+	const __m128 Scale = _mm_set1_ps( 0.001f );
+	const __m128 NaN4 = _mm_set1_ps( NaN );
+	const __m128i Zero = _mm_setzero_si128();
+	for( ; i + 4 <= End; i += 4 )
+	{
+		// 4 depth values to float, in meters
+		__m128i Depth4 = _mm_unpacklo_epi16( _mm_loadl_epi64( (const __m128i*)(Depth + i) ), Zero );
+		__m128 Z = _mm_mul_ps( _mm_cvtepi32_ps( Depth4 ), Scale );
+		__m128 Valid = _mm_castsi128_ps( _mm_cmpgt_epi32( Depth4, Zero ) );
+		if ( BodyIndex != nullptr )
+		{
+			__m128i Keep = _mm_set_epi32( -(int)KeepPixel[BodyIndex[i+3]], -(int)KeepPixel[BodyIndex[i+2]], -(int)KeepPixel[BodyIndex[i+1]], -(int)KeepPixel[BodyIndex[i]] );
+			Valid = _mm_and_ps( Valid, _mm_castsi128_ps( Keep ) );
+		}
+
+		__m128 X = _mm_mul_ps( _mm_loadu_ps( TX + i ), Z );
+		__m128 Y = _mm_mul_ps( _mm_loadu_ps( TY + i ), Z );
+
+		// Invalid points set to NaN
+		X = _mm_or_ps( _mm_and_ps( Valid, X ), _mm_andnot_ps( Valid, NaN4 ) );
+		Y = _mm_or_ps( _mm_and_ps( Valid, Y ), _mm_andnot_ps( Valid, NaN4 ) );
+		Z = _mm_or_ps( _mm_and_ps( Valid, Z ), _mm_andnot_ps( Valid, NaN4 ) );
+
+		int ValidMask = _mm_movemask_ps( Valid );
+		NbValid += (ValidMask & 1) + ((ValidMask >> 1) & 1) + ((ValidMask >> 2) & 1) + ((ValidMask >> 3) & 1);
+
+		if ( Precision == FloatPrecision )
+		{
+			if ( Layout == StructureOfArrays )
+			{
+				_mm_storeu_ps( Out + i, X );
+				_mm_storeu_ps( Out + NumberOfPoints + i, Y );
+				_mm_storeu_ps( Out + 2*NumberOfPoints + i, Z );
+			}
+			else
+			{
+				// Interleave to x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3
+				__m128 XY01 = _mm_unpacklo_ps( X, Y );	// x0 y0 x1 y1
+				__m128 XY23 = _mm_unpackhi_ps( X, Y );	// x2 y2 x3 y3
+				__m128 Z0X1 = _mm_shuffle_ps( Z, XY01, _MM_SHUFFLE(2,2,0,0) );	// z0 z0 x1 x1
+				__m128 Y1Z1 = _mm_shuffle_ps( XY01, Z, _MM_SHUFFLE(1,1,3,3) );	// y1 y1 z1 z1
+				__m128 Z2X3 = _mm_shuffle_ps( Z, XY23, _MM_SHUFFLE(2,2,2,2) );	// z2 z2 x3 x3
+				__m128 Y3Z3 = _mm_shuffle_ps( XY23, Z, _MM_SHUFFLE(3,3,3,3) );	// y3 y3 z3 z3
+
+				float * Dest = Out + 3*i;
+				_mm_storeu_ps( Dest, _mm_shuffle_ps( XY01, Z0X1, _MM_SHUFFLE(2,0,1,0) ) );
+				_mm_storeu_ps( Dest+4, _mm_shuffle_ps( Y1Z1, XY23, _MM_SHUFFLE(1,0,2,0) ) );
+				_mm_storeu_ps( Dest+8, _mm_shuffle_ps( Z2X3, Y3Z3, _MM_SHUFFLE(2,0,2,0) ) );
+			}
+		}
+		else
+		{
+			// 8 halves per register: X and Y together, then Z
+			__m128i XY = _mm_packs_epi32( FloatToHalf4( X ), FloatToHalf4( Y ) );
+			__m128i ZZ = _mm_packs_epi32( FloatToHalf4( Z ), FloatToHalf4( Z ) );
+
+			if ( Layout == StructureOfArrays )
+			{
+				_mm_storel_epi64( (__m128i*)(OutHalf + i), XY );
+				_mm_storel_epi64( (__m128i*)(OutHalf + NumberOfPoints + i), _mm_srli_si128( XY, 8 ) );
+				_mm_storel_epi64( (__m128i*)(OutHalf + 2*NumberOfPoints + i), ZZ );
+			}
+			else
+			{
+				unsigned short Tmp[12];
+				_mm_storeu_si128( (__m128i*)Tmp, XY );
+				_mm_storel_epi64( (__m128i*)(Tmp+8), ZZ );
+				unsigned short * Dest = OutHalf + 3*i;
+				for( int k = 0; k < 4; k++ )
+				{
+					Dest[3*k] = Tmp[k];
+					Dest[3*k+1] = Tmp[4+k];
+					Dest[3*k+2] = Tmp[8+k];
+				}
+			}
+		}
+	}
+#endif
+
+	// Scalar version (and remaining pixels)
+	for( ; i < End; i++ )
+	{
+		float Z = (float)Depth[i] * 0.001f;
+		float X = TX[i] * Z;
+		float Y = TY[i] * Z;
+		bool IsValid = Depth[i] != 0 && (BodyIndex == nullptr || KeepPixel[BodyIndex[i]] != 0);
+		if ( IsValid == true )
+		{
+			NbValid++;
+		}
+
+		if ( Precision == FloatPrecision )
+		{
+			if ( IsValid == false )
+			{
+				X = Y = Z = NaN;
+			}
+
+			if ( Layout == StructureOfArrays )
+			{
+				Out[i] = X;
+				Out[NumberOfPoints + i] = Y;
+				Out[2*NumberOfPoints + i] = Z;
+			}
+			else
+			{
+				Out[3*i] = X;
+				Out[3*i+1] = Y;
+				Out[3*i+2] = Z;
+			}
+		}
+		else
+		{
+			unsigned short HX = HalfNaN, HY = HalfNaN, HZ = HalfNaN;
+			if ( IsValid == true )
+			{
+				HX = FloatToHalf( X );
+				HY = FloatToHalf( Y );
+				HZ = FloatToHalf( Z );
+			}
+
+			if ( Layout == StructureOfArrays )
+			{
+				OutHalf[i] = HX;
+				OutHalf[NumberOfPoints + i] = HY;
+				OutHalf[2*NumberOfPoints + i] = HZ;
+			}
+			else
+			{
+				OutHalf[3*i] = HX;
+				OutHalf[3*i+1] = HY;
+				OutHalf[3*i+2] = HZ;
+			}
+		}
+	}
+
+	return NbValid;
+}
+
+#endif // KINECT_2
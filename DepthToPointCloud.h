@@ -0,0 +1,109 @@
+/**
+ * @file DepthToPointCloud.h
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#ifndef __DEPTH_TO_POINT_CLOUD_H__
+#define __DEPTH_TO_POINT_CLOUD_H__
+
+#ifdef KINECT_2
+
+#include "KinectBasics.h"
+#include "DepthFrameToCameraSpaceTable.h"
+
+#include <vector>
+
+class KinectWorkerPool;
+
+namespace MobileRGBD { namespace Kinect2 {
+
+/**
+ * @class DepthToPointCloud DepthToPointCloud.cpp DepthToPointCloud.h
+ * @brief Unproject depth frames (as recorded in depth.raw, 16 bits, mm) to camera space points (meters)
+ * using the DepthFrameToCameraSpace table: X = Table.X*Z, Y = Table.Y*Z. Output is dense (one point
+ * per depth pixel, row order), invalid or masked pixels are set to NaN. Points can be stored as
+ * XYZXYZ... (ArrayOfStructures) or as 3 planes X..., Y..., Z... (StructureOfArrays), in float or
+ * half float. Float output uses SSE2 when available (define KINECT_NO_SSE2 to disable).
+ * Convert is const, one DepthToPointCloud can be used by several threads at once.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class DepthToPointCloud
+{
+public:
+	enum { NumberOfPoints = DepthWidth*DepthHeight };
+	enum OutputLayout { ArrayOfStructures, StructureOfArrays };
+	enum OutputPrecision { FloatPrecision, HalfPrecision };
+	enum { NoBody = 255, AllBodies = 0x3F };
+
+	/** @brief constructor.
+	 *
+	 * @param Table [in] lookup table of the session.
+	 * @param Layout [in] output layout (see OutputLayout).
+	 * @param Precision [in] output precision (see OutputPrecision).
+	 */
+	DepthToPointCloud(const DepthFrameToCameraSpaceTable& Table, int Layout = StructureOfArrays, int Precision = FloatPrecision);
+
+	/** @brief Virtual destructor, always.
+	 */
+	virtual ~DepthToPointCloud() {}
+
+	/** @brief Is the engine ready (valid table)?
+	 */
+	bool IsValid() const
+	{
+		return TableX.size() == (size_t)NumberOfPoints;
+	}
+
+	/** @brief Select bodies to keep when a body index frame is given to Convert.
+	 *
+	 * @param BodyMask [in] bit i set to keep body i (default AllBodies). Pixels without body are never kept.
+	 */
+	void SetBodyMask(unsigned char BodyMask);
+
+	/** @brief Size of the output buffer in bytes.
+	 */
+	unsigned int GetOutputSize() const
+	{
+		return NumberOfPoints*3*(Precision == FloatPrecision ? sizeof(float) : sizeof(unsigned short));
+	}
+
+	/** @brief Unproject a depth frame.
+	 *
+	 * @param Depth [in] depth frame (DepthWidth*DepthHeight values in mm).
+	 * @param BodyIndex [in] body index frame to mask depth, nullptr to keep all pixels.
+	 * @param Output [out] output buffer of GetOutputSize() bytes.
+	 * @param Pool [in] optional worker pool to split the frame between threads.
+	 * @return number of valid points.
+	 */
+	int Convert(const unsigned short * Depth, const unsigned char * BodyIndex, void * Output, KinectWorkerPool * Pool = nullptr) const;
+
+	/** @brief Convert a float to an IEEE half float (round to nearest).
+	 */
+	static unsigned short FloatToHalf(float Value);
+
+	/** @brief Convert an IEEE half float to float.
+	 */
+	static float HalfToFloat(unsigned short Value);
+
+protected:
+	/** @brief Unproject pixels [Begin;End[ (Begin and End multiple of 4).
+	 *
+	 * @return number of valid points.
+	 */
+	int ConvertRange(const unsigned short * Depth, const unsigned char * BodyIndex, void * Output, int Begin, int End) const;
+
+	int Layout;							/*!< @brief Output layout. */
+	int Precision;						/*!< @brief Output precision. */
+	std::vector<float> TableX;			/*!< @brief X entries of the table. */
+	std::vector<float> TableY;			/*!< @brief Y entries of the table. */
+	unsigned char KeepPixel[256];		/*!< @brief Keep pixel for each body index value. */
+};
+
+}} // namespace MobileRGBD::Kinect2
+
+#endif // KINECT_2
+
+#endif // __DEPTH_TO_POINT_CLOUD_H__
@@ -0,0 +1,356 @@
+/**
+ * @file FloorPlaneEstimator.cpp
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#include "FloorPlaneEstimator.h"
+
+#ifdef KINECT_2
+
+#include "DepthCameraModel.h"
+#include "SerializableFile.h"
+#include "TimestampFileReader.h"
+
+#include <stdio.h>
+#include <math.h>
+#include <string>
+
+using namespace MobileRGBD::Kinect2;
+
+namespace {
+
+static const float Pi = 3.14159265358979f;
+
+// Weight of the new frame when tracking the floor
+static const float TrackingAlpha = 0.2f;
+
+// Motion of the plane under these values is considered as noise for stability
+static const float StableAngleInDegrees = 0.5f;
+static const float StableHeight = 0.01f;
+
+} // namespace
+
+FloorPlane::FloorPlane(const FloorPlane& ToCopy) : Omiscid::Serializable()
+{
+	*this = ToCopy;
+}
+
+FloorPlane& FloorPlane::operator=(const FloorPlane& ToCopy)
+{
+	Plane = ToCopy.Plane;
+	TiltInDegrees = ToCopy.TiltInDegrees;
+	NbInliers = ToCopy.NbInliers;
+	return *this;
+}
+
+/* virtual */ void FloorPlane::DeclareSerializeMapping()
+{
+	AddToSerialization( "PlaneX", Plane.x );
+	AddToSerialization( "PlaneY", Plane.y );
+	AddToSerialization( "PlaneZ", Plane.z );
+	AddToSerialization( "PlaneW", Plane.w );
+	AddToSerialization( "TiltInDegrees", TiltInDegrees );
+}
+
+bool FloorPlane::Save(const char * FileName) const
+{
+	return SerializableFile::Save( FileName, *this );
+}
+
+bool FloorPlane::Load(const char * FileName)
+{
+	// Load in a copy, keep current values if something is missing
+	FloorPlane NewValues;
+	if ( SerializableFile::Load( FileName, NewValues ) == false )
+	{
+		return false;
+	}
+
+	*this = NewValues;
+	NbInliers = 0;
+	return true;
+}
+
+bool FloorPlane::SaveInSession(const char * SessionFolder) const
+{
+	return Save( TimestampFileReader::GetStreamFileName( SessionFolder, "depth", "floor" ).c_str() );
+}
+
+bool FloorPlane::LoadFromSession(const char * SessionFolder)
+{
+	return Load( TimestampFileReader::GetStreamFileName( SessionFolder, "depth", "floor" ).c_str() );
+}
+
+FloorPlaneEstimator::FloorPlaneEstimator(const DepthFrameToCameraSpaceTable& _Table, float _InlierDistance /* = 0.03f */, float MaxTiltInDegrees /* = 45.0f */) :
+	Table(_Table), InlierDistance(_InlierDistance)
+{
+	MinNormalY = cosf( MaxTiltInDegrees*Pi/180.0f );
+	Points.reserve( (DepthWidth/SubSampling)*(DepthHeight/SubSampling) );
+	Reset();
+}
+
+void FloorPlaneEstimator::Reset()
+{
+	Current = FloorPlane();
+	NbStableFrames = 0;
+	RandomState = 12345;
+}
+
+void FloorPlaneEstimator::SamplePoints(const unsigned short * Depth)
+{
+	const PointF * Entries = Table.GetTable();
+
+	Points.clear();
+	for( int v = SubSampling/2; v < DepthHeight; v += SubSampling )
+	{
+		for( int u = SubSampling/2; u < DepthWidth; u += SubSampling )
+		{
+			int i = v*DepthWidth + u;
+			if ( Depth[i] == 0 )
+			{
+				continue;
+			}
+
+			CameraSpacePoint Point;
+			Point.Z = (float)Depth[i]*0.001f;
+			Point.X = Entries[i].X*Point.Z;
+			Point.Y = Entries[i].Y*Point.Z;
+			Points.push_back( Point );
+		}
+	}
+}
+
+bool FloorPlaneEstimator::SetPlane(float nx, float ny, float nz, float d, FloorPlane& Plane) const
+{
+	float Norm = sqrtf( nx*nx + ny*ny + nz*nz );
+	if ( Norm < 1e-6f )
+	{
+		return false;
+	}
+
+	// Normal pointing up
+	if ( ny < 0.0f )
+	{
+		Norm = -Norm;
+	}
+
+	float x = nx/Norm, y = ny/Norm, z = nz/Norm, w = d/Norm;
+
+	// Nearly horizontal and below the sensor
+	if ( y < MinNormalY || w <= 0.0f )
+	{
+		return false;
+	}
+
+	Plane.Plane.x = x;
+	Plane.Plane.y = y;
+	Plane.Plane.z = z;
+	Plane.Plane.w = w;
+	Plane.TiltInDegrees = atan2f( z, y )*180.0f/Pi;
+	return true;
+}
+
+int FloorPlaneEstimator::CountInliers(const FloorPlane& Plane) const
+{
+	int NbInliers = 0;
+	for( size_t i = 0; i < Points.size(); i++ )
+	{
+		if ( fabsf( Plane.GetHeight(Points[i]) ) < InlierDistance )
+		{
+			NbInliers++;
+		}
+	}
+	return NbInliers;
+}
+
+bool FloorPlaneEstimator::Ransac(FloorPlane& Result)
+{
+	const int NbPoints = (int)Points.size();
+	if ( NbPoints < 3 )
+	{
+		return false;
+	}
+
+	FloorPlane Best;
+	for( int Iteration = 0; Iteration < RansacIterations; Iteration++ )
+	{
+		const CameraSpacePoint * p[3];
+		for( int k = 0; k < 3; k++ )
+		{
+			// Numerical Recipes LCG, enough to pick points
+			RandomState = RandomState*1664525u + 1013904223u;
+			p[k] = &Points[(RandomState >> 8) % (unsigned int)NbPoints];
+		}
+
+		float ax = p[1]->X - p[0]->X, ay = p[1]->Y - p[0]->Y, az = p[1]->Z - p[0]->Z;
+		float bx = p[2]->X - p[0]->X, by = p[2]->Y - p[0]->Y, bz = p[2]->Z - p[0]->Z;
+		float nx = ay*bz - az*by;
+		float ny = az*bx - ax*bz;
+		float nz = ax*by - ay*bx;
+
+		FloorPlane Candidate;
+		if ( SetPlane( nx, ny, nz, -(nx*p[0]->X + ny*p[0]->Y + nz*p[0]->Z), Candidate ) == false )
+		{
+			continue;
+		}
+
+		Candidate.NbInliers = CountInliers( Candidate );
+		if ( Candidate.NbInliers > Best.NbInliers )
+		{
+			Best = Candidate;
+		}
+	}
+
+	if ( Best.IsValid() == false || Refine( Best ) == 0 )
+	{
+		return false;
+	}
+
+	Result = Best;
+	return true;
+}
+
+int FloorPlaneEstimator::Refine(FloorPlane& Plane) const
+{
+	// Floor is nearly horizontal, fit Y = a*X + b*Z + c with normal equations
+	double Sxx = 0.0, Sxz = 0.0, Szz = 0.0, Sx = 0.0, Sz = 0.0;
+	double Sxy = 0.0, Szy = 0.0, Sy = 0.0;
+	int n = 0;
+
+	for( size_t i = 0; i < Points.size(); i++ )
+	{
+		const CameraSpacePoint& P = Points[i];
+		if ( fabsf( Plane.GetHeight(P) ) >= InlierDistance )
+		{
+			continue;
+		}
+
+		Sxx += P.X*P.X; Sxz += P.X*P.Z; Szz += P.Z*P.Z;
+		Sx += P.X; Sz += P.Z;
+		Sxy += P.X*P.Y; Szy += P.Z*P.Y; Sy += P.Y;
+		n++;
+	}
+
+	if ( n < 3 )
+	{
+		return 0;
+	}
+
+	// Cramer's rule on the symmetric 3x3 system
+	double Det = Sxx*(Szz*n - Sz*Sz) - Sxz*(Sxz*n - Sz*Sx) + Sx*(Sxz*Sz - Szz*Sx);
+	if ( fabs(Det) < 1e-12 )
+	{
+		return 0;
+	}
+
+	double a = (Sxy*(Szz*n - Sz*Sz) - Sxz*(Szy*n - Sz*Sy) + Sx*(Szy*Sz - Szz*Sy))/Det;
+	double b = (Sxx*(Szy*n - Sy*Sz) - Sxy*(Sxz*n - Sz*Sx) + Sx*(Sxz*Sy - Szy*Sx))/Det;
+	double c = (Sxx*(Szz*Sy - Sz*Szy) - Sxz*(Sxz*Sy - Sz*Sxy) + Sx*(Sxz*Szy - Szz*Sxy))/Det;
+
+	FloorPlane Refined;
+	if ( SetPlane( (float)-a, 1.0f, (float)-b, (float)-c, Refined ) == false )
+	{
+		return 0;
+	}
+
+	Refined.NbInliers = CountInliers( Refined );
+	Plane = Refined;
+	return n;
+}
+
+bool FloorPlaneEstimator::Update(const unsigned short * Depth, FloorPlane& Result)
+{
+	if ( Depth == nullptr || IsValid() == false )
+	{
+		return false;
+	}
+
+	SamplePoints( Depth );
+	const int MinInliers = (int)Points.size()/20 > 100 ? (int)Points.size()/20 : 100;
+
+	// Follow current floor while it keeps enough support
+	FloorPlane Candidate = Current;
+	bool Tracked = Current.IsValid() == true && Refine( Candidate ) != 0 &&
+		Candidate.NbInliers >= MinInliers && 2*Candidate.NbInliers >= Current.NbInliers;
+
+	if ( Tracked == true )
+	{
+		FloorPlane Smoothed;
+		const Vector4& o = Current.Plane;
+		const Vector4& c = Candidate.Plane;
+		if ( SetPlane( o.x + TrackingAlpha*(c.x - o.x), o.y + TrackingAlpha*(c.y - o.y), o.z + TrackingAlpha*(c.z - o.z),
+			o.w + TrackingAlpha*(c.w - o.w), Smoothed ) == false )
+		{
+			Smoothed = Candidate;
+		}
+		Smoothed.NbInliers = Candidate.NbInliers;
+
+		float CosAngle = o.x*Smoothed.Plane.x + o.y*Smoothed.Plane.y + o.z*Smoothed.Plane.z;
+		float AngleInDegrees = acosf( CosAngle < 1.0f ? CosAngle : 1.0f )*180.0f/Pi;
+		if ( AngleInDegrees < StableAngleInDegrees && fabsf(Smoothed.Plane.w - o.w) < StableHeight )
+		{
+			NbStableFrames++;
+		}
+		else
+		{
+			NbStableFrames = 0;
+		}
+
+		Current = Smoothed;
+	}
+	else
+	{
+		// Lost or never found, search again
+		NbStableFrames = 0;
+		if ( Ransac( Candidate ) == false || Candidate.NbInliers < MinInliers )
+		{
+			Result = Current;
+			return false;
+		}
+		Current = Candidate;
+	}
+
+	Result = Current;
+	return true;
+}
+
+/* static */ bool FloorPlaneEstimator::EstimateSession(const char * SessionFolder, std::vector<FloorPlane>& PerFrame)
+{
+	PerFrame.clear();
+
+	DepthFrameToCameraSpaceTable SessionTable;
+	if ( DepthCameraModel::GetSessionUnprojectionTable( SessionFolder, SessionTable ) == false )
+	{
+		fprintf( stderr, "No depth table nor intrinsics in '%s'\n", SessionFolder );
+		return false;
+	}
+
+	std::string RawFileName = TimestampFileReader::GetStreamFileName( SessionFolder, "depth", "raw" );
+	FILE * f = fopen( RawFileName.c_str(), "rb" );
+	if ( f == (FILE*)nullptr )
+	{
+		fprintf( stderr, "Could not open '%s' depth file\n", RawFileName.c_str() );
+		return false;
+	}
+
+	FloorPlaneEstimator Estimator( SessionTable );
+	std::vector<unsigned short> Frame( DepthWidth*DepthHeight );
+	FloorPlane Result;
+	while( fread( &Frame[0], sizeof(unsigned short), Frame.size(), f ) == Frame.size() )
+	{
+		Estimator.Update( &Frame[0], Result );
+		PerFrame.push_back( Result );
+	}
+	fclose(f);
+
+	if ( Estimator.GetFloorPlane().IsValid() == false )
+	{
+		return false;
+	}
+
+	return Estimator.GetFloorPlane().SaveInSession( SessionFolder );
+}
+
+#endif // KINECT_2
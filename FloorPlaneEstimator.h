@@ -0,0 +1,194 @@
+/**
+ * @file FloorPlaneEstimator.h
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#ifndef __FLOOR_PLANE_ESTIMATOR_H__
+#define __FLOOR_PLANE_ESTIMATOR_H__
+
+#ifdef KINECT_2
+
+#include "KinectBasics.h"
+#include "DepthFrameToCameraSpaceTable.h"
+
+#include <vector>
+
+// Add Serialization facilities
+#include <Messaging/Serializable.h>
+
+namespace MobileRGBD { namespace Kinect2 {
+
+/**
+ * @class FloorPlane FloorPlaneEstimator.cpp FloorPlaneEstimator.h
+ * @brief Floor plane in camera space, same convention as the SDK FloorClipPlane:
+ * Plane.x*X + Plane.y*Y + Plane.z*Z + Plane.w = 0, (x,y,z) unit normal pointing up, w height of the sensor in meters.
+ * Stored in sessions as "depth/depth.floor" (JSON).
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class FloorPlane : public Omiscid::Serializable
+{
+public:
+	/** @brief constructor. Plane is not valid.
+	 */
+	FloorPlane()
+	{
+		Plane.x = Plane.y = Plane.z = Plane.w = 0.0f;
+		TiltInDegrees = 0.0f;
+		NbInliers = 0;
+	}
+
+	/** @brief Copy constructor and operator, only values are copied (not the serialization mapping).
+	 */
+	FloorPlane(const FloorPlane& ToCopy);
+	FloorPlane& operator=(const FloorPlane& ToCopy);
+
+	/** @brief Virtual destructor, always.
+	 */
+	virtual ~FloorPlane() {}
+
+	/** @brief Is there a floor?
+	 */
+	bool IsValid() const
+	{
+		return Plane.y > 0.0f;
+	}
+
+	/** @brief Signed distance of a point to the floor (height above floor) in meters.
+	 */
+	float GetHeight(const CameraSpacePoint& Point) const
+	{
+		return Plane.x*Point.X + Plane.y*Point.Y + Plane.z*Point.Z + Plane.w;
+	}
+
+	/** @brief Save plane as a JSON object.
+	 */
+	bool Save(const char * FileName) const;
+
+	/** @brief Load plane from a JSON object written by Save, current values are kept if it fails.
+	 */
+	bool Load(const char * FileName);
+
+	/** @brief To (Un)serialize data, declare JSON mapping (NbInliers is not saved).
+	 */
+	virtual void DeclareSerializeMapping();
+
+	/** @brief Save/Load in a session folder ("SessionFolder/depth/depth.floor").
+	 */
+	bool SaveInSession(const char * SessionFolder) const;
+	bool LoadFromSession(const char * SessionFolder);
+
+	Vector4 Plane;			/*!< @brief Plane equation (as FloorClipPlane). */
+	float TiltInDegrees;	/*!< @brief Sensor tilt, atan2(Plane.z, Plane.y) in degrees. */
+	int NbInliers;			/*!< @brief Number of sampled depth points on the plane in the last frame. */
+};
+
+/**
+ * @class FloorPlaneEstimator FloorPlaneEstimator.cpp FloorPlaneEstimator.h
+ * @brief Estimate the floor from depth frames, without the SDK: depth pixels are sampled (1 every SubSampling
+ * in both directions) and unprojected with the DepthFrameToCameraSpace table, the plane is found with RANSAC
+ * (normal at most MaxTiltInDegrees from vertical, plane below the sensor, largest support) and refined by
+ * least squares on its inliers. Next frames only refine the current plane on its inliers (smoothed over time),
+ * RANSAC runs again when support is lost. The estimation is stable when the plane did not move for StableFrames frames.
+ * One estimator is used by one thread.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class FloorPlaneEstimator
+{
+public:
+	enum { SubSampling = 4, RansacIterations = 100, StableFrames = 30 };
+
+	/** @brief constructor.
+	 *
+	 * @param Table [in] lookup table of the sensor/session.
+	 * @param InlierDistance [in] max distance to the plane of floor points in meters.
+	 * @param MaxTiltInDegrees [in] max angle between floor normal and camera Y axis.
+	 */
+	FloorPlaneEstimator(const DepthFrameToCameraSpaceTable& Table, float InlierDistance = 0.03f, float MaxTiltInDegrees = 45.0f);
+
+	/** @brief Virtual destructor, always.
+	 */
+	virtual ~FloorPlaneEstimator() {}
+
+	/** @brief Is the estimator ready (valid table)?
+	 */
+	bool IsValid() const
+	{
+		return Table.IsValid();
+	}
+
+	/** @brief Forget current plane.
+	 */
+	void Reset();
+
+	/** @brief Process a depth frame.
+	 *
+	 * @param Depth [in] depth frame (DepthWidth*DepthHeight values in mm).
+	 * @param Result [out] floor plane after this frame.
+	 * @return true if the floor was seen in this frame.
+	 */
+	bool Update(const unsigned short * Depth, FloorPlane& Result);
+
+	/** @brief Current floor plane.
+	 */
+	const FloorPlane& GetFloorPlane() const
+	{
+		return Current;
+	}
+
+	/** @brief Did the plane stay still during the last StableFrames frames?
+	 */
+	bool IsStable() const
+	{
+		return NbStableFrames >= StableFrames;
+	}
+
+	/** @brief Estimate floor on a recorded session ("SessionFolder/depth/depth.raw") and save the final plane
+	 * in the session ("depth/depth.floor").
+	 *
+	 * @param SessionFolder [in] session folder.
+	 * @param PerFrame [out] floor plane after each depth frame.
+	 * @return true if a floor was found and saved.
+	 */
+	static bool EstimateSession(const char * SessionFolder, std::vector<FloorPlane>& PerFrame);
+
+protected:
+	/** @brief Unproject sampled depth pixels to Points.
+	 */
+	void SamplePoints(const unsigned short * Depth);
+
+	/** @brief Search a floor on Points from scratch.
+	 */
+	bool Ransac(FloorPlane& Result);
+
+	/** @brief Least squares fit of Y = a*X + b*Z + c on points close to Plane, then update Plane.
+	 *
+	 * @return number of points used, 0 if the fit failed.
+	 */
+	int Refine(FloorPlane& Plane) const;
+
+	/** @brief Set Plane from its normal (any length) and a point.
+	 */
+	bool SetPlane(float nx, float ny, float nz, float d, FloorPlane& Plane) const;
+
+	/** @brief Number of points close to a plane.
+	 */
+	int CountInliers(const FloorPlane& Plane) const;
+
+	DepthFrameToCameraSpaceTable Table;		/*!< @brief Unprojection table. */
+	float InlierDistance;					/*!< @brief Max distance to the floor in meters. */
+	float MinNormalY;						/*!< @brief Cosinus of the max tilt. */
+	std::vector<CameraSpacePoint> Points;	/*!< @brief Sampled points of the current frame. */
+	unsigned int RandomState;				/*!< @brief Deterministic random generator for RANSAC. */
+	FloorPlane Current;						/*!< @brief Current floor. */
+	int NbStableFrames;						/*!< @brief Number of consecutive frames without plane motion. */
+};
+
+}} // namespace MobileRGBD::Kinect2
+
+#endif // KINECT_2
+
+#endif // __FLOOR_PLANE_ESTIMATOR_H__
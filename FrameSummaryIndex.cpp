@@ -0,0 +1,463 @@
+/**
+ * @file FrameSummaryIndex.cpp
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#include "FrameSummaryIndex.h"
+
+#ifdef KINECT_2
+
+#include "KinectBody.h"
+#include "KinectFace.h"
+#include "LittleEndianRecord.h"
+
+#include <string.h>
+
+using namespace MobileRGBD::Kinect2;
+
+namespace {
+
+const char IndexMagic[4] = { 'F', 'S', 'U', 'M' };
+const unsigned int IndexVersion = 2;
+
+const TIMESPAN MaxFaceAge = 1000000;	// Faces older than 100 ms are not in the body frame summary
+
+// Little-endian layout of the sidecar file, whatever the platform:
+// - header: magic, version, number of frames, number of features, body size, face size (32 bits), lean threshold
+//   (float), skeleton and face raw file sizes (64 bits);
+// - device time of each frame (64 bits), number of bodies of each frame (8 bits), then feature columns (64 bits words).
+const size_t HeaderSize = 44;
+
+/** @brief Number of bits set in a word.
+ */
+static inline int CountBits(UINT64 Word)
+{
+	Word = Word - ((Word >> 1) & 0x5555555555555555ULL);
+	Word = (Word & 0x3333333333333333ULL) + ((Word >> 2) & 0x3333333333333333ULL);
+	Word = (Word + (Word >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+	return (int)((Word*0x0101010101010101ULL) >> 56);
+}
+
+} // namespace
+
+FrameSummaryIndex::FrameSummaryIndex(float _LeanThreshold /* = 0.3f */)
+{
+	LeanThreshold = _LeanThreshold;
+	Clear();
+}
+
+void FrameSummaryIndex::Clear()
+{
+	NbFrames = 0;
+	NbWords = 0;
+	BodySize = 0;
+	FaceSize = 0;
+	SkeletonRawFileSize = 0;
+	FaceRawFileSize = -1;
+	RelativeTimes.clear();
+	BodyCounts.clear();
+	Bits.clear();
+}
+
+bool FrameSummaryIndex::Open(const char * SessionFolder)
+{
+	// Compute record sizes of this platform
+	KinectBodies Bodies;
+	KinectFaces Faces;
+
+	const float RequestedLeanThreshold = LeanThreshold;
+	const std::string FileName = TimestampFileReader::GetStreamFileName( SessionFolder, "skeleton", "fsum" );
+	const long long int CurrentSkeletonSize = TimestampFileReader::GetFileSize( TimestampFileReader::GetStreamFileName( SessionFolder, "skeleton", "raw" ).c_str() );
+	const long long int CurrentFaceSize = TimestampFileReader::GetFileSize( TimestampFileReader::GetStreamFileName( SessionFolder, "face", "raw" ).c_str() );
+	if ( Load( FileName.c_str() ) == true && SkeletonRawFileSize == CurrentSkeletonSize && FaceRawFileSize == CurrentFaceSize &&
+		BodySize == KinectBody::BodySize && FaceSize == KinectFace::FaceSize && LeanThreshold == RequestedLeanThreshold )
+	{
+		return true;
+	}
+
+	LeanThreshold = RequestedLeanThreshold;
+
+	if ( Build( SessionFolder ) == false )
+	{
+		return false;
+	}
+
+	// Index is usable even if the session folder is read only
+	Save( FileName.c_str() );
+	return true;
+}
+
+bool FrameSummaryIndex::Build(const char * SessionFolder)
+{
+	Clear();
+
+	// KinectBodies and KinectFaces compute KinectBody::BodySize and KinectFace::FaceSize
+	KinectBodies Bodies;
+	KinectFaces Faces;
+
+	RecordStreamReader BodyStream;
+	if ( BodyStream.Open( SessionFolder, "skeleton", KinectBody::BodySize ) == false )
+	{
+		fprintf( stderr, "Could not read skeleton stream of '%s'\n", SessionFolder );
+		return false;
+	}
+
+	// Face stream is optional
+	RecordStreamReader FaceStream;
+	FaceStream.Open( SessionFolder, "face", KinectFace::FaceSize );
+
+	const std::string BodyFileName = TimestampFileReader::GetStreamFileName( SessionFolder, "skeleton", "raw" );
+	const std::string FaceFileName = TimestampFileReader::GetStreamFileName( SessionFolder, "face", "raw" );
+	BodySize = KinectBody::BodySize;
+	FaceSize = KinectFace::FaceSize;
+	SkeletonRawFileSize = TimestampFileReader::GetFileSize( BodyFileName.c_str() );
+	FaceRawFileSize = TimestampFileReader::GetFileSize( FaceFileName.c_str() );
+
+	// Streaming pass: one feature mask per frame, transposed in columns at the end
+	const size_t NbBodyFrames = BodyStream.GetRecords().size();
+	std::vector<unsigned int> FrameMasks;
+	FrameMasks.reserve( NbBodyFrames );
+	RelativeTimes.reserve( NbBodyFrames );
+	BodyCounts.reserve( NbBodyFrames );
+
+	unsigned int FaceMask = 0;
+	TIMESPAN FaceTime = 0;
+	int NbFaces = 0;
+
+	// Stops at the end of the records or of a truncated file, keep what we have
+	int NbRecords;
+	while( BodyStream.ReadFrame( Bodies.BodyData, NbRecords ) == true )
+	{
+		const TIMESPAN BodyTime = BodyStream.GetRecord().RelativeTime;
+
+		unsigned int Mask = 0;
+		int NbBodies = 0;
+		for( int b = 0; b < NbRecords; b++ )
+		{
+			const KinectBody& Body = Bodies.BodiesInformation[b];
+
+			// Old recordings saved empty slots
+			if ( *Body.trackingId == 0 )
+			{
+				continue;
+			}
+			NbBodies++;
+
+			for( int h = 0; h < KinectBody::NumberOfHands; h++ )
+			{
+				switch( Body.HandsState[h] )
+				{
+					case HandState_Open:
+						Mask |= 1 << AnyHandOpen;
+						break;
+					case HandState_Closed:
+						Mask |= 1 << AnyHandClosed;
+						break;
+					case HandState_Lasso:
+						Mask |= 1 << AnyHandLasso;
+						break;
+					default:
+						break;
+				}
+			}
+
+			if ( *Body.LeanTrackingState != TrackingState_NotTracked )
+			{
+				Mask |= Body.Lean->X <= -LeanThreshold ? 1 << AnyLeanLeft : 0;
+				Mask |= Body.Lean->X >= LeanThreshold ? 1 << AnyLeanRight : 0;
+				Mask |= Body.Lean->Y >= LeanThreshold ? 1 << AnyLeanForward : 0;
+				Mask |= Body.Lean->Y <= -LeanThreshold ? 1 << AnyLeanBackward : 0;
+			}
+
+			Mask |= *Body.Engaged == DetectionResult_Yes ? 1 << AnyEngaged : 0;
+			Mask |= *Body.IsRestricted != 0 ? 1 << AnyRestricted : 0;
+		}
+		for( int n = 0; n < NbBodies; n++ )
+		{
+			Mask |= 1 << (AtLeast1Body + n);
+		}
+
+		// Last face frame not after this body frame
+		if ( FaceStream.ReadFramesNotAfter( BodyTime, Faces.FaceData, NbFaces ) != 0 )
+		{
+			FaceMask = 0;
+			for( int i = 0; i < NbFaces; i++ )
+			{
+				const KinectFace& Face = Faces.FacesInformation[i];
+				if ( *Face.TrackingId == 0 )
+				{
+					continue;
+				}
+				FaceMask |= 1 << AnyFace;
+				for( int p = 0; p < FaceProperty_Count; p++ )
+				{
+					FaceMask |= Face.FaceProperties[p] == DetectionResult_Yes ? 1 << (AnyFaceHappy + p) : 0;
+				}
+			}
+			FaceTime = FaceStream.GetRecord().RelativeTime;
+		}
+		if ( FaceStream.GetNumFrame() >= 0 && BodyTime - FaceTime <= MaxFaceAge )
+		{
+			Mask |= FaceMask;
+		}
+
+		FrameMasks.push_back( Mask );
+		RelativeTimes.push_back( BodyTime );
+		BodyCounts.push_back( (unsigned char)NbBodies );
+	}
+
+	// Feature columns
+	NbFrames = (int)FrameMasks.size();
+	NbWords = (NbFrames + 63)/64;
+	Bits.assign( (size_t)NumberOfFeatures*NbWords, 0 );
+	for( int f = 0; f < NbFrames; f++ )
+	{
+		for( unsigned int Mask = FrameMasks[f]; Mask != 0; Mask &= Mask - 1 )
+		{
+			int Which = 0;
+			while( ((Mask >> Which) & 1) == 0 )
+			{
+				Which++;
+			}
+			SetFeature( f, Which );
+		}
+	}
+
+	return true;
+}
+
+bool FrameSummaryIndex::Save(const char * FileName) const
+{
+	if ( BodySize == 0 )
+	{
+		return false;
+	}
+
+	std::vector<unsigned char> Content( HeaderSize + (size_t)NbFrames*(sizeof(UINT64) + 1) + Bits.size()*sizeof(UINT64) );
+	memcpy( &Content[0], IndexMagic, sizeof(IndexMagic) );
+	RecordWriter w = { &Content[sizeof(IndexMagic)] };
+	w.U32( IndexVersion );
+	w.U32( (unsigned int)NbFrames );
+	w.U32( NumberOfFeatures );
+	w.U32( (unsigned int)BodySize );
+	w.U32( (unsigned int)FaceSize );
+	w.F32( LeanThreshold );
+	w.U64( (unsigned long long int)SkeletonRawFileSize );
+	w.U64( (unsigned long long int)FaceRawFileSize );
+	for( int Frame = 0; Frame < NbFrames; Frame++ )
+	{
+		w.U64( (unsigned long long int)RelativeTimes[Frame] );
+	}
+	for( int Frame = 0; Frame < NbFrames; Frame++ )
+	{
+		w.U8( BodyCounts[Frame] );
+	}
+	for( size_t i = 0; i < Bits.size(); i++ )
+	{
+		w.U64( Bits[i] );
+	}
+
+	FILE * f = fopen( FileName, "wb" );
+	if ( f == (FILE*)nullptr )
+	{
+		fprintf( stderr, "Could not create '%s' index file\n", FileName );
+		return false;
+	}
+	bool Res = fwrite( &Content[0], Content.size(), 1, f ) == 1;
+	fclose(f);
+
+	return Res;
+}
+
+bool FrameSummaryIndex::Load(const char * FileName)
+{
+	Clear();
+
+	FILE * f = fopen( FileName, "rb" );
+	if ( f == (FILE*)nullptr )
+	{
+		return false;
+	}
+
+	unsigned char Header[HeaderSize];
+	if ( fread( Header, HeaderSize, 1, f ) != 1 || memcmp( Header, IndexMagic, sizeof(IndexMagic) ) != 0 )
+	{
+		fclose(f);
+		return false;
+	}
+
+	RecordReader r = { Header + sizeof(IndexMagic) };
+	const unsigned int Version = r.U32();
+	const unsigned int lNbFrames = r.U32();
+	const unsigned int NbFeatures = r.U32();
+	const int lBodySize = (int)r.U32();
+	const int lFaceSize = (int)r.U32();
+	const float lLeanThreshold = r.F32();
+	const long long int lSkeletonRawFileSize = (long long int)r.U64();
+	const long long int lFaceRawFileSize = (long long int)r.U64();
+	const long long int lNbWords = ((long long int)lNbFrames + 63)/64;
+	if ( Version != IndexVersion || NbFeatures != NumberOfFeatures || lNbFrames > 0x7fffffffU ||
+		TimestampFileReader::GetFileSize( FileName ) != (long long int)HeaderSize + (long long int)lNbFrames*(long long int)(sizeof(UINT64) + 1) +
+			(long long int)NumberOfFeatures*lNbWords*(long long int)sizeof(UINT64) )
+	{
+		fclose(f);
+		return false;
+	}
+
+	std::vector<unsigned char> Content( (size_t)lNbFrames*(sizeof(UINT64) + 1) + (size_t)NumberOfFeatures*(size_t)lNbWords*sizeof(UINT64) );
+	bool Res = Content.empty() == true || fread( &Content[0], Content.size(), 1, f ) == 1;
+	fclose(f);
+
+	if ( Res == false )
+	{
+		return false;
+	}
+
+	NbFrames = (int)lNbFrames;
+	NbWords = (int)lNbWords;
+	RelativeTimes.resize( NbFrames );
+	BodyCounts.resize( NbFrames );
+	Bits.resize( (size_t)NumberOfFeatures*NbWords );
+	r.Buffer = Content.empty() == true ? (const unsigned char *)nullptr : &Content[0];
+	for( int Frame = 0; Frame < NbFrames; Frame++ )
+	{
+		RelativeTimes[Frame] = (TIMESPAN)r.U64();
+	}
+	for( int Frame = 0; Frame < NbFrames; Frame++ )
+	{
+		BodyCounts[Frame] = (unsigned char)r.U8();
+	}
+	for( size_t i = 0; i < Bits.size(); i++ )
+	{
+		Bits[i] = r.U64();
+	}
+
+	BodySize = lBodySize;
+	FaceSize = lFaceSize;
+	LeanThreshold = lLeanThreshold;
+	SkeletonRawFileSize = lSkeletonRawFileSize;
+	FaceRawFileSize = lFaceRawFileSize;
+	return true;
+}
+
+int FrameSummaryIndex::Query(const FrameSummaryQuery& Query, std::vector<UINT64>& Result) const
+{
+	Result.assign( NbWords, 0 );
+	if ( NbFrames == 0 || (Query.Required & Query.Excluded) != 0 )
+	{
+		return 0;
+	}
+
+	// Columns to combine
+	const UINT64 * RequiredColumns[NumberOfFeatures];
+	const UINT64 * ExcludedColumns[NumberOfFeatures];
+	int NbRequired = 0;
+	int NbExcluded = 0;
+	for( int i = 0; i < NumberOfFeatures; i++ )
+	{
+		if ( (Query.Required >> i) & 1 )
+		{
+			RequiredColumns[NbRequired++] = &Bits[(size_t)i*NbWords];
+		}
+		if ( (Query.Excluded >> i) & 1 )
+		{
+			ExcludedColumns[NbExcluded++] = &Bits[(size_t)i*NbWords];
+		}
+	}
+
+	int w = 0;
+#ifdef KINECT_SSE2
+	for( ; w + 2 <= NbWords; w += 2 )
+	{
+		__m128i Acc = _mm_set1_epi32( -1 );
+		for( int i = 0; i < NbRequired; i++ )
+		{
+			Acc = _mm_and_si128( Acc, _mm_loadu_si128( (const __m128i*)&RequiredColumns[i][w] ) );
+		}
+		for( int i = 0; i < NbExcluded; i++ )
+		{
+			Acc = _mm_andnot_si128( _mm_loadu_si128( (const __m128i*)&ExcludedColumns[i][w] ), Acc );
+		}
+		_mm_storeu_si128( (__m128i*)&Result[w], Acc );
+	}
+#endif
+	for( ; w < NbWords; w++ )
+	{
+		UINT64 Acc = ~(UINT64)0;
+		for( int i = 0; i < NbRequired; i++ )
+		{
+			Acc &= RequiredColumns[i][w];
+		}
+		for( int i = 0; i < NbExcluded; i++ )
+		{
+			Acc &= ~ExcludedColumns[i][w];
+		}
+		Result[w] = Acc;
+	}
+
+	// Bits after the last frame
+	if ( (NbFrames & 63) != 0 )
+	{
+		Result[NbWords-1] &= ((UINT64)1 << (NbFrames & 63)) - 1;
+	}
+
+	int NbMatches = 0;
+	for( w = 0; w < NbWords; w++ )
+	{
+		NbMatches += CountBits( Result[w] );
+	}
+	return NbMatches;
+}
+
+int FrameSummaryIndex::Query(const FrameSummaryQuery& lQuery, std::vector<int>& Frames) const
+{
+	std::vector<UINT64> Result;
+	const int NbMatches = Query( lQuery, Result );
+
+	Frames.clear();
+	Frames.reserve( NbMatches );
+	for( int w = 0; w < NbWords; w++ )
+	{
+		for( UINT64 Word = Result[w]; Word != 0; Word &= Word - 1 )
+		{
+			int Bit = 0;
+			while( ((Word >> Bit) & 1) == 0 )
+			{
+				Bit++;
+			}
+			Frames.push_back( w*64 + Bit );
+		}
+	}
+	return NbMatches;
+}
+
+/* static */ int FrameSummaryIndex::QuerySessions(const std::vector<std::string>& SessionFolders, const FrameSummaryQuery& Query, std::vector<FrameSummaryMatch>& Matches, float LeanThreshold /* = 0.3f */)
+{
+	Matches.clear();
+
+	FrameSummaryIndex Index( LeanThreshold );
+	std::vector<int> Frames;
+	for( size_t s = 0; s < SessionFolders.size(); s++ )
+	{
+		if ( Index.Open( SessionFolders[s].c_str() ) == false )
+		{
+			continue;
+		}
+
+		Index.Query( Query, Frames );
+		for( size_t i = 0; i < Frames.size(); i++ )
+		{
+			FrameSummaryMatch Match;
+			Match.Session = (int)s;
+			Match.Frame = Frames[i];
+			Match.RelativeTime = Index.GetRelativeTime( Frames[i] );
+			Matches.push_back( Match );
+		}
+	}
+
+	return (int)Matches.size();
+}
+
+#endif // KINECT_2
@@ -0,0 +1,200 @@
+/**
+ * @file FrameSummaryIndex.h
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#ifndef __FRAME_SUMMARY_INDEX_H__
+#define __FRAME_SUMMARY_INDEX_H__
+
+#ifdef KINECT_2
+
+#include "KinectBasics.h"
+#include "TimestampFileReader.h"
+
+#include <string>
+#include <vector>
+
+namespace MobileRGBD { namespace Kinect2 {
+
+/**
+ * @class FrameSummaryQuery FrameSummaryIndex.cpp FrameSummaryIndex.h
+ * @brief Query on frame summaries: frames having all Required features and none of Excluded ones.
+ * Masks are combinations of (1 << FrameSummaryIndex::Feature), for instance "at least 2 bodies, a closed hand and a
+ * happy face" is (1 << AtLeast2Bodies) | (1 << AnyHandClosed) | (1 << AnyFaceHappy).
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class FrameSummaryQuery
+{
+public:
+	/** @brief constructor.
+	 */
+	FrameSummaryQuery(unsigned int _Required = 0, unsigned int _Excluded = 0)
+	{
+		Required = _Required;
+		Excluded = _Excluded;
+	}
+
+	unsigned int Required;		/*!< @brief Features that must be present. */
+	unsigned int Excluded;		/*!< @brief Features that must be absent. */
+};
+
+/**
+ * @class FrameSummaryMatch FrameSummaryIndex.cpp FrameSummaryIndex.h
+ * @brief A frame matching a query in a set of sessions.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class FrameSummaryMatch
+{
+public:
+	int Session;				/*!< @brief Index of the session in the queried list. */
+	int Frame;					/*!< @brief Index of the frame in the skeleton timestamp file. */
+	TIMESPAN RelativeTime;		/*!< @brief Device time of the frame (100 ns ticks). */
+};
+
+/**
+ * @class FrameSummaryIndex FrameSummaryIndex.cpp FrameSummaryIndex.h
+ * @brief Per-frame summary of the skeleton and face streams of a session, to select frames without decoding raw
+ * records. For each skeleton frame: number of bodies, and one bit per Feature (body count thresholds, hand states,
+ * lean, engagement, face properties of the last face frame less than 100 ms before). Features are stored by column
+ * as bitsets (64 frames per word), so queries are AND/ANDNOT of columns (SSE2 when available).
+ * Built in one streaming pass and persisted as a sidecar file ("SessionFolder/skeleton/skeleton.fsum"), rebuilt by
+ * Open when raw files or record sizes changed.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class FrameSummaryIndex
+{
+public:
+	/** @brief Features of a frame. "Any" features are set if at least one body/face has it.
+	 */
+	enum Feature
+	{
+		AtLeast1Body = 0, AtLeast2Bodies, AtLeast3Bodies, AtLeast4Bodies, AtLeast5Bodies, AtLeast6Bodies,
+		AnyHandOpen, AnyHandClosed, AnyHandLasso,
+		AnyLeanLeft, AnyLeanRight, AnyLeanForward, AnyLeanBackward,
+		AnyEngaged, AnyRestricted,
+		AnyFace,
+		AnyFaceHappy, AnyFaceEngaged, AnyFaceWearingGlasses, AnyFaceLeftEyeClosed, AnyFaceRightEyeClosed,
+		AnyFaceMouthOpen, AnyFaceMouthMoved, AnyFaceLookingAway,
+		NumberOfFeatures
+	};
+
+	/** @brief constructor. Empty index.
+	 *
+	 * @param LeanThreshold [in] absolute lean value (in [0;1]) to consider a body leaning.
+	 */
+	FrameSummaryIndex(float LeanThreshold = 0.3f);
+
+	/** @brief Virtual destructor, always.
+	 */
+	virtual ~FrameSummaryIndex() {}
+
+	/** @brief Empty the index.
+	 */
+	void Clear();
+
+	/** @brief Load the index of a session from its sidecar file, build and save it if missing or outdated.
+	 *
+	 * @param SessionFolder [in] session folder.
+	 * @return true if the index is available.
+	 */
+	bool Open(const char * SessionFolder);
+
+	/** @brief Build the index of a session (the face stream is optional).
+	 *
+	 * @param SessionFolder [in] session folder.
+	 * @return true if built.
+	 */
+	bool Build(const char * SessionFolder);
+
+	/** @brief Save index in a file.
+	 */
+	bool Save(const char * FileName) const;
+
+	/** @brief Load index from a file.
+	 */
+	bool Load(const char * FileName);
+
+	/** @brief Number of indexed skeleton frames.
+	 */
+	int GetNbFrames() const
+	{
+		return NbFrames;
+	}
+
+	/** @brief Number of bodies of a frame.
+	 */
+	int GetNbBodies(int Frame) const
+	{
+		return (int)BodyCounts[Frame];
+	}
+
+	/** @brief Device time of a frame.
+	 */
+	TIMESPAN GetRelativeTime(int Frame) const
+	{
+		return RelativeTimes[Frame];
+	}
+
+	/** @brief Has a frame a feature?
+	 */
+	bool HasFeature(int Frame, Feature Which) const
+	{
+		return ((Bits[(size_t)Which*NbWords + (Frame >> 6)] >> (Frame & 63)) & 1) != 0;
+	}
+
+	/** @brief Evaluate a query.
+	 *
+	 * @param Query [in] query.
+	 * @param Result [out] bitset of matching frames (64 frames per word).
+	 * @return number of matching frames.
+	 */
+	int Query(const FrameSummaryQuery& Query, std::vector<UINT64>& Result) const;
+
+	/** @brief Evaluate a query.
+	 *
+	 * @param Query [in] query.
+	 * @param Frames [out] matching frames in increasing order.
+	 * @return number of matching frames.
+	 */
+	int Query(const FrameSummaryQuery& Query, std::vector<int>& Frames) const;
+
+	/** @brief Evaluate a query on several sessions, opening (thus building if needed) their index.
+	 *
+	 * @param SessionFolders [in] sessions.
+	 * @param Query [in] query.
+	 * @param Matches [out] matching frames, by session then frame.
+	 * @param LeanThreshold [in] lean threshold used if an index is built.
+	 * @return number of matching frames, sessions without skeleton stream are ignored.
+	 */
+	static int QuerySessions(const std::vector<std::string>& SessionFolders, const FrameSummaryQuery& Query, std::vector<FrameSummaryMatch>& Matches, float LeanThreshold = 0.3f);
+
+protected:
+	/** @brief Set a feature of a frame.
+	 */
+	void SetFeature(int Frame, int Which)
+	{
+		Bits[(size_t)Which*NbWords + (Frame >> 6)] |= (UINT64)1 << (Frame & 63);
+	}
+
+	float LeanThreshold;						/*!< @brief Lean threshold. */
+	int NbFrames;								/*!< @brief Number of frames. */
+	int NbWords;								/*!< @brief 64 bits words per feature column. */
+	int BodySize;								/*!< @brief KinectBody::BodySize when built. */
+	int FaceSize;								/*!< @brief KinectFace::FaceSize when built. */
+	long long int SkeletonRawFileSize;			/*!< @brief Size of the skeleton raw file when built. */
+	long long int FaceRawFileSize;				/*!< @brief Size of the face raw file when built (-1 if none). */
+	std::vector<TIMESPAN> RelativeTimes;		/*!< @brief Device time of each frame. */
+	std::vector<unsigned char> BodyCounts;		/*!< @brief Number of bodies of each frame. */
+	std::vector<UINT64> Bits;					/*!< @brief NumberOfFeatures columns of NbWords words. */
+};
+
+}} // namespace MobileRGBD::Kinect2
+
+#endif // KINECT_2
+
+#endif // __FRAME_SUMMARY_INDEX_H__
@@ -0,0 +1,516 @@
+/**
+ * @file GestureDetection.cpp
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#include "GestureDetection.h"
+
+#ifdef KINECT_2
+
+#include "TimestampFileReader.h"
+
+#include <math.h>
+#include <stdio.h>
+
+using namespace MobileRGBD::Kinect2;
+
+namespace {
+
+const TIMESPAN MaxFrameGap = 5000000;	// Longer gaps (0.5 s) restart the history of a body
+
+const char * EventNames[GestureEvent::NumberOfEventTypes] = {
+	"BodyAppeared", "BodyLost",
+	"HandRaised", "HandLowered", "Wave",
+	"Approaching", "Leaving",
+	"SatDown", "StoodUp"
+};
+
+// Joints of each hand side, in KinectBody::HandLeft, KinectBody::HandRight order
+const int HandJoints[KinectBody::NumberOfHands] = { JointType_HandLeft, JointType_HandRight };
+const int ElbowJoints[KinectBody::NumberOfHands] = { JointType_ElbowLeft, JointType_ElbowRight };
+
+/** @brief Seconds to device time.
+ */
+static inline TIMESPAN ToTimespan(float Seconds)
+{
+	return (TIMESPAN)(Seconds*1e7f);
+}
+
+/** @brief Distance between 2 joints.
+ */
+static inline float JointDistance(const GestureSample& Sample, int j0, int j1)
+{
+	const float dx = Sample.Positions[j0].X - Sample.Positions[j1].X;
+	const float dy = Sample.Positions[j0].Y - Sample.Positions[j1].Y;
+	const float dz = Sample.Positions[j0].Z - Sample.Positions[j1].Z;
+	return sqrtf( dx*dx + dy*dy + dz*dz );
+}
+
+} // namespace
+
+void GestureBodyHistory::Add(const KinectBody& Body, TIMESPAN RelativeTime)
+{
+	Newest = (Newest + 1) % Capacity;
+	NbSamples = NbSamples < Capacity ? NbSamples + 1 : Capacity;
+
+	GestureSample& Sample = Samples[Newest];
+	Sample.RelativeTime = RelativeTime;
+	for( int j = 0; j < JointType_Count; j++ )
+	{
+		Sample.Positions[j] = Body.Joints[j].Position;
+		Sample.States[j] = (unsigned char)Body.Joints[j].TrackingState;
+	}
+}
+
+/* static */ void GestureDetector::AddEvent(std::vector<GestureEvent>& Events, int Type, int Side, const GestureBodyHistory& History, float Value)
+{
+	GestureEvent Event;
+	Event.Type = Type;
+	Event.Side = Side;
+	Event.TrackingId = History.GetTrackingId();
+	Event.RelativeTime = History.GetSample(0).RelativeTime;
+	Event.Value = Value;
+	Events.push_back( Event );
+}
+
+HandRaiseDetector::HandRaiseDetector(float _Margin /* = 0.05f */, float _MinDuration /* = 0.3f */)
+{
+	Margin = _Margin;
+	MinDuration = ToTimespan( _MinDuration );
+	for( int s = 0; s < BODY_COUNT; s++ )
+	{
+		Reset( s );
+	}
+}
+
+/* virtual */ void HandRaiseDetector::Reset(int Slot)
+{
+	for( int h = 0; h < KinectBody::NumberOfHands; h++ )
+	{
+		IsRaised[Slot][h].Reset( false );
+	}
+}
+
+/* virtual */ void HandRaiseDetector::Update(int Slot, const GestureBodyHistory& History, std::vector<GestureEvent>& Events)
+{
+	const GestureSample& Sample = History.GetSample(0);
+	if ( Sample.IsTracked(JointType_Head) == false )
+	{
+		return;
+	}
+
+	const float HeadY = Sample.Positions[JointType_Head].Y;
+	for( int h = 0; h < KinectBody::NumberOfHands; h++ )
+	{
+		if ( Sample.IsTracked(HandJoints[h]) == false )
+		{
+			continue;
+		}
+
+		// Raised above head + Margin, lowered below head
+		const float HandY = Sample.Positions[HandJoints[h]].Y;
+		const bool Value = IsRaised[Slot][h].State == true ? HandY > HeadY : HandY > HeadY + Margin;
+		if ( IsRaised[Slot][h].Update( Value, Sample.RelativeTime, MinDuration ) == true )
+		{
+			AddEvent( Events, Value == true ? GestureEvent::HandRaised : GestureEvent::HandLowered, h, History, HandY - HeadY );
+		}
+	}
+}
+
+WaveDetector::WaveDetector(float _MinAmplitude /* = 0.04f */, float _Window /* = 1.5f */, int _MinCrossings /* = 4 */)
+{
+	MinAmplitude = _MinAmplitude;
+	Window = ToTimespan( _Window );
+	MinCrossings = _MinCrossings < 1 ? 1 : (_MinCrossings > MaxCrossings ? MaxCrossings : _MinCrossings);
+	for( int s = 0; s < BODY_COUNT; s++ )
+	{
+		Reset( s );
+	}
+}
+
+/* virtual */ void WaveDetector::Reset(int Slot)
+{
+	for( int h = 0; h < KinectBody::NumberOfHands; h++ )
+	{
+		Hands[Slot][h].LastSide = 0;
+		Hands[Slot][h].FirstCrossing = 0;
+		Hands[Slot][h].NbCrossings = 0;
+		Hands[Slot][h].LastWave = -1;
+	}
+}
+
+/* virtual */ void WaveDetector::Update(int Slot, const GestureBodyHistory& History, std::vector<GestureEvent>& Events)
+{
+	const GestureSample& Sample = History.GetSample(0);
+	const TIMESPAN Now = Sample.RelativeTime;
+
+	for( int h = 0; h < KinectBody::NumberOfHands; h++ )
+	{
+		WavingHand& Hand = Hands[Slot][h];
+		const int HandJoint = HandJoints[h];
+		const int ElbowJoint = ElbowJoints[h];
+
+		// Forget old crossings
+		while( Hand.NbCrossings > 0 && Now - Hand.Crossings[Hand.FirstCrossing] > Window )
+		{
+			Hand.FirstCrossing = (Hand.FirstCrossing + 1) % MaxCrossings;
+			Hand.NbCrossings--;
+		}
+
+		// Waving is done with hand above elbow
+		if ( Sample.IsTracked(HandJoint) == false || Sample.IsTracked(ElbowJoint) == false ||
+			Sample.Positions[HandJoint].Y <= Sample.Positions[ElbowJoint].Y )
+		{
+			Hand.LastSide = 0;
+			Hand.NbCrossings = 0;
+			continue;
+		}
+
+		const float dx = Sample.Positions[HandJoint].X - Sample.Positions[ElbowJoint].X;
+		const int Side = dx > MinAmplitude ? 1 : (dx < -MinAmplitude ? -1 : 0);
+		if ( Side == 0 )
+		{
+			continue;
+		}
+		if ( Hand.LastSide != 0 && Side != Hand.LastSide )
+		{
+			if ( Hand.NbCrossings == MaxCrossings )
+			{
+				Hand.FirstCrossing = (Hand.FirstCrossing + 1) % MaxCrossings;
+				Hand.NbCrossings--;
+			}
+			Hand.Crossings[(Hand.FirstCrossing + Hand.NbCrossings) % MaxCrossings] = Now;
+			Hand.NbCrossings++;
+		}
+		Hand.LastSide = Side;
+
+		if ( Hand.NbCrossings >= MinCrossings && (Hand.LastWave < 0 || Now - Hand.LastWave > Window) )
+		{
+			AddEvent( Events, GestureEvent::Wave, h, History, (float)Hand.NbCrossings );
+			Hand.LastWave = Now;
+			Hand.NbCrossings = 0;
+		}
+	}
+}
+
+ApproachLeaveDetector::ApproachLeaveDetector(float _MinSpeed /* = 0.3f */, float _Window /* = 1.0f */)
+{
+	MinSpeed = _MinSpeed;
+	Window = ToTimespan( _Window );
+	for( int s = 0; s < BODY_COUNT; s++ )
+	{
+		Reset( s );
+	}
+}
+
+/* virtual */ void ApproachLeaveDetector::Reset(int Slot)
+{
+	WindowStart[Slot] = -1;
+	Move[Slot] = 0;
+}
+
+/* virtual */ void ApproachLeaveDetector::Update(int Slot, const GestureBodyHistory& History, std::vector<GestureEvent>& Events)
+{
+	const GestureSample& Sample = History.GetSample(0);
+	const TIMESPAN Now = Sample.RelativeTime;
+
+	// New sample: window start is one sample older, then move it forward while the next one is still old enough
+	int Start = WindowStart[Slot] + 1;
+	Start = Start >= History.GetNbSamples() ? History.GetNbSamples() - 1 : Start;
+	while( Start > 0 && Now - History.GetSample(Start-1).RelativeTime >= Window )
+	{
+		Start--;
+	}
+	WindowStart[Slot] = Start;
+
+	const GestureSample& First = History.GetSample(Start);
+	const TIMESPAN Duration = Now - First.RelativeTime;
+	if ( Duration < Window || Sample.IsTracked(JointType_SpineBase) == false || First.IsTracked(JointType_SpineBase) == false )
+	{
+		return;
+	}
+
+	// Positive when distance to sensor decreases
+	const float Speed = (First.Positions[JointType_SpineBase].Z - Sample.Positions[JointType_SpineBase].Z)/((float)Duration*1e-7f);
+	int NewMove = Move[Slot];
+	if ( NewMove == 0 )
+	{
+		NewMove = Speed >= MinSpeed ? 1 : (Speed <= -MinSpeed ? -1 : 0);
+	}
+	else if ( Speed*(float)NewMove < 0.5f*MinSpeed )
+	{
+		NewMove = 0;
+	}
+
+	if ( NewMove != Move[Slot] && NewMove != 0 )
+	{
+		AddEvent( Events, NewMove > 0 ? GestureEvent::Approaching : GestureEvent::Leaving, -1, History, fabsf(Speed) );
+	}
+	Move[Slot] = NewMove;
+}
+
+SitStandDetector::SitStandDetector(float _SitRatio /* = 0.65f */, float _StandRatio /* = 0.8f */, float _MinDuration /* = 0.5f */)
+{
+	SitRatio = _SitRatio;
+	StandRatio = _StandRatio;
+	MinDuration = ToTimespan( _MinDuration );
+	for( int s = 0; s < BODY_COUNT; s++ )
+	{
+		Reset( s );
+	}
+}
+
+/* virtual */ void SitStandDetector::Reset(int Slot)
+{
+	IsKnown[Slot] = false;
+	IsSitting[Slot].Reset( false );
+	LegLength[Slot] = 0.0f;
+}
+
+/* virtual */ void SitStandDetector::Update(int Slot, const GestureBodyHistory& History, std::vector<GestureEvent>& Events)
+{
+	const GestureSample& Sample = History.GetSample(0);
+	if ( Sample.IsTracked(JointType_SpineBase) == false )
+	{
+		return;
+	}
+
+	// Legs with hip, knee and ankle
+	static const int Legs[2][3] = { { JointType_HipLeft, JointType_KneeLeft, JointType_AnkleLeft }, { JointType_HipRight, JointType_KneeRight, JointType_AnkleRight } };
+	float Length = 0.0f;
+	float AnkleY = 0.0f;
+	int NbLegs = 0;
+	for( int l = 0; l < 2; l++ )
+	{
+		if ( Sample.IsTracked(Legs[l][0]) == false || Sample.IsTracked(Legs[l][1]) == false || Sample.IsTracked(Legs[l][2]) == false )
+		{
+			continue;
+		}
+		Length += JointDistance( Sample, Legs[l][0], Legs[l][1] ) + JointDistance( Sample, Legs[l][1], Legs[l][2] );
+		AnkleY = NbLegs == 0 || Sample.Positions[Legs[l][2]].Y < AnkleY ? Sample.Positions[Legs[l][2]].Y : AnkleY;
+		NbLegs++;
+	}
+	if ( NbLegs == 0 )
+	{
+		return;
+	}
+
+	// Smooth leg length, it does not change with posture
+	Length /= (float)NbLegs;
+	LegLength[Slot] = LegLength[Slot] == 0.0f ? Length : LegLength[Slot] + 0.1f*(Length - LegLength[Slot]);
+	if ( LegLength[Slot] < 0.1f )
+	{
+		return;
+	}
+
+	const float Ratio = (Sample.Positions[JointType_SpineBase].Y - AnkleY)/LegLength[Slot];
+	if ( IsKnown[Slot] == false )
+	{
+		// First posture, no event
+		if ( Ratio < SitRatio || Ratio > StandRatio )
+		{
+			IsKnown[Slot] = true;
+			IsSitting[Slot].Reset( Ratio < SitRatio );
+		}
+		return;
+	}
+
+	// Between thresholds, posture does not change
+	const bool Value = Ratio < SitRatio ? true : (Ratio > StandRatio ? false : IsSitting[Slot].State);
+	if ( IsSitting[Slot].Update( Value, Sample.RelativeTime, MinDuration ) == true )
+	{
+		AddEvent( Events, Value == true ? GestureEvent::SatDown : GestureEvent::StoodUp, -1, History, Ratio );
+	}
+}
+
+GestureDetection::GestureDetection(bool AddDefaultDetectors /* = true */)
+{
+	if ( AddDefaultDetectors == true )
+	{
+		AddDetector( new HandRaiseDetector );
+		AddDetector( new WaveDetector );
+		AddDetector( new ApproachLeaveDetector );
+		AddDetector( new SitStandDetector );
+	}
+	Reset();
+}
+
+void GestureDetection::AddDetector(GestureDetector * Detector)
+{
+	Detectors.push_back( std::unique_ptr<GestureDetector>(Detector) );
+	for( int s = 0; s < BODY_COUNT; s++ )
+	{
+		Detector->Reset( s );
+	}
+}
+
+void GestureDetection::Reset()
+{
+	Histories.Clear();
+	for( int s = 0; s < BODY_COUNT; s++ )
+	{
+		Histories.Get(s).Clear( 0 );
+	}
+	Events.clear();
+}
+
+/* static */ const char * GestureDetection::GetEventName(int Type)
+{
+	if ( Type >= 0 && Type < GestureEvent::NumberOfEventTypes )
+	{
+		return EventNames[Type];
+	}
+	return "UserEvent";
+}
+
+int GestureDetection::Update(const KinectBodies& Bodies, TIMESPAN RelativeTime)
+{
+	Events.clear();
+
+	const int NbBodies = (int)(Bodies.ActualNbBody > (unsigned int)BODY_COUNT ? BODY_COUNT : Bodies.ActualNbBody);
+
+	// Forget bodies not in this frame first, their slots are free for new bodies
+	int LostSlots[BODY_COUNT];
+	const int NbLost = Histories.ReleaseMissing( Bodies, LostSlots );
+	for( int l = 0; l < NbLost; l++ )
+	{
+		GestureDetector::AddEvent( Events, GestureEvent::BodyLost, -1, Histories.Get(LostSlots[l]), 0.0f );
+		Events.back().RelativeTime = RelativeTime;
+	}
+
+	for( int b = 0; b < NbBodies; b++ )
+	{
+		const KinectBody& Body = Bodies.BodiesInformation[b];
+		const UINT64 TrackingId = *Body.trackingId;
+		if ( TrackingId == 0 )
+		{
+			continue;
+		}
+
+		bool IsNew;
+		const int Slot = Histories.Acquire( TrackingId, IsNew );
+		if ( Slot < 0 )
+		{
+			continue;
+		}
+
+		GestureBodyHistory& History = Histories.Get(Slot);
+		const TIMESPAN Gap = IsNew == true ? 0 : RelativeTime - History.GetSample(0).RelativeTime;
+		if ( IsNew == false && Gap <= 0 )
+		{
+			// Same or older frame, ignore
+			continue;
+		}
+
+		// New body, or restart detectors without event as body is still there
+		if ( IsNew == true || Gap > MaxFrameGap )
+		{
+			History.Clear( TrackingId );
+			for( size_t d = 0; d < Detectors.size(); d++ )
+			{
+				Detectors[d]->Reset( Slot );
+			}
+		}
+
+		History.Add( Body, RelativeTime );
+		if ( IsNew == true )
+		{
+			GestureDetector::AddEvent( Events, GestureEvent::BodyAppeared, -1, History, 0.0f );
+		}
+
+		for( size_t d = 0; d < Detectors.size(); d++ )
+		{
+			Detectors[d]->Update( Slot, History, Events );
+		}
+	}
+
+	if ( Events.empty() == false )
+	{
+		ProcessGestureEvents( &Events[0], (int)Events.size() );
+	}
+
+	return (int)Events.size();
+}
+
+int GestureDetection::ProcessSession(const char * SessionFolder, const char * OutputFileName /* = nullptr */)
+{
+	// KinectBodies computes KinectBody::BodySize
+	KinectBodies Bodies;
+
+	RecordStreamReader Stream;
+	if ( Stream.Open( SessionFolder, "skeleton", KinectBody::BodySize ) == false )
+	{
+		fprintf( stderr, "Could not read skeleton stream of '%s'\n", SessionFolder );
+		return -1;
+	}
+
+	FILE * fOut = nullptr;
+	if ( OutputFileName != nullptr )
+	{
+		fOut = fopen( OutputFileName, "wb" );
+		if ( fOut == (FILE*)nullptr )
+		{
+			fprintf( stderr, "Could not create '%s' event file\n", OutputFileName );
+			return -1;
+		}
+	}
+
+	Reset();
+
+	int NbEvents = 0;
+	int NbBodies;
+	while( Stream.ReadFrame( Bodies.BodyData, NbBodies ) == true )
+	{
+		Bodies.ActualNbBody = (unsigned int)NbBodies;
+
+		NbEvents += Update( Bodies, Stream.GetRecord().RelativeTime );
+		for( size_t e = 0; fOut != nullptr && e < Events.size(); e++ )
+		{
+			fprintf( fOut, "%.3f %lld %llu %s %d %f\n", Stream.GetRecord().WallClockTime, (long long int)Events[e].RelativeTime,
+				(unsigned long long int)Events[e].TrackingId, GetEventName(Events[e].Type), Events[e].Side, Events[e].Value );
+		}
+	}
+
+	if ( fOut != nullptr )
+	{
+		fclose(fOut);
+	}
+
+	return NbEvents;
+}
+
+GestureDetectionThread::GestureDetectionThread(GestureDetection& _Detection) : Detection(_Detection)
+{
+}
+
+/* virtual */ GestureDetectionThread::~GestureDetectionThread()
+{
+	Stop();
+}
+
+bool GestureDetectionThread::Start()
+{
+	return StartQueue();
+}
+
+void GestureDetectionThread::Stop()
+{
+	StopQueue();
+}
+
+bool GestureDetectionThread::Push(const KinectBodies& Bodies, TIMESPAN RelativeTime, bool WaitIfFull /* = false */)
+{
+	return Enqueue( WaitIfFull, [&](KinectBodiesSnapshot& Frame)
+	{
+		Frame.Take( Bodies, -1, RelativeTime );
+	} );
+}
+
+/* virtual */ void GestureDetectionThread::ProcessSnapshot(KinectBodiesSnapshot& Frame)
+{
+	Detection.Update( Frame.Get(), Frame.RelativeTime );
+}
+
+#endif // KINECT_2
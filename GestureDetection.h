@@ -0,0 +1,448 @@
+/**
+ * @file GestureDetection.h
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#ifndef __GESTURE_DETECTION_H__
+#define __GESTURE_DETECTION_H__
+
+#ifdef KINECT_2
+
+#include "KinectBasics.h"
+#include "KinectBody.h"
+#include "KinectFrameSnapshot.h"
+#include "SnapshotWorkQueue.h"
+#include "TrackingIdSlotTable.h"
+
+#include <memory>
+#include <vector>
+
+namespace MobileRGBD { namespace Kinect2 {
+
+/**
+ * @class GestureEvent GestureDetection.cpp GestureDetection.h
+ * @brief Event detected on a body.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class GestureEvent
+{
+public:
+	/** @brief Event types. Detectors added by users can use types from FirstUserEvent.
+	 */
+	enum
+	{
+		BodyAppeared = 0, BodyLost,
+		HandRaised, HandLowered, Wave,
+		Approaching, Leaving,
+		SatDown, StoodUp,
+		NumberOfEventTypes,
+		FirstUserEvent = 100
+	};
+
+	int Type;					/*!< @brief Event type. */
+	int Side;					/*!< @brief KinectBody::HandLeft or KinectBody::HandRight for hand events, -1 otherwise. */
+	UINT64 TrackingId;			/*!< @brief Tracking id of the body. */
+	TIMESPAN RelativeTime;		/*!< @brief Device time of the frame where the event is detected (100 ns ticks). */
+	float Value;				/*!< @brief Event dependent value (speed for Approaching/Leaving, hip height ratio for sit/stand). */
+};
+
+/**
+ * @class GestureSample GestureDetection.cpp GestureDetection.h
+ * @brief Joints of a body in a frame.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class GestureSample
+{
+public:
+	/** @brief Is a joint tracked or inferred?
+	 */
+	bool IsTracked(int Joint) const
+	{
+		return States[Joint] != TrackingState_NotTracked;
+	}
+
+	TIMESPAN RelativeTime;								/*!< @brief Device time of the frame. */
+	CameraSpacePoint Positions[JointType_Count];		/*!< @brief Joint positions (m). */
+	unsigned char States[JointType_Count];				/*!< @brief Joint tracking states. */
+};
+
+/**
+ * @class GestureBodyHistory GestureDetection.cpp GestureDetection.h
+ * @brief Ring buffer of the last samples of a tracking id (about 2 s at 30 fps).
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class GestureBodyHistory
+{
+public:
+	enum { Capacity = 64 };
+
+	/** @brief constructor. Empty history.
+	 */
+	GestureBodyHistory()
+	{
+		Clear(0);
+	}
+
+	/** @brief Empty the history.
+	 *
+	 * @param _TrackingId [in] tracking id of the new body.
+	 */
+	void Clear(UINT64 _TrackingId)
+	{
+		TrackingId = _TrackingId;
+		NbSamples = 0;
+		Newest = -1;
+	}
+
+	/** @brief Add a sample, the oldest one is forgotten when full.
+	 */
+	void Add(const KinectBody& Body, TIMESPAN RelativeTime);
+
+	/** @brief Tracking id of the body.
+	 */
+	UINT64 GetTrackingId() const
+	{
+		return TrackingId;
+	}
+
+	/** @brief Number of samples.
+	 */
+	int GetNbSamples() const
+	{
+		return NbSamples;
+	}
+
+	/** @brief Get a sample.
+	 *
+	 * @param Age [in] 0 for the newest sample, GetNbSamples()-1 for the oldest.
+	 */
+	const GestureSample& GetSample(int Age) const
+	{
+		return Samples[(Newest - Age + Capacity) % Capacity];
+	}
+
+protected:
+	UINT64 TrackingId;						/*!< @brief Tracking id of the body. */
+	int NbSamples;							/*!< @brief Number of samples. */
+	int Newest;								/*!< @brief Index of the newest sample. */
+	GestureSample Samples[Capacity];		/*!< @brief Samples. */
+};
+
+/**
+ * @class GestureDetector GestureDetection.cpp GestureDetection.h
+ * @brief Base class of detectors. A detector keeps its state for each of the BODY_COUNT body slots of
+ * GestureDetection; Update is called once per frame and per body, after the sample is added to the history.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class GestureDetector
+{
+public:
+	/** @brief Virtual destructor, always.
+	 */
+	virtual ~GestureDetector() {}
+
+	/** @brief A new body uses a slot.
+	 */
+	virtual void Reset(int Slot) = 0;
+
+	/** @brief Process the newest sample of a body.
+	 *
+	 * @param Slot [in] slot of the body.
+	 * @param History [in] history of the body.
+	 * @param Events [in,out] detected events are appended.
+	 */
+	virtual void Update(int Slot, const GestureBodyHistory& History, std::vector<GestureEvent>& Events) = 0;
+
+	/** @brief Append an event of the body at the time of its newest sample.
+	 */
+	static void AddEvent(std::vector<GestureEvent>& Events, int Type, int Side, const GestureBodyHistory& History, float Value);
+
+protected:
+	/** @brief Boolean state changing only when the opposite value lasts MinDuration.
+	 */
+	struct DebouncedState
+	{
+		/** @brief Set state and forget pending change.
+		 */
+		void Reset(bool _State)
+		{
+			State = _State;
+			ChangeSince = -1;
+		}
+
+		/** @brief Update with a new value.
+		 *
+		 * @return true if state changed.
+		 */
+		bool Update(bool Value, TIMESPAN RelativeTime, TIMESPAN MinDuration)
+		{
+			if ( Value == State )
+			{
+				ChangeSince = -1;
+				return false;
+			}
+			if ( ChangeSince < 0 )
+			{
+				ChangeSince = RelativeTime;
+			}
+			if ( RelativeTime - ChangeSince < MinDuration )
+			{
+				return false;
+			}
+			Reset( Value );
+			return true;
+		}
+
+		bool State;				/*!< @brief Current state. */
+		TIMESPAN ChangeSince;	/*!< @brief Time since the value differs from State, -1 if not. */
+	};
+};
+
+/**
+ * @class HandRaiseDetector GestureDetection.cpp GestureDetection.h
+ * @brief Hand above head (by Margin) for MinDuration: HandRaised, then HandLowered when the hand goes back below head.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class HandRaiseDetector : public GestureDetector
+{
+public:
+	/** @brief constructor.
+	 *
+	 * @param Margin [in] height of the hand above head to raise (m).
+	 * @param MinDuration [in] duration of a change (s).
+	 */
+	HandRaiseDetector(float Margin = 0.05f, float MinDuration = 0.3f);
+
+	virtual void Reset(int Slot);
+	virtual void Update(int Slot, const GestureBodyHistory& History, std::vector<GestureEvent>& Events);
+
+protected:
+	float Margin;
+	TIMESPAN MinDuration;
+	DebouncedState IsRaised[BODY_COUNT][KinectBody::NumberOfHands];
+};
+
+/**
+ * @class WaveDetector GestureDetection.cpp GestureDetection.h
+ * @brief Hand above elbow going MinCrossings times from one side of the elbow to the other (further than
+ * MinAmplitude) within Window: Wave. Crossing times are kept in a small ring, old ones are dropped as time goes.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class WaveDetector : public GestureDetector
+{
+public:
+	enum { MaxCrossings = 8 };
+
+	/** @brief constructor.
+	 *
+	 * @param MinAmplitude [in] horizontal distance from elbow to count a side (m).
+	 * @param Window [in] time window (s), also the minimum time between 2 waves.
+	 * @param MinCrossings [in] number of side changes (at most MaxCrossings).
+	 */
+	WaveDetector(float MinAmplitude = 0.04f, float Window = 1.5f, int MinCrossings = 4);
+
+	virtual void Reset(int Slot);
+	virtual void Update(int Slot, const GestureBodyHistory& History, std::vector<GestureEvent>& Events);
+
+protected:
+	/** @brief State of a hand.
+	 */
+	struct WavingHand
+	{
+		int LastSide;						/*!< @brief -1, 1 or 0 if unknown. */
+		int FirstCrossing;					/*!< @brief Oldest crossing in ring. */
+		int NbCrossings;					/*!< @brief Number of crossings in ring. */
+		TIMESPAN Crossings[MaxCrossings];	/*!< @brief Times of crossings. */
+		TIMESPAN LastWave;					/*!< @brief Time of last wave, -1 if none. */
+	};
+
+	float MinAmplitude;
+	TIMESPAN Window;
+	int MinCrossings;
+	WavingHand Hands[BODY_COUNT][KinectBody::NumberOfHands];
+};
+
+/**
+ * @class ApproachLeaveDetector GestureDetection.cpp GestureDetection.h
+ * @brief Distance of SpineBase to the sensor decreasing (Approaching) or increasing (Leaving) faster than MinSpeed
+ * over Window. The beginning of the window is followed in the history as time goes (amortized constant time).
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class ApproachLeaveDetector : public GestureDetector
+{
+public:
+	/** @brief constructor.
+	 *
+	 * @param MinSpeed [in] speed to start a move (m/s), the move ends below half of it.
+	 * @param Window [in] duration on which speed is computed (s, at most 2 s).
+	 */
+	ApproachLeaveDetector(float MinSpeed = 0.3f, float Window = 1.0f);
+
+	virtual void Reset(int Slot);
+	virtual void Update(int Slot, const GestureBodyHistory& History, std::vector<GestureEvent>& Events);
+
+protected:
+	float MinSpeed;
+	TIMESPAN Window;
+	int WindowStart[BODY_COUNT];	/*!< @brief Age of the first sample of the window. */
+	int Move[BODY_COUNT];			/*!< @brief 1 approaching, -1 leaving, 0 none. */
+};
+
+/**
+ * @class SitStandDetector GestureDetection.cpp GestureDetection.h
+ * @brief Sitting/standing from the height of SpineBase above the lowest ankle, relative to leg length (hip-knee-ankle
+ * bone lengths, which do not depend on posture): standing is about 1, sitting about 0.4. Changes are emitted as
+ * SatDown/StoodUp once the first posture is known.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class SitStandDetector : public GestureDetector
+{
+public:
+	/** @brief constructor.
+	 *
+	 * @param SitRatio [in] ratio below which body is sitting.
+	 * @param StandRatio [in] ratio above which body is standing.
+	 * @param MinDuration [in] duration of a change (s).
+	 */
+	SitStandDetector(float SitRatio = 0.65f, float StandRatio = 0.8f, float MinDuration = 0.5f);
+
+	virtual void Reset(int Slot);
+	virtual void Update(int Slot, const GestureBodyHistory& History, std::vector<GestureEvent>& Events);
+
+protected:
+	float SitRatio;
+	float StandRatio;
+	TIMESPAN MinDuration;
+	bool IsKnown[BODY_COUNT];				/*!< @brief Is the posture known? */
+	DebouncedState IsSitting[BODY_COUNT];	/*!< @brief Posture. */
+	float LegLength[BODY_COUNT];			/*!< @brief Smoothed leg length, 0 if unknown. */
+};
+
+/**
+ * @class GestureDetection GestureDetection.cpp GestureDetection.h
+ * @brief Rule based event detection on body frames. Each tracking id has a slot with its history; all detectors are
+ * updated for each body of each frame, and events of the frame are given to ProcessGestureEvents. Bodies missing in a
+ * frame are forgotten (BodyLost). Can process a recorded session (skeleton stream) as fast as it can be read.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class GestureDetection
+{
+public:
+	/** @brief constructor.
+	 *
+	 * @param AddDefaultDetectors [in] add HandRaiseDetector, WaveDetector, ApproachLeaveDetector and SitStandDetector.
+	 */
+	GestureDetection(bool AddDefaultDetectors = true);
+
+	/** @brief Virtual destructor, always.
+	 */
+	virtual ~GestureDetection() {}
+
+	/** @brief Add a detector, GestureDetection owns it.
+	 */
+	void AddDetector(GestureDetector * Detector);
+
+	/** @brief Forget all bodies (no event).
+	 */
+	void Reset();
+
+	/** @brief Process a body frame.
+	 *
+	 * @param Bodies [in] bodies of the frame (ActualNbBody bodies).
+	 * @param RelativeTime [in] device time of the frame.
+	 * @return number of events in this frame.
+	 */
+	int Update(const KinectBodies& Bodies, TIMESPAN RelativeTime);
+
+	/** @brief Events of the last frame.
+	 */
+	const std::vector<GestureEvent>& GetEvents() const
+	{
+		return Events;
+	}
+
+	/** @brief Callback with events of a frame (only called if there are events).
+	 */
+	virtual void ProcessGestureEvents(const GestureEvent * Events, int NbEvents) {}
+
+	/** @brief Process the skeleton stream of a session.
+	 *
+	 * @param SessionFolder [in] session folder.
+	 * @param OutputFileName [in] text file for events (one per line: wall clock time, relative time, tracking id,
+	 * event, side, value), nullptr for none.
+	 * @return number of events, -1 on error.
+	 */
+	int ProcessSession(const char * SessionFolder, const char * OutputFileName = nullptr);
+
+	/** @brief Name of an event type.
+	 */
+	static const char * GetEventName(int Type);
+
+protected:
+	TrackingIdSlotTable<GestureBodyHistory> Histories;		/*!< @brief History of each tracking id. */
+	std::vector< std::unique_ptr<GestureDetector> > Detectors;
+	std::vector<GestureEvent> Events;						/*!< @brief Events of the last frame. */
+};
+
+/**
+ * @class GestureDetectionThread GestureDetection.cpp GestureDetection.h
+ * @brief Run a GestureDetection off the acquisition thread: Push copies body frames in a small queue, the thread
+ * updates the detection (thus ProcessGestureEvents is called by this thread). Frames are dropped when the queue is full,
+ * unless Push is asked to wait. Frames remaining at Stop are processed before returning.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class GestureDetectionThread : public SnapshotWorkQueue<KinectBodiesSnapshot, 8>
+{
+public:
+	/** @brief constructor.
+	 *
+	 * @param Detection [in] detection to run, must live longer than the thread.
+	 */
+	GestureDetectionThread(GestureDetection& Detection);
+
+	/** @brief Virtual destructor, always. Stop the thread.
+	 */
+	virtual ~GestureDetectionThread();
+
+	/** @brief Start the thread.
+	 */
+	bool Start();
+
+	/** @brief Process remaining frames and stop.
+	 */
+	void Stop();
+
+	/** @brief Queue a body frame. Data are copied.
+	 *
+	 * @param Bodies [in] bodies of the frame.
+	 * @param RelativeTime [in] device time of the frame.
+	 * @param WaitIfFull [in] wait for room instead of dropping the frame.
+	 * @return false if the frame was dropped or thread not started.
+	 */
+	bool Push(const KinectBodies& Bodies, TIMESPAN RelativeTime, bool WaitIfFull = false);
+
+protected:
+	/** @brief Update detection with a queued frame.
+	 */
+	virtual void ProcessSnapshot(KinectBodiesSnapshot& Frame);
+
+	GestureDetection& Detection;
+};
+
+}} // namespace MobileRGBD::Kinect2
+
+#endif // KINECT_2
+
+#endif // __GESTURE_DETECTION_H__
@@ -0,0 +1,222 @@
+/**
+ * @file KinectAudioRing.cpp
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#include "KinectAudioRing.h"
+
+#include <cstring>
+
+namespace {
+
+/** @brief Round up to the next power of 2.
+ */
+unsigned int RoundUpToPowerOf2(unsigned int Value)
+{
+	unsigned int Res = 1;
+	while( Res < Value )
+	{
+		Res <<= 1;
+	}
+	return Res;
+}
+
+} // namespace
+
+KinectAudioRing::KinectAudioRing(unsigned int CapacityInSamples /* = 65536 */, unsigned int MaxBlocks /* = 512 */)
+{
+	Consumer = (KinectAudioBlockConsumer*)nullptr;
+
+	unsigned int Capacity = RoundUpToPowerOf2( CapacityInSamples < 2 ? 2 : CapacityInSamples );
+	Samples.resize( Capacity );
+	SampleMask = Capacity-1;
+
+	unsigned int NbBlocks = RoundUpToPowerOf2( MaxBlocks < 2 ? 2 : MaxBlocks );
+	Blocks.resize( NbBlocks );
+	BlockMask = NbBlocks-1;
+
+	Reset();
+}
+
+void KinectAudioRing::Reset()
+{
+	WritePosition = 0;
+	WriteBlock = 0;
+	ReadPosition = 0;
+	ReadBlock = 0;
+	OverrunSamples = 0;
+	OverrunBlocks = 0;
+}
+
+bool KinectAudioRing::Write(const float * NewSamples, unsigned int NbSamples, TIMESPAN FirstSampleTime)
+{
+	if ( NbSamples == 0 )
+	{
+		return true;
+	}
+
+	unsigned long long int CurrentWrite = WritePosition.load(std::memory_order_relaxed);
+	unsigned long long int CurrentRead = ReadPosition.load(std::memory_order_acquire);
+	unsigned long long int CurrentWriteBlock = WriteBlock.load(std::memory_order_relaxed);
+	unsigned long long int CurrentReadBlock = ReadBlock.load(std::memory_order_acquire);
+
+	unsigned long long int FreeSamples = (unsigned long long int)Samples.size() - (CurrentWrite - CurrentRead);
+	if ( (unsigned long long int)NbSamples > FreeSamples || CurrentWriteBlock - CurrentReadBlock > (unsigned long long int)BlockMask )
+	{
+		// Do not overwrite unread samples, drop the new ones
+		OverrunSamples.fetch_add(NbSamples, std::memory_order_relaxed);
+		OverrunBlocks.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	// Copy samples, in 2 parts if we wrap around the ring
+	unsigned int Start = (unsigned int)(CurrentWrite & SampleMask);
+	unsigned int FirstPart = (unsigned int)Samples.size() - Start;
+	if ( FirstPart > NbSamples )
+	{
+		FirstPart = NbSamples;
+	}
+	memcpy( &Samples[Start], NewSamples, FirstPart*sizeof(float) );
+	if ( FirstPart < NbSamples )
+	{
+		memcpy( &Samples[0], NewSamples + FirstPart, (NbSamples-FirstPart)*sizeof(float) );
+	}
+
+	// Block information
+	BlockInfo& Block = Blocks[(unsigned int)(CurrentWriteBlock & BlockMask)];
+	Block.FirstSample = CurrentWrite;
+	Block.NbSamples = NbSamples;
+	Block.FirstSampleTime = FirstSampleTime;
+
+	// Publish block then samples
+	WriteBlock.store(CurrentWriteBlock+1, std::memory_order_release);
+	WritePosition.store(CurrentWrite+NbSamples, std::memory_order_release);
+
+	return true;
+}
+
+TIMESPAN KinectAudioRing::GetReadTimeAndReleaseBlocks(unsigned long long int CurrentReadPosition)
+{
+	unsigned long long int CurrentReadBlock = ReadBlock.load(std::memory_order_relaxed);
+	unsigned long long int CurrentWriteBlock = WriteBlock.load(std::memory_order_acquire);
+
+	// Release blocks completely read
+	while( CurrentReadBlock < CurrentWriteBlock )
+	{
+		const BlockInfo& Block = Blocks[(unsigned int)(CurrentReadBlock & BlockMask)];
+		if ( Block.FirstSample + Block.NbSamples > CurrentReadPosition )
+		{
+			break;
+		}
+		CurrentReadBlock++;
+	}
+	ReadBlock.store(CurrentReadBlock, std::memory_order_release);
+
+	if ( CurrentReadBlock == CurrentWriteBlock )
+	{
+		return 0;
+	}
+
+	// Time of the sample using time of the first sample of its block
+	const BlockInfo& Block = Blocks[(unsigned int)(CurrentReadBlock & BlockMask)];
+	return Block.FirstSampleTime + (TIMESPAN)(CurrentReadPosition - Block.FirstSample) * (TIMESPAN)SampleDuration;
+}
+
+unsigned int KinectAudioRing::Read(float * Dest, unsigned int NbSamples, TIMESPAN& FirstSampleTime)
+{
+	unsigned long long int CurrentWrite = WritePosition.load(std::memory_order_acquire);
+	unsigned long long int CurrentRead = ReadPosition.load(std::memory_order_relaxed);
+
+	unsigned long long int Available = CurrentWrite - CurrentRead;
+	if ( Available == 0 || NbSamples == 0 )
+	{
+		FirstSampleTime = 0;
+		return 0;
+	}
+	if ( (unsigned long long int)NbSamples > Available )
+	{
+		NbSamples = (unsigned int)Available;
+	}
+
+	FirstSampleTime = GetReadTimeAndReleaseBlocks( CurrentRead );
+
+	unsigned int Start = (unsigned int)(CurrentRead & SampleMask);
+	unsigned int FirstPart = (unsigned int)Samples.size() - Start;
+	if ( FirstPart > NbSamples )
+	{
+		FirstPart = NbSamples;
+	}
+	memcpy( Dest, &Samples[Start], FirstPart*sizeof(float) );
+	if ( FirstPart < NbSamples )
+	{
+		memcpy( Dest + FirstPart, &Samples[0], (NbSamples-FirstPart)*sizeof(float) );
+	}
+
+	// Give space back to the producer
+	ReadPosition.store(CurrentRead+NbSamples, std::memory_order_release);
+	GetReadTimeAndReleaseBlocks( CurrentRead+NbSamples );
+
+	return NbSamples;
+}
+
+bool KinectAudioRing::ReadExactly(float * Dest, unsigned int NbSamples, TIMESPAN& FirstSampleTime)
+{
+	if ( GetAvailableSamples() < NbSamples )
+	{
+		FirstSampleTime = 0;
+		return false;
+	}
+
+	return Read( Dest, NbSamples, FirstSampleTime ) == NbSamples;
+}
+
+unsigned int KinectAudioRing::ProcessAvailableBlocks()
+{
+	unsigned int NbProcessedBlocks = 0;
+
+	// Keep samples for Read if nobody processes blocks
+	KinectAudioBlockConsumer * CurrentConsumer = Consumer;
+	if ( CurrentConsumer == (KinectAudioBlockConsumer*)nullptr )
+	{
+		return 0;
+	}
+
+	for(;;)
+	{
+		unsigned long long int CurrentWrite = WritePosition.load(std::memory_order_acquire);
+		unsigned long long int CurrentRead = ReadPosition.load(std::memory_order_relaxed);
+		if ( CurrentRead == CurrentWrite )
+		{
+			break;
+		}
+
+		// Block containing the next sample to read (it may have been partially pulled by Read)
+		TIMESPAN FirstSampleTime = GetReadTimeAndReleaseBlocks( CurrentRead );
+		const BlockInfo& Block = Blocks[(unsigned int)(ReadBlock.load(std::memory_order_relaxed) & BlockMask)];
+		unsigned long long int BlockEnd = Block.FirstSample + Block.NbSamples;
+		if ( BlockEnd > CurrentWrite )
+		{
+			// Should not happen, samples are published after their block
+			break;
+		}
+		unsigned int NbSamples = (unsigned int)(BlockEnd - CurrentRead);
+
+		unsigned int Start = (unsigned int)(CurrentRead & SampleMask);
+		unsigned int FirstPart = (unsigned int)Samples.size() - Start;
+		if ( FirstPart > NbSamples )
+		{
+			FirstPart = NbSamples;
+		}
+
+		CurrentConsumer->ProcessAudioBlock( &Samples[Start], FirstPart, FirstPart < NbSamples ? &Samples[0] : (const float*)nullptr, NbSamples-FirstPart, FirstSampleTime );
+
+		ReadPosition.store(BlockEnd, std::memory_order_release);
+		GetReadTimeAndReleaseBlocks( BlockEnd );
+
+		NbProcessedBlocks++;
+	}
+
+	return NbProcessedBlocks;
+}
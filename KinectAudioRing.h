@@ -0,0 +1,176 @@
+/**
+ * @file KinectAudioRing.h
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#ifndef __KINECT_AUDIO_RING_H__
+#define __KINECT_AUDIO_RING_H__
+
+#include "KinectBasics.h"
+
+#include <atomic>
+#include <vector>
+
+/**
+ * @class KinectAudioBlockConsumer KinectAudioRing.cpp KinectAudioRing.h
+ * @brief Interface of consumers processing blocks of a KinectAudioRing (see KinectAudioRing::SetConsumer).
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class KinectAudioBlockConsumer
+{
+public:
+	/** @brief Virtual destructor, always.
+	 */
+	virtual ~KinectAudioBlockConsumer() {}
+
+	/** @brief Called by KinectAudioRing::ProcessAvailableBlocks with each block as written by the producer.
+	 * Data pointer is only valid during the call.
+	 *
+	 * @param Samples [in] samples of the block (may be split in 2 parts when wrapping around the ring).
+	 * @param NbSamples [in] number of samples in the first part.
+	 * @param SecondPart [in] remaining samples at the beginning of the ring, nullptr if none.
+	 * @param NbSamplesSecondPart [in] number of samples in the second part.
+	 * @param FirstSampleTime [in] device time of the first sample (100 ns ticks).
+	 */
+	virtual void ProcessAudioBlock(const float * Samples, unsigned int NbSamples, const float * SecondPart, unsigned int NbSamplesSecondPart, TIMESPAN FirstSampleTime) = 0;
+};
+
+/**
+ * @class KinectAudioRing KinectAudioRing.cpp KinectAudioRing.h
+ * @brief Lock-free single producer/single consumer ring of float audio samples. Each written block
+ * keeps the device time (RelativeTime) of its first sample, so the time of any sample can be computed
+ * from its position. When the ring is full, new samples are dropped and counted as overruns: samples
+ * not yet read are never overwritten.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class KinectAudioRing
+{
+public:
+	enum { SampleRate = 16000 };										/*!< @brief Kinect v2 audio sample rate. */
+	enum { SampleDuration = 10000000/SampleRate };						/*!< @brief Duration of one sample in 100 ns ticks (625). */
+
+	/** @brief constructor.
+	 *
+	 * @param CapacityInSamples [in] number of samples in the ring (rounded up to a power of 2, default ~4 s).
+	 * @param MaxBlocks [in] maximum number of blocks waiting in the ring (rounded up to a power of 2).
+	 */
+	KinectAudioRing(unsigned int CapacityInSamples = 65536, unsigned int MaxBlocks = 512);
+
+	/** @brief Virtual destructor, always.
+	 */
+	virtual ~KinectAudioRing() {}
+
+	/** @brief Forget all samples and reset counters. Must not be called while producer or consumer are working.
+	 */
+	void Reset();
+
+	/** @brief Add a block of samples (producer side only).
+	 *
+	 * @param Samples [in] samples to add.
+	 * @param NbSamples [in] number of samples.
+	 * @param FirstSampleTime [in] device time of the first sample (100 ns ticks).
+	 * @return false if the block did not fit in the ring (it is dropped and counted as overrun).
+	 */
+	bool Write(const float * Samples, unsigned int NbSamples, TIMESPAN FirstSampleTime);
+
+	/** @brief Pull samples (consumer side only). Samples are copied until Dest is full or the ring is empty.
+	 * Samples read in one call may come from several blocks, FirstSampleTime is the time of the first one.
+	 *
+	 * @param Dest [out] destination buffer.
+	 * @param NbSamples [in] maximum number of samples to read.
+	 * @param FirstSampleTime [out] device time of the first read sample (100 ns ticks).
+	 * @return number of read samples.
+	 */
+	unsigned int Read(float * Dest, unsigned int NbSamples, TIMESPAN& FirstSampleTime);
+
+	/** @brief Pull exactly NbSamples samples (consumer side only), nothing is read if not enough samples are available.
+	 *
+	 * @param Dest [out] destination buffer.
+	 * @param NbSamples [in] number of samples to read.
+	 * @param FirstSampleTime [out] device time of the first read sample (100 ns ticks).
+	 * @return true if NbSamples samples were read.
+	 */
+	bool ReadExactly(float * Dest, unsigned int NbSamples, TIMESPAN& FirstSampleTime);
+
+	/** @brief Set the consumer called by ProcessAvailableBlocks (it must outlive its use by the ring).
+	 *
+	 * @param _Consumer [in] consumer, nullptr to remove it.
+	 */
+	void SetConsumer(KinectAudioBlockConsumer * _Consumer)
+	{
+		Consumer = _Consumer;
+	}
+
+	/** @brief Give each available block to the consumer (consumer side only). Nothing is read if there is no consumer.
+	 *
+	 * @return number of processed blocks.
+	 */
+	unsigned int ProcessAvailableBlocks();
+
+	/** @brief Number of samples waiting to be read.
+	 */
+	unsigned int GetAvailableSamples() const
+	{
+		return (unsigned int)(WritePosition.load(std::memory_order_acquire) - ReadPosition.load(std::memory_order_relaxed));
+	}
+
+	/** @brief Number of samples dropped because the ring was full.
+	 */
+	unsigned long long int GetOverrunSamples() const
+	{
+		return OverrunSamples.load(std::memory_order_relaxed);
+	}
+
+	/** @brief Number of blocks dropped because the ring was full.
+	 */
+	unsigned long long int GetOverrunBlocks() const
+	{
+		return OverrunBlocks.load(std::memory_order_relaxed);
+	}
+
+	/** @brief Total number of samples written since last Reset.
+	 */
+	unsigned long long int GetWrittenSamples() const
+	{
+		return WritePosition.load(std::memory_order_relaxed);
+	}
+
+protected:
+	/** @brief Block information: position of its first sample (since Reset) and its device time.
+	 */
+	class BlockInfo
+	{
+	public:
+		unsigned long long int FirstSample;
+		unsigned int NbSamples;
+		TIMESPAN FirstSampleTime;
+	};
+
+	/** @brief Time of the sample at position ReadPosition, release consumed blocks. Consumer side only.
+	 */
+	TIMESPAN GetReadTimeAndReleaseBlocks(unsigned long long int CurrentReadPosition);
+
+	KinectAudioBlockConsumer * Consumer;				/*!< @brief Consumer of ProcessAvailableBlocks, may be nullptr. */
+
+	std::vector<float> Samples;							/*!< @brief Sample storage. */
+	unsigned int SampleMask;							/*!< @brief Capacity-1 (capacity is a power of 2). */
+	std::vector<BlockInfo> Blocks;						/*!< @brief Block information storage. */
+	unsigned int BlockMask;								/*!< @brief Number of blocks-1 (power of 2). */
+
+	// Written by producer, read by consumer
+	std::atomic<unsigned long long int> WritePosition;	/*!< @brief Number of samples written since Reset. */
+	std::atomic<unsigned long long int> WriteBlock;		/*!< @brief Number of blocks written since Reset. */
+
+	// Written by consumer, read by producer
+	std::atomic<unsigned long long int> ReadPosition;	/*!< @brief Number of samples read since Reset. */
+	std::atomic<unsigned long long int> ReadBlock;		/*!< @brief Index of the oldest block not completely read. */
+
+	std::atomic<unsigned long long int> OverrunSamples;	/*!< @brief Dropped samples. */
+	std::atomic<unsigned long long int> OverrunBlocks;	/*!< @brief Dropped blocks. */
+};
+
+#endif // __KINECT_AUDIO_RING_H__
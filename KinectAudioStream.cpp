@@ -21,6 +21,7 @@ using namespace MobileRGBD::Kinect2;
 
 	WAITABLE_HANDLE hAudioSource = NULL;
 	timeb lTimestamp;
+	KinectTimestamp HostTimestamp;
 
 	IKinectSensor * pSensor = Caller.pSensor;
 	if ( pSensor == nullptr )
@@ -50,7 +51,8 @@ using namespace MobileRGBD::Kinect2;
 			SafeRelease(pArgs);
 
 			// Get timestamp
-			ftime(&lTimestamp);
+			KinectClock::GetTimestamp(HostTimestamp);
+			HostTimestamp.ToTimeb(lTimestamp);
 
 			// get data
 			IAudioBeamFrameList * pAudioFrameList = nullptr;
@@ -68,6 +70,7 @@ using namespace MobileRGBD::Kinect2;
 											
 				unsigned char * InBuffer = InitBuffer;
 				RecContext->BufferSize = 0;
+				RecContext->LastFrameTime = 0;
 
 				if ( SUCCEEDED(pAudioFrameList->OpenAudioBeamFrame(NbBeams-1, &pAudioBeamFrame)) && 
 						SUCCEEDED(pAudioBeamFrame->get_SubFrameCount(&SubFrameCount)) )
@@ -83,11 +86,24 @@ using namespace MobileRGBD::Kinect2;
 							UINT BufferSize = 0;
 							BYTE * BufferAddress = nullptr;
 
+							// Device time of the first sample of this sub frame
+							TIMESPAN SubFrameTime = 0;
+							pAudioBeamSubFrame->get_RelativeTime(&SubFrameTime);
+
 							if ( SUCCEEDED(pAudioBeamSubFrame->AccessUnderlyingBuffer(&BufferSize,&BufferAddress)) )
 							{
 								memcpy( InBuffer, BufferAddress, BufferSize );
 								InBuffer += BufferSize;
 								RecContext->BufferSize += BufferSize; 
+
+								// Frame time is the time of the first sub frame
+								if ( RecContext->LastFrameTime == 0 )
+								{
+									RecContext->LastFrameTime = SubFrameTime;
+								}
+
+								// Give samples to ring consumer, overruns are counted by the ring
+								Caller.AudioRing.Write( (const float*)BufferAddress, BufferSize/sizeof(float), SubFrameTime );
 							}
 						}
 			
@@ -109,14 +125,17 @@ using namespace MobileRGBD::Kinect2;
 				RawKinectRecording& rcs = *RecContext;
 
 				// Create quick a string containing number of samples
+				unsigned int NbSamples = rcs.BufferSize/sizeof(float);
 				char TmpNb[10];
-				sprintf( TmpNb, "%d", rcs.BufferSize/sizeof(float) );
+				sprintf( TmpNb, "%u", NbSamples );
 
 				// Save Data, first set buffer size (in term of number of faces)
-				rcs.SaveDataAndIncreaseInputNumber( lTimestamp, TmpNb );
+				rcs.SaveDataAndIncreaseInputNumber( HostTimestamp, TmpNb );
 
 				// Ok, here call the virtual function from the parent thread, from now, one beam, one call
-				// Caller.ProcessAudio();
+				long long int CallbackStart = KinectClock::GetMonotonicTime();
+				Caller.ProcessAudioFrame( (float*)rcs.BufferData, NbSamples, rcs.InputNumber, lTimestamp, rcs.LastFrameTime );
+				rcs.AddCallbackTime( CallbackStart );
 			}
 		}
 	}
@@ -37,6 +37,12 @@ static const int DepthBytesPerPixel = 2;
 
 #include <cstdio>
 
+// SSE2 code paths of processing classes, define KINECT_NO_SSE2 to use only scalar code
+#if !defined KINECT_NO_SSE2 && (defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2))
+#define KINECT_SSE2
+#include <emmintrin.h>
+#endif
+
 // Do we used the Kinect in live (for recording for instance) ?
 #ifdef KINECT_LIVE
 
@@ -161,6 +161,7 @@ public:
 		}
 	}
 #else
+	// Offline, use KinectCoordinateMapper::ComputeJointsInRGBAndDepth to recompute them from session calibration
 	void ComputeJointsInRGBAndDepth() {}
 #endif	// (defined WIN32 || defined WIN64) && defined KINECT_LIVE
 
@@ -369,6 +370,7 @@ public:
 			BodiesInformation[i].Set(lBuffer);
 			lBuffer += KinectBody::BodySize;
 			BodyIsPresent[i] = false;
+			InitialBodyIndex[i] = -1;
 #ifdef KINECT_LIVE			
 			ppBodies[i] = nullptr;
 #endif
@@ -387,11 +389,22 @@ public:
 #endif
 	}
 
-	
-	/** @brief Copy operator
+	/** @brief Copy constructor. Data are copied in a buffer owned by the new instance.
+	 */
+	KinectBodies(const KinectBodies& Other) : KinectBodies()
+	{
+		*this = Other;
+	}
+
+	/** @brief Copy operator. Only the ActualNbBody bodies are copied in the buffer of this instance, without allocation.
 	 */
-	KinectBodies& operator=(KinectBodies& Other)
+	KinectBodies& operator=(const KinectBodies& Other)
 	{
+		if ( this == &Other )
+		{
+			return *this;
+		}
+
 		ActualNbBody = Other.ActualNbBody;
 
 		// Copy ppBodies is useless, it has been released
@@ -400,15 +413,13 @@ public:
 		// Initial body index
 		memcpy( InitialBodyIndex, Other.InitialBodyIndex, sizeof(InitialBodyIndex) );
 
-		if ( ActualNbBody == 0 )
+		// copy data of actual bodies, buffer may be external (see KinectSensor) thus do not rely on AllocatedBuffer
+		if ( ActualNbBody != 0 )
 		{
-				return Other;
+			memcpy( BodyData, Other.BodyData, ActualNbBody*KinectBody::BodySize );
 		}
 
-		// copy data to data
-		memcpy( BodyData, Other.BodyData, AllocatedBuffer.GetLength() );
-
-		return Other;
+		return *this;
 	}
 
 #ifdef KINECT_LIVE
@@ -454,7 +465,7 @@ public:
 #endif 
 
 	bool BodyIsPresent[BODY_COUNT];				/*!< @brief Store presence of body data state. */
-	int InitialBodyIndex[BODY_COUNT];			/*!< @brief Store index in original Kinect data. */
+	int InitialBodyIndex[BODY_COUNT];			/*!< @brief Store index in original Kinect data, -1 if unknown (not saved in skeleton.raw). */
 
 	KinectBody BodiesInformation[BODY_COUNT];	/*!< @brief Up to BODY_COUNT KinectBody can be handled. */
 	unsigned int ActualNbBody;					/*!< @brief Actual number of body in the buffer. */
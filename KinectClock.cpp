@@ -0,0 +1,212 @@
+/**
+ * @file KinectClock.cpp
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#include "KinectClock.h"
+
+#include <atomic>
+#include <chrono>
+
+namespace {
+
+/** @brief Anchor to convert monotonic time to wall clock time, WallClock = Monotonic + Anchor.
+ */
+std::atomic<long long int>& WallClockAnchor()
+{
+	static std::atomic<long long int> Anchor( std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count()
+											 - KinectClock::GetMonotonicTime() );
+	return Anchor;
+}
+
+} // namespace
+
+/* static */ KinectTimestamp KinectTimestamp::FromTimeb(const struct timeb& lTimestamp)
+{
+	KinectTimestamp Res;
+	Res.WallClockTime = (long long int)lTimestamp.time * 1000000000LL + (long long int)lTimestamp.millitm * 1000000LL;
+	Res.MonotonicTime = Res.WallClockTime - KinectClock::GetWallClockAnchor();
+	return Res;
+}
+
+void KinectTimestamp::ToTimeb(struct timeb& lTimestamp) const
+{
+	memset( &lTimestamp, 0, sizeof(lTimestamp) );
+	lTimestamp.time = (time_t)(WallClockTime / 1000000000LL);
+	lTimestamp.millitm = (unsigned short)((WallClockTime % 1000000000LL) / 1000000LL);
+}
+
+/* static */ long long int KinectClock::GetMonotonicTime()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* static */ void KinectClock::GetTimestamp(KinectTimestamp& Timestamp)
+{
+	Timestamp.MonotonicTime = GetMonotonicTime();
+	Timestamp.WallClockTime = Timestamp.MonotonicTime + WallClockAnchor().load(std::memory_order_relaxed);
+}
+
+/* static */ long long int KinectClock::MonotonicToWallClock(long long int MonotonicTime)
+{
+	return MonotonicTime + WallClockAnchor().load(std::memory_order_relaxed);
+}
+
+/* static */ long long int KinectClock::GetWallClockAnchor()
+{
+	return WallClockAnchor().load(std::memory_order_relaxed);
+}
+
+/* static */ void KinectClock::ResetWallClockAnchor()
+{
+	long long int Before = GetMonotonicTime();
+	long long int Wall = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	long long int After = GetMonotonicTime();
+
+	// Use middle of the monotonic readings as reference for the system clock reading
+	WallClockAnchor().store( Wall - (Before + (After-Before)/2), std::memory_order_relaxed );
+}
+
+DeviceClockCalibration::DeviceClockCalibration()
+{
+	Reset();
+}
+
+void DeviceClockCalibration::Reset()
+{
+	Omiscid::SmartLocker SL_Protection(Protection);
+
+	NbObservations = 0;
+	NextObservation = 0;
+	ReferenceDeviceTime = 0;
+	ReferenceHostTime = 0;
+	Slope = 100.0;		// 1 tick = 100 ns
+	Intercept = 0.0;
+	LastReceptionDelay = 0;
+}
+
+void DeviceClockCalibration::AddObservation(TIMESPAN DeviceTime, long long int HostMonotonicTime)
+{
+	if ( DeviceTime == 0 )
+	{
+		// No device time for this frame
+		return;
+	}
+
+	Omiscid::SmartLocker SL_Protection(Protection);
+
+	if ( NbObservations == 0 )
+	{
+		ReferenceDeviceTime = DeviceTime;
+		ReferenceHostTime = HostMonotonicTime;
+	}
+
+	DeviceTimes[NextObservation] = DeviceTime;
+	HostTimes[NextObservation] = HostMonotonicTime;
+	NextObservation = (NextObservation+1) % WindowSize;
+	if ( NbObservations < WindowSize )
+	{
+		NbObservations++;
+	}
+
+	ComputeEstimation();
+
+	// Delay of this reception against the lower envelope
+	double Predicted = Intercept + Slope * (double)(DeviceTime - ReferenceDeviceTime);
+	LastReceptionDelay = (HostMonotonicTime - ReferenceHostTime) - (long long int)Predicted;
+}
+
+void DeviceClockCalibration::ComputeEstimation()
+{
+	// Mean of observations, relative to references to keep precision
+	double MeanDevice = 0.0;
+	double MeanHost = 0.0;
+	TIMESPAN MinDevice = DeviceTimes[0];
+	TIMESPAN MaxDevice = DeviceTimes[0];
+	for( int i = 0; i < NbObservations; i++ )
+	{
+		MeanDevice += (double)(DeviceTimes[i] - ReferenceDeviceTime);
+		MeanHost += (double)(HostTimes[i] - ReferenceHostTime);
+		if ( DeviceTimes[i] < MinDevice ) { MinDevice = DeviceTimes[i]; }
+		if ( DeviceTimes[i] > MaxDevice ) { MaxDevice = DeviceTimes[i]; }
+	}
+	MeanDevice /= (double)NbObservations;
+	MeanHost /= (double)NbObservations;
+
+	// Estimate drift only if window is long enough, if not, keep nominal slope
+	if ( (double)(MaxDevice - MinDevice) * 100.0 >= (double)MinimalSpanForDrift )
+	{
+		double Sxy = 0.0;
+		double Sxx = 0.0;
+		for( int i = 0; i < NbObservations; i++ )
+		{
+			double dx = (double)(DeviceTimes[i] - ReferenceDeviceTime) - MeanDevice;
+			double dy = (double)(HostTimes[i] - ReferenceHostTime) - MeanHost;
+			Sxy += dx*dy;
+			Sxx += dx*dx;
+		}
+		if ( Sxx > 0.0 )
+		{
+			Slope = Sxy/Sxx;
+		}
+	}
+
+	// Move the line to the lower envelope of observations
+	double MinResidual = 0.0;
+	for( int i = 0; i < NbObservations; i++ )
+	{
+		double Residual = (double)(HostTimes[i] - ReferenceHostTime) - Slope * (double)(DeviceTimes[i] - ReferenceDeviceTime);
+		if ( i == 0 || Residual < MinResidual )
+		{
+			MinResidual = Residual;
+		}
+	}
+	Intercept = MinResidual;
+}
+
+bool DeviceClockCalibration::IsCalibrated()
+{
+	Omiscid::SmartLocker SL_Protection(Protection);
+
+	return NbObservations != 0;
+}
+
+long long int DeviceClockCalibration::DeviceToHost(TIMESPAN DeviceTime)
+{
+	Omiscid::SmartLocker SL_Protection(Protection);
+
+	if ( NbObservations == 0 )
+	{
+		return 0;
+	}
+
+	return ReferenceHostTime + (long long int)(Intercept + Slope * (double)(DeviceTime - ReferenceDeviceTime));
+}
+
+double DeviceClockCalibration::GetDriftPPM()
+{
+	Omiscid::SmartLocker SL_Protection(Protection);
+
+	return (Slope/100.0 - 1.0) * 1.0e6;
+}
+
+long long int DeviceClockCalibration::GetOffset()
+{
+	Omiscid::SmartLocker SL_Protection(Protection);
+
+	if ( NbObservations == 0 )
+	{
+		return 0;
+	}
+
+	return ReferenceHostTime + (long long int)(Intercept - Slope * (double)ReferenceDeviceTime);
+}
+
+long long int DeviceClockCalibration::GetLastReceptionDelay()
+{
+	Omiscid::SmartLocker SL_Protection(Protection);
+
+	return LastReceptionDelay;
+}
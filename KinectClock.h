@@ -0,0 +1,188 @@
+/**
+ * @file KinectClock.h
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#ifndef __KINECT_CLOCK_H__
+#define __KINECT_CLOCK_H__
+
+#include "KinectBasics.h"
+
+#include <System/Mutex.h>
+#include <System/LockManagement.h>
+
+#include <sys/timeb.h>
+
+/**
+ * @class KinectTimestamp KinectClock.cpp KinectClock.h
+ * @brief Host timestamp of a frame. Monotonic time is used for synchronisation and latency,
+ * wall clock time (derived from the monotonic one using an anchor) is used for dating recordings.
+ * Both values are in nanoseconds.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class KinectTimestamp
+{
+public:
+	/** @brief constructor.
+	 */
+	KinectTimestamp()
+	{
+		MonotonicTime = 0;
+		WallClockTime = 0;
+	}
+
+	long long int MonotonicTime;	/*!< @brief Monotonic host time in ns (arbitrary origin, never goes backward). */
+	long long int WallClockTime;	/*!< @brief Wall clock time in ns since Epoch (1970-01-01 UTC). */
+
+	/** @brief Fill a legacy timeb structure (ms resolution) from the wall clock time.
+	 *
+	 * @param lTimestamp [out] legacy timestamp.
+	 */
+	void ToTimeb(struct timeb& lTimestamp) const;
+
+	/** @brief Wall clock time as a double in seconds, as used for StartTime in KinectRecording.
+	 *
+	 * @return wall clock time in seconds.
+	 */
+	double GetWallClockInSeconds() const
+	{
+		return (double)WallClockTime/1.0e9;
+	}
+
+	/** @brief Create a KinectTimestamp from a legacy timeb, for instance read from an old file. Monotonic time is
+	 * derived from the wall clock time with the current anchor, at ms resolution. Capture threads must take a
+	 * KinectTimestamp when a frame arrives instead.
+	 *
+	 * @param lTimestamp [in] legacy timestamp.
+	 * @return the new KinectTimestamp.
+	 */
+	static KinectTimestamp FromTimeb(const struct timeb& lTimestamp);
+};
+
+/**
+ * @class KinectClock KinectClock.cpp KinectClock.h
+ * @brief Host clock abstraction. Provides ns monotonic time and a wall clock anchored on it.
+ * All capture threads must use it instead of ftime to get comparable timestamps.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class KinectClock
+{
+public:
+	/** @brief Get current monotonic time.
+	 *
+	 * @return monotonic time in ns.
+	 */
+	static long long int GetMonotonicTime();
+
+	/** @brief Get current timestamp (monotonic and wall clock from a unique clock reading).
+	 *
+	 * @param Timestamp [out] current host timestamp.
+	 */
+	static void GetTimestamp(KinectTimestamp& Timestamp);
+
+	/** @brief Convert a monotonic time to wall clock time using current anchor.
+	 *
+	 * @param MonotonicTime [in] monotonic time in ns.
+	 * @return wall clock time in ns since Epoch.
+	 */
+	static long long int MonotonicToWallClock(long long int MonotonicTime);
+
+	/** @brief Get the anchor, i.e. WallClock - Monotonic, in ns.
+	 *
+	 * @return current anchor.
+	 */
+	static long long int GetWallClockAnchor();
+
+	/** @brief Resynchronise the wall clock anchor with the system clock (call it when starting a recording,
+	 * never during one to keep wall clock monotonic).
+	 */
+	static void ResetWallClockAnchor();
+};
+
+/**
+ * @class DeviceClockCalibration KinectClock.cpp KinectClock.h
+ * @brief Map device RelativeTime (100 ns ticks) onto host monotonic time. Estimate offset and drift
+ * with a least square fit on a sliding window of observations. The line is then moved down to the
+ * lower envelope of observations, i.e. a device time is mapped to the earliest possible reception time
+ * on the host (transport latency removed as much as possible).
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class DeviceClockCalibration
+{
+public:
+	/** @brief constructor.
+	 */
+	DeviceClockCalibration();
+
+	/** @brief Virtual destructor, always.
+	 */
+	virtual ~DeviceClockCalibration() {}
+
+	/** @brief Forget all observations.
+	 */
+	void Reset();
+
+	/** @brief Add a new (device time, host reception time) couple and update estimation.
+	 *
+	 * @param DeviceTime [in] RelativeTime of the frame, in 100 ns ticks.
+	 * @param HostMonotonicTime [in] reception time of the frame on the host (monotonic, ns).
+	 */
+	void AddObservation(TIMESPAN DeviceTime, long long int HostMonotonicTime);
+
+	/** @brief Do we have enough data to map device time onto host time?
+	 *
+	 * @return true if at least one observation was added.
+	 */
+	bool IsCalibrated();
+
+	/** @brief Map a device time onto host monotonic time.
+	 *
+	 * @param DeviceTime [in] RelativeTime in 100 ns ticks.
+	 * @return host monotonic time in ns, 0 if not calibrated.
+	 */
+	long long int DeviceToHost(TIMESPAN DeviceTime);
+
+	/** @brief Get the estimated drift of device clock against host clock.
+	 *
+	 * @return drift in part per million (positive if device clock is slower than host clock).
+	 */
+	double GetDriftPPM();
+
+	/** @brief Get estimated offset, i.e. host time of device time 0.
+	 *
+	 * @return offset in ns.
+	 */
+	long long int GetOffset();
+
+	/** @brief Get the latency of the last observation against the estimated lower envelope.
+	 *
+	 * @return jitter of reception in ns.
+	 */
+	long long int GetLastReceptionDelay();
+
+protected:
+	enum { WindowSize = 256 };					/*!< @brief Number of observations used for estimation */
+	static const long long int MinimalSpanForDrift = 2000000000LL;	/*!< @brief 2 s of data needed before estimating drift */
+
+	void ComputeEstimation();
+
+	Omiscid::Mutex Protection;					/*!< @brief Protect access, writer and readers are in different threads. */
+
+	TIMESPAN DeviceTimes[WindowSize];			/*!< @brief Device time of observations. */
+	long long int HostTimes[WindowSize];		/*!< @brief Host time of observations. */
+	int NbObservations;							/*!< @brief Number of valid observations in window. */
+	int NextObservation;						/*!< @brief Index of next observation in circular window. */
+
+	TIMESPAN ReferenceDeviceTime;				/*!< @brief Origin for computation (keep precision of double). */
+	long long int ReferenceHostTime;			/*!< @brief Origin for computation (keep precision of double). */
+	double Slope;								/*!< @brief Host ns per device tick (nominally 100). */
+	double Intercept;							/*!< @brief Host time (relative to ReferenceHostTime) of ReferenceDeviceTime. */
+	long long int LastReceptionDelay;			/*!< @brief Delay of last observation against the model. */
+};
+
+#endif // __KINECT_CLOCK_H__
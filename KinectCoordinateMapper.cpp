@@ -0,0 +1,497 @@
+/**
+ * @file KinectCoordinateMapper.cpp
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#include "KinectCoordinateMapper.h"
+
+#ifdef KINECT_2
+
+#include "KinectBody.h"
+#include "KinectWorkerPool.h"
+#include "SerializableFile.h"
+#include "TimestampFileReader.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+using namespace MobileRGBD::Kinect2;
+
+namespace {
+
+// Names of Rotation and Translation elements in JSON files
+static const char * RotationNames[9] = { "Rotation0", "Rotation1", "Rotation2", "Rotation3", "Rotation4", "Rotation5", "Rotation6", "Rotation7", "Rotation8" };
+static const char * TranslationNames[3] = { "TranslationX", "TranslationY", "TranslationZ" };
+
+// Number of points projected at once from CameraSpacePoint arrays
+static const int ProjectionBlockSize = 256;
+
+// Solve 3x3 system A*x = b with Cramer's rule, false if A is singular
+static bool Solve3x3(const double A[3][3], const double b[3], double x[3])
+{
+	double Det = A[0][0]*(A[1][1]*A[2][2] - A[1][2]*A[2][1])
+		- A[0][1]*(A[1][0]*A[2][2] - A[1][2]*A[2][0])
+		+ A[0][2]*(A[1][0]*A[2][1] - A[1][1]*A[2][0]);
+	if ( fabs(Det) < 1e-12 )
+	{
+		return false;
+	}
+
+	for( int c = 0; c < 3; c++ )
+	{
+		double M[3][3];
+		for( int i = 0; i < 3; i++ )
+		{
+			for( int j = 0; j < 3; j++ )
+			{
+				M[i][j] = (j == c) ? b[i] : A[i][j];
+			}
+		}
+		x[c] = ( M[0][0]*(M[1][1]*M[2][2] - M[1][2]*M[2][1])
+			- M[0][1]*(M[1][0]*M[2][2] - M[1][2]*M[2][0])
+			+ M[0][2]*(M[1][0]*M[2][1] - M[1][1]*M[2][0]) ) / Det;
+	}
+	return true;
+}
+
+} // namespace
+
+DepthToColorCalibration::DepthToColorCalibration()
+{
+	// Typical Kinect v2 values, color camera is about 5 cm aside the depth one
+	FocalLengthX = 1081.37f;
+	FocalLengthY = 1081.37f;
+	PrincipalPointX = 959.5f;
+	PrincipalPointY = 539.5f;
+	RadialDistortionSecondOrder = 0.0f;
+	RadialDistortionFourthOrder = 0.0f;
+	RadialDistortionSixthOrder = 0.0f;
+
+	for( int i = 0; i < 9; i++ )
+	{
+		Rotation[i] = (i % 4 == 0) ? 1.0f : 0.0f;
+	}
+	Translation[0] = -0.052f;
+	Translation[1] = 0.0f;
+	Translation[2] = 0.0f;
+}
+
+DepthToColorCalibration::DepthToColorCalibration(const DepthToColorCalibration& ToCopy) : Omiscid::Serializable()
+{
+	*this = ToCopy;
+}
+
+DepthToColorCalibration& DepthToColorCalibration::operator=(const DepthToColorCalibration& ToCopy)
+{
+	FocalLengthX = ToCopy.FocalLengthX;
+	FocalLengthY = ToCopy.FocalLengthY;
+	PrincipalPointX = ToCopy.PrincipalPointX;
+	PrincipalPointY = ToCopy.PrincipalPointY;
+	RadialDistortionSecondOrder = ToCopy.RadialDistortionSecondOrder;
+	RadialDistortionFourthOrder = ToCopy.RadialDistortionFourthOrder;
+	RadialDistortionSixthOrder = ToCopy.RadialDistortionSixthOrder;
+	memcpy( Rotation, ToCopy.Rotation, sizeof(Rotation) );
+	memcpy( Translation, ToCopy.Translation, sizeof(Translation) );
+	return *this;
+}
+
+/* virtual */ void DepthToColorCalibration::DeclareSerializeMapping()
+{
+	AddToSerialization( "FocalLengthX", FocalLengthX );
+	AddToSerialization( "FocalLengthY", FocalLengthY );
+	AddToSerialization( "PrincipalPointX", PrincipalPointX );
+	AddToSerialization( "PrincipalPointY", PrincipalPointY );
+	AddToSerialization( "RadialDistortionSecondOrder", RadialDistortionSecondOrder );
+	AddToSerialization( "RadialDistortionFourthOrder", RadialDistortionFourthOrder );
+	AddToSerialization( "RadialDistortionSixthOrder", RadialDistortionSixthOrder );
+	for( int i = 0; i < 9; i++ )
+	{
+		AddToSerialization( RotationNames[i], Rotation[i] );
+	}
+	for( int i = 0; i < 3; i++ )
+	{
+		AddToSerialization( TranslationNames[i], Translation[i] );
+	}
+}
+
+bool DepthToColorCalibration::Save(const char * FileName) const
+{
+	return SerializableFile::Save( FileName, *this );
+}
+
+bool DepthToColorCalibration::Load(const char * FileName)
+{
+	// Load in a copy, keep current values if something is missing
+	DepthToColorCalibration NewValues;
+	if ( SerializableFile::Load( FileName, NewValues ) == false )
+	{
+		return false;
+	}
+
+	*this = NewValues;
+	return true;
+}
+
+bool DepthToColorCalibration::SaveInSession(const char * SessionFolder) const
+{
+	return Save( TimestampFileReader::GetStreamFileName( SessionFolder, "video", "calibration" ).c_str() );
+}
+
+bool DepthToColorCalibration::LoadFromSession(const char * SessionFolder)
+{
+	return Load( TimestampFileReader::GetStreamFileName( SessionFolder, "video", "calibration" ).c_str() );
+}
+
+/* static */ void DepthToColorCalibration::GetSamplePoints(std::vector<CameraSpacePoint>& Points)
+{
+	// Keep |X/Z| < 0.6 and |Y/Z| < 0.4, inside depth (70x60 degrees) and color (84x54 degrees) fields of view
+	Points.clear();
+	for( int z = 1; z <= 4; z++ )
+	{
+		for( int y = -2; y <= 2; y++ )
+		{
+			for( int x = -3; x <= 3; x++ )
+			{
+				CameraSpacePoint Point;
+				Point.X = (float)(x*z)*0.2f;
+				Point.Y = (float)(y*z)*0.2f;
+				Point.Z = (float)z;
+				Points.push_back( Point );
+			}
+		}
+	}
+}
+
+bool DepthToColorCalibration::Estimate(const CameraSpacePoint * Points, const PixelPosition * ColorPixels, int NbPoints)
+{
+	// Without rotation and distortion: u = cx + fx*X/Z + (fx*tx)/Z and v = cy - fy*Y/Z - (fy*ty)/Z,
+	// both linear in their 3 unknowns. Accumulate normal equations.
+	double Au[3][3] = { { 0.0 } }, bu[3] = { 0.0 };
+	double Av[3][3] = { { 0.0 } }, bv[3] = { 0.0 };
+	int NbUsed = 0;
+	for( int i = 0; i < NbPoints; i++ )
+	{
+		const CameraSpacePoint& P = Points[i];
+		const PixelPosition& Pix = ColorPixels[i];
+		if ( P.Z <= 0.0f || fabs(Pix.x) > 1e6f || fabs(Pix.y) > 1e6f || Pix.x != Pix.x || Pix.y != Pix.y )
+		{
+			continue;
+		}
+
+		double InvZ = 1.0/(double)P.Z;
+		double Ru[3] = { 1.0, (double)P.X*InvZ, InvZ };
+		double Rv[3] = { 1.0, -(double)P.Y*InvZ, -InvZ };
+		for( int r = 0; r < 3; r++ )
+		{
+			for( int c = 0; c < 3; c++ )
+			{
+				Au[r][c] += Ru[r]*Ru[c];
+				Av[r][c] += Rv[r]*Rv[c];
+			}
+			bu[r] += Ru[r]*(double)Pix.x;
+			bv[r] += Rv[r]*(double)Pix.y;
+		}
+		NbUsed++;
+	}
+
+	double Xu[3], Xv[3];
+	if ( NbUsed < 3 || Solve3x3( Au, bu, Xu ) == false || Solve3x3( Av, bv, Xv ) == false || Xu[1] <= 0.0 || Xv[1] <= 0.0 )
+	{
+		return false;
+	}
+
+	PrincipalPointX = (float)Xu[0];
+	FocalLengthX = (float)Xu[1];
+	PrincipalPointY = (float)Xv[0];
+	FocalLengthY = (float)Xv[1];
+	RadialDistortionSecondOrder = 0.0f;
+	RadialDistortionFourthOrder = 0.0f;
+	RadialDistortionSixthOrder = 0.0f;
+
+	for( int i = 0; i < 9; i++ )
+	{
+		Rotation[i] = (i % 4 == 0) ? 1.0f : 0.0f;
+	}
+	Translation[0] = (float)(Xu[2]/Xu[1]);
+	Translation[1] = (float)(Xv[2]/Xv[1]);
+	Translation[2] = 0.0f;
+
+	return true;
+}
+
+KinectCoordinateMapper::KinectCoordinateMapper()
+{
+	memset( &DepthProjection, 0, sizeof(DepthProjection) );
+	memset( &ColorProjection, 0, sizeof(ColorProjection) );
+}
+
+bool KinectCoordinateMapper::Init(const DepthCameraIntrinsics& Intrinsics, const DepthToColorCalibration& _Calibration)
+{
+	DepthModel = DepthCameraModel::GetModel( Intrinsics );
+	if ( DepthModel == nullptr )
+	{
+		return false;
+	}
+	UnprojectionTable = DepthModel->GetUnprojectionTable();
+	Calibration = _Calibration;
+
+	// Depth projection: identity transformation
+	const DepthCameraIntrinsics::IntrinsicsType& Params = Intrinsics.IntrinsicsParameters;
+	for( int i = 0; i < 9; i++ )
+	{
+		DepthProjection.R[i] = (i % 4 == 0) ? 1.0f : 0.0f;
+	}
+	DepthProjection.T[0] = DepthProjection.T[1] = DepthProjection.T[2] = 0.0f;
+	DepthProjection.fx = Params.FocalLengthX;
+	DepthProjection.fy = Params.FocalLengthY;
+	DepthProjection.cx = Params.PrincipalPointX;
+	DepthProjection.cy = Params.PrincipalPointY;
+	DepthProjection.k2 = Params.RadialDistortionSecondOrder;
+	DepthProjection.k4 = Params.RadialDistortionFourthOrder;
+	DepthProjection.k6 = Params.RadialDistortionSixthOrder;
+
+	// Color projection
+	memcpy( ColorProjection.R, Calibration.Rotation, sizeof(ColorProjection.R) );
+	memcpy( ColorProjection.T, Calibration.Translation, sizeof(ColorProjection.T) );
+	ColorProjection.fx = Calibration.FocalLengthX;
+	ColorProjection.fy = Calibration.FocalLengthY;
+	ColorProjection.cx = Calibration.PrincipalPointX;
+	ColorProjection.cy = Calibration.PrincipalPointY;
+	ColorProjection.k2 = Calibration.RadialDistortionSecondOrder;
+	ColorProjection.k4 = Calibration.RadialDistortionFourthOrder;
+	ColorProjection.k6 = Calibration.RadialDistortionSixthOrder;
+
+	return true;
+}
+
+bool KinectCoordinateMapper::InitFromSession(const char * SessionFolder)
+{
+	DepthCameraIntrinsics Intrinsics;
+	if ( Intrinsics.LoadFromSession( SessionFolder ) == false )
+	{
+		fprintf( stderr, "Could not load depth intrinsics of '%s'\n", SessionFolder );
+		return false;
+	}
+
+	// Sessions recorded before KinectSensor saved video/video.calibration only have depth data,
+	// color positions will come from typical Kinect v2 values and may be off by several pixels
+	DepthToColorCalibration SessionCalibration;
+	if ( SessionCalibration.LoadFromSession( SessionFolder ) == false )
+	{
+		fprintf( stderr, "No color calibration in '%s', using default Kinect v2 values\n", SessionFolder );
+	}
+
+	if ( Init( Intrinsics, SessionCalibration ) == false )
+	{
+		return false;
+	}
+
+	// SDK table is more accurate if present
+	DepthFrameToCameraSpaceTable SDKTable;
+	if ( SDKTable.LoadFromSession( SessionFolder ) == true )
+	{
+		SetUnprojectionTable( SDKTable );
+	}
+
+	return true;
+}
+
+/* static */ void KinectCoordinateMapper::ProjectPlanes(const Projection& Proj, const float * X, const float * Y, const float * Z, int NbPoints, PixelPosition * Pixels)
+{
+	int i = 0;
+
+#ifdef KINECT_SSE2
+	const __m128 R0 = _mm_set1_ps(Proj.R[0]), R1 = _mm_set1_ps(Proj.R[1]), R2 = _mm_set1_ps(Proj.R[2]);
+	const __m128 R3 = _mm_set1_ps(Proj.R[3]), R4 = _mm_set1_ps(Proj.R[4]), R5 = _mm_set1_ps(Proj.R[5]);
+	const __m128 R6 = _mm_set1_ps(Proj.R[6]), R7 = _mm_set1_ps(Proj.R[7]), R8 = _mm_set1_ps(Proj.R[8]);
+	const __m128 T0 = _mm_set1_ps(Proj.T[0]), T1 = _mm_set1_ps(Proj.T[1]), T2 = _mm_set1_ps(Proj.T[2]);
+	const __m128 fx = _mm_set1_ps(Proj.fx), fy = _mm_set1_ps(Proj.fy), cx = _mm_set1_ps(Proj.cx), cy = _mm_set1_ps(Proj.cy);
+	const __m128 k2 = _mm_set1_ps(Proj.k2), k4 = _mm_set1_ps(Proj.k4), k6 = _mm_set1_ps(Proj.k6);
+	const __m128 One = _mm_set1_ps(1.0f), MinusOne = _mm_set1_ps(-1.0f), Zero = _mm_setzero_ps();
+
+	for( ; i + 4 <= NbPoints; i += 4 )
+	{
+		__m128 Px = _mm_loadu_ps( X + i );
+		__m128 Py = _mm_loadu_ps( Y + i );
+		__m128 Pz = _mm_loadu_ps( Z + i );
+
+		// Rigid transformation
+		__m128 Xc = _mm_add_ps( _mm_add_ps( _mm_mul_ps(R0, Px), _mm_mul_ps(R1, Py) ), _mm_add_ps( _mm_mul_ps(R2, Pz), T0 ) );
+		__m128 Yc = _mm_add_ps( _mm_add_ps( _mm_mul_ps(R3, Px), _mm_mul_ps(R4, Py) ), _mm_add_ps( _mm_mul_ps(R5, Pz), T1 ) );
+		__m128 Zc = _mm_add_ps( _mm_add_ps( _mm_mul_ps(R6, Px), _mm_mul_ps(R7, Py) ), _mm_add_ps( _mm_mul_ps(R8, Pz), T2 ) );
+
+		__m128 Valid = _mm_cmpgt_ps( Zc, Zero );
+		__m128 InvZ = _mm_div_ps( One, _mm_or_ps( _mm_and_ps( Valid, Zc ), _mm_andnot_ps( Valid, One ) ) );
+
+		// Distorted pinhole
+		__m128 x = _mm_mul_ps( Xc, InvZ );
+		__m128 y = _mm_mul_ps( Yc, InvZ );
+		__m128 r2 = _mm_add_ps( _mm_mul_ps(x, x), _mm_mul_ps(y, y) );
+		__m128 d = _mm_add_ps( One, _mm_mul_ps( r2, _mm_add_ps( k2, _mm_mul_ps( r2, _mm_add_ps( k4, _mm_mul_ps( r2, k6 ) ) ) ) ) );
+		__m128 u = _mm_add_ps( cx, _mm_mul_ps( fx, _mm_mul_ps( x, d ) ) );
+		__m128 v = _mm_sub_ps( cy, _mm_mul_ps( fy, _mm_mul_ps( y, d ) ) );
+
+		u = _mm_or_ps( _mm_and_ps( Valid, u ), _mm_andnot_ps( Valid, MinusOne ) );
+		v = _mm_or_ps( _mm_and_ps( Valid, v ), _mm_andnot_ps( Valid, MinusOne ) );
+
+		// Store as (u,v) pairs
+		_mm_storeu_ps( (float*)(Pixels + i), _mm_unpacklo_ps( u, v ) );
+		_mm_storeu_ps( (float*)(Pixels + i + 2), _mm_unpackhi_ps( u, v ) );
+	}
+#endif
+
+	for( ; i < NbPoints; i++ )
+	{
+		float Xc = Proj.R[0]*X[i] + Proj.R[1]*Y[i] + Proj.R[2]*Z[i] + Proj.T[0];
+		float Yc = Proj.R[3]*X[i] + Proj.R[4]*Y[i] + Proj.R[5]*Z[i] + Proj.T[1];
+		float Zc = Proj.R[6]*X[i] + Proj.R[7]*Y[i] + Proj.R[8]*Z[i] + Proj.T[2];
+		if ( Zc <= 0.0f )
+		{
+			Pixels[i].x = -1.0f;
+			Pixels[i].y = -1.0f;
+			continue;
+		}
+
+		float x = Xc/Zc;
+		float y = Yc/Zc;
+		float r2 = x*x + y*y;
+		float d = 1.0f + r2*(Proj.k2 + r2*(Proj.k4 + r2*Proj.k6));
+		Pixels[i].x = Proj.cx + Proj.fx*x*d;
+		Pixels[i].y = Proj.cy - Proj.fy*y*d;
+	}
+}
+
+/* static */ void KinectCoordinateMapper::ProjectPoints(const Projection& Proj, const CameraSpacePoint * Points, int NbPoints, PixelPosition * Pixels)
+{
+	float X[ProjectionBlockSize], Y[ProjectionBlockSize], Z[ProjectionBlockSize];
+
+	for( int Begin = 0; Begin < NbPoints; Begin += ProjectionBlockSize )
+	{
+		int NbInBlock = NbPoints - Begin < ProjectionBlockSize ? NbPoints - Begin : ProjectionBlockSize;
+		for( int i = 0; i < NbInBlock; i++ )
+		{
+			X[i] = Points[Begin+i].X;
+			Y[i] = Points[Begin+i].Y;
+			Z[i] = Points[Begin+i].Z;
+		}
+		ProjectPlanes( Proj, X, Y, Z, NbInBlock, Pixels + Begin );
+	}
+}
+
+void KinectCoordinateMapper::MapCameraPointsToDepthSpace(const CameraSpacePoint * Points, int NbPoints, PixelPosition * Pixels) const
+{
+	ProjectPoints( DepthProjection, Points, NbPoints, Pixels );
+}
+
+void KinectCoordinateMapper::MapCameraPointsToColorSpace(const CameraSpacePoint * Points, int NbPoints, PixelPosition * Pixels) const
+{
+	ProjectPoints( ColorProjection, Points, NbPoints, Pixels );
+}
+
+void KinectCoordinateMapper::ComputeJointsInRGBAndDepth(KinectBody& Body) const
+{
+	if ( Body.Joints == (Joint*)nullptr )
+	{
+		return;
+	}
+
+	CameraSpacePoint Positions[JointType_Count];
+	for( int i = 0; i < JointType_Count; i++ )
+	{
+		Positions[i] = Body.Joints[i].Position;
+	}
+
+	MapCameraPointsToDepthSpace( Positions, JointType_Count, Body.JointsInDepthSpace );
+	MapCameraPointsToColorSpace( Positions, JointType_Count, Body.JointsInColorSpace );
+}
+
+void KinectCoordinateMapper::ComputeJointsInRGBAndDepth(KinectBodies& Bodies) const
+{
+	// All joints of all bodies as planes, then 2 projections
+	float X[BODY_COUNT*JointType_Count], Y[BODY_COUNT*JointType_Count], Z[BODY_COUNT*JointType_Count];
+	PixelPosition InDepth[BODY_COUNT*JointType_Count];
+	PixelPosition InColor[BODY_COUNT*JointType_Count];
+
+	int NbBodies = (int)Bodies.ActualNbBody < BODY_COUNT ? (int)Bodies.ActualNbBody : BODY_COUNT;
+	int NbPoints = 0;
+	for( int NumBody = 0; NumBody < NbBodies; NumBody++ )
+	{
+		const Joint * Joints = Bodies.BodiesInformation[NumBody].Joints;
+		for( int i = 0; i < JointType_Count; i++, NbPoints++ )
+		{
+			X[NbPoints] = Joints[i].Position.X;
+			Y[NbPoints] = Joints[i].Position.Y;
+			Z[NbPoints] = Joints[i].Position.Z;
+		}
+	}
+
+	ProjectPlanes( DepthProjection, X, Y, Z, NbPoints, InDepth );
+	ProjectPlanes( ColorProjection, X, Y, Z, NbPoints, InColor );
+
+	for( int NumBody = 0; NumBody < NbBodies; NumBody++ )
+	{
+		KinectBody& Body = Bodies.BodiesInformation[NumBody];
+		memcpy( Body.JointsInDepthSpace, InDepth + NumBody*JointType_Count, JointType_Count*sizeof(PixelPosition) );
+		memcpy( Body.JointsInColorSpace, InColor + NumBody*JointType_Count, JointType_Count*sizeof(PixelPosition) );
+	}
+}
+
+void KinectCoordinateMapper::MapDepthPixelsToColorSpace(const unsigned short * Depth, PixelPosition * ColorPixels, int Begin, int End) const
+{
+	const PointF * Table = UnprojectionTable.GetTable();
+	if ( Table == nullptr )
+	{
+		return;
+	}
+
+	float X[ProjectionBlockSize], Y[ProjectionBlockSize], Z[ProjectionBlockSize];
+	for( int BlockBegin = Begin; BlockBegin < End; BlockBegin += ProjectionBlockSize )
+	{
+		int NbInBlock = End - BlockBegin < ProjectionBlockSize ? End - BlockBegin : ProjectionBlockSize;
+
+		// Unproject with the table
+		for( int i = 0; i < NbInBlock; i++ )
+		{
+			float CurrentZ = (float)Depth[BlockBegin+i] * 0.001f;
+			X[i] = Table[BlockBegin+i].X * CurrentZ;
+			Y[i] = Table[BlockBegin+i].Y * CurrentZ;
+			Z[i] = CurrentZ;
+		}
+
+		ProjectPlanes( ColorProjection, X, Y, Z, NbInBlock, ColorPixels + BlockBegin );
+
+		// Invalid depth
+		for( int i = 0; i < NbInBlock; i++ )
+		{
+			if ( Depth[BlockBegin+i] == 0 )
+			{
+				ColorPixels[BlockBegin+i].x = -1.0f;
+				ColorPixels[BlockBegin+i].y = -1.0f;
+			}
+		}
+	}
+}
+
+void KinectCoordinateMapper::MapDepthFrameToColorSpace(const unsigned short * Depth, PixelPosition * ColorPixels, KinectWorkerPool * Pool /* = nullptr */) const
+{
+	if ( Depth == nullptr || ColorPixels == nullptr )
+	{
+		return;
+	}
+
+	if ( Pool == nullptr )
+	{
+		MapDepthPixelsToColorSpace( Depth, ColorPixels, 0, DepthWidth*DepthHeight );
+		return;
+	}
+
+	Pool->ParallelFor( DepthHeight, [&](int FirstRow, int LastRow)
+	{
+		MapDepthPixelsToColorSpace( Depth, ColorPixels, FirstRow*DepthWidth, LastRow*DepthWidth );
+	}, 16 );
+}
+
+#endif // KINECT_2
@@ -0,0 +1,225 @@
+/**
+ * @file KinectCoordinateMapper.h
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#ifndef __KINECT_COORDINATE_MAPPER_H__
+#define __KINECT_COORDINATE_MAPPER_H__
+
+#ifdef KINECT_2
+
+#include "KinectBasics.h"
+#include "DepthCameraModel.h"
+#include "DepthFrameToCameraSpaceTable.h"
+
+#include <memory>
+#include <vector>
+
+// Add Serialization facilities
+#include <Messaging/Serializable.h>
+
+class KinectWorkerPool;
+
+namespace MobileRGBD { namespace Kinect2 {
+
+class KinectBody;
+class KinectBodies;
+
+/**
+ * @class DepthToColorCalibration KinectCoordinateMapper.cpp KinectCoordinateMapper.h
+ * @brief Color camera intrinsics and rigid transformation from depth camera space to color camera space:
+ * Pc = Rotation*Pd + Translation (meters). Color pixels follow the same model as DepthCameraModel
+ * (radial distortion, Y axis up). Default values are typical Kinect v2 values, KinectSensor saves a per-device
+ * calibration estimated from the SDK mapper in sessions as "video/video.calibration".
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class DepthToColorCalibration : public Omiscid::Serializable
+{
+public:
+	/** @brief constructor. Set typical Kinect v2 values.
+	 */
+	DepthToColorCalibration();
+
+	/** @brief Copy constructor and operator, only values are copied (not the serialization mapping).
+	 */
+	DepthToColorCalibration(const DepthToColorCalibration& ToCopy);
+	DepthToColorCalibration& operator=(const DepthToColorCalibration& ToCopy);
+
+	/** @brief Virtual destructor, always.
+	 */
+	virtual ~DepthToColorCalibration() {}
+
+	/** @brief Save calibration as a JSON object.
+	 */
+	bool Save(const char * FileName) const;
+
+	/** @brief Load calibration from a JSON object written by Save, current values are kept if it fails.
+	 */
+	bool Load(const char * FileName);
+
+	/** @brief To (Un)serialize data, declare JSON mapping (Rotation and Translation are stored element by element).
+	 */
+	virtual void DeclareSerializeMapping();
+
+	/** @brief Save/Load in a session folder ("SessionFolder/video/video.calibration").
+	 */
+	bool SaveInSession(const char * SessionFolder) const;
+	bool LoadFromSession(const char * SessionFolder);
+
+	/** @brief Camera space points spread in the field of view of both cameras (1 to 4 m), to be mapped
+	 * to color space by a reference mapper (for instance the SDK ICoordinateMapper) before calling Estimate.
+	 *
+	 * @param Points [out] sample points.
+	 */
+	static void GetSamplePoints(std::vector<CameraSpacePoint>& Points);
+
+	/** @brief Estimate calibration from camera space points and their positions in the color image.
+	 * Focal lengths, principal point and X/Y translation are fitted by least squares, rotation is
+	 * identity, Z translation and distortion are 0. Points mapped outside (infinite values) are ignored.
+	 *
+	 * @param Points [in] camera space points.
+	 * @param ColorPixels [in] their positions in the color image.
+	 * @param NbPoints [in] number of points.
+	 * @return true if the fit succeeded, current values are kept otherwise.
+	 */
+	bool Estimate(const CameraSpacePoint * Points, const PixelPosition * ColorPixels, int NbPoints);
+
+	float FocalLengthX;						/*!< @brief Color focal length in pixels. */
+	float FocalLengthY;						/*!< @brief Color focal length in pixels. */
+	float PrincipalPointX;					/*!< @brief Color principal point. */
+	float PrincipalPointY;					/*!< @brief Color principal point. */
+	float RadialDistortionSecondOrder;		/*!< @brief Color radial distortion (r^2). */
+	float RadialDistortionFourthOrder;		/*!< @brief Color radial distortion (r^4). */
+	float RadialDistortionSixthOrder;		/*!< @brief Color radial distortion (r^6). */
+	float Rotation[9];						/*!< @brief Depth to color rotation, row major. */
+	float Translation[3];					/*!< @brief Depth to color translation in meters. */
+};
+
+/**
+ * @class KinectCoordinateMapper KinectCoordinateMapper.cpp KinectCoordinateMapper.h
+ * @brief Pure C++ replacement of the SDK ICoordinateMapper for recorded sessions: maps camera space points
+ * (joints) to depth and color images and depth frames to color space, using stored depth intrinsics
+ * (or SDK lookup table) and a DepthToColorCalibration. Points are processed 4 at a time with SSE2 when
+ * available. All mapping functions are const and can be used by several threads.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class KinectCoordinateMapper
+{
+public:
+	/** @brief constructor. Mapper is not valid until Init or InitFromSession succeeds.
+	 */
+	KinectCoordinateMapper();
+
+	/** @brief Virtual destructor, always.
+	 */
+	virtual ~KinectCoordinateMapper() {}
+
+	/** @brief Init mapper.
+	 *
+	 * @param Intrinsics [in] depth camera intrinsics.
+	 * @param Calibration [in] depth to color calibration.
+	 * @return true if intrinsics are valid.
+	 */
+	bool Init(const DepthCameraIntrinsics& Intrinsics, const DepthToColorCalibration& Calibration);
+
+	/** @brief Init mapper from a recorded session: depth intrinsics (required), SDK lookup table if any
+	 * (more accurate for depth frames), depth to color calibration if any (default values otherwise).
+	 *
+	 * @param SessionFolder [in] session folder.
+	 * @return true if the mapper is usable.
+	 */
+	bool InitFromSession(const char * SessionFolder);
+
+	/** @brief Use another table to unproject depth frames (for instance the SDK one).
+	 */
+	void SetUnprojectionTable(const DepthFrameToCameraSpaceTable& Table)
+	{
+		UnprojectionTable = Table;
+	}
+
+	/** @brief Is the mapper ready?
+	 */
+	bool IsValid() const
+	{
+		return DepthModel != nullptr;
+	}
+
+	/** @brief Calibration in use.
+	 */
+	const DepthToColorCalibration& GetCalibration() const
+	{
+		return Calibration;
+	}
+
+	/** @brief Map camera space points to depth image.
+	 *
+	 * @param Points [in] camera space points.
+	 * @param NbPoints [in] number of points.
+	 * @param Pixels [out] positions in depth image, (-1,-1) if behind the camera.
+	 */
+	void MapCameraPointsToDepthSpace(const CameraSpacePoint * Points, int NbPoints, PixelPosition * Pixels) const;
+
+	/** @brief Map camera space points to color image.
+	 *
+	 * @param Points [in] camera space points.
+	 * @param NbPoints [in] number of points.
+	 * @param Pixels [out] positions in color image, (-1,-1) if behind the color camera.
+	 */
+	void MapCameraPointsToColorSpace(const CameraSpacePoint * Points, int NbPoints, PixelPosition * Pixels) const;
+
+	/** @brief Recompute JointsInDepthSpace and JointsInColorSpace of one body.
+	 */
+	void ComputeJointsInRGBAndDepth(KinectBody& Body) const;
+
+	/** @brief Recompute JointsInDepthSpace and JointsInColorSpace of all bodies of a frame in one batch.
+	 */
+	void ComputeJointsInRGBAndDepth(KinectBodies& Bodies) const;
+
+	/** @brief Map a whole depth frame to color space (as ICoordinateMapper::MapDepthFrameToColorSpace).
+	 *
+	 * @param Depth [in] depth frame in mm (DepthWidth*DepthHeight).
+	 * @param ColorPixels [out] DepthWidth*DepthHeight positions in color image, (-1,-1) for invalid depth.
+	 * @param Pool [in] optional worker pool to split the frame between threads.
+	 */
+	void MapDepthFrameToColorSpace(const unsigned short * Depth, PixelPosition * ColorPixels, KinectWorkerPool * Pool = nullptr) const;
+
+	/** @brief Map depth pixels [Begin;End[ to color space, see MapDepthFrameToColorSpace.
+	 */
+	void MapDepthPixelsToColorSpace(const unsigned short * Depth, PixelPosition * ColorPixels, int Begin, int End) const;
+
+protected:
+	/** @brief Parameters of a projection: rigid transformation then distorted pinhole.
+	 */
+	class Projection
+	{
+	public:
+		float R[9];
+		float T[3];
+		float fx, fy, cx, cy;
+		float k2, k4, k6;
+	};
+
+	/** @brief Project points given as 3 planes (X, Y, Z).
+	 */
+	static void ProjectPlanes(const Projection& Proj, const float * X, const float * Y, const float * Z, int NbPoints, PixelPosition * Pixels);
+
+	/** @brief Project an array of CameraSpacePoint (converted to planes by blocks).
+	 */
+	static void ProjectPoints(const Projection& Proj, const CameraSpacePoint * Points, int NbPoints, PixelPosition * Pixels);
+
+	std::shared_ptr<const DepthCameraModel> DepthModel;		/*!< @brief Depth camera model (shared, cached). */
+	DepthFrameToCameraSpaceTable UnprojectionTable;			/*!< @brief Table to unproject depth pixels. */
+	DepthToColorCalibration Calibration;					/*!< @brief Color calibration. */
+	Projection DepthProjection;								/*!< @brief Camera space to depth image. */
+	Projection ColorProjection;								/*!< @brief Camera space to color image. */
+};
+
+}} // namespace MobileRGBD::Kinect2
+
+#endif // KINECT_2
+
+#endif // __KINECT_COORDINATE_MAPPER_H__
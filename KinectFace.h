@@ -38,23 +38,22 @@ public:
 	 */
 	KinectFace()
 	{
-			DWORD * FaceFrameFeatures = (DWORD *)nullptr;
-			UINT64 * TrackingId = (UINT64 *)nullptr;							// Gets the tracking ID.
-			Vector4 * RotationQuaternion = (Vector4 *)nullptr;						// FaceQuaternion
-			RectI * BoundingBoxInColorSpace  = (RectI *)nullptr;					// BoundingBox
-			RectI * BoundingBoxInInfraredSpace = (RectI *)nullptr;					// BoundingBox
-			PointF * FacePointsInColorSpace = (PointF *)nullptr;					
-			PointF * FacePointsInInfraredSpace = (PointF *)nullptr;
-			DetectionResult * FaceProperties = (DetectionResult *)nullptr;
-	};
+		// Not set in memory
+		TrackingId = (UINT64 *)nullptr;
+		RotationQuaternion = (Vector4 *)nullptr;
+		BoundingBoxInColorSpace = (RectI *)nullptr;
+		BoundingBoxInInfraredSpace = (RectI *)nullptr;
+		FacePointsInColorSpace = (PointF *)nullptr;
+		FacePointsInInfraredSpace = (PointF *)nullptr;
+		FaceProperties = (DetectionResult *)nullptr;
+	}
 
 	/** @brief constructor. Will set the data in memory.
 	 *
 	 * @param Buffer [in] Buffer to use for KinectFace data
 	 */
-	KinectFace(unsigned char *Buffer)
+	KinectFace(unsigned char *Buffer) : KinectFace()
 	{
-		KinectFace();
 		Set(Buffer);
 	}
 
@@ -115,6 +114,27 @@ public:
 
 		return true;
 	}
+
+	/** @brief Fill KinectFace buffer with data coming from the Kinect2 and store the tracking id of the body
+	 * associated to the face source, so faces can be joined to bodies. Exists only if KINECT_LIVE is defined.
+	 *
+	 * @param pFaceFrame [in] Pointer to the Kinect2 structure.
+	 * @param BodyTrackingId [in] Tracking id of the body followed by the face source (0 to keep the face one).
+	 */
+	bool Init(IFaceFrame* pFaceFrame, UINT64 BodyTrackingId)
+	{
+		if ( Init(pFaceFrame) == false )
+		{
+			return false;
+		}
+
+		if ( BodyTrackingId != 0 )
+		{
+			*TrackingId = BodyTrackingId;
+		}
+
+		return true;
+	}
 #endif
 
 #ifdef ACTIVATE_KINECT_DRAWING
@@ -218,6 +238,33 @@ public:
 	{
 	}
 
+	/** @brief Copy constructor. Data are copied in a buffer owned by the new instance.
+	 */
+	KinectFaces(const KinectFaces& Other) : KinectFaces()
+	{
+		*this = Other;
+	}
+
+	/** @brief Copy operator. Only the ActualNbFaces faces are copied in the buffer of this instance, without allocation.
+	 */
+	KinectFaces& operator=(const KinectFaces& Other)
+	{
+		if ( this == &Other )
+		{
+			return *this;
+		}
+
+		ActualNbFaces = Other.ActualNbFaces;
+		memcpy( FaceIsTracked, Other.FaceIsTracked, sizeof(FaceIsTracked) );
+
+		if ( ActualNbFaces != 0 )
+		{
+			memcpy( FaceData, Other.FaceData, ActualNbFaces*KinectFace::FaceSize );
+		}
+
+		return *this;
+	}
+
 	bool FaceIsTracked[BODY_COUNT];				/*!< @brief Store tracked state of faces. */
 
 	KinectFace FacesInformation[BODY_COUNT];	/*!< @brief Up to BODY_COUNT KinectFace can be handled. */
@@ -74,6 +74,7 @@ void KinectFaceStream::Exchange(KinectBodies& CurrentBodies)
 
 	HRESULT	hr = S_OK;
 	struct timeb lTimestamp = { 0 };
+	KinectTimestamp HostTimestamp;
 
 	// Face sources and readers
 	IFaceFrameReader *	   pFaceFrameReaders[BODY_COUNT] = { nullptr };
@@ -178,7 +179,8 @@ void KinectFaceStream::Exchange(KinectBodies& CurrentBodies)
 			}
 
 			// Get timestamp
-			ftime(&lTimestamp);
+			KinectClock::GetTimestamp(HostTimestamp);
+			HostTimestamp.ToTimeb(lTimestamp);
 					
 			BOOLEAN bFaceTracked = FALSE;
 			// check if a valid face is tracked in this face frame
@@ -233,11 +235,15 @@ void KinectFaceStream::Exchange(KinectBodies& CurrentBodies)
 
 			// Save Data, first set buffer size (in term of number of faces)
 			rcs.BufferSize = KF.ActualNbFaces*KinectFace::FaceSize;
-			rcs.SaveDataAndIncreaseInputNumber( lTimestamp, TmpNb );
+			const unsigned int NumFrame = rcs.InputNumber;
+			rcs.SaveDataAndIncreaseInputNumber( HostTimestamp, TmpNb );
+			Caller.PushToSynchronizer( KinectStreamSynchronizer::FaceStream, NumFrame, rcs, HostTimestamp, (int)KF.ActualNbFaces );
 
 			// Call only if we had faces
 			LastFrameContainedFaces = true;
+			long long int CallbackStart = KinectClock::GetMonotonicTime();
 			Caller.ProcessFaceFrame( KF, rcs.InputNumber, lTimestamp, rcs.LastFrameTime );
+			rcs.AddCallbackTime( CallbackStart );
 
 			// Input number was increased by 1 in SaveDataAndIncreaseInputNumber, increase it by the actual number of faces-1
 			rcs.InputNumber += KF.ActualNbFaces - 1;
@@ -0,0 +1,129 @@
+/**
+ * @file KinectFrameSnapshot.h
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#ifndef __KINECT_FRAME_SNAPSHOT_H__
+#define __KINECT_FRAME_SNAPSHOT_H__
+
+#ifdef KINECT_2
+
+#include "KinectBasics.h"
+#include "KinectBody.h"
+#include "KinectFace.h"
+
+#include <memory>
+
+namespace MobileRGBD { namespace Kinect2 {
+
+/**
+ * @class KinectFrameSnapshot KinectFrameSnapshot.h
+ * @brief Owning copy of a body or face frame (KinectBodies, KinectFaces) that survives the next acquisition, for
+ * instance to keep the frame given to ProcessBodyFrame. Snapshots can be moved but not copied: moving only transfers
+ * the buffer. Taking a new frame in a snapshot reuses its buffer, memory is allocated only by the first Take.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+template<typename FRAME_TYPE>
+class KinectFrameSnapshot
+{
+public:
+	/** @brief constructor. Empty snapshot.
+	 */
+	KinectFrameSnapshot()
+	{
+		NumFrame = -1;
+		RelativeTime = 0;
+	}
+
+	/** @brief constructor. Copy a frame.
+	 *
+	 * @param Frame [in] frame to copy.
+	 * @param NumFrame [in] frame number.
+	 * @param RelativeTime [in] device time of the frame.
+	 */
+	KinectFrameSnapshot(const FRAME_TYPE& Frame, int _NumFrame = -1, TIMESPAN _RelativeTime = 0)
+	{
+		Take( Frame, _NumFrame, _RelativeTime );
+	}
+
+	/** @brief Move constructor, Other becomes empty.
+	 */
+	KinectFrameSnapshot(KinectFrameSnapshot&& Other) : Data(std::move(Other.Data))
+	{
+		NumFrame = Other.NumFrame;
+		RelativeTime = Other.RelativeTime;
+		Other.NumFrame = -1;
+		Other.RelativeTime = 0;
+	}
+
+	/** @brief Move operator, Other becomes empty.
+	 */
+	KinectFrameSnapshot& operator=(KinectFrameSnapshot&& Other)
+	{
+		if ( this != &Other )
+		{
+			Data = std::move(Other.Data);
+			NumFrame = Other.NumFrame;
+			RelativeTime = Other.RelativeTime;
+			Other.NumFrame = -1;
+			Other.RelativeTime = 0;
+		}
+		return *this;
+	}
+
+	/** @brief Virtual destructor, always.
+	 */
+	virtual ~KinectFrameSnapshot() {}
+
+	/** @brief Copy a frame, reusing the buffer of the snapshot if any.
+	 *
+	 * @param Frame [in] frame to copy.
+	 * @param NumFrame [in] frame number.
+	 * @param RelativeTime [in] device time of the frame.
+	 */
+	void Take(const FRAME_TYPE& Frame, int _NumFrame = -1, TIMESPAN _RelativeTime = 0)
+	{
+		if ( Data == nullptr )
+		{
+			Data.reset( new FRAME_TYPE() );
+		}
+		*Data = Frame;
+		NumFrame = _NumFrame;
+		RelativeTime = _RelativeTime;
+	}
+
+	/** @brief Is there a frame?
+	 */
+	bool IsEmpty() const
+	{
+		return Data == nullptr;
+	}
+
+	/** @brief Frame of the snapshot (snapshot must not be empty).
+	 */
+	const FRAME_TYPE& Get() const
+	{
+		return *Data;
+	}
+
+	int NumFrame;				/*!< @brief Frame number, -1 if unknown. */
+	TIMESPAN RelativeTime;		/*!< @brief Device time of the frame (100 ns ticks). */
+
+protected:
+	KinectFrameSnapshot(const KinectFrameSnapshot&) = delete;
+	KinectFrameSnapshot& operator=(const KinectFrameSnapshot&) = delete;
+
+	std::unique_ptr<FRAME_TYPE> Data;	/*!< @brief Owned copy of the frame. */
+};
+
+typedef KinectFrameSnapshot<KinectBodies> KinectBodiesSnapshot;
+typedef KinectFrameSnapshot<KinectFaces> KinectFacesSnapshot;
+
+}} // namespace MobileRGBD::Kinect2
+
+#endif // KINECT_2
+
+#endif // __KINECT_FRAME_SNAPSHOT_H__
@@ -154,4 +154,25 @@ unsigned char * KinectImageConverter::ConvertYVY2ToBRG(unsigned char *buffer_in,
 	}
 
 	return (unsigned char*)nullptr;
+}
+
+/** @brief Convert only one pixel of a YVY2 buffer to BGR, to sample an image without converting it all.
+	*
+	* @param buffer_in [in] buffer to the YVY2 data from the Kinect2.
+	* @param rawFile_width [in] original width of the data.
+	* @param x [in] column of the pixel (must be in image).
+	* @param y [in] row of the pixel (must be in image).
+	* @param bgr_out [out] 3 bytes for BGR value.
+	*/
+void KinectImageConverter::ConvertYVY2PixelToBGR(const unsigned char *buffer_in, int rawFile_width, int x, int y, unsigned char * bgr_out)
+{
+	// 32 bits for 2 pixels: y0 u y1 v
+	const unsigned char * Macropixel = &buffer_in[(y*rawFile_width + (x & ~1))*2];
+	int c = (int)Macropixel[(x & 1) << 1] - 16;
+	int d = (int)Macropixel[1] - 128;
+	int e = (int)Macropixel[3] - 128;
+
+	bgr_out[IndexR] = clip(((298 * c) + (409 * e) + 128) >> 8);				// R
+	bgr_out[IndexG] = clip(((298 * c) - (100 * d) - (208 * e) + 128) >> 8);	// G
+	bgr_out[IndexB] = clip(((298 * c) + (516 * d) + 128) >> 8);				// B
 }
\ No newline at end of file
@@ -50,6 +50,16 @@ public:
 	 */
 	bool ConvertYVY2ToBRG(unsigned char *buffer_in, unsigned char *buffer_out, int rawFile_width, int rawFile_height, int resizefactor = 1 );
 
+	/** @brief Convert only one pixel of a YVY2 buffer to BGR, to sample an image without converting it all.
+	 *
+	 * @param buffer_in [in] buffer to the YVY2 data from the Kinect2.
+	 * @param rawFile_width [in] original width of the data.
+	 * @param x [in] column of the pixel (must be in image).
+	 * @param y [in] row of the pixel (must be in image).
+	 * @param bgr_out [out] 3 bytes for BGR value.
+	 */
+	static void ConvertYVY2PixelToBGR(const unsigned char *buffer_in, int rawFile_width, int x, int y, unsigned char * bgr_out);
+
 protected:
 	Omiscid::MemoryBuffer InternalBuffer;
 };
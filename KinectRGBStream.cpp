@@ -105,14 +105,21 @@ using namespace MobileRGBD::Kinect2;
 
 		SafeRelease( pColorFrame );
 			
+		KinectTimestamp HostTimestamp;
+		KinectClock::GetTimestamp(HostTimestamp);
+
 		timeb lTimestamp;
-		ftime(&lTimestamp);
+		HostTimestamp.ToTimeb(lTimestamp);
 
 		// Save data
-		RecContext->SaveDataAndIncreaseInputNumber( lTimestamp, nullptr );
+		const unsigned int NumFrame = RecContext->InputNumber;
+		RecContext->SaveDataAndIncreaseInputNumber( HostTimestamp, nullptr );
+		Caller.PushToSynchronizer( KinectStreamSynchronizer::ColorStream, NumFrame, *RecContext, HostTimestamp );
 
 		// Call Process function if any
+		long long int CallbackStart = KinectClock::GetMonotonicTime();
 		Caller.ProcessColorFrame(RecContext->BufferData, RecContext->BufferSize, RecContext->Width, RecContext->Height, KS_YUV2, RecContext->InputNumber, lTimestamp, RecContext->LastFrameTime );
+		RecContext->AddCallbackTime( CallbackStart );
 	}
 
 	m_pColorFrameReader->UnsubscribeFrameArrived(Wait);
@@ -6,6 +6,8 @@
 #include <System/LockManagement.h>
 
 #include "KinectBasics.h"
+#include "KinectClock.h"
+#include "KinectStreamStatistics.h"
 
 #include <sys/timeb.h>
 
@@ -14,6 +16,7 @@ class KinectRecording : public Omiscid::Serializable
 {
 public:
 	FILE* TimestampedFile;
+	FILE* HighResTimestampFile;
 
 	bool RawRecording;
 	FILE * RawFile;
@@ -26,9 +29,19 @@ public:
 	double StartTime;
 	unsigned int InputNumber;
 	TIMESPAN LastFrameTime;
+	KinectTimestamp LastHostTimestamp;
 	void * BufferData;
 	float FrameRate;
 
+	// Mapping of device RelativeTime onto host monotonic time
+	DeviceClockCalibration ClockCalibration;
+	float DeviceClockDriftPPM;
+	double DeviceClockOffset;
+	double WallClockAnchor;
+
+	// Latency, jitter and drop monitoring (owned by a StreamStatisticsRegistry, may be nullptr)
+	StreamStatistics * Statistics;
+
 	Omiscid::SimpleString FilePrefix;
 	bool IsActive;
 
@@ -70,13 +83,21 @@ public:
 		// For standard recording
 		FilePrefix		= Prefix;
 		TimestampedFile = (FILE*)nullptr;
+		HighResTimestampFile = (FILE*)nullptr;
 		InputNumber		= 0;
 		StartTime		= 0.0;
 		FrameRate		= 0.0;
 
 		LastFrameTime = 0;
+		LastHostTimestamp = KinectTimestamp();
 		BufferData = nullptr;
 
+		DeviceClockDriftPPM = 0.0f;
+		DeviceClockOffset = 0.0;
+		WallClockAnchor = 0.0;
+
+		Statistics = (StreamStatistics*)nullptr;
+
 		// Raw recording
 		RawRecording	= doRawRecord;
 		RawFile = (FILE*)nullptr;
@@ -115,6 +136,14 @@ public:
 
 		StartTime = 0;
 		LastFrameTime = 0;
+		ClockCalibration.Reset();
+
+		// Drops and latencies written at stop must only concern this recording. Frames are added
+		// under InternalProtection, only callback times may be recorded concurrently with the reset.
+		if ( Statistics != (StreamStatistics*)nullptr )
+		{
+			Statistics->Reset();
+		}
 
 		// Create session folder
 		if ( CreateDirectory(SessionFolder, NULL) == FALSE && GetLastError() != ERROR_ALREADY_EXISTS)
@@ -149,6 +178,18 @@ public:
 			return false;
 		}
 
+		// High resolution timestamps, legacy timestamp file is kept unchanged for compatibility
+		str2 = str;
+		str2 += ".hrtimestamp";
+
+		HighResTimestampFile = fopen(str2.GetStr(), "wb");
+		if ( HighResTimestampFile == nullptr )
+		{
+			fprintf( stderr, "Could not create '%s' high resolution timestamp file\n", str2.GetStr() );
+			CloseAndSetNull(TimestampedFile);
+			return false;
+		}
+
 	// Create Raw and Description file if mandatory
 		if ( RawRecording == true )
 		{
@@ -158,6 +199,7 @@ public:
 			{
 				fprintf( stderr, "Could not create '%s' raw file\n", str2.GetStr() );
 				CloseAndSetNull(TimestampedFile);
+				CloseAndSetNull(HighResTimestampFile);
 				return false;
 			}
 
@@ -167,6 +209,7 @@ public:
 			{
 				fprintf( stderr, "Could not create '%s' desc file\n", str2.GetStr() );
 				CloseAndSetNull(TimestampedFile);
+				CloseAndSetNull(HighResTimestampFile);
 				CloseAndSetNull(RawFile);
 				return false;
 			}
@@ -185,25 +228,79 @@ public:
 			CloseAndSetNull(RawFile);
 		}
 		CloseAndSetNull(TimestampedFile);
+		CloseAndSetNull(HighResTimestampFile);
 	}
 
-	void SaveDataAndIncreaseInputNumber( const struct timeb& lTimestamp, char * SuppInfo /* = nullptr */ )
+	/** @brief Compute clock calibration values to put in description files.
+	 */
+	void UpdateClockDescription()
+	{
+		DeviceClockDriftPPM = (float)ClockCalibration.GetDriftPPM();
+		DeviceClockOffset = (double)ClockCalibration.GetOffset()/1.0e9;
+		WallClockAnchor = (double)KinectClock::GetWallClockAnchor()/1.0e9;
+	}
+
+	void SaveDataAndIncreaseInputNumber( const KinectTimestamp& HostTimestamp, char * SuppInfo /* = nullptr */ )
 	{
 		Omiscid::SmartLocker InternalProtection_SL(InternalProtection);
 
+		long long int SaveStart = KinectClock::GetMonotonicTime();
+
+		// Remember host time of this frame and feed device/host clock mapping
+		LastHostTimestamp = HostTimestamp;
+		ClockCalibration.AddObservation( LastFrameTime, HostTimestamp.MonotonicTime );
+
+		if ( Statistics != (StreamStatistics*)nullptr )
+		{
+			Statistics->AddQueueWait( SaveStart - HostTimestamp.MonotonicTime );
+			Statistics->AddFrame( LastFrameTime, HostTimestamp.MonotonicTime, ClockCalibration.GetLastReceptionDelay() );
+		}
+
 		if ( RawFile != (FILE*)nullptr )
 		{
+			// First recorded frame gives start time of this recording
+			if ( InputNumber == 0 )
+			{
+				StartTime = HostTimestamp.GetWallClockInSeconds();
+			}
+
 			if ( BufferSize != 0 )
 			{
 				while (fwrite(BufferData, BufferSize, 1, RawFile) != 1) {}
 			}
+
+			struct timeb lTimestamp;
+			HostTimestamp.ToTimeb(lTimestamp);
 			SaveTimestamp(TimestampedFile, lTimestamp, InputNumber, LastFrameTime, SuppInfo);
+			SaveHighResTimestamp(HighResTimestampFile, HostTimestamp, InputNumber, LastFrameTime);
+
+			if ( Statistics != (StreamStatistics*)nullptr )
+			{
+				Statistics->AddDiskWrite( KinectClock::GetMonotonicTime() - SaveStart, BufferSize );
+			}
 		}
 
 		// We had an input
 		InputNumber++;
 	}
 
+	void SaveDataAndIncreaseInputNumber( const struct timeb& lTimestamp, char * SuppInfo /* = nullptr */ )
+	{
+		SaveDataAndIncreaseInputNumber( KinectTimestamp::FromTimeb(lTimestamp), SuppInfo );
+	}
+
+	/** @brief Add time spent in a Process* callback to statistics.
+	 *
+	 * @param CallbackStart [in] monotonic time before calling the callback.
+	 */
+	void AddCallbackTime( long long int CallbackStart )
+	{
+		if ( Statistics != (StreamStatistics*)nullptr )
+		{
+			Statistics->AddCallback( KinectClock::GetMonotonicTime() - CallbackStart );
+		}
+	}
+
 
 	// Static utility function
 	static void SaveTimestamp(FILE* f, const struct timeb& lTimestamp, unsigned int numFrame, TIMESPAN FrameTime, char * SuppInfo /* = nullptr */ )
@@ -222,6 +319,17 @@ public:
 			fprintf(f, "%d.%03d %u, %I64d\n", (int)lTimestamp.time, (int)lTimestamp.millitm, numFrame, FrameTime);
 		}
 	}
+
+	// Static utility function, one line per frame: "numFrame, monotonic ns, wall clock ns, RelativeTime"
+	static void SaveHighResTimestamp(FILE* f, const KinectTimestamp& HostTimestamp, unsigned int numFrame, TIMESPAN FrameTime )
+	{
+		if ( f == (FILE*)nullptr)
+		{
+			return;
+		}
+
+		fprintf(f, "%u, %lld, %lld, %lld\n", numFrame, HostTimestamp.MonotonicTime, HostTimestamp.WallClockTime, (long long int)FrameTime);
+	}
 };
 
 #endif // __KINECT_RECORDING_H__
@@ -0,0 +1,140 @@
+/**
+ * @file KinectRegistration.cpp
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#include "KinectRegistration.h"
+
+#ifdef KINECT_2
+
+#include "KinectImageConverter.h"
+#include "KinectWorkerPool.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+
+using namespace MobileRGBD::Kinect2;
+
+KinectRegistration::KinectRegistration(const KinectCoordinateMapper& _Mapper, KinectWorkerPool * _Pool /* = nullptr */) :
+	Mapper(_Mapper), Pool(_Pool), OcclusionTolerance(50),
+	ColorPixels( DepthWidth*DepthHeight ), ZBuffer( ZBufferWidth*ZBufferHeight )
+{
+}
+
+int KinectRegistration::Register(const unsigned short * Depth, const unsigned char * ColorYVY2, unsigned char * RegisteredBGR, unsigned char * ValidMask /* = nullptr */)
+{
+	if ( Depth == nullptr || ColorYVY2 == nullptr || RegisteredBGR == nullptr || Mapper.IsValid() == false )
+	{
+		return 0;
+	}
+
+	// Where each depth pixel is seen by the color camera
+	Mapper.MapDepthFrameToColorSpace( Depth, &ColorPixels[0], Pool );
+
+	// Keep closest depth in each z-buffer cell covered by the footprint of each depth pixel. Sequential, footprints
+	// are a few cells
+	memset( &ZBuffer[0], 0, ZBuffer.size()*sizeof(unsigned short) );
+	for( int v = 0; v < DepthHeight; v++ )
+	{
+		for( int u = 0; u < DepthWidth; u++ )
+		{
+			RasterizeFootprint( Depth, u, v );
+		}
+	}
+
+	// Sample colors of visible depth pixels
+	if ( Pool == nullptr )
+	{
+		return SampleColor( Depth, ColorYVY2, RegisteredBGR, ValidMask, 0, DepthWidth*DepthHeight );
+	}
+
+	std::atomic<int> NbRegistered(0);
+	Pool->ParallelFor( DepthHeight, [&](int FirstRow, int LastRow)
+	{
+		NbRegistered += SampleColor( Depth, ColorYVY2, RegisteredBGR, ValidMask, FirstRow*DepthWidth, LastRow*DepthWidth );
+	}, 16 );
+	return NbRegistered;
+}
+
+void KinectRegistration::RasterizeFootprint(const unsigned short * Depth, int u, int v)
+{
+	const int NumPixel = v*DepthWidth + u;
+	const unsigned short CurrentDepth = Depth[NumPixel];
+	const PixelPosition& Pos = ColorPixels[NumPixel];
+	if ( CurrentDepth == 0 || GetZBufferCell(NumPixel) < 0 )
+	{
+		return;
+	}
+
+	// Half size of the footprint: half the distance to the projection of the right/bottom neighbours
+	// when they are on the same surface, about one depth pixel otherwise
+	float HalfWidth = (float)ZBufferScale * 0.5f;
+	float HalfHeight = (float)ZBufferScale * 0.5f;
+	if ( u+1 < DepthWidth && Depth[NumPixel+1] != 0 && abs((int)Depth[NumPixel+1] - (int)CurrentDepth) <= (int)OcclusionTolerance )
+	{
+		HalfWidth = fabsf(ColorPixels[NumPixel+1].x - Pos.x) * 0.5f;
+	}
+	if ( v+1 < DepthHeight && Depth[NumPixel+DepthWidth] != 0 && abs((int)Depth[NumPixel+DepthWidth] - (int)CurrentDepth) <= (int)OcclusionTolerance )
+	{
+		HalfHeight = fabsf(ColorPixels[NumPixel+DepthWidth].y - Pos.y) * 0.5f;
+	}
+	HalfWidth = HalfWidth > (float)ZBufferScale ? (float)ZBufferScale : HalfWidth;
+	HalfHeight = HalfHeight > (float)ZBufferScale ? (float)ZBufferScale : HalfHeight;
+
+	// Cells covered by the footprint, clipped to the z-buffer
+	int FirstCol = (int)(Pos.x - HalfWidth) / ZBufferScale;
+	int LastCol = (int)(Pos.x + HalfWidth) / ZBufferScale;
+	int FirstRow = (int)(Pos.y - HalfHeight) / ZBufferScale;
+	int LastRow = (int)(Pos.y + HalfHeight) / ZBufferScale;
+	FirstCol = FirstCol < 0 ? 0 : FirstCol;
+	FirstRow = FirstRow < 0 ? 0 : FirstRow;
+	LastCol = LastCol >= ZBufferWidth ? ZBufferWidth-1 : LastCol;
+	LastRow = LastRow >= ZBufferHeight ? ZBufferHeight-1 : LastRow;
+
+	for( int Row = FirstRow; Row <= LastRow; Row++ )
+	{
+		unsigned short * Cells = &ZBuffer[Row*ZBufferWidth];
+		for( int Col = FirstCol; Col <= LastCol; Col++ )
+		{
+			if ( Cells[Col] == 0 || CurrentDepth < Cells[Col] )
+			{
+				Cells[Col] = CurrentDepth;
+			}
+		}
+	}
+}
+
+int KinectRegistration::SampleColor(const unsigned short * Depth, const unsigned char * ColorYVY2, unsigned char * RegisteredBGR, unsigned char * ValidMask, int Begin, int End) const
+{
+	int NbRegistered = 0;
+	for( int i = Begin; i < End; i++ )
+	{
+		unsigned char * BGR = &RegisteredBGR[i*3];
+
+		int Cell = GetZBufferCell(i);
+		if ( Cell < 0 || (int)Depth[i] > (int)ZBuffer[Cell] + (int)OcclusionTolerance )
+		{
+			// Not seen or hidden by something closer
+			BGR[0] = BGR[1] = BGR[2] = 0;
+			if ( ValidMask != nullptr )
+			{
+				ValidMask[i] = 0;
+			}
+			continue;
+		}
+
+		KinectImageConverter::ConvertYVY2PixelToBGR( ColorYVY2, CamWidth, (int)ColorPixels[i].x, (int)ColorPixels[i].y, BGR );
+		if ( ValidMask != nullptr )
+		{
+			ValidMask[i] = 1;
+		}
+		NbRegistered++;
+	}
+	return NbRegistered;
+}
+
+#endif // KINECT_2
@@ -0,0 +1,115 @@
+/**
+ * @file KinectRegistration.h
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#ifndef __KINECT_REGISTRATION_H__
+#define __KINECT_REGISTRATION_H__
+
+#ifdef KINECT_2
+
+#include "KinectBasics.h"
+#include "KinectCoordinateMapper.h"
+
+#include <vector>
+
+class KinectWorkerPool;
+
+namespace MobileRGBD { namespace Kinect2 {
+
+/**
+ * @class KinectRegistration KinectRegistration.cpp KinectRegistration.h
+ * @brief Register color on depth: for each depth pixel, the BGR value of the color pixel it projects to,
+ * giving 512x424 RGB-D frames. Color is sampled directly in the YVY2 frame (as stored in video.raw),
+ * the full HD image is never converted. Depth pixels hidden from the color camera by closer ones are
+ * detected with a coarse z-buffer in color space, where each depth pixel covers all cells of its projected
+ * footprint, and get no color.
+ * One instance keeps internal buffers, use one instance per thread (or a worker pool for one frame).
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class KinectRegistration
+{
+public:
+	enum { ZBufferScale = 4 };		/*!< @brief One z-buffer cell for ZBufferScale*ZBufferScale color pixels (about one depth pixel). */
+
+	/** @brief constructor.
+	 *
+	 * @param Mapper [in] coordinate mapper of the session (must outlive the registration).
+	 * @param Pool [in] optional worker pool to split frames between threads.
+	 */
+	KinectRegistration(const KinectCoordinateMapper& Mapper, KinectWorkerPool * Pool = nullptr);
+
+	/** @brief Virtual destructor, always.
+	 */
+	virtual ~KinectRegistration() {}
+
+	/** @brief Set occlusion tolerance: a depth pixel is occluded if it is farther than
+	 * the closest one seen at the same place in color by more than this distance.
+	 *
+	 * @param ToleranceInMm [in] tolerance in mm (default 50 mm).
+	 */
+	void SetOcclusionTolerance(unsigned short ToleranceInMm)
+	{
+		OcclusionTolerance = ToleranceInMm;
+	}
+
+	/** @brief Register a color frame on a depth frame.
+	 *
+	 * @param Depth [in] depth frame in mm (DepthWidth*DepthHeight).
+	 * @param ColorYVY2 [in] color frame in YVY2 (CamWidth*CamHeight).
+	 * @param RegisteredBGR [out] DepthWidth*DepthHeight*3 bytes, BGR for each depth pixel, 0 if no color.
+	 * @param ValidMask [out] optional DepthWidth*DepthHeight bytes, 1 if the depth pixel got a color, 0 otherwise.
+	 * @return number of depth pixels with a color.
+	 */
+	int Register(const unsigned short * Depth, const unsigned char * ColorYVY2, unsigned char * RegisteredBGR, unsigned char * ValidMask = nullptr);
+
+	/** @brief Depth in color image space (color-aligned depth) at z-buffer resolution, computed by the last Register call.
+	 *
+	 * @return (CamWidth/ZBufferScale)*(CamHeight/ZBufferScale) values in mm, 0 where no depth.
+	 */
+	const unsigned short * GetColorAlignedDepth() const
+	{
+		return &ZBuffer[0];
+	}
+
+protected:
+	/** @brief Sample color for depth pixels [Begin;End[ not occluded.
+	 *
+	 * @return number of depth pixels with a color.
+	 */
+	int SampleColor(const unsigned short * Depth, const unsigned char * ColorYVY2, unsigned char * RegisteredBGR, unsigned char * ValidMask, int Begin, int End) const;
+
+	/** @brief Keep depth of pixel (u,v) in all z-buffer cells covered by its footprint in color image, i.e. the
+	 * area up to half way to the projections of its neighbours (at most ZBufferScale color pixels on each side).
+	 */
+	void RasterizeFootprint(const unsigned short * Depth, int u, int v);
+
+	/** @brief Z-buffer cell of a depth pixel, -1 if outside color image.
+	 */
+	inline int GetZBufferCell(int NumPixel) const
+	{
+		const PixelPosition& Pos = ColorPixels[NumPixel];
+		if ( Pos.x < 0.0f || Pos.y < 0.0f || Pos.x >= (float)CamWidth || Pos.y >= (float)CamHeight )
+		{
+			return -1;
+		}
+		return ((int)Pos.y/ZBufferScale)*ZBufferWidth + (int)Pos.x/ZBufferScale;
+	}
+
+	enum { ZBufferWidth = CamWidth/ZBufferScale, ZBufferHeight = CamHeight/ZBufferScale };
+
+	const KinectCoordinateMapper& Mapper;		/*!< @brief Mapping from depth to color. */
+	KinectWorkerPool * Pool;					/*!< @brief Optional threads. */
+	unsigned short OcclusionTolerance;			/*!< @brief Occlusion tolerance in mm. */
+	std::vector<PixelPosition> ColorPixels;		/*!< @brief Position in color image of each depth pixel. */
+	std::vector<unsigned short> ZBuffer;		/*!< @brief Closest depth for each z-buffer cell. */
+};
+
+}} // namespace MobileRGBD::Kinect2
+
+#endif // KINECT_2
+
+#endif // __KINECT_REGISTRATION_H__
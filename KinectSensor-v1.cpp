@@ -200,6 +200,7 @@ void FUNCTION_CALL_TYPE KinectSensor::Run()
 
 	//Timestamp
 	struct timeb lTimestamp;
+	KinectTimestamp HostTimestamp;
 
 	// forever
 	while(StopPending() != true)
@@ -208,13 +209,14 @@ void FUNCTION_CALL_TYPE KinectSensor::Run()
 		WaitForMultipleObjects( NumberOfEvents, FrameEvents, FALSE, 20);
 
 		// Get time of this event (from Client side)
-		ftime(&lTimestamp);
+		KinectClock::GetTimestamp(HostTimestamp);
+		HostTimestamp.ToTimeb(lTimestamp);
 
 		// Process signal events
 		if (WAIT_OBJECT_0 == WaitForSingleObject(FrameEvents[DepthFrameEvent], 0))
 		{
 			VideoKinectRecording& rcs = *reinterpret_cast<VideoKinectRecording*>(DepthRecContext);
-			if ( GetRawFrame(lTimestamp, m_pDepthStreamHandle, rcs, 2 /* Bytes per pixels */ ) )
+			if ( GetRawFrame(HostTimestamp, m_pDepthStreamHandle, rcs, 2 /* Bytes per pixels */ ) )
 			{
 				ProcessDepthFrame(rcs.BufferData, rcs.FrameLengthInPixels, rcs.Width, rcs.Height, KS_UINT16_12, rcs.InputNumber, lTimestamp, rcs.LastFrameTime);
 			}
@@ -224,7 +226,7 @@ void FUNCTION_CALL_TYPE KinectSensor::Run()
 		if ( WAIT_OBJECT_0 == WaitForSingleObject(FrameEvents[VideoFrameEvent], 0) )
 		{
 			VideoKinectRecording& rcs = *reinterpret_cast<VideoKinectRecording*>(ColorRecContext);
-			if ( GetRawFrame(lTimestamp, m_pVideoStreamHandle, rcs, 4 /* Bytes per pixels */ ) )
+			if ( GetRawFrame(HostTimestamp, m_pVideoStreamHandle, rcs, 4 /* Bytes per pixels */ ) )
 			{
 				ProcessColorFrame(rcs.BufferData, rcs.FrameLengthInPixels, rcs.Width, rcs.Height, KS_RGBA, rcs.InputNumber, lTimestamp, rcs.LastFrameTime);
 			}	
@@ -252,7 +254,7 @@ void FUNCTION_CALL_TYPE KinectSensor::Run()
 	return;
 }
 
-bool KinectSensor::GetRawFrame( struct timeb& lTimestamp, HANDLE CurrentStream, VideoKinectRecording& RecContext, int NumberOfBytesPerPixels )
+bool KinectSensor::GetRawFrame( const KinectTimestamp& HostTimestamp, HANDLE CurrentStream, VideoKinectRecording& RecContext, int NumberOfBytesPerPixels )
 {
 	if ( RecContext.InitDescription == true)
 	{
@@ -260,7 +262,7 @@ bool KinectSensor::GetRawFrame( struct timeb& lTimestamp, HANDLE CurrentStream,
 		DWORD height = 0;
 		NuiImageResolutionToSize(NUI_IMAGE_RESOLUTION_640x480, width, height);
 				
-		RecContext.StartTime = (double)lTimestamp.time + (((double)lTimestamp.millitm)/1000.0);
+		RecContext.StartTime = HostTimestamp.GetWallClockInSeconds();
 		RecContext.Width = width;
 		RecContext.Height = height;
 		RecContext.BytesPerPixel = NumberOfBytesPerPixels;
@@ -297,7 +299,7 @@ bool KinectSensor::GetRawFrame( struct timeb& lTimestamp, HANDLE CurrentStream,
 	if ( IsRecording == true )
 	{
 		// Save data
-		SaveDataAndIncreaseInputNumber( RecContext, lTimestamp, nullptr );
+		SaveDataAndIncreaseInputNumber( RecContext, HostTimestamp, nullptr );
 	}
 
 	return true;
@@ -99,7 +99,7 @@ protected:
 	bool NearMode;		// Near mode
 	bool SeatedMode;	// Seated mode, i.e. upper body
 
-	bool GetRawFrame( struct timeb& lTimestamp, HANDLE CurrentStream, VideoKinectRecording& RecContext, int NumberOfBytesPerPixels );
+	bool GetRawFrame( const KinectTimestamp& HostTimestamp, HANDLE CurrentStream, VideoKinectRecording& RecContext, int NumberOfBytesPerPixels );
 
 	// Avants for streams
 	enum { DepthFrameEvent, VideoFrameEvent, SkeletonFrameEvent, AudioEvent, NumberOfEvents };
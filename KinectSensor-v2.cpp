@@ -23,12 +23,18 @@ KinectSensor::KinectSensor()
 {
 	pSensor = nullptr; 
 	GatheredSources = FrameSourceTypes::FrameSourceTypes_None;
+	StreamSynchronizer = nullptr;
+	DepthFilter = nullptr;
+	BodySmoothing = nullptr;
+	IsDepthFrameToCameraSpaceLookupTableFilled = false;
+	IsColorCalibrationEstimated = false;
 
 	IsRecording = false;
 
 	FloorEstimationProcess = NoEstimation;
+	IsFloorEstimatorToReset = false;
 	AngleWithFloor = 0;
-	NumberOfIdenticalFloorEStimation = 0;
+	IsFloorSavedInSession = false;
 }
 
 KinectSensor::~KinectSensor()
@@ -39,10 +45,7 @@ KinectSensor::~KinectSensor()
 
 	StopRecording();
 
-	while( RecContexts.IsNotEmpty() )
-	{
-		delete RecContexts.ExtractFirst();
-	}
+	ClearRecContexts();
 }
 
 void FUNCTION_CALL_TYPE KinectSensor::Run()
@@ -52,6 +55,7 @@ void FUNCTION_CALL_TYPE KinectSensor::Run()
 	WAITABLE_HANDLE hMultiSource = NULL;
 
 	struct timeb lTimestamp;
+	KinectTimestamp HostTimestamp;
 
 	KinectAudioStream AudioStream(*this);
 	KinectFaceStream FaceStream(*this);
@@ -127,6 +131,7 @@ void FUNCTION_CALL_TYPE KinectSensor::Run()
 		AudioStream.SetRecContext( reinterpret_cast<RawKinectRecording*>(AddRecContext( "audio", "AudioSample", RecordingContextFactory::VideoRecContext)) );
 				
 		// Open audio reader thread
+		AudioRing.Reset();
 		AudioStream.StartThread();
 	}
 
@@ -168,11 +173,11 @@ void FUNCTION_CALL_TYPE KinectSensor::Run()
 		{
 			// fprintf( stderr, "." );
 
-			// We lock access to RecordContexts
-			Omiscid::SmartLocker ProtectAccess_SL(ProtectAccess);
+			// No global lock here, each recording context protects itself while saving
 
 			// Get received timestamp
-			ftime(&lTimestamp);
+			KinectClock::GetTimestamp(HostTimestamp);
+			HostTimestamp.ToTimeb(lTimestamp);
 
 			IMultiSourceFrameReference * pRef = nullptr;
 			if (FAILED(pArgs->get_FrameReference(&pRef)))
@@ -230,29 +235,49 @@ void FUNCTION_CALL_TYPE KinectSensor::Run()
 			// Release multisource frame
 			SafeRelease(pFrame);
 
-			// Here we have all data, if needed
-			double CurrentTimeAsDouble = (double)lTimestamp.time + (((double)lTimestamp.millitm)/1000.0);
-			if ( IsRecording == true )
-			{
-				for( RecContexts.First(); RecContexts.NotAtEnd(); RecContexts.Next() )
-				{
-					KinectRecording * pRec = RecContexts.GetCurrent();
-					if( pRec->InputNumber == 0 )
-					{
-						pRec->StartTime = CurrentTimeAsDouble;
-					}
-				}
-			}
+			// Here we have all data, start time of recordings is set by each context on its first saved frame
 
 			if ( GatheredSources & FrameSourceTypes_Depth && DepthRecContext->LastFrameTime != 0 )
 			{				
 				RawKinectRecording& rcs =reinterpret_cast<RawKinectRecording&>(*DepthRecContext);
 
+				// Lookup table and intrinsics are available once the sensor delivers depth, save them in the current session if any
+				if ( IsDepthFrameToCameraSpaceLookupTableFilled == false && GetDepthFrameToCameraSpaceTable() == true && GetDepthCameraIntrinsics() == true )
+				{
+					bool CalibrationEstimated = GetDepthToColorCalibration();
+
+					Omiscid::SmartLocker ProtectAccess_SL(ProtectAccess);
+					IsDepthFrameToCameraSpaceLookupTableFilled = true;
+					IsColorCalibrationEstimated = CalibrationEstimated;
+					if ( IsRecording == true )
+					{
+						DepthFrameToCameraSpaceLookupTable.SaveInSession( CurrentSessionFolder.GetStr() );
+						DepthCameraInts.SaveInSession( CurrentSessionFolder.GetStr() );
+						SaveColorCalibrationInSession( CurrentSessionFolder.GetStr() );
+					}
+				}
+
 				// Save data
-				SaveDataAndIncreaseInputNumber( rcs, lTimestamp, nullptr );
+				const unsigned int NumFrame = rcs.InputNumber;
+				SaveDataAndIncreaseInputNumber( rcs, HostTimestamp, nullptr );
+				PushToSynchronizer( KinectStreamSynchronizer::DepthStream, NumFrame, rcs, HostTimestamp );
 												
-				// Call Process function if any
-				ProcessDepthFrame(rcs.BufferData, rcs.BufferSize, rcs.Width, rcs.Height, KS_UINT16, rcs.InputNumber, lTimestamp, rcs.LastFrameTime );
+				// Call Process function if any, with filtered depth if asked
+				long long int CallbackStart = KinectClock::GetMonotonicTime();
+				void * DepthData = rcs.BufferData;
+				if ( DepthFilter != nullptr && rcs.Width*rcs.Height == DepthFilterPipeline::NumberOfPixels )
+				{
+					FilteredDepth.resize( DepthFilterPipeline::NumberOfPixels );
+					DepthFilter->Filter( (const unsigned short*)rcs.BufferData, &FilteredDepth[0] );
+					DepthData = &FilteredDepth[0];
+				}
+				if ( IsDepthFrameToCameraSpaceLookupTableFilled == true && IsFloorEstimationActive() == true )
+				{
+					UpdateFloorEstimation( (const unsigned short*)DepthData );
+				}
+				CurrentDepthPyramid.SetFrame( (const unsigned short*)DepthData );
+				ProcessDepthFrame(DepthData, rcs.BufferSize, rcs.Width, rcs.Height, KS_UINT16, rcs.InputNumber, lTimestamp, rcs.LastFrameTime );
+				rcs.AddCallbackTime( CallbackStart );
 			}
 
 			if ( GatheredSources & FrameSourceTypes_Infrared && InfraredRecContext->LastFrameTime != 0 )
@@ -260,20 +285,26 @@ void FUNCTION_CALL_TYPE KinectSensor::Run()
 				RawKinectRecording& rcs = reinterpret_cast<RawKinectRecording&>(*InfraredRecContext);
 
 				// Save data
-				SaveDataAndIncreaseInputNumber(rcs, lTimestamp, nullptr );
+				const unsigned int NumFrame = rcs.InputNumber;
+				SaveDataAndIncreaseInputNumber(rcs, HostTimestamp, nullptr );
+				PushToSynchronizer( KinectStreamSynchronizer::InfraredStream, NumFrame, rcs, HostTimestamp );
 
 				// Call Process function if any
+				long long int CallbackStart = KinectClock::GetMonotonicTime();
 				ProcessInfaredFrame(rcs.BufferData, rcs.BufferSize, rcs.Width, rcs.Height, KS_UINT16, rcs.InputNumber, lTimestamp, rcs.LastFrameTime );
+				rcs.AddCallbackTime( CallbackStart );
 			}
 
 			if( GatheredSources & FrameSourceTypes_LongExposureInfrared && LongExposureInfraredRecContext->LastFrameTime != 0 )
 			{
 				RawKinectRecording& rcs = reinterpret_cast<RawKinectRecording&>(*LongExposureInfraredRecContext);
 
-				SaveDataAndIncreaseInputNumber(rcs, lTimestamp, nullptr );
+				SaveDataAndIncreaseInputNumber(rcs, HostTimestamp, nullptr );
 
 				// Call Process function if any
+				long long int CallbackStart = KinectClock::GetMonotonicTime();
 				ProcessLongExposureInfaredFrame( rcs.BufferData, rcs.BufferSize, rcs.Width, rcs.Height, KS_UINT16, rcs.InputNumber, lTimestamp, rcs.LastFrameTime );
+				rcs.AddCallbackTime( CallbackStart );
 			}
 
 			if( GatheredSources & FrameSourceTypes_BodyIndex && BodyIndexRecContext->LastFrameTime != 0 )
@@ -281,10 +312,14 @@ void FUNCTION_CALL_TYPE KinectSensor::Run()
 				RawKinectRecording& rcs = reinterpret_cast<RawKinectRecording&>(*BodyIndexRecContext);
 
 				// Save data
-				SaveDataAndIncreaseInputNumber(rcs, lTimestamp, nullptr );
+				const unsigned int NumFrame = rcs.InputNumber;
+				SaveDataAndIncreaseInputNumber(rcs, HostTimestamp, nullptr );
+				PushToSynchronizer( KinectStreamSynchronizer::BodyIndexStream, NumFrame, rcs, HostTimestamp );
 
 				// Call Process function if any
-				ProcessBodyIndexFrame( rcs.BufferData, rcs.BufferSize, rcs.Width, rcs.Height, KS_UINT16, rcs.InputNumber, lTimestamp, rcs.LastFrameTime );
+				long long int CallbackStart = KinectClock::GetMonotonicTime();
+				ProcessBodyIndexFrame( rcs.BufferData, rcs.BufferSize, rcs.Width, rcs.Height, KS_UINT8, rcs.InputNumber, lTimestamp, rcs.LastFrameTime );
+				rcs.AddCallbackTime( CallbackStart );
 			}
 
 			if( GatheredSources & FrameSourceTypes_Body && BodyRecContext->LastFrameTime != 0 )
@@ -296,14 +331,24 @@ void FUNCTION_CALL_TYPE KinectSensor::Run()
 				TmpNb[0] = (char)(CurrentBodies->ActualNbBody+48);	// Create ascii version of the number
 				TmpNb[1] = '\0';
 
-				// Save Data
-				SaveDataAndIncreaseInputNumber( rcs, lTimestamp, TmpNb );
+				// Save Data, NumFrame is the first body record of this frame
+				const unsigned int NumFrame = rcs.InputNumber;
+				SaveDataAndIncreaseInputNumber( rcs, HostTimestamp, TmpNb );
+				PushToSynchronizer( KinectStreamSynchronizer::BodyStream, NumFrame, rcs, HostTimestamp, (int)CurrentBodies->ActualNbBody );
+
+				// Smooth joints after saving, also with no body to forget lost ones
+				if ( BodySmoothing != nullptr )
+				{
+					BodySmoothing->Filter( *CurrentBodies, rcs.LastFrameTime );
+				}
 
 				// Call Process function if any
 				if ( CurrentBodies->ActualNbBody != 0 )
 				{
 					// Call only if we had bodies
+					long long int CallbackStart = KinectClock::GetMonotonicTime();
 					ProcessBodyFrame( *CurrentBodies, rcs.InputNumber, lTimestamp, rcs.LastFrameTime );
+					rcs.AddCallbackTime( CallbackStart );
 
 					// Remember we sent body
 					BodyWasSentPreviously = true;
@@ -327,29 +372,7 @@ void FUNCTION_CALL_TYPE KinectSensor::Run()
 				}
 			}
 
-
-			if ( IsRecording == true )
-			{
-				// Compute time between frames
-				for( RecContexts.First(); RecContexts.NotAtEnd(); RecContexts.Next() )
-				{
-					KinectRecording * pRec = RecContexts.GetCurrent();
-					if ( pRec->IsActive == false )
-					{
-						continue;
-					}
-
-					double TotalRecordingTime = CurrentTimeAsDouble - pRec->StartTime;
-					if ( TotalRecordingTime == 0.0 || pRec->InputNumber == 0 )
-					{
-						pRec->FrameRate = 0;
-					}
-					else
-					{
-						pRec->FrameRate = (float)pRec->InputNumber/(float)TotalRecordingTime;
-					}
-				}
-			}
+			// Frame rates are computed on demand by statistics (see GetStatistics) and at StopRecording for description files
 
 			// Shall we draw something?
 			if ( ShowFlags != SHOW_KINECT_NONE)
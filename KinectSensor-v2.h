@@ -28,6 +28,14 @@
 #include "RecordingManagement.h"
 #include "KinectSensorCommon.h"
 #include "DepthCameraIntrinsics.h"
+#include "KinectCoordinateMapper.h"
+#include "KinectStreamSynchronizer.h"
+#include "KinectAudioRing.h"
+#include "DepthFrameToCameraSpaceTable.h"
+#include "DepthFilterPipeline.h"
+#include "FloorPlaneEstimator.h"
+#include "DepthPyramid.h"
+#include "SkeletonSmoothing.h"
 
 class DepthCameraIntrinsics;
 
@@ -59,11 +67,57 @@ public:
 	virtual void ProcessBodyIndexFrame(void * Buffer, unsigned int BufferSize, int Width, int Height, ImgType FrameType, int NumFrame, const struct timeb& FrameTimestamp, TIMESPAN InternalFrameTime) {}
 	virtual void ProcessBodyFrame(MobileRGBD::Kinect2::KinectBodies& CurrentBodies, int NumFrame, const struct timeb& FrameTimestamp, TIMESPAN InternalFrameTime) {}
 	virtual void ProcessFaceFrame(MobileRGBD::Kinect2::KinectFaces& CurrentFaces, int NumFrame, const struct timeb& FrameTimestamp, TIMESPAN InternalFrameTime) {}
-	virtual void ProcessAudioFrame(float * CurrentAudio, int NumFrame, const struct timeb& FrameTimestamp, TIMESPAN InternalFrameTime) {}
+	virtual void ProcessAudioFrame(float * CurrentAudio, unsigned int NbSamples, int NumFrame, const struct timeb& FrameTimestamp, TIMESPAN InternalFrameTime) {}
 
 	// Init start with source selection
 	bool Init(int DesiredSources);
 
+	// Set synchronizer to receive timing of all frames (must be called before Init, synchronizer must outlive the sensor thread)
+	void SetStreamSynchronizer(KinectStreamSynchronizer * Synchronizer)
+	{
+		StreamSynchronizer = Synchronizer;
+	}
+
+	// Depth given to ProcessDepthFrame is filtered by this pipeline, recorded depth stays raw (must be called before Init, pipeline must outlive the sensor thread)
+	void SetDepthFilter(DepthFilterPipeline * Filter)
+	{
+		DepthFilter = Filter;
+	}
+
+	// Bodies given to ProcessBodyFrame are smoothed by this filter, recorded bodies stay raw (must be called before Init, filter must outlive the sensor thread)
+	void SetBodySmoothing(SkeletonSmoothing * Smoothing)
+	{
+		BodySmoothing = Smoothing;
+	}
+
+	// Audio samples are also pushed in this lock-free ring, one consumer can pull them (Read) or process them by block
+	// (register a KinectAudioBlockConsumer with SetConsumer, then call ProcessAvailableBlocks from the consumer thread)
+	KinectAudioRing& GetAudioRing()
+	{
+		return AudioRing;
+	}
+
+	// Start floor estimation from depth frames (OnlineFloorEstimation or EstimateFloorUntilStable), previous
+	// estimations are discarded. FloorPlaneEstimated is signaled when EstimateFloorUntilStable finds a stable floor.
+	// Sessions started without a stable floor estimate it until stable to save depth/depth.floor.
+	enum { NoEstimation, OnlineFloorEstimation, EstimateFloorUntilStable };
+	void StartFloorEstimation(int Mode)
+	{
+		Omiscid::SmartLocker ProtectAccess_SL(ProtectAccess);
+		FloorEstimationProcess = Mode;
+		IsFloorEstimatorToReset = true;
+		if ( Mode == EstimateFloorUntilStable )
+		{
+			FloorPlaneEstimated.Reset();
+		}
+	}
+
+	void StopFloorEstimation()
+	{
+		Omiscid::SmartLocker ProtectAccess_SL(ProtectAccess);
+		FloorEstimationProcess = NoEstimation;
+	}
+
 protected:
 	friend class KinectAudioStream;
 	friend class KinectRGBStream;
@@ -72,23 +126,111 @@ protected:
 	int GatheredSources;
 	IKinectSensor * pSensor;
 
+	// Cross stream synchronisation
+	KinectStreamSynchronizer * StreamSynchronizer;
+
+	// Optional filtering of depth for ProcessDepthFrame
+	DepthFilterPipeline * DepthFilter;
+	std::vector<unsigned short> FilteredDepth;
+
+	// Optional smoothing of bodies for ProcessBodyFrame
+	SkeletonSmoothing * BodySmoothing;
+
+	// Pyramid and integral images of the depth frame given to ProcessDepthFrame, built on first request during the call
+	DepthPyramid CurrentDepthPyramid;
+	DepthPyramid& GetDepthPyramid()
+	{
+		return CurrentDepthPyramid;
+	}
+
+	// Audio samples with device timestamps, filled by KinectAudioStream
+	KinectAudioRing AudioRing;
+	// NumFrame is the input number before SaveDataAndIncreaseInputNumber, i.e. the one written in the timestamp file
+	// (first record for bodies and faces), as used by SynchronizeRecordedSession
+	inline void PushToSynchronizer(int Stream, unsigned int NumFrame, const KinectRecording& RecordContext, const KinectTimestamp& HostTimestamp, int SuppInfo = -1)
+	{
+		if ( StreamSynchronizer != nullptr )
+		{
+			StreamSynchronizer->Push( Stream, NumFrame, RecordContext.LastFrameTime, HostTimestamp.MonotonicTime, SuppInfo );
+		}
+	}
+
 	virtual void FUNCTION_CALL_TYPE Run();
 
 
-	// Estimate floor Angle using Kinect SDK
-	enum { NoEstimation, OnlineFloorEstimation, EstimateFloorUntilStable };
-	int FloorEstimationProcess;
+	// Estimate floor plane and angle from depth frames (see FloorPlaneEstimator), saved as depth/depth.floor when stable
+	int FloorEstimationProcess;			// protected by ProtectAccess
+	bool IsFloorEstimatorToReset;		// protected by ProtectAccess
 	Vector4 FloorClipPlane;
 	float AngleWithFloor;
-	int NumberOfIdenticalFloorEStimation;
+	std::unique_ptr<FloorPlaneEstimator> FloorEstimator;
+	FloorPlane StableFloor;				// last stable estimation, protected by ProtectAccess
+	bool IsFloorSavedInSession;			// protected by ProtectAccess
 	Omiscid::Event FloorPlaneEstimated;
 
+	// Called by the sensor thread before each depth frame, reset estimator if asked by StartFloorEstimation
+	bool IsFloorEstimationActive()
+	{
+		Omiscid::SmartLocker ProtectAccess_SL(ProtectAccess);
+		if ( IsFloorEstimatorToReset == true && FloorEstimator != nullptr )
+		{
+			FloorEstimator->Reset();
+		}
+		IsFloorEstimatorToReset = false;
+		return FloorEstimationProcess != NoEstimation;
+	}
+
+	// Called with each depth frame when floor estimation is active
+	void UpdateFloorEstimation(const unsigned short * Depth)
+	{
+		if ( FloorEstimator == nullptr )
+		{
+			FloorEstimator.reset( new FloorPlaneEstimator( DepthFrameToCameraSpaceLookupTable ) );
+		}
+
+		FloorPlane FloorEstimate;
+		if ( FloorEstimator->Update( Depth, FloorEstimate ) == false )
+		{
+			return;
+		}
+
+		FloorClipPlane = FloorEstimate.Plane;
+		AngleWithFloor = FloorEstimate.TiltInDegrees;
+
+		if ( FloorEstimator->IsStable() == false )
+		{
+			return;
+		}
+
+		bool SignalStableFloor = false;
+		{
+			Omiscid::SmartLocker ProtectAccess_SL(ProtectAccess);
+			StableFloor = FloorEstimate;
+			if ( IsFloorSavedInSession == false && IsRecording == true )
+			{
+				IsFloorSavedInSession = StableFloor.SaveInSession( CurrentSessionFolder.GetStr() );
+			}
+
+			if ( FloorEstimationProcess == EstimateFloorUntilStable )
+			{
+				// Stop processing and signal that we found something
+				FloorEstimationProcess = NoEstimation;
+				SignalStableFloor = true;
+			}
+		}
+
+		if ( SignalStableFloor == true )
+		{
+			FloorPlaneEstimated.Signal();
+		}
+	}
+
 
 	DataEvent<bool> InitStepDone;
 
 	// Utility functions
 	bool IsDepthFrameToCameraSpaceLookupTableFilled;
-	Omiscid::TypedMemoryBuffer<PointF> DepthFrameToCameraSpaceLookupTable;
+	DepthFrameToCameraSpaceTable DepthFrameToCameraSpaceLookupTable;
 	bool GetDepthFrameToCameraSpaceTable()
 	{
 		if ( pSensor == nullptr )
@@ -109,16 +251,35 @@ protected:
 		{
 			return false;
 		}
-		// Set space to number of depth pixels
-		DepthFrameToCameraSpaceLookupTable.SetNewNumberOfElementsInBuffer( MobileRGBD::Kinect2::DepthWidth * MobileRGBD::Kinect2::DepthHeight );
-
-		// Copy data
-		memcpy( (PointF*)DepthFrameToCameraSpaceLookupTable, tableEntries, NumberOfElementInTable*sizeof(PointF) );
+		// Copy data, table may be empty while sensor is starting
+		bool Res = DepthFrameToCameraSpaceLookupTable.Set( tableEntries, NumberOfElementInTable );
 
 		// Free memory provided by Kinect
 		CoTaskMemFree(tableEntries);
 
-		return true;
+		return Res;
+	}
+
+	// Save lookup table and intrinsics in the session (depth/depth.table, depth/depth.intrinsics)
+	// to unproject depth offline, see DepthToPointCloud and DepthCameraModel
+	Omiscid::SimpleString CurrentSessionFolder;
+	virtual void SessionStarted(const char * SessionFolder)
+	{
+		CurrentSessionFolder = SessionFolder;
+		if ( IsDepthFrameToCameraSpaceLookupTableFilled == true && (GatheredSources & FrameSourceTypes_Depth) )
+		{
+			DepthFrameToCameraSpaceLookupTable.SaveInSession( SessionFolder );
+			DepthCameraInts.SaveInSession( SessionFolder );
+			SaveColorCalibrationInSession( SessionFolder );
+		}
+		IsFloorSavedInSession = StableFloor.IsValid() == true && StableFloor.SaveInSession( SessionFolder );
+
+		// No floor yet, estimate it until stable to save it in this session
+		if ( IsFloorSavedInSession == false && FloorEstimationProcess == NoEstimation && (GatheredSources & FrameSourceTypes_Depth) )
+		{
+			FloorEstimationProcess = EstimateFloorUntilStable;
+			FloorPlaneEstimated.Reset();
+		}
 	}
 
 	DepthCameraIntrinsics  DepthCameraInts;
@@ -136,7 +297,54 @@ protected:
 				return false;
 		}
 		pMapper->GetDepthCameraIntrinsics(&DepthCameraInts.IntrinsicsParameters);
-		return true;
+
+		// Intrinsics are zero while sensor is starting
+		return DepthCameraInts.IsValid();
+	}
+
+	// Depth to color calibration estimated from the SDK mapper, valid once depth intrinsics are
+	// (see GetDepthToColorCalibration), saved as video/video.calibration for KinectCoordinateMapper
+	DepthToColorCalibration ColorCalibration;
+	bool IsColorCalibrationEstimated;
+	bool GetDepthToColorCalibration()
+	{
+		if ( pSensor == nullptr )
+		{
+			return false;
+		}
+
+		ICoordinateMapper * pMapper;
+		if ( FAILED(pSensor->get_CoordinateMapper(&pMapper)) )
+		{
+				fprintf( stderr, "Unable to retrieve CoordinateMapper\n" );
+				return false;
+		}
+
+		std::vector<CameraSpacePoint> Points;
+		DepthToColorCalibration::GetSamplePoints( Points );
+		std::vector<ColorSpacePoint> SDKPixels( Points.size() );
+		if ( FAILED(pMapper->MapCameraPointsToColorSpace( (UINT)Points.size(), &Points[0], (UINT)SDKPixels.size(), &SDKPixels[0] )) )
+		{
+			return false;
+		}
+
+		std::vector<PixelPosition> ColorPixels( Points.size() );
+		for( size_t i = 0; i < Points.size(); i++ )
+		{
+			ColorPixels[i].x = SDKPixels[i].X;
+			ColorPixels[i].y = SDKPixels[i].Y;
+		}
+
+		return ColorCalibration.Estimate( &Points[0], &ColorPixels[0], (int)Points.size() );
+	}
+
+	// Color calibration goes with the color stream, only if it is recorded
+	void SaveColorCalibrationInSession(const char * SessionFolder)
+	{
+		if ( IsColorCalibrationEstimated == true && (GatheredSources & FrameSourceTypes_Color) )
+		{
+			ColorCalibration.SaveInSession( SessionFolder );
+		}
 	}
 
 	// Templating for code generation !
@@ -198,35 +406,6 @@ protected:
 
 	inline void GetBodyFrame(IBodyFrame * pInterfaceToFrame, KinectRecording& RecordContext, MobileRGBD::Kinect2::KinectBodies& Bodies, const char * DataTypeName)
 	{
-		// if we are tracking floor clip plane and floor angle
-		if (FloorEstimationProcess != NoEstimation)
-		{
-			pInterfaceToFrame->get_FloorClipPlane(&FloorClipPlane);
-
-			float tmpf = ceilf(atan2f(FloorClipPlane.z, FloorClipPlane.y) * 180.0f / 3.14f);
-			if (tmpf == AngleWithFloor)
-			{
-				NumberOfIdenticalFloorEStimation++;
-			}
-			else
-			{
-				// Get the new value
-				AngleWithFloor = tmpf;
-				NumberOfIdenticalFloorEStimation = 0;
-			}
-
-			if (FloorEstimationProcess == EstimateFloorUntilStable && NumberOfIdenticalFloorEStimation > 5 * 30)
-			{
-				// Stop processing
-				FloorEstimationProcess = NoEstimation;
-				NumberOfIdenticalFloorEStimation = 0;
-
-				// Signal that we found something
-				FloorPlaneEstimated.Signal();
-			}
-
-		}
-
 		// TODO : free previous IBody
 		for( int iBody = 0; iBody < BODY_COUNT; iBody++ )
 		{
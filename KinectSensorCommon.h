@@ -19,7 +19,8 @@ public:
 		KS_RGBA,		// RGBA
 		KS_YUV2,		// YUV2
 		KS_UINT16_12,	// UINT12, generally depth data from the Kinect 1.x version
-		KS_UINT16		// UINT16, depth data from the Kinect 2 version
+		KS_UINT16,		// UINT16, depth data from the Kinect 2 version
+		KS_UINT8		// UINT8, body index data from the Kinect 2 version
 	};
 
 protected:
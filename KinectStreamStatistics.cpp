@@ -0,0 +1,460 @@
+/**
+ * @file KinectStreamStatistics.cpp
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#include "KinectStreamStatistics.h"
+#include "KinectClock.h"
+
+#include <cstring>
+
+// LatencyHistogramSnapshot
+
+LatencyHistogramSnapshot::LatencyHistogramSnapshot()
+{
+	Count = 0;
+	Sum = 0;
+	Min = 0;
+	Max = 0;
+	memset( Buckets, 0, sizeof(Buckets) );
+}
+
+/* static */ int LatencyHistogramSnapshot::GetBucketIndex(long long int Value)
+{
+	if ( Value < SubBucketCount )
+	{
+		return Value < 0 ? 0 : (int)Value;
+	}
+
+	const long long int MaxValue = (1LL << (MaxExponent+1)) - 1;
+	if ( Value > MaxValue )
+	{
+		Value = MaxValue;
+	}
+
+	// Exponent of the most significant bit
+	int Exponent = 0;
+	unsigned long long int Tmp = (unsigned long long int)Value;
+	for( int Shift = 32; Shift > 0; Shift >>= 1 )
+	{
+		if ( Tmp >= (1ULL << Shift) )
+		{
+			Tmp >>= Shift;
+			Exponent += Shift;
+		}
+	}
+
+	int Mantissa = (int)((Value >> (Exponent - SubBucketBits)) & (SubBucketCount - 1));
+	return (Exponent - SubBucketBits + 1) * SubBucketCount + Mantissa;
+}
+
+/* static */ long long int LatencyHistogramSnapshot::GetBucketLowerBound(int Index)
+{
+	if ( Index < SubBucketCount )
+	{
+		return Index;
+	}
+
+	int Exponent = Index / SubBucketCount + SubBucketBits - 1;
+	int Mantissa = Index % SubBucketCount;
+	return ((long long int)(SubBucketCount + Mantissa)) << (Exponent - SubBucketBits);
+}
+
+long long int LatencyHistogramSnapshot::GetValueAtPercentile(double Percentile) const
+{
+	if ( Count == 0 )
+	{
+		return 0;
+	}
+
+	unsigned long long int Target = (unsigned long long int)((Percentile / 100.0) * (double)Count + 0.5);
+	if ( Target == 0 )
+	{
+		Target = 1;
+	}
+
+	unsigned long long int Cumulated = 0;
+	for( int i = 0; i < NumberOfBuckets; i++ )
+	{
+		Cumulated += Buckets[i];
+		if ( Cumulated >= Target )
+		{
+			// Keep value within observed range
+			long long int Value = GetBucketLowerBound(i);
+			if ( Value < Min ) { Value = Min; }
+			if ( Value > Max ) { Value = Max; }
+			return Value;
+		}
+	}
+	return Max;
+}
+
+double LatencyHistogramSnapshot::GetMean() const
+{
+	if ( Count == 0 )
+	{
+		return 0.0;
+	}
+	return (double)Sum/(double)Count;
+}
+
+// LatencyHistogram
+
+LatencyHistogram::LatencyHistogram()
+{
+	Reset();
+}
+
+void LatencyHistogram::Reset()
+{
+	Count.store( 0, std::memory_order_relaxed );
+	Sum.store( 0, std::memory_order_relaxed );
+	Min.store( -1, std::memory_order_relaxed );
+	Max.store( 0, std::memory_order_relaxed );
+	for( int i = 0; i < LatencyHistogramSnapshot::NumberOfBuckets; i++ )
+	{
+		Buckets[i].store( 0, std::memory_order_relaxed );
+	}
+}
+
+void LatencyHistogram::Record(long long int Value)
+{
+	if ( Value < 0 )
+	{
+		Value = 0;
+	}
+
+	Buckets[LatencyHistogramSnapshot::GetBucketIndex(Value)].fetch_add( 1, std::memory_order_relaxed );
+	Sum.fetch_add( Value, std::memory_order_relaxed );
+
+	long long int Current = Min.load(std::memory_order_relaxed);
+	while( (Current < 0 || Value < Current) && Min.compare_exchange_weak(Current, Value, std::memory_order_relaxed) == false ) {}
+
+	Current = Max.load(std::memory_order_relaxed);
+	while( Value > Current && Max.compare_exchange_weak(Current, Value, std::memory_order_relaxed) == false ) {}
+
+	// Count last, readers use it as the number of values
+	Count.fetch_add( 1, std::memory_order_release );
+}
+
+void LatencyHistogram::GetSnapshot(LatencyHistogramSnapshot& Snapshot) const
+{
+	Snapshot.Count = 0;
+	for( int i = 0; i < LatencyHistogramSnapshot::NumberOfBuckets; i++ )
+	{
+		Snapshot.Buckets[i] = Buckets[i].load(std::memory_order_relaxed);
+		Snapshot.Count += Snapshot.Buckets[i];
+	}
+	Snapshot.Sum = Sum.load(std::memory_order_relaxed);
+	Snapshot.Min = Min.load(std::memory_order_relaxed);
+	Snapshot.Max = Max.load(std::memory_order_relaxed);
+	if ( Snapshot.Min < 0 )
+	{
+		Snapshot.Min = 0;
+	}
+}
+
+// StreamStatisticsSnapshot
+
+namespace {
+
+void WriteHistogramJSON(FILE * f, const char * Name, const LatencyHistogramSnapshot& Histo)
+{
+	// Values in us are easier to read
+	fprintf( f, "\"%s\":{\"Count\":%llu,\"Mean\":%.1f,\"Min\":%.1f,\"P50\":%.1f,\"P90\":%.1f,\"P99\":%.1f,\"Max\":%.1f}",
+		Name, Histo.Count, Histo.GetMean()/1000.0, (double)Histo.Min/1000.0,
+		(double)Histo.GetValueAtPercentile(50.0)/1000.0, (double)Histo.GetValueAtPercentile(90.0)/1000.0,
+		(double)Histo.GetValueAtPercentile(99.0)/1000.0, (double)Histo.Max/1000.0 );
+}
+
+} // namespace
+
+void StreamStatisticsSnapshot::WriteJSON(FILE * f) const
+{
+	fprintf( f, "\"%s\":{\"Frames\":%llu,\"DroppedFrames\":%llu,\"BytesWritten\":%llu,\"FrameRate\":%.3f,\"UnitOfTimes\":\"us\",",
+		Name.c_str(), Frames, DroppedFrames, BytesWritten, FrameRate );
+	WriteHistogramJSON( f, "DeviceToHostLatency", DeviceToHostLatency );
+	fprintf( f, "," );
+	WriteHistogramJSON( f, "InterFrameJitter", InterFrameJitter );
+	fprintf( f, "," );
+	WriteHistogramJSON( f, "QueueWait", QueueWait );
+	fprintf( f, "," );
+	WriteHistogramJSON( f, "DiskWriteTime", DiskWriteTime );
+	fprintf( f, "," );
+	WriteHistogramJSON( f, "CallbackTime", CallbackTime );
+	fprintf( f, "}" );
+}
+
+// StreamStatistics
+
+StreamStatistics::StreamStatistics(const char * StreamName) : Name(StreamName)
+{
+	NominalFramePeriod = GetNominalFramePeriod(StreamName);
+	Reset();
+}
+
+/* static */ TIMESPAN StreamStatistics::GetNominalFramePeriod(const char * StreamName)
+{
+	// Image and body streams are 30 fps (color goes down to 15 fps in low light, the median follows it).
+	// Face frames only come with tracked faces and audio frames come by bursts: no drop inference.
+	static const char * PeriodicStreams[] = { "video", "depth", "infrared", "longexp_infrared", "body_index", "skeleton" };
+	for( size_t i = 0; i < sizeof(PeriodicStreams)/sizeof(PeriodicStreams[0]); i++ )
+	{
+		if ( strcmp(StreamName, PeriodicStreams[i]) == 0 )
+		{
+			return 333333;
+		}
+	}
+	return 0;
+}
+
+void StreamStatistics::Reset()
+{
+	Frames.store( 0, std::memory_order_relaxed );
+	DroppedFrames.store( 0, std::memory_order_relaxed );
+	BytesWritten.store( 0, std::memory_order_relaxed );
+	FirstHostTime.store( 0, std::memory_order_relaxed );
+	LastHostTime.store( 0, std::memory_order_relaxed );
+
+	DeviceToHostLatency.Reset();
+	InterFrameJitter.Reset();
+	QueueWait.Reset();
+	DiskWriteTime.Reset();
+	CallbackTime.Reset();
+
+	LastRelativeTime = 0;
+	NbRecentGaps = 0;
+	NextGap = 0;
+}
+
+TIMESPAN StreamStatistics::GetFramePeriod() const
+{
+	if ( NbRecentGaps < GapWindow )
+	{
+		return NominalFramePeriod;
+	}
+
+	// Insertion sort of a copy, GapWindow is small
+	TIMESPAN Sorted[GapWindow];
+	for( int i = 0; i < GapWindow; i++ )
+	{
+		int j = i;
+		for( ; j > 0 && Sorted[j-1] > RecentGaps[i]; j-- )
+		{
+			Sorted[j] = Sorted[j-1];
+		}
+		Sorted[j] = RecentGaps[i];
+	}
+	return Sorted[GapWindow/2];
+}
+
+void StreamStatistics::AddFrame(TIMESPAN RelativeTime, long long int HostTime, long long int ReceptionDelay)
+{
+	long long int PreviousHostTime = LastHostTime.load(std::memory_order_relaxed);
+
+	if ( RelativeTime != 0 )
+	{
+		DeviceToHostLatency.Record( ReceptionDelay );
+
+		if ( LastRelativeTime != 0 && RelativeTime > LastRelativeTime )
+		{
+			TIMESPAN Gap = RelativeTime - LastRelativeTime;
+
+			if ( NominalFramePeriod != 0 )
+			{
+				// More than 1.5 period means we lost frames
+				const TIMESPAN FramePeriod = GetFramePeriod();
+				if ( 2*Gap > 3*FramePeriod )
+				{
+					DroppedFrames.fetch_add( (unsigned long long int)((Gap + FramePeriod/2) / FramePeriod) - 1, std::memory_order_relaxed );
+				}
+
+				RecentGaps[NextGap] = Gap;
+				NextGap = (NextGap + 1) % GapWindow;
+				NbRecentGaps = NbRecentGaps < GapWindow ? NbRecentGaps + 1 : GapWindow;
+			}
+
+			// Host inter-arrival against device inter-frame
+			long long int Jitter = (HostTime - PreviousHostTime) - (long long int)Gap * 100;
+			InterFrameJitter.Record( Jitter < 0 ? -Jitter : Jitter );
+		}
+		LastRelativeTime = RelativeTime;
+	}
+
+	if ( FirstHostTime.load(std::memory_order_relaxed) == 0 )
+	{
+		FirstHostTime.store( HostTime, std::memory_order_relaxed );
+	}
+	LastHostTime.store( HostTime, std::memory_order_relaxed );
+	Frames.fetch_add( 1, std::memory_order_release );
+}
+
+void StreamStatistics::GetSnapshot(StreamStatisticsSnapshot& Snapshot) const
+{
+	Snapshot.Name = Name;
+	Snapshot.Frames = Frames.load(std::memory_order_acquire);
+	Snapshot.DroppedFrames = DroppedFrames.load(std::memory_order_relaxed);
+	Snapshot.BytesWritten = BytesWritten.load(std::memory_order_relaxed);
+
+	long long int Duration = LastHostTime.load(std::memory_order_relaxed) - FirstHostTime.load(std::memory_order_relaxed);
+	Snapshot.FrameRate = 0.0;
+	if ( Duration > 0 && Snapshot.Frames > 1 )
+	{
+		Snapshot.FrameRate = (double)(Snapshot.Frames-1) * 1.0e9 / (double)Duration;
+	}
+
+	DeviceToHostLatency.GetSnapshot( Snapshot.DeviceToHostLatency );
+	InterFrameJitter.GetSnapshot( Snapshot.InterFrameJitter );
+	QueueWait.GetSnapshot( Snapshot.QueueWait );
+	DiskWriteTime.GetSnapshot( Snapshot.DiskWriteTime );
+	CallbackTime.GetSnapshot( Snapshot.CallbackTime );
+}
+
+// StreamStatisticsRegistry
+
+StreamStatisticsRegistry::StreamStatisticsRegistry()
+{
+	for( int i = 0; i < MaxStreams; i++ )
+	{
+		Streams[i].store( nullptr, std::memory_order_relaxed );
+	}
+}
+
+StreamStatisticsRegistry::~StreamStatisticsRegistry()
+{
+	for( int i = 0; i < MaxStreams; i++ )
+	{
+		delete Streams[i].load(std::memory_order_relaxed);
+	}
+}
+
+StreamStatistics * StreamStatisticsRegistry::GetStreamStatistics(const char * StreamName)
+{
+	Omiscid::SmartLocker SL_CreationProtection(CreationProtection);
+
+	for( int i = 0; i < MaxStreams; i++ )
+	{
+		StreamStatistics * pStats = Streams[i].load(std::memory_order_acquire);
+		if ( pStats == nullptr )
+		{
+			// Free slot, create it
+			pStats = new StreamStatistics(StreamName);
+			Streams[i].store( pStats, std::memory_order_release );
+			return pStats;
+		}
+
+		if ( pStats->GetName() == StreamName )
+		{
+			// New context for this stream
+			pStats->Reset();
+			return pStats;
+		}
+	}
+
+	fprintf( stderr, "Too many streams for statistics, '%s' will not be monitored\n", StreamName );
+	return nullptr;
+}
+
+StreamStatistics * StreamStatisticsRegistry::GetStreamStatistics(int Index) const
+{
+	if ( Index < 0 || Index >= MaxStreams )
+	{
+		return nullptr;
+	}
+	return Streams[Index].load(std::memory_order_acquire);
+}
+
+void StreamStatisticsRegistry::WriteJSON(FILE * f) const
+{
+	KinectTimestamp Now;
+	KinectClock::GetTimestamp(Now);
+
+	StreamStatisticsSnapshot Snapshot;
+
+	fprintf( f, "{\"WallClockTime\":%.6f,\"Streams\":{", Now.GetWallClockInSeconds() );
+	bool First = true;
+	for( int i = 0; i < MaxStreams; i++ )
+	{
+		StreamStatistics * pStats = GetStreamStatistics(i);
+		if ( pStats == nullptr )
+		{
+			break;
+		}
+
+		pStats->GetSnapshot(Snapshot);
+		if ( First == false )
+		{
+			fprintf( f, "," );
+		}
+		Snapshot.WriteJSON(f);
+		First = false;
+	}
+	fprintf( f, "}}\n" );
+	fflush( f );
+}
+
+// StreamStatisticsDumper
+
+StreamStatisticsDumper::StreamStatisticsDumper(const StreamStatisticsRegistry& Registry) : Statistics(Registry)
+{
+	Output = (FILE*)nullptr;
+	Period = 1000;
+}
+
+StreamStatisticsDumper::~StreamStatisticsDumper()
+{
+	Stop();
+}
+
+bool StreamStatisticsDumper::Start(const char * FileName, unsigned int PeriodInMs)
+{
+	Stop();
+
+	if ( strcmp(FileName, "-") == 0 )
+	{
+		Output = stderr;
+	}
+	else
+	{
+		Output = fopen( FileName, "ab" );
+		if ( Output == (FILE*)nullptr )
+		{
+			fprintf( stderr, "Could not open '%s' to dump statistics\n", FileName );
+			return false;
+		}
+	}
+
+	Period = PeriodInMs == 0 ? 1 : PeriodInMs;
+	return StartThread();
+}
+
+void StreamStatisticsDumper::Stop()
+{
+	StopThread();
+
+	if ( Output != (FILE*)nullptr && Output != stderr )
+	{
+		fclose( Output );
+	}
+	Output = (FILE*)nullptr;
+}
+
+/* virtual */ void FUNCTION_CALL_TYPE StreamStatisticsDumper::Run()
+{
+	unsigned int Elapsed = 0;
+	while( StopPending() == false )
+	{
+		// Sleep by small steps to stop quickly
+		Omiscid::Thread::Sleep(50);
+		Elapsed += 50;
+		if ( Elapsed < Period )
+		{
+			continue;
+		}
+		Elapsed = 0;
+
+		Statistics.WriteJSON( Output );
+	}
+}
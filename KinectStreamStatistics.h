@@ -0,0 +1,299 @@
+/**
+ * @file KinectStreamStatistics.h
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#ifndef __KINECT_STREAM_STATISTICS_H__
+#define __KINECT_STREAM_STATISTICS_H__
+
+#include "KinectBasics.h"
+
+#include <System/Mutex.h>
+#include <System/LockManagement.h>
+#include <System/Thread.h>
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+
+/**
+ * @class LatencyHistogramSnapshot KinectStreamStatistics.cpp KinectStreamStatistics.h
+ * @brief Copy of a LatencyHistogram at a given time. Values are in ns.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class LatencyHistogramSnapshot
+{
+public:
+	enum { SubBucketBits = 5, SubBucketCount = 1 << SubBucketBits, MaxExponent = 47,
+		NumberOfBuckets = (MaxExponent - SubBucketBits + 2) * SubBucketCount };
+
+	LatencyHistogramSnapshot();
+
+	/** @brief Get value at a given percentile (lower bound of the bucket containing it).
+	 *
+	 * @param Percentile [in] percentile in [0;100].
+	 * @return value in ns, 0 if empty.
+	 */
+	long long int GetValueAtPercentile(double Percentile) const;
+
+	/** @brief Get mean value.
+	 *
+	 * @return mean in ns, 0 if empty.
+	 */
+	double GetMean() const;
+
+	/** @brief Bucket index of a value.
+	 */
+	static int GetBucketIndex(long long int Value);
+
+	/** @brief Lower bound of the values in a bucket.
+	 */
+	static long long int GetBucketLowerBound(int Index);
+
+	unsigned long long int Count;				/*!< @brief Number of recorded values. */
+	long long int Sum;							/*!< @brief Sum of recorded values. */
+	long long int Min;							/*!< @brief Minimum value. */
+	long long int Max;							/*!< @brief Maximum value. */
+	unsigned int Buckets[NumberOfBuckets];		/*!< @brief Log-linear buckets (~3% precision). */
+};
+
+/**
+ * @class LatencyHistogram KinectStreamStatistics.cpp KinectStreamStatistics.h
+ * @brief HDR-like log-linear histogram of durations in ns. Record and GetSnapshot are lock-free,
+ * Record can be called by one or several writers while readers take snapshots.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class LatencyHistogram
+{
+public:
+	LatencyHistogram();
+
+	/** @brief Add a value.
+	 *
+	 * @param Value [in] value in ns, negative values are counted as 0.
+	 */
+	void Record(long long int Value);
+
+	/** @brief Reset all values (not atomic against concurrent Record).
+	 */
+	void Reset();
+
+	/** @brief Get a copy of the histogram.
+	 *
+	 * @param Snapshot [out] copy.
+	 */
+	void GetSnapshot(LatencyHistogramSnapshot& Snapshot) const;
+
+protected:
+	std::atomic<unsigned long long int> Count;
+	std::atomic<long long int> Sum;
+	std::atomic<long long int> Min;
+	std::atomic<long long int> Max;
+	std::atomic<unsigned int> Buckets[LatencyHistogramSnapshot::NumberOfBuckets];
+};
+
+/**
+ * @class StreamStatisticsSnapshot KinectStreamStatistics.cpp KinectStreamStatistics.h
+ * @brief Copy of all statistics of a stream.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class StreamStatisticsSnapshot
+{
+public:
+	std::string Name;							/*!< @brief Name of the stream (recording prefix). */
+	unsigned long long int Frames;				/*!< @brief Number of received frames. */
+	unsigned long long int DroppedFrames;		/*!< @brief Frames missing according to RelativeTime gaps. */
+	unsigned long long int BytesWritten;		/*!< @brief Bytes written on disk. */
+	double FrameRate;							/*!< @brief Frames per second since first frame. */
+
+	LatencyHistogramSnapshot DeviceToHostLatency;	/*!< @brief Reception delay against device clock mapping (see DeviceClockCalibration). */
+	LatencyHistogramSnapshot InterFrameJitter;		/*!< @brief |host inter-arrival - device inter-frame| */
+	LatencyHistogramSnapshot QueueWait;				/*!< @brief From reception to start of saving. */
+	LatencyHistogramSnapshot DiskWriteTime;			/*!< @brief Time spent writing raw and timestamps. */
+	LatencyHistogramSnapshot CallbackTime;			/*!< @brief Time spent in Process* callbacks. */
+
+	/** @brief Write snapshot as a JSON object.
+	 *
+	 * @param f [in] output file.
+	 */
+	void WriteJSON(FILE * f) const;
+};
+
+/**
+ * @class StreamStatistics KinectStreamStatistics.cpp KinectStreamStatistics.h
+ * @brief Counters and histograms of a stream. Frame information is given by the thread processing
+ * the stream, snapshots can be taken from any thread without lock.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class StreamStatistics
+{
+public:
+	enum { GapWindow = 9 };
+
+	/** @brief constructor.
+	 *
+	 * @param StreamName [in] name of the stream, used to get its nominal frame period.
+	 */
+	StreamStatistics(const char * StreamName);
+
+	/** @brief Nominal device period of a stream from its recording prefix.
+	 *
+	 * @param StreamName [in] name of the stream.
+	 * @return period in 100 ns ticks, 0 for event-driven streams (face, audio) or unknown ones.
+	 */
+	static TIMESPAN GetNominalFramePeriod(const char * StreamName);
+
+	/** @brief Set nominal device period (0 to disable drop inference).
+	 */
+	void SetNominalFramePeriod(TIMESPAN Period) { NominalFramePeriod = Period; }
+
+	/** @brief Reset all values.
+	 */
+	void Reset();
+
+	/** @brief Add a new frame. Infer drops and jitter from device/host times (only one thread per stream).
+	 * Drops are inferred only for periodic streams, against the median of the last GapWindow device gaps.
+	 *
+	 * @param RelativeTime [in] device time of the frame (100 ns ticks, 0 if unknown).
+	 * @param HostTime [in] host monotonic reception time in ns.
+	 * @param ReceptionDelay [in] delay against device clock mapping in ns.
+	 */
+	void AddFrame(TIMESPAN RelativeTime, long long int HostTime, long long int ReceptionDelay);
+
+	/** @brief Add time spent waiting before saving.
+	 */
+	void AddQueueWait(long long int Duration) { QueueWait.Record(Duration); }
+
+	/** @brief Add time spent writing data.
+	 */
+	void AddDiskWrite(long long int Duration, unsigned int NumberOfBytes)
+	{
+		DiskWriteTime.Record(Duration);
+		BytesWritten.fetch_add(NumberOfBytes, std::memory_order_relaxed);
+	}
+
+	/** @brief Add time spent in callback.
+	 */
+	void AddCallback(long long int Duration) { CallbackTime.Record(Duration); }
+
+	/** @brief Get a copy of all statistics.
+	 *
+	 * @param Snapshot [out] copy.
+	 */
+	void GetSnapshot(StreamStatisticsSnapshot& Snapshot) const;
+
+	/** @brief Get the name of the stream.
+	 */
+	const std::string& GetName() const { return Name; }
+
+protected:
+	std::string Name;
+
+	std::atomic<unsigned long long int> Frames;
+	std::atomic<unsigned long long int> DroppedFrames;
+	std::atomic<unsigned long long int> BytesWritten;
+	std::atomic<long long int> FirstHostTime;
+	std::atomic<long long int> LastHostTime;
+
+	LatencyHistogram DeviceToHostLatency;
+	LatencyHistogram InterFrameJitter;
+	LatencyHistogram QueueWait;
+	LatencyHistogram DiskWriteTime;
+	LatencyHistogram CallbackTime;
+
+	/** @brief Current period estimate: median of recent gaps, nominal period until there are enough of them.
+	 */
+	TIMESPAN GetFramePeriod() const;
+
+	// Only used by the writer thread
+	TIMESPAN LastRelativeTime;
+	TIMESPAN NominalFramePeriod;		/*!< @brief Nominal device period, 0 for event-driven streams. */
+	TIMESPAN RecentGaps[GapWindow];		/*!< @brief Ring of the last device gaps. */
+	int NbRecentGaps;
+	int NextGap;
+};
+
+/**
+ * @class StreamStatisticsRegistry KinectStreamStatistics.cpp KinectStreamStatistics.h
+ * @brief Owns statistics of all streams. Statistics objects are never freed before the registry,
+ * so readers can enumerate them without lock while recording contexts come and go.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class StreamStatisticsRegistry
+{
+public:
+	enum { MaxStreams = 16 };
+
+	StreamStatisticsRegistry();
+	virtual ~StreamStatisticsRegistry();
+
+	/** @brief Get statistics of a stream, created if needed, reset if it existed.
+	 *
+	 * @param StreamName [in] name of the stream.
+	 * @return the statistics, nullptr if too many streams.
+	 */
+	StreamStatistics * GetStreamStatistics(const char * StreamName);
+
+	/** @brief Get statistics of stream at index (lock-free).
+	 *
+	 * @param Index [in] index in [0;MaxStreams[.
+	 * @return the statistics or nullptr.
+	 */
+	StreamStatistics * GetStreamStatistics(int Index) const;
+
+	/** @brief Write snapshots of all streams as a JSON object.
+	 *
+	 * @param f [in] output file.
+	 */
+	void WriteJSON(FILE * f) const;
+
+protected:
+	Omiscid::Mutex CreationProtection;						/*!< @brief Only creation is protected. */
+	std::atomic<StreamStatistics*> Streams[MaxStreams];
+};
+
+/**
+ * @class StreamStatisticsDumper KinectStreamStatistics.cpp KinectStreamStatistics.h
+ * @brief Thread dumping periodically all statistics of a registry as JSON (one object per line).
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class StreamStatisticsDumper : public Omiscid::Thread
+{
+public:
+	/** @brief constructor.
+	 *
+	 * @param Registry [in] statistics to dump.
+	 */
+	StreamStatisticsDumper(const StreamStatisticsRegistry& Registry);
+
+	virtual ~StreamStatisticsDumper();
+
+	/** @brief Start dumping.
+	 *
+	 * @param FileName [in] output file ("-" for stderr).
+	 * @param PeriodInMs [in] dump period.
+	 * @return true if started.
+	 */
+	bool Start(const char * FileName, unsigned int PeriodInMs);
+
+	/** @brief Stop dumping.
+	 */
+	void Stop();
+
+	virtual void FUNCTION_CALL_TYPE Run();
+
+protected:
+	const StreamStatisticsRegistry& Statistics;
+	FILE * Output;
+	unsigned int Period;
+};
+
+#endif // __KINECT_STREAM_STATISTICS_H__
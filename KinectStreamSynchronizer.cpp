@@ -0,0 +1,408 @@
+/**
+ * @file KinectStreamSynchronizer.cpp
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#include "KinectStreamSynchronizer.h"
+
+#ifdef KINECT_2
+
+#include "KinectBody.h"
+#include "KinectFace.h"
+#include "TimestampFileReader.h"
+
+#include <vector>
+
+using namespace MobileRGBD::Kinect2;
+
+namespace MobileRGBD { namespace Kinect2 {
+
+KinectStreamSynchronizer::KinectStreamSynchronizer(TIMESPAN MatchingTolerance /* = 166666 */, TIMESPAN MaximumWaitingTime /* = 2000000 */, int ReferenceStream /* = DepthStream */)
+{
+	Tolerance = MatchingTolerance;
+	MaxWait = MaximumWaitingTime;
+	Reference = ReferenceStream;
+
+	for( int i = 0; i < NumberOfStreams; i++ )
+	{
+		Expected[i] = false;
+		WaitFor[i] = false;
+	}
+	Expected[Reference] = true;
+	WaitFor[Reference] = true;
+
+	Reset();
+}
+
+void KinectStreamSynchronizer::EnableStream(int Stream, bool IsExpected /* = true */, bool WaitForIt /* = true */)
+{
+	if ( Stream < 0 || Stream >= NumberOfStreams || Stream == Reference )
+	{
+		return;
+	}
+
+	Omiscid::SmartLocker SL_Protection(Protection);
+
+	Expected[Stream] = IsExpected;
+	WaitFor[Stream] = IsExpected && WaitForIt;
+}
+
+void KinectStreamSynchronizer::Reset()
+{
+	Omiscid::SmartLocker SL_SendProtection(SendProtection);
+	Omiscid::SmartLocker SL_Protection(Protection);
+
+	for( int i = 0; i < NumberOfStreams; i++ )
+	{
+		Pending[i].clear();
+		PendingUsed[i].clear();
+		Stats.Matched[i] = 0;
+		Stats.Missing[i] = 0;
+		Stats.Unmatched[i] = 0;
+		Stats.Late[i] = 0;
+	}
+	Stats.EmittedTuples = 0;
+	LastEmittedTime = 0;
+}
+
+void KinectStreamSynchronizer::GetStatistics(Statistics& CurrentStats)
+{
+	Omiscid::SmartLocker SL_Protection(Protection);
+
+	CurrentStats = Stats;
+}
+
+void KinectStreamSynchronizer::Push(int Stream, unsigned int NumFrame, TIMESPAN RelativeTime, long long int HostTime, int SuppInfo /* = -1 */)
+{
+	SynchronizedFrame Frame;
+	Frame.Stream = Stream;
+	Frame.NumFrame = NumFrame;
+	Frame.RelativeTime = RelativeTime;
+	Frame.HostTime = HostTime;
+	Frame.SuppInfo = SuppInfo;
+
+	Push( Frame );
+}
+
+void KinectStreamSynchronizer::Push(const SynchronizedFrame& Frame)
+{
+	int Stream = Frame.Stream;
+	if ( Stream < 0 || Stream >= NumberOfStreams || Frame.RelativeTime == 0 )
+	{
+		return;
+	}
+
+	std::deque<SynchronizedFrame> Ready;
+
+	Omiscid::SmartLocker SL_SendProtection(SendProtection);
+	Omiscid::SmartLocker SL_Protection(Protection);
+
+	if ( Expected[Stream] == false )
+	{
+		return;
+	}
+
+	// Is it too late for this frame?
+	if ( LastEmittedTime != 0 )
+	{
+		if ( (Stream == Reference && Frame.RelativeTime <= LastEmittedTime) ||
+			 (Stream != Reference && Frame.RelativeTime < LastEmittedTime - Tolerance) )
+		{
+			Stats.Late[Stream]++;
+			return;
+		}
+	}
+
+	Pending[Stream].push_back(Frame);
+	PendingUsed[Stream].push_back(false);
+
+	CollectReadyTuples( false, Ready );
+
+	SL_Protection.Unlock();
+
+	SendTuples( Ready );
+}
+
+void KinectStreamSynchronizer::Flush()
+{
+	std::deque<SynchronizedFrame> Ready;
+
+	Omiscid::SmartLocker SL_SendProtection(SendProtection);
+	Omiscid::SmartLocker SL_Protection(Protection);
+
+	CollectReadyTuples( true, Ready );
+
+	// Everything left can not be matched anymore
+	for( int Stream = 0; Stream < NumberOfStreams; Stream++ )
+	{
+		PruneStream( Stream, LastEmittedTime + Tolerance + 1 );
+	}
+
+	SL_Protection.Unlock();
+
+	SendTuples( Ready );
+}
+
+void KinectStreamSynchronizer::PruneStream(int Stream, TIMESPAN OldestUsefulTime)
+{
+	while( Pending[Stream].empty() == false && Pending[Stream].front().RelativeTime < OldestUsefulTime )
+	{
+		if ( PendingUsed[Stream].front() == false )
+		{
+			Stats.Unmatched[Stream]++;
+		}
+		Pending[Stream].pop_front();
+		PendingUsed[Stream].pop_front();
+	}
+}
+
+void KinectStreamSynchronizer::CollectReadyTuples(bool ForceAll, std::deque<SynchronizedFrame>& Ready)
+{
+	std::deque<SynchronizedFrame>& RefPending = Pending[Reference];
+
+	while( RefPending.empty() == false )
+	{
+		const SynchronizedFrame& RefFrame = RefPending.front();
+		TIMESPAN RefTime = RefFrame.RelativeTime;
+
+		// Can we emit this reference frame?
+		bool IsReady = ForceAll;
+		if ( IsReady == false )
+		{
+			if ( RefPending.back().RelativeTime - RefTime >= MaxWait )
+			{
+				// We waited long enough for other streams
+				IsReady = true;
+			}
+			else
+			{
+				// Did all waited streams go beyond the matching window?
+				IsReady = true;
+				for( int Stream = 0; Stream < NumberOfStreams; Stream++ )
+				{
+					if ( Stream == Reference || WaitFor[Stream] == false )
+					{
+						continue;
+					}
+					if ( Pending[Stream].empty() || Pending[Stream].back().RelativeTime < RefTime + Tolerance )
+					{
+						IsReady = false;
+						break;
+					}
+				}
+			}
+		}
+
+		if ( IsReady == false )
+		{
+			break;
+		}
+
+		// Build tuple, search nearest frame of each stream
+		for( int Stream = 0; Stream < NumberOfStreams; Stream++ )
+		{
+			if ( Stream == Reference )
+			{
+				Ready.push_back(RefFrame);
+				Stats.Matched[Stream]++;
+				continue;
+			}
+
+			int BestIndex = -1;
+			TIMESPAN BestDelta = Tolerance + 1;
+			if ( Expected[Stream] == true )
+			{
+				// Frames are sorted, stop when delta starts increasing
+				for( size_t i = 0; i < Pending[Stream].size(); i++ )
+				{
+					TIMESPAN Delta = Pending[Stream][i].RelativeTime - RefTime;
+					if ( Delta < 0 )
+					{
+						Delta = -Delta;
+					}
+					if ( Delta < BestDelta )
+					{
+						BestDelta = Delta;
+						BestIndex = (int)i;
+					}
+					else if ( Pending[Stream][i].RelativeTime > RefTime )
+					{
+						break;
+					}
+				}
+			}
+
+			if ( BestIndex >= 0 )
+			{
+				Ready.push_back(Pending[Stream][BestIndex]);
+				PendingUsed[Stream][BestIndex] = true;
+				Stats.Matched[Stream]++;
+			}
+			else
+			{
+				// Empty frame
+				Ready.push_back(SynchronizedFrame());
+				if ( Expected[Stream] == true )
+				{
+					Stats.Missing[Stream]++;
+				}
+			}
+		}
+
+		Stats.EmittedTuples++;
+		LastEmittedTime = RefTime;
+		RefPending.pop_front();
+		PendingUsed[Reference].pop_front();
+
+		// Next reference frames are after RefTime, older frames can not be matched anymore
+		for( int Stream = 0; Stream < NumberOfStreams; Stream++ )
+		{
+			if ( Stream != Reference )
+			{
+				PruneStream( Stream, RefTime - Tolerance );
+			}
+		}
+	}
+}
+
+void KinectStreamSynchronizer::SendTuples(std::deque<SynchronizedFrame>& Ready)
+{
+	SynchronizedFrame Tuple[NumberOfStreams];
+
+	while( Ready.size() >= (size_t)NumberOfStreams )
+	{
+		for( int Stream = 0; Stream < NumberOfStreams; Stream++ )
+		{
+			Tuple[Stream] = Ready.front();
+			Ready.pop_front();
+		}
+
+		ProcessSynchronizedFrames( Tuple );
+	}
+}
+
+namespace {
+
+/** @brief Stream information for recorded sessions.
+ */
+class RecordedStream
+{
+public:
+	RecordedStream()
+	{
+		FixedFrameSize = 0;
+		RecordSize = 0;
+		Current = 0;
+	}
+
+	std::vector<TimestampRecord> Records;
+	long long int FixedFrameSize;	// size of frames for images
+	long long int RecordSize;		// size of one record for bodies/faces
+	size_t Current;
+};
+
+} // namespace
+
+bool SynchronizeRecordedSession(const char * SessionFolder, KinectStreamSynchronizer& Synchronizer)
+{
+	static const char * Prefixes[KinectStreamSynchronizer::NumberOfStreams] = { "depth", "video", "infrared", "body_index", "skeleton", "face" };
+
+	// Compute size of bodies and faces
+	KinectBody TmpBody;
+	TmpBody.Set(nullptr);
+	KinectFace TmpFace;
+	TmpFace.Set(nullptr);
+
+	RecordedStream Streams[KinectStreamSynchronizer::NumberOfStreams];
+	for( int Stream = 0; Stream < KinectStreamSynchronizer::NumberOfStreams; Stream++ )
+	{
+		if ( Synchronizer.IsStreamExpected(Stream) == false )
+		{
+			continue;
+		}
+
+		if ( TimestampFileReader::Load( SessionFolder, Prefixes[Stream], Streams[Stream].Records ) == false )
+		{
+			if ( Stream == Synchronizer.GetReferenceStream() )
+			{
+				fprintf( stderr, "Could not load reference stream '%s' in '%s'\n", Prefixes[Stream], SessionFolder );
+				return false;
+			}
+			continue;
+		}
+
+		if ( Stream == KinectStreamSynchronizer::BodyStream )
+		{
+			Streams[Stream].RecordSize = KinectBody::BodySize;
+		}
+		else if ( Stream == KinectStreamSynchronizer::FaceStream )
+		{
+			Streams[Stream].RecordSize = KinectFace::FaceSize;
+		}
+		else if ( Streams[Stream].Records.empty() == false )
+		{
+			// Images have a fixed size
+			long long int RawSize = TimestampFileReader::GetFileSize( TimestampFileReader::GetStreamFileName( SessionFolder, Prefixes[Stream], "raw" ).c_str() );
+			if ( RawSize > 0 )
+			{
+				Streams[Stream].FixedFrameSize = RawSize / (long long int)Streams[Stream].Records.size();
+			}
+		}
+	}
+
+	// Merge all streams in RelativeTime order
+	for(;;)
+	{
+		int NextStream = -1;
+		for( int Stream = 0; Stream < KinectStreamSynchronizer::NumberOfStreams; Stream++ )
+		{
+			RecordedStream& rs = Streams[Stream];
+			if ( rs.Current >= rs.Records.size() )
+			{
+				continue;
+			}
+			if ( NextStream == -1 || rs.Records[rs.Current].RelativeTime < Streams[NextStream].Records[Streams[NextStream].Current].RelativeTime )
+			{
+				NextStream = Stream;
+			}
+		}
+
+		if ( NextStream == -1 )
+		{
+			break;
+		}
+
+		RecordedStream& rs = Streams[NextStream];
+		const TimestampRecord& Record = rs.Records[rs.Current++];
+
+		SynchronizedFrame Frame;
+		Frame.Stream = NextStream;
+		Frame.RelativeTime = Record.RelativeTime;
+		Frame.HostTime = Record.MonotonicTime;
+		Frame.NumFrame = Record.NumFrame;
+		Frame.SuppInfo = Record.SuppInfo;
+		if ( rs.RecordSize != 0 )
+		{
+			// For bodies and faces, NumFrame is the number of the first record of this frame
+			Frame.FileOffset = (long long int)Record.NumFrame * rs.RecordSize;
+			Frame.DataSize = (unsigned int)(Record.GetNbRecords() * rs.RecordSize);
+		}
+		else
+		{
+			Frame.FileOffset = (long long int)Record.NumFrame * rs.FixedFrameSize;
+			Frame.DataSize = (unsigned int)rs.FixedFrameSize;
+		}
+
+		Synchronizer.Push( Frame );
+	}
+
+	Synchronizer.Flush();
+
+	return true;
+}
+
+}} // namespace MobileRGBD::Kinect2
+
+#endif // KINECT_2
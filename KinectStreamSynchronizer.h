@@ -0,0 +1,199 @@
+/**
+ * @file KinectStreamSynchronizer.h
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#ifndef __KINECT_STREAM_SYNCHRONIZER_H__
+#define __KINECT_STREAM_SYNCHRONIZER_H__
+
+#ifdef KINECT_2
+
+#include "KinectBasics.h"
+
+#include <System/Mutex.h>
+#include <System/LockManagement.h>
+
+#include <deque>
+#include <memory>
+
+namespace MobileRGBD { namespace Kinect2 {
+
+/**
+ * @class SynchronizedFrame KinectStreamSynchronizer.cpp KinectStreamSynchronizer.h
+ * @brief Reference to a frame of one stream. Payload is never copied: either Data points to memory
+ * kept alive by Holder (live usage), or FileOffset/DataSize locate it in the raw file (recorded sessions).
+ * Data may also be nullptr when only timing is synchronised, NumFrame is then the key to retrieve frames.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class SynchronizedFrame
+{
+public:
+	SynchronizedFrame()
+	{
+		Stream = -1;
+		RelativeTime = 0;
+		HostTime = 0;
+		NumFrame = 0;
+		SuppInfo = -1;
+		Data = nullptr;
+		DataSize = 0;
+		FileOffset = -1;
+	}
+
+	/** @brief Is this reference valid, i.e. did the stream provide a frame?
+	 */
+	bool IsValid() const
+	{
+		return Stream >= 0;
+	}
+
+	int Stream;								/*!< @brief Stream of the frame (see KinectStreamSynchronizer::StreamType). */
+	TIMESPAN RelativeTime;					/*!< @brief Device time in 100 ns ticks, used for matching. */
+	long long int HostTime;					/*!< @brief Host monotonic reception time in ns. */
+	unsigned int NumFrame;					/*!< @brief Input number of the frame in its stream. */
+	int SuppInfo;							/*!< @brief Number of bodies/faces (-1 if not applicable). */
+	const void * Data;						/*!< @brief Payload, may be nullptr. */
+	unsigned int DataSize;					/*!< @brief Payload size in bytes. */
+	long long int FileOffset;				/*!< @brief Offset of payload in the raw file, -1 for live frames. */
+	std::shared_ptr<const void> Holder;		/*!< @brief Optional owner of the payload (keep it alive while referenced). */
+};
+
+/**
+ * @class KinectStreamSynchronizer KinectStreamSynchronizer.cpp KinectStreamSynchronizer.h
+ * @brief Buffer a short window of frames per stream and emit tuples matched by nearest RelativeTime
+ * against a reference stream (depth by default). Frames may be pushed from several threads.
+ * Matched tuples are delivered through ProcessSynchronizedFrames in reference stream order.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class KinectStreamSynchronizer
+{
+public:
+	enum StreamType { DepthStream = 0, ColorStream, InfraredStream, BodyIndexStream, BodyStream, FaceStream, NumberOfStreams };
+
+	/** @brief constructor.
+	 *
+	 * @param MatchingTolerance [in] maximum difference of RelativeTime between reference frame and matched frame (100 ns ticks, default 16.6 ms).
+	 * @param MaximumWaitingTime [in] maximum time to wait for other streams before emitting a reference frame (100 ns ticks, default 200 ms).
+	 * @param ReferenceStream [in] stream driving the tuples.
+	 */
+	KinectStreamSynchronizer(TIMESPAN MatchingTolerance = 166666, TIMESPAN MaximumWaitingTime = 2000000, int ReferenceStream = DepthStream);
+
+	/** @brief Virtual destructor, always.
+	 */
+	virtual ~KinectStreamSynchronizer() {}
+
+	/** @brief Declare stream as expected (or not) in the tuples. Must be called before pushing frames.
+	 *
+	 * @param Stream [in] stream.
+	 * @param IsExpected [in] is it expected?
+	 * @param WaitForIt [in] wait for this stream before emitting a tuple. Use false for sparse streams (faces),
+	 *                       they will be matched only if already there.
+	 */
+	void EnableStream(int Stream, bool IsExpected = true, bool WaitForIt = true);
+
+	/** @brief Is this stream expected in tuples?
+	 */
+	bool IsStreamExpected(int Stream) const
+	{
+		return Stream >= 0 && Stream < NumberOfStreams && Expected[Stream];
+	}
+
+	/** @brief Get reference stream.
+	 */
+	int GetReferenceStream() const
+	{
+		return Reference;
+	}
+
+	/** @brief Add a frame. Frames of one stream must be pushed in increasing RelativeTime.
+	 *
+	 * @param Frame [in] the frame reference.
+	 */
+	void Push(const SynchronizedFrame& Frame);
+
+	/** @brief Helper to push a frame without payload (timing only).
+	 */
+	void Push(int Stream, unsigned int NumFrame, TIMESPAN RelativeTime, long long int HostTime, int SuppInfo = -1);
+
+	/** @brief Emit all remaining reference frames, for instance at the end of a recorded session.
+	 */
+	void Flush();
+
+	/** @brief Forget all buffered frames and reset counters.
+	 */
+	void Reset();
+
+	/** @brief Callback called with matched frames. Frames[Stream].IsValid() is false if no frame was found within tolerance.
+	 *
+	 * @param Frames [in] array of NumberOfStreams frames.
+	 */
+	virtual void ProcessSynchronizedFrames(const SynchronizedFrame * Frames) {}
+
+	/** @brief Counters of the synchronizer.
+	 */
+	class Statistics
+	{
+	public:
+		unsigned int EmittedTuples;					/*!< @brief Number of emitted tuples. */
+		unsigned int Matched[NumberOfStreams];		/*!< @brief Number of frames matched for each stream. */
+		unsigned int Missing[NumberOfStreams];		/*!< @brief Number of tuples without frame for this stream. */
+		unsigned int Unmatched[NumberOfStreams];	/*!< @brief Frames dropped without being part of any tuple. */
+		unsigned int Late[NumberOfStreams];			/*!< @brief Frames arrived after their tuple was emitted. */
+	};
+
+	/** @brief Get a copy of counters.
+	 *
+	 * @param Stats [out] counters.
+	 */
+	void GetStatistics(Statistics& Stats);
+
+protected:
+	/** @brief Emit ready reference frames. Must be called with Protection locked.
+	 *
+	 * @param ForceAll [in] emit all buffered reference frames.
+	 * @param Ready [out] tuples to send (NumberOfStreams frames per tuple).
+	 */
+	void CollectReadyTuples(bool ForceAll, std::deque<SynchronizedFrame>& Ready);
+
+	/** @brief Send tuples to ProcessSynchronizedFrames (Protection must not be locked).
+	 */
+	void SendTuples(std::deque<SynchronizedFrame>& Ready);
+
+	/** @brief Remove frames that can not be matched anymore.
+	 */
+	void PruneStream(int Stream, TIMESPAN OldestUsefulTime);
+
+	TIMESPAN Tolerance;								/*!< @brief Matching tolerance (100 ns ticks). */
+	TIMESPAN MaxWait;								/*!< @brief Maximum waiting time for other streams. */
+	int Reference;									/*!< @brief Reference stream. */
+
+	bool Expected[NumberOfStreams];					/*!< @brief Stream expected in tuples. */
+	bool WaitFor[NumberOfStreams];					/*!< @brief Wait for stream before emitting tuples. */
+	std::deque<SynchronizedFrame> Pending[NumberOfStreams];	/*!< @brief Buffered frames of each stream. */
+	std::deque<bool> PendingUsed[NumberOfStreams];	/*!< @brief Was a buffered frame used in a tuple? */
+	TIMESPAN LastEmittedTime;						/*!< @brief RelativeTime of last emitted reference frame. */
+
+	Statistics Stats;								/*!< @brief Counters. */
+
+	Omiscid::Mutex Protection;						/*!< @brief Protect buffers and counters. */
+	Omiscid::Mutex SendProtection;					/*!< @brief Keep tuples in order when several threads push frames (taken before Protection). */
+};
+
+/** @brief Synchronise a recorded session. Frames of all enabled streams are pushed in RelativeTime order,
+ * with FileOffset and DataSize set to locate payloads in raw files. Nothing is read from raw files.
+ *
+ * @param SessionFolder [in] session folder (containing depth/, video/, skeleton/, face/ ...).
+ * @param Synchronizer [in] synchronizer with enabled streams.
+ * @return true if at least the reference stream was loaded.
+ */
+bool SynchronizeRecordedSession(const char * SessionFolder, KinectStreamSynchronizer& Synchronizer);
+
+}} // namespace MobileRGBD::Kinect2
+
+#endif // KINECT_2
+
+#endif // __KINECT_STREAM_SYNCHRONIZER_H__
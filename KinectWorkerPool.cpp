@@ -0,0 +1,119 @@
+/**
+ * @file KinectWorkerPool.cpp
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#include "KinectWorkerPool.h"
+
+#include <thread>
+
+KinectWorkerPool::Worker::Worker()
+{
+	Task = nullptr;
+	Begin = 0;
+	End = 0;
+}
+
+KinectWorkerPool::Worker::~Worker()
+{
+	StopThread();
+}
+
+/* virtual */ void FUNCTION_CALL_TYPE KinectWorkerPool::Worker::Run()
+{
+	while( !StopPending() )
+	{
+		// Wake up regularly to check StopPending
+		if ( WorkAvailable.Wait(100) == false )
+		{
+			continue;
+		}
+		WorkAvailable.Reset();
+
+		if ( Task != nullptr )
+		{
+			(*Task)( Begin, End );
+			Task = nullptr;
+		}
+
+		WorkDone.Signal();
+	}
+}
+
+KinectWorkerPool::KinectWorkerPool(int NumberOfWorkers /* = -1 */)
+{
+	if ( NumberOfWorkers < 0 )
+	{
+		int NbCores = (int)std::thread::hardware_concurrency();
+		NumberOfWorkers = NbCores > 1 ? NbCores-1 : 0;
+	}
+
+	for( int i = 0; i < NumberOfWorkers; i++ )
+	{
+		Workers.push_back( std::unique_ptr<Worker>(new Worker) );
+		Workers.back()->StartThread();
+	}
+}
+
+/* virtual */ KinectWorkerPool::~KinectWorkerPool()
+{
+	for( size_t i = 0; i < Workers.size(); i++ )
+	{
+		Workers[i]->StopThread();
+	}
+}
+
+void KinectWorkerPool::ParallelFor(int NbItems, const RangeTask& Task, int MinItemsPerRange /* = 1 */)
+{
+	if ( NbItems <= 0 )
+	{
+		return;
+	}
+
+	if ( MinItemsPerRange < 1 )
+	{
+		MinItemsPerRange = 1;
+	}
+
+	Omiscid::SmartLocker SL_Protection(Protection);
+
+	// Compute number of ranges
+	int NbRanges = GetNumberOfThreads();
+	if ( NbItems/MinItemsPerRange < NbRanges )
+	{
+		NbRanges = NbItems/MinItemsPerRange;
+		if ( NbRanges < 1 )
+		{
+			NbRanges = 1;
+		}
+	}
+	int RangeSize = (NbItems + NbRanges - 1)/NbRanges;
+	NbRanges = (NbItems + RangeSize - 1)/RangeSize;	// Avoid empty ranges
+
+	// Give first ranges to workers, last one for the caller
+	int NbUsedWorkers = NbRanges-1;
+	for( int i = 0; i < NbUsedWorkers; i++ )
+	{
+		Worker& CurrentWorker = *Workers[i];
+		CurrentWorker.Begin = i*RangeSize;
+		CurrentWorker.End = (i+1)*RangeSize;
+		CurrentWorker.Task = &Task;
+		CurrentWorker.WorkDone.Reset();
+		CurrentWorker.WorkAvailable.Signal();
+	}
+
+	int Begin = NbUsedWorkers*RangeSize;
+	if ( Begin < NbItems )
+	{
+		Task( Begin, NbItems );
+	}
+
+	// Wait for all workers
+	for( int i = 0; i < NbUsedWorkers; i++ )
+	{
+		Workers[i]->WorkDone.Wait();
+		Workers[i]->WorkDone.Reset();
+	}
+}
@@ -0,0 +1,83 @@
+/**
+ * @file KinectWorkerPool.h
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#ifndef __KINECT_WORKER_POOL_H__
+#define __KINECT_WORKER_POOL_H__
+
+#include <System/Thread.h>
+#include <System/Mutex.h>
+#include <System/LockManagement.h>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+/**
+ * @class KinectWorkerPool KinectWorkerPool.cpp KinectWorkerPool.h
+ * @brief Fixed set of worker threads used to split per-pixel or per-frame processing in ranges.
+ * The calling thread also works, so a pool with 0 worker runs everything sequentially.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class KinectWorkerPool
+{
+public:
+	/** @brief Task applied on a range [Begin;End[ of items.
+	 */
+	typedef std::function<void(int Begin, int End)> RangeTask;
+
+	/** @brief constructor.
+	 *
+	 * @param NumberOfWorkers [in] number of worker threads (-1 for number of cores - 1).
+	 */
+	KinectWorkerPool(int NumberOfWorkers = -1);
+
+	/** @brief Virtual destructor, always. Stop all workers.
+	 */
+	virtual ~KinectWorkerPool();
+
+	/** @brief Number of threads working in ParallelFor (workers + caller).
+	 */
+	int GetNumberOfThreads() const
+	{
+		return (int)Workers.size() + 1;
+	}
+
+	/** @brief Split [0;NbItems[ in ranges and process them in parallel. Returns when all ranges are done.
+	 * Only one ParallelFor runs at a time on a pool.
+	 *
+	 * @param NbItems [in] number of items.
+	 * @param Task [in] task to apply on each range.
+	 * @param MinItemsPerRange [in] do not split in ranges smaller than this.
+	 */
+	void ParallelFor(int NbItems, const RangeTask& Task, int MinItemsPerRange = 1);
+
+protected:
+	/**
+	 * @class Worker KinectWorkerPool.cpp KinectWorkerPool.h
+	 * @brief One worker thread, wait for a range and process it.
+	 */
+	class Worker : public Omiscid::Thread
+	{
+	public:
+		Worker();
+		virtual ~Worker();
+
+		virtual void FUNCTION_CALL_TYPE Run();
+
+		Omiscid::Event WorkAvailable;	/*!< @brief Signaled by ParallelFor when a range is set. */
+		Omiscid::Event WorkDone;		/*!< @brief Signaled by worker when its range is done. */
+		const RangeTask * Task;			/*!< @brief Current task. */
+		int Begin;						/*!< @brief Current range begin. */
+		int End;						/*!< @brief Current range end. */
+	};
+
+	std::vector< std::unique_ptr<Worker> > Workers;	/*!< @brief Worker threads. */
+	Omiscid::Mutex Protection;						/*!< @brief Only one ParallelFor at a time. */
+};
+
+#endif // __KINECT_WORKER_POOL_H__
@@ -0,0 +1,157 @@
+/**
+ * @file LittleEndianRecord.h
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#ifndef __LITTLE_ENDIAN_RECORD_H__
+#define __LITTLE_ENDIAN_RECORD_H__
+
+#ifdef KINECT_2
+
+#include <math.h>
+#include <string.h>
+
+namespace MobileRGBD { namespace Kinect2 {
+
+/**
+ * @class RecordWriter LittleEndianRecord.h
+ * @brief Little-endian writer in a byte buffer, whatever the platform. Used by portable file formats (compact records,
+ * index sidecar files). The caller allocates the buffer.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+struct RecordWriter
+{
+	unsigned char * Buffer;
+
+	void U8(unsigned int Value)
+	{
+		*Buffer++ = (unsigned char)Value;
+	}
+
+	void U16(unsigned int Value)
+	{
+		U8( Value & 0xff );
+		U8( (Value >> 8) & 0xff );
+	}
+
+	void U32(unsigned int Value)
+	{
+		U16( Value & 0xffff );
+		U16( (Value >> 16) & 0xffff );
+	}
+
+	void U64(unsigned long long int Value)
+	{
+		U32( (unsigned int)(Value & 0xffffffffULL) );
+		U32( (unsigned int)(Value >> 32) );
+	}
+
+	void F32(float Value)
+	{
+		unsigned int Bits;
+		memcpy( &Bits, &Value, sizeof(Bits) );
+		U32( Bits );
+	}
+
+	void F64(double Value)
+	{
+		unsigned long long int Bits;
+		memcpy( &Bits, &Value, sizeof(Bits) );
+		U64( Bits );
+	}
+
+	// Quantized value: round(Value*Scale) clamped to 16 bits, NaN gives 0
+	void Q16(float Value, float Scale)
+	{
+		float Scaled = Value*Scale;
+		int Quantized = 0;
+		if ( Scaled == Scaled )
+		{
+			Scaled = Scaled > 32767.0f ? 32767.0f : (Scaled < -32767.0f ? -32767.0f : Scaled);
+			Quantized = (int)floorf( Scaled + 0.5f );
+		}
+		U16( (unsigned int)(Quantized & 0xffff) );
+	}
+
+	// 32 bits float, or 16 bits quantized
+	void Value(float Value, bool IsQuantized, float Scale)
+	{
+		if ( IsQuantized == true )
+		{
+			Q16( Value, Scale );
+		}
+		else
+		{
+			F32( Value );
+		}
+	}
+};
+
+/**
+ * @class RecordReader LittleEndianRecord.h
+ * @brief Little-endian reader from a byte buffer, whatever the platform. The caller checks the buffer size.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+struct RecordReader
+{
+	const unsigned char * Buffer;
+
+	unsigned int U8()
+	{
+		return *Buffer++;
+	}
+
+	unsigned int U16()
+	{
+		unsigned int Low = U8();
+		return Low | (U8() << 8);
+	}
+
+	unsigned int U32()
+	{
+		unsigned int Low = U16();
+		return Low | (U16() << 16);
+	}
+
+	unsigned long long int U64()
+	{
+		unsigned long long int Low = U32();
+		return Low | ((unsigned long long int)U32() << 32);
+	}
+
+	float F32()
+	{
+		unsigned int Bits = U32();
+		float Res;
+		memcpy( &Res, &Bits, sizeof(Res) );
+		return Res;
+	}
+
+	double F64()
+	{
+		unsigned long long int Bits = U64();
+		double Res;
+		memcpy( &Res, &Bits, sizeof(Res) );
+		return Res;
+	}
+
+	float Q16(float Scale)
+	{
+		return (float)(short)U16()/Scale;
+	}
+
+	float Value(bool IsQuantized, float Scale)
+	{
+		return IsQuantized == true ? Q16( Scale ) : F32();
+	}
+};
+
+}} // namespace MobileRGBD::Kinect2
+
+#endif // KINECT_2
+
+#endif // __LITTLE_ENDIAN_RECORD_H__
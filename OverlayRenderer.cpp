@@ -0,0 +1,441 @@
+/**
+ * @file OverlayRenderer.cpp
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#include "OverlayRenderer.h"
+
+#ifdef KINECT_2
+
+#include "TimestampFileReader.h"
+
+#include <math.h>
+#include <string.h>
+
+using namespace MobileRGBD::Kinect2;
+
+namespace {
+
+// Bones, in KinectBody::Draw order
+const int Bones[OverlayRenderer::NumberOfBones][2] = {
+	// Torso
+	{ JointType_Head, JointType_Neck },
+	{ JointType_Neck, JointType_SpineShoulder },
+	{ JointType_SpineShoulder, JointType_SpineMid },
+	{ JointType_SpineMid, JointType_SpineBase },
+	{ JointType_SpineShoulder, JointType_ShoulderRight },
+	{ JointType_SpineShoulder, JointType_ShoulderLeft },
+	{ JointType_SpineBase, JointType_HipRight },
+	{ JointType_SpineBase, JointType_HipLeft },
+	// Right arm
+	{ JointType_ShoulderRight, JointType_ElbowRight },
+	{ JointType_ElbowRight, JointType_WristRight },
+	{ JointType_WristRight, JointType_HandRight },
+	{ JointType_HandRight, JointType_HandTipRight },
+	{ JointType_WristRight, JointType_ThumbRight },
+	// Left arm
+	{ JointType_ShoulderLeft, JointType_ElbowLeft },
+	{ JointType_ElbowLeft, JointType_WristLeft },
+	{ JointType_WristLeft, JointType_HandLeft },
+	{ JointType_HandLeft, JointType_HandTipLeft },
+	{ JointType_WristLeft, JointType_ThumbLeft },
+	// Right leg
+	{ JointType_HipRight, JointType_KneeRight },
+	{ JointType_KneeRight, JointType_AnkleRight },
+	{ JointType_AnkleRight, JointType_FootRight },
+	// Left leg
+	{ JointType_HipLeft, JointType_KneeLeft },
+	{ JointType_KneeLeft, JointType_AnkleLeft },
+	{ JointType_AnkleLeft, JointType_FootLeft }
+};
+
+// BGR colors, as in KinectBody::Draw and KinectFace::Draw
+const unsigned char TrackedColor[3] = { 0, 255, 0 };
+const unsigned char InferredColor[3] = { 0, 0, 255 };
+const unsigned char FaceBoxColor[3] = { 0, 0, 0 };
+const unsigned char FacePointColor[3] = { 0, 0, 255 };
+
+const TIMESPAN MaxFaceAge = 1000000;	// Do not draw faces older than 100 ms in RenderSession
+
+} // namespace
+
+OverlayRenderer::OverlayRenderer(int _Width /* = DepthWidth */, int _Height /* = DepthHeight */, int _Channels /* = 3 */, int _Space /* = DepthSpace */)
+{
+	SetTarget( _Width, _Height, _Channels, _Space );
+}
+
+void OverlayRenderer::SetTarget(int _Width, int _Height, int _Channels, int _Space)
+{
+	Width = _Width;
+	Height = _Height;
+	Channels = _Channels == 1 ? 1 : 3;
+	Space = _Space;
+
+	SourceWidth = Space == DepthSpace ? DepthWidth : CamWidth;
+	SourceHeight = Space == DepthSpace ? DepthHeight : CamHeight;
+	ScaleX = (float)Width/(float)SourceWidth;
+	ScaleY = (float)Height/(float)SourceHeight;
+}
+
+/* static */ void OverlayRenderer::GetBone(int Index, int& Joint0, int& Joint1)
+{
+	Joint0 = Bones[Index][0];
+	Joint1 = Bones[Index][1];
+}
+
+void OverlayRenderer::FillSpan(unsigned char * Image, int y, int x0, int x1, const unsigned char Color[3]) const
+{
+	if ( y < 0 || y >= Height )
+	{
+		return;
+	}
+	x0 = x0 < 0 ? 0 : x0;
+	x1 = x1 >= Width ? Width-1 : x1;
+	if ( x0 > x1 )
+	{
+		return;
+	}
+
+	unsigned char * Pixel = &Image[(y*Width + x0)*Channels];
+	if ( Channels == 1 )
+	{
+		// Luminance of the BGR color
+		memset( Pixel, (Color[0]*29 + Color[1]*150 + Color[2]*77) >> 8, x1 - x0 + 1 );
+		return;
+	}
+	for( int x = x0; x <= x1; x++, Pixel += 3 )
+	{
+		Pixel[0] = Color[0];
+		Pixel[1] = Color[1];
+		Pixel[2] = Color[2];
+	}
+}
+
+void OverlayRenderer::DrawLine(unsigned char * Image, int x0, int y0, int x1, int y1, const unsigned char Color[3], int Thickness /* = 1 */) const
+{
+	const int Before = (Thickness-1)/2;
+	const int After = Thickness/2;
+
+	// Whole line outside image?
+	if ( (x0 < -Before && x1 < -Before) || (x0 >= Width + After && x1 >= Width + After) ||
+		 (y0 < -Before && y1 < -Before) || (y0 >= Height + After && y1 >= Height + After) )
+	{
+		return;
+	}
+
+	// Bresenham, a Thickness x Thickness square at each point
+	const int dx = x1 > x0 ? x1 - x0 : x0 - x1;
+	const int dy = y1 > y0 ? y0 - y1 : y1 - y0;
+	const int sx = x0 < x1 ? 1 : -1;
+	const int sy = y0 < y1 ? 1 : -1;
+	int Error = dx + dy;
+	for(;;)
+	{
+		for( int y = y0 - Before; y <= y0 + After; y++ )
+		{
+			FillSpan( Image, y, x0 - Before, x0 + After, Color );
+		}
+		if ( x0 == x1 && y0 == y1 )
+		{
+			break;
+		}
+		const int e2 = 2*Error;
+		if ( e2 >= dy )
+		{
+			Error += dy;
+			x0 += sx;
+		}
+		if ( e2 <= dx )
+		{
+			Error += dx;
+			y0 += sy;
+		}
+	}
+}
+
+void OverlayRenderer::DrawCircle(unsigned char * Image, int cx, int cy, int Radius, const unsigned char Color[3]) const
+{
+	for( int dy = -Radius; dy <= Radius; dy++ )
+	{
+		const int dx = (int)sqrtf( (float)(Radius*Radius - dy*dy) );
+		FillSpan( Image, cy + dy, cx - dx, cx + dx, Color );
+	}
+}
+
+void OverlayRenderer::DrawRectangle(unsigned char * Image, int Left, int Top, int Right, int Bottom, const unsigned char Color[3]) const
+{
+	FillSpan( Image, Top, Left, Right, Color );
+	FillSpan( Image, Bottom, Left, Right, Color );
+	DrawLine( Image, Left, Top, Left, Bottom, Color );
+	DrawLine( Image, Right, Top, Right, Bottom, Color );
+}
+
+void OverlayRenderer::DrawDepth(const unsigned short * Depth, unsigned char * Image, unsigned short MaxDepth /* = 8000 */) const
+{
+	// Source column of each image column, computed once
+	std::vector<int> Columns( Width );
+	for( int x = 0; x < Width; x++ )
+	{
+		Columns[x] = (x*DepthWidth)/Width;
+	}
+
+	for( int y = 0; y < Height; y++ )
+	{
+		const unsigned short * Row = &Depth[((y*DepthHeight)/Height)*DepthWidth];
+		unsigned char * Pixel = &Image[y*Width*Channels];
+		for( int x = 0; x < Width; x++, Pixel += Channels )
+		{
+			const unsigned int d = Row[Columns[x]];
+			const unsigned char Value = (d == 0 || d > MaxDepth) ? 0 : (unsigned char)(255 - (d*255)/MaxDepth);
+			for( int c = 0; c < Channels; c++ )
+			{
+				Pixel[c] = Value;
+			}
+		}
+	}
+}
+
+void OverlayRenderer::DrawBody(const KinectBody& Body, unsigned char * Image) const
+{
+	// Project joints once, reject the ones outside the Kinect image (as KinectBody::DrawBone)
+	const PixelPosition * Pixels = Space == DepthSpace ? Body.JointsInDepthSpace : Body.JointsInColorSpace;
+	int Points[JointType_Count][2];
+	bool IsVisible[JointType_Count];
+	for( int j = 0; j < JointType_Count; j++ )
+	{
+		const float x = Pixels[j].x;
+		const float y = Pixels[j].y;
+		IsVisible[j] = Body.Joints[j].TrackingState != TrackingState_NotTracked &&
+			x >= 0.0f && x <= (float)SourceWidth && y >= 0.0f && y <= (float)SourceHeight;
+		Points[j][0] = IsVisible[j] == true ? (int)(x*ScaleX) : 0;
+		Points[j][1] = IsVisible[j] == true ? (int)(y*ScaleY) : 0;
+	}
+
+	for( int i = 0; i < NumberOfBones; i++ )
+	{
+		const int j0 = Bones[i][0];
+		const int j1 = Bones[i][1];
+		if ( IsVisible[j0] == false || IsVisible[j1] == false )
+		{
+			continue;
+		}
+
+		const int State0 = Body.Joints[j0].TrackingState;
+		const int State1 = Body.Joints[j1].TrackingState;
+		if ( State0 == TrackingState_Tracked && State1 == TrackingState_Tracked )
+		{
+			DrawLine( Image, Points[j0][0], Points[j0][1], Points[j1][0], Points[j1][1], TrackedColor, 2 );
+		}
+		else if ( State0 == TrackingState_Tracked || State1 == TrackingState_Tracked )
+		{
+			// Don't draw if both points are inferred
+			DrawLine( Image, Points[j0][0], Points[j0][1], Points[j1][0], Points[j1][1], InferredColor, 1 );
+		}
+	}
+}
+
+void OverlayRenderer::DrawBodies(const KinectBodies& Bodies, unsigned char * Image) const
+{
+	for( unsigned int b = 0; b < Bodies.ActualNbBody && b < (unsigned int)BODY_COUNT; b++ )
+	{
+		DrawBody( Bodies.BodiesInformation[b], Image );
+	}
+}
+
+void OverlayRenderer::DrawFace(const KinectFace& Face, unsigned char * Image) const
+{
+	const RectI& Box = Space == DepthSpace ? *Face.BoundingBoxInInfraredSpace : *Face.BoundingBoxInColorSpace;
+	const PointF * Points = Space == DepthSpace ? Face.FacePointsInInfraredSpace : Face.FacePointsInColorSpace;
+
+	DrawRectangle( Image, (int)(ScaleX*(float)Box.Left), (int)(ScaleY*(float)Box.Top), (int)(ScaleX*(float)Box.Right), (int)(ScaleY*(float)Box.Bottom), FaceBoxColor );
+	for( int i = 0; i < FacePointType_Count; i++ )
+	{
+		// Points outside Kinect image are invalid
+		if ( !(Points[i].X >= 0.0f && Points[i].X <= (float)SourceWidth && Points[i].Y >= 0.0f && Points[i].Y <= (float)SourceHeight) )
+		{
+			continue;
+		}
+		DrawCircle( Image, (int)(ScaleX*Points[i].X), (int)(ScaleY*Points[i].Y), 2, FacePointColor );
+	}
+}
+
+void OverlayRenderer::DrawFaces(const KinectFaces& Faces, unsigned char * Image) const
+{
+	for( unsigned int f = 0; f < Faces.ActualNbFaces && f < (unsigned int)BODY_COUNT; f++ )
+	{
+		DrawFace( Faces.FacesInformation[f], Image );
+	}
+}
+
+OverlayVideoWriter::OverlayVideoWriter()
+{
+	Output = (FILE*)nullptr;
+	NbWrittenFrames = 0;
+}
+
+/* virtual */ OverlayVideoWriter::~OverlayVideoWriter()
+{
+	Stop();
+}
+
+bool OverlayVideoWriter::Start(const char * FileName, int Width /* = DepthWidth */, int Height /* = DepthHeight */, int Channels /* = 3 */, int Space /* = OverlayRenderer::DepthSpace */)
+{
+	Stop();
+
+	Output = fopen( FileName, "wb" );
+	if ( Output == (FILE*)nullptr )
+	{
+		fprintf( stderr, "Could not create '%s' overlay video\n", FileName );
+		return false;
+	}
+
+	Renderer.SetTarget( Width, Height, Channels, Space );
+	Image.resize( Renderer.GetImageSize() );
+	NbWrittenFrames = 0;
+
+	return StartQueue();
+}
+
+void OverlayVideoWriter::Stop()
+{
+	if ( IsStarted == false )
+	{
+		return;
+	}
+
+	// Write last frames
+	StopQueue();
+
+	fclose( Output );
+	Output = (FILE*)nullptr;
+}
+
+bool OverlayVideoWriter::Push(const KinectBodies * Bodies, const KinectFaces * Faces, const unsigned short * Depth, bool WaitIfFull /* = false */)
+{
+	return Enqueue( WaitIfFull, [&](OverlayVideoFrame& Frame)
+	{
+		Frame.HasBodies = Bodies != nullptr;
+		if ( Frame.HasBodies == true )
+		{
+			Frame.Bodies.Take( *Bodies );
+		}
+		Frame.HasFaces = Faces != nullptr;
+		if ( Frame.HasFaces == true )
+		{
+			Frame.Faces.Take( *Faces );
+		}
+		Frame.HasDepth = Depth != nullptr;
+		if ( Frame.HasDepth == true )
+		{
+			Frame.Depth.assign( Depth, Depth + DepthWidth*DepthHeight );
+		}
+	} );
+}
+
+/* virtual */ void OverlayVideoWriter::ProcessSnapshot(OverlayVideoFrame& Frame)
+{
+	if ( Frame.HasDepth == true )
+	{
+		Renderer.DrawDepth( Frame.Depth.data(), Image.data() );
+	}
+	else
+	{
+		memset( Image.data(), 0, Image.size() );
+	}
+	if ( Frame.HasBodies == true )
+	{
+		Renderer.DrawBodies( Frame.Bodies.Get(), Image.data() );
+	}
+	if ( Frame.HasFaces == true )
+	{
+		Renderer.DrawFaces( Frame.Faces.Get(), Image.data() );
+	}
+
+	if ( fwrite( Image.data(), 1, Image.size(), Output ) == Image.size() )
+	{
+		NbWrittenFrames++;
+	}
+}
+
+/* static */ int OverlayVideoWriter::RenderSession(const char * SessionFolder, const char * FileName, int Width /* = DepthWidth */, int Height /* = DepthHeight */, int Channels /* = 3 */)
+{
+	// KinectBodies and KinectFaces compute KinectBody::BodySize and KinectFace::FaceSize
+	KinectBodies Bodies;
+	KinectFaces Faces;
+
+	RecordStreamReader BodyStream;
+	if ( BodyStream.Open( SessionFolder, "skeleton", KinectBody::BodySize ) == false )
+	{
+		fprintf( stderr, "Could not read skeleton stream of '%s'\n", SessionFolder );
+		return -1;
+	}
+
+	// Face and depth streams are optional
+	RecordStreamReader FaceStream;
+	FaceStream.Open( SessionFolder, "face", KinectFace::FaceSize );
+	std::vector<TimestampRecord> DepthRecords;
+	FILE * fDepth = nullptr;
+	if ( TimestampFileReader::Load( SessionFolder, "depth", DepthRecords ) == true )
+	{
+		fDepth = fopen( TimestampFileReader::GetStreamFileName( SessionFolder, "depth", "raw" ).c_str(), "rb" );
+	}
+
+	OverlayVideoWriter Writer;
+	if ( Writer.Start( FileName, Width, Height, Channels, OverlayRenderer::DepthSpace ) == false )
+	{
+		if ( fDepth != nullptr ) fclose(fDepth);
+		return -1;
+	}
+
+	std::vector<unsigned short> Depth( DepthWidth*DepthHeight );
+	size_t NumDepth = 0;
+	bool HasFaces = false;
+	bool HasDepth = false;
+	TIMESPAN FacesTime = 0;
+	int NbFaces = 0;
+
+	int NbBodies;
+	while( BodyStream.ReadFrame( Bodies.BodyData, NbBodies ) == true )
+	{
+		Bodies.ActualNbBody = (unsigned int)NbBodies;
+		const TIMESPAN BodyTime = BodyStream.GetRecord().RelativeTime;
+
+		// Last face frame not after this body frame
+		if ( FaceStream.ReadFramesNotAfter( BodyTime, Faces.FaceData, NbFaces ) != 0 )
+		{
+			FacesTime = FaceStream.GetRecord().RelativeTime;
+			HasFaces = true;
+		}
+		Faces.ActualNbFaces = (unsigned int)NbFaces;	// 0 if the face file is truncated
+
+		// Last depth frame not after this body frame
+		while( fDepth != nullptr && NumDepth < DepthRecords.size() && DepthRecords[NumDepth].RelativeTime <= BodyTime )
+		{
+			if ( fread( Depth.data(), sizeof(unsigned short), Depth.size(), fDepth ) != Depth.size() )
+			{
+				fclose(fDepth);
+				fDepth = nullptr;
+				HasDepth = false;
+				break;
+			}
+			HasDepth = true;
+			NumDepth++;
+		}
+
+		Writer.Push( &Bodies, (HasFaces == true && BodyTime - FacesTime <= MaxFaceAge) ? &Faces : (const KinectFaces*)nullptr,
+			HasDepth == true ? Depth.data() : (const unsigned short*)nullptr, true );
+	}
+
+	Writer.Stop();
+
+	if ( fDepth != nullptr )
+	{
+		fclose(fDepth);
+	}
+
+	return Writer.GetNbWrittenFrames();
+}
+
+#endif // KINECT_2
@@ -0,0 +1,217 @@
+/**
+ * @file OverlayRenderer.h
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#ifndef __OVERLAY_RENDERER_H__
+#define __OVERLAY_RENDERER_H__
+
+#ifdef KINECT_2
+
+#include "KinectBasics.h"
+#include "KinectBody.h"
+#include "KinectFace.h"
+#include "KinectFrameSnapshot.h"
+#include "SnapshotWorkQueue.h"
+
+#include <stdio.h>
+#include <vector>
+
+namespace MobileRGBD { namespace Kinect2 {
+
+/**
+ * @class OverlayRenderer OverlayRenderer.cpp OverlayRenderer.h
+ * @brief Headless rendering of skeletons and faces in BGR (3 channels) or gray (1 channel) buffers, without OpenCV.
+ * Drawing follows KinectBody::Draw and KinectFace::Draw: bones are green if both joints are tracked, red if one is
+ * inferred, face boxes are black and face points red. Scale from depth or color space to the image is computed once
+ * by SetTarget, joints of a body are projected once and bones come from a static table.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class OverlayRenderer
+{
+public:
+	enum { DepthSpace, ColorSpace };	/*!< @brief Space of Kinect pixel positions to draw. */
+	enum { NumberOfBones = 24 };
+
+	/** @brief constructor.
+	 *
+	 * @param Width [in] image width.
+	 * @param Height [in] image height.
+	 * @param Channels [in] 3 for BGR, 1 for gray.
+	 * @param Space [in] DepthSpace or ColorSpace.
+	 */
+	OverlayRenderer(int Width = DepthWidth, int Height = DepthHeight, int Channels = 3, int Space = DepthSpace);
+
+	/** @brief Virtual destructor, always.
+	 */
+	virtual ~OverlayRenderer() {}
+
+	/** @brief Change the target image.
+	 */
+	void SetTarget(int Width, int Height, int Channels, int Space);
+
+	int GetWidth() const { return Width; }
+	int GetHeight() const { return Height; }
+	int GetChannels() const { return Channels; }
+
+	/** @brief Size of an image in bytes.
+	 */
+	int GetImageSize() const { return Width*Height*Channels; }
+
+	/** @brief Joints of a bone.
+	 *
+	 * @param Index [in] bone in [0;NumberOfBones[.
+	 * @param Joint0 [out] first joint.
+	 * @param Joint1 [out] second joint.
+	 */
+	static void GetBone(int Index, int& Joint0, int& Joint1);
+
+	/** @brief Draw a depth frame (DepthWidth x DepthHeight, mm) as background, near is bright, 0 and farther than
+	 * MaxDepth are black. Nearest neighbour scaling to the image.
+	 */
+	void DrawDepth(const unsigned short * Depth, unsigned char * Image, unsigned short MaxDepth = 8000) const;
+
+	/** @brief Draw one body.
+	 */
+	void DrawBody(const KinectBody& Body, unsigned char * Image) const;
+
+	/** @brief Draw the ActualNbBody bodies of a frame.
+	 */
+	void DrawBodies(const KinectBodies& Bodies, unsigned char * Image) const;
+
+	/** @brief Draw one face (box and points).
+	 */
+	void DrawFace(const KinectFace& Face, unsigned char * Image) const;
+
+	/** @brief Draw the ActualNbFaces faces of a frame.
+	 */
+	void DrawFaces(const KinectFaces& Faces, unsigned char * Image) const;
+
+	/** @brief Draw a line, clipped to the image.
+	 *
+	 * @param Color [in] BGR color (gray images use its luminance).
+	 * @param Thickness [in] width in pixels.
+	 */
+	void DrawLine(unsigned char * Image, int x0, int y0, int x1, int y1, const unsigned char Color[3], int Thickness = 1) const;
+
+	/** @brief Draw a filled circle, clipped to the image.
+	 */
+	void DrawCircle(unsigned char * Image, int cx, int cy, int Radius, const unsigned char Color[3]) const;
+
+	/** @brief Draw a rectangle outline, clipped to the image.
+	 */
+	void DrawRectangle(unsigned char * Image, int Left, int Top, int Right, int Bottom, const unsigned char Color[3]) const;
+
+protected:
+	/** @brief Fill a clipped horizontal span [x0;x1] of row y.
+	 */
+	void FillSpan(unsigned char * Image, int y, int x0, int x1, const unsigned char Color[3]) const;
+
+	int Width;			/*!< @brief Image width. */
+	int Height;			/*!< @brief Image height. */
+	int Channels;		/*!< @brief 3 (BGR) or 1 (gray). */
+	int Space;			/*!< @brief DepthSpace or ColorSpace. */
+	int SourceWidth;	/*!< @brief Width of the Kinect space. */
+	int SourceHeight;	/*!< @brief Height of the Kinect space. */
+	float ScaleX;		/*!< @brief Kinect space to image scale in x. */
+	float ScaleY;		/*!< @brief Kinect space to image scale in y. */
+};
+
+/**
+ * @class OverlayVideoFrame OverlayRenderer.cpp OverlayRenderer.h
+ * @brief Frame queued in an OverlayVideoWriter. Buffers are reused from a frame to another.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class OverlayVideoFrame
+{
+public:
+	bool HasBodies;						/*!< @brief Are there bodies to draw? */
+	bool HasFaces;						/*!< @brief Are there faces to draw? */
+	bool HasDepth;						/*!< @brief Is there a depth background? */
+	KinectBodiesSnapshot Bodies;		/*!< @brief Copy of the bodies. */
+	KinectFacesSnapshot Faces;			/*!< @brief Copy of the faces. */
+	std::vector<unsigned short> Depth;	/*!< @brief Copy of the depth frame. */
+};
+
+/**
+ * @class OverlayVideoWriter OverlayRenderer.cpp OverlayRenderer.h
+ * @brief Worker thread rendering body/face/depth frames with an OverlayRenderer and appending them to a raw video
+ * file (Width x Height x Channels bytes per frame), readable for instance with
+ * "ffmpeg -f rawvideo -pix_fmt bgr24 -s 512x424 -r 30 -i file.raw review.mp4" (gray for 1 channel).
+ * Frames are copied in a small queue by Push: live, frames are dropped when the queue is full so acquisition is
+ * never slowed down; in batch, Push can wait for room. Frames remaining at Stop are written before closing.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class OverlayVideoWriter : public SnapshotWorkQueue<OverlayVideoFrame, 4>
+{
+public:
+	/** @brief constructor.
+	 */
+	OverlayVideoWriter();
+
+	/** @brief Virtual destructor, always. Stop writing.
+	 */
+	virtual ~OverlayVideoWriter();
+
+	/** @brief Start writing.
+	 *
+	 * @param FileName [in] output raw video file.
+	 * @param Width [in] image width.
+	 * @param Height [in] image height.
+	 * @param Channels [in] 3 for BGR, 1 for gray.
+	 * @param Space [in] OverlayRenderer::DepthSpace or OverlayRenderer::ColorSpace.
+	 * @return true if started.
+	 */
+	bool Start(const char * FileName, int Width = DepthWidth, int Height = DepthHeight, int Channels = 3, int Space = OverlayRenderer::DepthSpace);
+
+	/** @brief Write remaining frames and stop.
+	 */
+	void Stop();
+
+	/** @brief Queue a frame. Data are copied.
+	 *
+	 * @param Bodies [in] bodies to draw, may be nullptr.
+	 * @param Faces [in] faces to draw, may be nullptr.
+	 * @param Depth [in] depth background (DepthWidth x DepthHeight), may be nullptr for a black background.
+	 * @param WaitIfFull [in] wait for room instead of dropping the frame.
+	 * @return false if the frame was dropped or writer is not started.
+	 */
+	bool Push(const KinectBodies * Bodies, const KinectFaces * Faces, const unsigned short * Depth, bool WaitIfFull = false);
+
+	/** @brief Number of frames written.
+	 */
+	int GetNbWrittenFrames() const { return NbWrittenFrames; }
+
+	/** @brief Render all skeleton frames of a session ("SessionFolder/skeleton"), with the last face frame and last
+	 * depth frame not after each of them if these streams exist, in a raw video file.
+	 *
+	 * @param SessionFolder [in] session folder.
+	 * @param FileName [in] output raw video file.
+	 * @param Width [in] image width.
+	 * @param Height [in] image height.
+	 * @param Channels [in] 3 for BGR, 1 for gray.
+	 * @return number of frames written, -1 on error.
+	 */
+	static int RenderSession(const char * SessionFolder, const char * FileName, int Width = DepthWidth, int Height = DepthHeight, int Channels = 3);
+
+protected:
+	/** @brief Render and write a queued frame.
+	 */
+	virtual void ProcessSnapshot(OverlayVideoFrame& Frame);
+
+	OverlayRenderer Renderer;					/*!< @brief Used only by the writing thread. */
+	std::vector<unsigned char> Image;			/*!< @brief Rendered image. */
+	FILE * Output;								/*!< @brief Raw video file. */
+	int NbWrittenFrames;
+};
+
+}} // namespace MobileRGBD::Kinect2
+
+#endif // KINECT_2
+
+#endif // __OVERLAY_RENDERER_H__
@@ -0,0 +1,210 @@
+/**
+ * @file PersonFusion.cpp
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#include "PersonFusion.h"
+
+#ifdef KINECT_2
+
+#include "TimestampFileReader.h"
+
+#include <stdio.h>
+#include <string.h>
+
+using namespace MobileRGBD::Kinect2;
+
+namespace {
+
+/** @brief Absolute time difference.
+ */
+static inline TIMESPAN TimeDifference(TIMESPAN a, TIMESPAN b)
+{
+	return a > b ? a - b : b - a;
+}
+
+} // namespace
+
+PersonRecord::PersonRecord()
+{
+	TrackingId = 0;
+	NumBody = -1;
+	Body = (const KinectBody *)nullptr;
+	BodyTime = 0;
+	HasFace = false;
+	FaceTime = 0;
+
+	// Compute KinectFace::FaceSize, then set Face on our own buffer
+	Face.Set(nullptr);
+	FaceBuffer.resize( KinectFace::FaceSize );
+	Face.Set( FaceBuffer.data() );
+}
+
+PersonFusion::PersonFusion(TIMESPAN _MaxTimeDifference /* = 1000000 */)
+{
+	MaxTimeDifference = _MaxTimeDifference;
+	Reset();
+}
+
+void PersonFusion::Reset()
+{
+	Omiscid::SmartLocker SL_Protection(Protection);
+
+	LastFaces.Clear();
+}
+
+void PersonFusion::AddFaces(const KinectFaces& Faces, TIMESPAN RelativeTime)
+{
+	Omiscid::SmartLocker SL_Protection(Protection);
+
+	const int NbFaces = (int)(Faces.ActualNbFaces > (unsigned int)BODY_COUNT ? BODY_COUNT : Faces.ActualNbFaces);
+	for( int f = 0; f < NbFaces; f++ )
+	{
+		const UINT64 TrackingId = *Faces.FacesInformation[f].TrackingId;
+		if ( TrackingId == 0 )
+		{
+			continue;
+		}
+
+		// Slot of this tracking id, else a free one, else the oldest one
+		bool IsNew;
+		int Slot = LastFaces.Acquire( TrackingId, IsNew );
+		if ( Slot < 0 )
+		{
+			Slot = 0;
+			for( int i = 1; i < BODY_COUNT; i++ )
+			{
+				if ( LastFaces.Get(i).RelativeTime < LastFaces.Get(Slot).RelativeTime )
+				{
+					Slot = i;
+				}
+			}
+			LastFaces.Assign( Slot, TrackingId );
+		}
+
+		FaceSlot& Face = LastFaces.Get(Slot);
+		Face.RelativeTime = RelativeTime;
+		Face.Data.resize( KinectFace::FaceSize );
+		memcpy( Face.Data.data(), Faces.FaceData + f*KinectFace::FaceSize, KinectFace::FaceSize );
+	}
+}
+
+int PersonFusion::AddBodies(const KinectBodies& Bodies, TIMESPAN RelativeTime)
+{
+	return Fuse( Bodies, RelativeTime, (const KinectFaces *)nullptr, 0 );
+}
+
+int PersonFusion::Fuse(const KinectBodies& Bodies, TIMESPAN RelativeTime, const KinectFaces * NextFaces, TIMESPAN NextFacesTime)
+{
+	const int NbPersons = (int)(Bodies.ActualNbBody > (unsigned int)BODY_COUNT ? BODY_COUNT : Bodies.ActualNbBody);
+
+	// Copy faces under lock, ProcessPersons is called without it
+	Omiscid::SmartLocker SL_Protection(Protection);
+	for( int b = 0; b < NbPersons; b++ )
+	{
+		PersonRecord& Person = Persons[b];
+		Person.TrackingId = *Bodies.BodiesInformation[b].trackingId;
+		Person.NumBody = b;
+		Person.Body = &Bodies.BodiesInformation[b];
+		Person.BodyTime = RelativeTime;
+		Person.HasFace = false;
+		Person.FaceTime = 0;
+
+		// Best candidate: last face of this tracking id...
+		const unsigned char * BestFace = nullptr;
+		TIMESPAN BestTime = 0;
+		const int Slot = LastFaces.Find( Person.TrackingId );
+		if ( Slot >= 0 )
+		{
+			BestFace = LastFaces.Get(Slot).Data.data();
+			BestTime = LastFaces.Get(Slot).RelativeTime;
+		}
+
+		// ... or the one of the next face frame if nearer
+		if ( NextFaces != nullptr )
+		{
+			for( unsigned int f = 0; f < NextFaces->ActualNbFaces && f < (unsigned int)BODY_COUNT; f++ )
+			{
+				if ( *NextFaces->FacesInformation[f].TrackingId != Person.TrackingId )
+				{
+					continue;
+				}
+				if ( BestFace == nullptr || TimeDifference(NextFacesTime, RelativeTime) < TimeDifference(BestTime, RelativeTime) )
+				{
+					BestFace = NextFaces->FaceData + f*KinectFace::FaceSize;
+					BestTime = NextFacesTime;
+				}
+				break;
+			}
+		}
+
+		if ( BestFace != nullptr && TimeDifference(BestTime, RelativeTime) <= MaxTimeDifference )
+		{
+			memcpy( Person.FaceBuffer.data(), BestFace, KinectFace::FaceSize );
+			Person.HasFace = true;
+			Person.FaceTime = BestTime;
+		}
+	}
+	SL_Protection.Unlock();
+
+	ProcessPersons( Persons, NbPersons, RelativeTime );
+
+	return NbPersons;
+}
+
+int PersonFusion::FuseSession(const char * SessionFolder)
+{
+	// KinectBodies and KinectFaces compute KinectBody::BodySize and KinectFace::FaceSize
+	KinectBodies Bodies;
+	KinectFaces NextFaces;
+
+	RecordStreamReader BodyStream;
+	if ( BodyStream.Open( SessionFolder, "skeleton", KinectBody::BodySize ) == false )
+	{
+		fprintf( stderr, "Could not read skeleton stream of '%s'\n", SessionFolder );
+		return -1;
+	}
+
+	// Face stream is optional, persons have no face without it
+	RecordStreamReader FaceStream;
+	FaceStream.Open( SessionFolder, "face", KinectFace::FaceSize );
+
+	Reset();
+
+	// Read the next face frame
+	int NbFaces;
+	bool HasNextFaces = FaceStream.ReadFrame( NextFaces.FaceData, NbFaces );
+	NextFaces.ActualNbFaces = HasNextFaces == true ? (unsigned int)NbFaces : 0;
+
+	int NbFrames = 0;
+	int NbBodies;
+	while( BodyStream.ReadFrame( Bodies.BodyData, NbBodies ) == true )
+	{
+		Bodies.ActualNbBody = (unsigned int)NbBodies;
+		const TIMESPAN BodyTime = BodyStream.GetRecord().RelativeTime;
+
+		// Face frames up to this body frame are past faces
+		while( HasNextFaces == true && FaceStream.GetRecord().RelativeTime <= BodyTime )
+		{
+			AddFaces( NextFaces, FaceStream.GetRecord().RelativeTime );
+			HasNextFaces = FaceStream.ReadFrame( NextFaces.FaceData, NbFaces );
+			NextFaces.ActualNbFaces = HasNextFaces == true ? (unsigned int)NbFaces : 0;
+		}
+
+		if ( HasNextFaces == true )
+		{
+			Fuse( Bodies, BodyTime, &NextFaces, FaceStream.GetRecord().RelativeTime );
+		}
+		else
+		{
+			Fuse( Bodies, BodyTime, (const KinectFaces *)nullptr, 0 );
+		}
+		NbFrames++;
+	}
+
+	return NbFrames;
+}
+
+#endif // KINECT_2
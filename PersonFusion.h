@@ -0,0 +1,141 @@
+/**
+ * @file PersonFusion.h
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#ifndef __PERSON_FUSION_H__
+#define __PERSON_FUSION_H__
+
+#ifdef KINECT_2
+
+#include "KinectBasics.h"
+#include "KinectBody.h"
+#include "KinectFace.h"
+#include "TrackingIdSlotTable.h"
+
+#include <System/Mutex.h>
+#include <System/LockManagement.h>
+
+#include <vector>
+
+namespace MobileRGBD { namespace Kinect2 {
+
+/**
+ * @class PersonRecord PersonFusion.cpp PersonFusion.h
+ * @brief One person in a body frame: its body and, when available, the face with the same tracking id nearest in time.
+ * Records are owned by PersonFusion and cannot be copied (Face points in the record buffer).
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class PersonRecord
+{
+public:
+	/** @brief constructor. No body, no face.
+	 */
+	PersonRecord();
+
+	/** @brief Virtual destructor, always.
+	 */
+	virtual ~PersonRecord() {}
+
+	UINT64 TrackingId;					/*!< @brief Tracking id of the person. */
+	int NumBody;						/*!< @brief Index of the body in KinectBodies::BodiesInformation. */
+	const KinectBody * Body;			/*!< @brief Body of the person, valid during ProcessPersons. */
+	TIMESPAN BodyTime;					/*!< @brief Device time of the body frame (100 ns ticks). */
+	bool HasFace;						/*!< @brief Is there a face for this person? */
+	TIMESPAN FaceTime;					/*!< @brief Device time of the face frame. */
+	KinectFace Face;					/*!< @brief Copy of the face, if HasFace. */
+
+protected:
+	friend class PersonFusion;
+
+	PersonRecord(const PersonRecord&) = delete;
+	PersonRecord& operator=(const PersonRecord&) = delete;
+
+	std::vector<unsigned char> FaceBuffer;	/*!< @brief Buffer of Face. */
+};
+
+/**
+ * @class PersonFusion PersonFusion.cpp PersonFusion.h
+ * @brief Join body and face streams into person records. Faces come asynchronously from KinectFaceStream and only
+ * carry a tracking id: the last face of each tracking id is kept (at most BODY_COUNT, lookup in constant time) and
+ * each body frame is completed with the face of the same tracking id nearest in RelativeTime, if closer than
+ * MaxTimeDifference. Live, AddFaces is called by the face thread and AddBodies by the sensor thread. Offline,
+ * FuseSession reads the skeleton and face streams of a session, looking one face frame ahead for the nearest face.
+ * Person records of each body frame are given to ProcessPersons.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class PersonFusion
+{
+public:
+	/** @brief constructor.
+	 *
+	 * @param MaxTimeDifference [in] largest time between a body and its face (100 ns ticks, default 100 ms).
+	 */
+	PersonFusion(TIMESPAN MaxTimeDifference = 1000000);
+
+	/** @brief Virtual destructor, always.
+	 */
+	virtual ~PersonFusion() {}
+
+	/** @brief Forget all faces.
+	 */
+	void Reset();
+
+	/** @brief Add a face frame.
+	 *
+	 * @param Faces [in] faces of the frame (ActualNbFaces faces).
+	 * @param RelativeTime [in] device time of the frame.
+	 */
+	void AddFaces(const KinectFaces& Faces, TIMESPAN RelativeTime);
+
+	/** @brief Fuse a body frame with known faces and call ProcessPersons.
+	 *
+	 * @param Bodies [in] bodies of the frame (ActualNbBody bodies).
+	 * @param RelativeTime [in] device time of the frame.
+	 * @return number of persons.
+	 */
+	int AddBodies(const KinectBodies& Bodies, TIMESPAN RelativeTime);
+
+	/** @brief Fuse skeleton and face streams of a recorded session, ProcessPersons is called for each body frame.
+	 *
+	 * @param SessionFolder [in] session folder.
+	 * @return number of body frames, -1 if the skeleton stream cannot be read.
+	 */
+	int FuseSession(const char * SessionFolder);
+
+	/** @brief Callback with persons of a body frame. Records are only valid during the call.
+	 *
+	 * @param Persons [in] one record per body of the frame.
+	 * @param NbPersons [in] number of records.
+	 * @param RelativeTime [in] device time of the body frame.
+	 */
+	virtual void ProcessPersons(const PersonRecord * Persons, int NbPersons, TIMESPAN RelativeTime) {}
+
+protected:
+	/** @brief Last face of a tracking id.
+	 */
+	struct FaceSlot
+	{
+		TIMESPAN RelativeTime;				/*!< @brief Device time of the face. */
+		std::vector<unsigned char> Data;	/*!< @brief Copy of the face record. */
+	};
+
+	/** @brief Fuse a body frame, optionally with the next face frame (offline).
+	 */
+	int Fuse(const KinectBodies& Bodies, TIMESPAN RelativeTime, const KinectFaces * NextFaces, TIMESPAN NextFacesTime);
+
+	TIMESPAN MaxTimeDifference;				/*!< @brief Largest body/face time difference. */
+	TrackingIdSlotTable<FaceSlot> LastFaces;	/*!< @brief Last face of each tracking id. */
+	PersonRecord Persons[BODY_COUNT];		/*!< @brief Records of the current body frame. */
+	Omiscid::Mutex Protection;				/*!< @brief Protect LastFaces between face and body threads. */
+};
+
+}} // namespace MobileRGBD::Kinect2
+
+#endif // KINECT_2
+
+#endif // __PERSON_FUSION_H__
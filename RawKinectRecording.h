@@ -18,6 +18,7 @@ public:
 	float DiagonalFieldOfView;
 	int FrameLengthInPixels;
 	int BytesPerPixel;
+	int DroppedFrames;
 
 	virtual void DeclareSerializeMapping()
 	{
@@ -33,6 +34,12 @@ public:
 		AddToSerialization("FrameLengthInPixels", FrameLengthInPixels);
 		AddToSerialization("BytesPerPixel", BytesPerPixel);
 
+		// Host/device clock information
+		AddToSerialization("DeviceClockDriftPPM", DeviceClockDriftPPM);
+		AddToSerialization("DeviceClockOffset", DeviceClockOffset);
+		AddToSerialization("WallClockAnchor", WallClockAnchor);
+		AddToSerialization("DroppedFrames", DroppedFrames);
+
 		// next standard description for KinectRecordings, i.e. FrameRate
 		KinectRecording::DeclareSerializeMapping();
 	}
@@ -47,6 +54,7 @@ public:
 		DiagonalFieldOfView = 0.0;
 		FrameLengthInPixels = 0;
 		BytesPerPixel = 0;
+		DroppedFrames = 0;
 		
 		BufferSize = 0;
 		FrameRate = 0.0f;
@@ -65,6 +73,7 @@ public:
 		DiagonalFieldOfView = 0.0;
 		FrameLengthInPixels = 0;
 		BytesPerPixel = 0;
+		DroppedFrames = 0;
 		
 		BufferSize = 0;
 		FrameRate = 0.0f;
@@ -84,6 +93,17 @@ public:
 		{
 			// Compute actual frame rate for this recording
 			FrameRate = (float)InputNumber/(float)(CurrentTime-StartTime);
+
+			// Get device clock mapping estimation
+			UpdateClockDescription();
+
+			// Get drops from statistics
+			if ( Statistics != (StreamStatistics*)nullptr )
+			{
+				StreamStatisticsSnapshot Snapshot;
+				Statistics->GetSnapshot( Snapshot );
+				DroppedFrames = (int)Snapshot.DroppedFrames;
+			}
 			
 			// Create description, save it and close description file in JSON
 			Omiscid::SimpleString Description = Omiscid::StructuredMessage(Serialize());
@@ -17,10 +17,21 @@ bool RecordingManagement::StartRecording( const char* SessionFolder )
 
 	Omiscid::SmartLocker ProtectAccess_SL(ProtectAccess);
 
+	// Check again, another thread may have started recording meanwhile
+	if ( IsRecording == true )
+	{
+		return false;
+	}
+
+	// Resynchronise wall clock with system clock, it will not change during recording
+	KinectClock::ResetWallClockAnchor();
+
+	std::shared_ptr<const KinectRecordingList> Contexts = GetRecContexts();
+
 	bool Success = true;
-	for( RecContexts.First(); RecContexts.NotAtEnd(); RecContexts.Next() )
+	for( size_t i = 0; i < Contexts->size(); i++ )
 	{
-		KinectRecording * pRec = RecContexts.GetCurrent();
+		KinectRecording * pRec = (*Contexts)[i].get();
 		if ( pRec->IsActive )
 		{
 			if ( pRec->StartRecording( SessionFolder ) == false )
@@ -36,17 +47,24 @@ bool RecordingManagement::StartRecording( const char* SessionFolder )
 	// Check is we succeeded in all sub start recording
 	if ( Success == false )
 	{
-		// Unlock mutex
-		ProtectAccess_SL.Unlock();
-
-		// Stop all started recordings
-		StopRecording();
+		// Stop all started recordings (IsRecording is still false, do not call StopRecording)
+		double CurrentTime = GetCurrentTime();
+		for( size_t i = 0; i < Contexts->size(); i++ )
+		{
+			KinectRecording * pRec = (*Contexts)[i].get();
+			if ( pRec->IsActive )
+			{
+				pRec->StopRecording( CurrentTime );
+			}
+		}
 		return false;
 	}
 
 	// everything went fine
 	IsRecording = true;
 
+	SessionStarted( SessionFolder );
+
 	return true;
 }
 
@@ -61,10 +79,12 @@ void RecordingManagement::StopRecording()
 
 	double CurrentTime = GetCurrentTime();
 
+	std::shared_ptr<const KinectRecordingList> Contexts = GetRecContexts();
+
 	// Call all record context to stop
-	for( RecContexts.First(); RecContexts.NotAtEnd(); RecContexts.Next() )
+	for( size_t i = 0; i < Contexts->size(); i++ )
 	{
-		KinectRecording * pRec = RecContexts.GetCurrent();
+		KinectRecording * pRec = (*Contexts)[i].get();
 		if ( pRec->IsActive )
 		{
 			pRec->StopRecording( CurrentTime );
@@ -77,7 +97,19 @@ void RecordingManagement::StopRecording()
 KinectRecording* RecordingManagement::AddRecContext(const Omiscid::SimpleString& Prefix, const Omiscid::SimpleString& _FrameType, int TypeOfContext )
 {
 	 KinectRecording* pKR = RecordingContextFactory::CreateContextRecording( Prefix, _FrameType, RecordingContextFactory::VideoRecContext);
-	 RecContexts.AddTail(pKR);
+	 if ( pKR == (KinectRecording*)nullptr )
+	 {
+		 return pKR;
+	 }
+	 pKR->Statistics = StatisticsRegistry.GetStreamStatistics( Prefix.GetStr() );
+
+	 Omiscid::SmartLocker ProtectAccess_SL(ProtectAccess);
+
+	 // Copy current list, add context and publish the new list
+	 std::shared_ptr<KinectRecordingList> NewContexts = std::make_shared<KinectRecordingList>( *GetRecContexts() );
+	 NewContexts->push_back( std::shared_ptr<KinectRecording>(pKR) );
+	 std::atomic_store( &RecContexts, std::shared_ptr<const KinectRecordingList>(NewContexts) );
+
 	 return pKR;
 }
 
@@ -85,14 +117,8 @@ void RecordingManagement::ClearRecContexts()
 {
 	Omiscid::SmartLocker ProtectAccess_SL(ProtectAccess);
 
-	while( RecContexts.IsNotEmpty() == true )
-	{
-		KinectRecording* pKR = RecContexts.ExtractFirst();
-		if ( pKR != (KinectRecording*)nullptr )
-		{
-			delete pKR;
-		}
-	}
+	// Contexts will be deleted when the last snapshot using them is released
+	std::atomic_store( &RecContexts, std::make_shared<const KinectRecordingList>() );
 }
 
 void RecordingManagement::SaveTimestamp( FILE* f, const struct timeb& lTimestamp, unsigned int numFrame, TIMESPAN FrameTime, char * SuppInfo /* = nullptr */ )
@@ -102,14 +128,16 @@ void RecordingManagement::SaveTimestamp( FILE* f, const struct timeb& lTimestamp
 		return;
 	}
 
-	Omiscid::SmartLocker ProtectAccess_SL(ProtectAccess);
-
 	KinectRecording::SaveTimestamp( f, lTimestamp, numFrame, FrameTime, SuppInfo );
 }
 
-void RecordingManagement::SaveDataAndIncreaseInputNumber( KinectRecording& RecordContext, const struct timeb& lTimestamp, char * SuppInfo /* = nullptr */ )
+void RecordingManagement::SaveDataAndIncreaseInputNumber( KinectRecording& RecordContext, const KinectTimestamp& HostTimestamp, char * SuppInfo /* = nullptr */ )
 {
-	Omiscid::SmartLocker ProtectAccess_SL(ProtectAccess);
+	// Only the context is locked, saves of different streams never contend
+	RecordContext.SaveDataAndIncreaseInputNumber( HostTimestamp, SuppInfo );
+}
 
-	RecordContext.SaveDataAndIncreaseInputNumber( lTimestamp, SuppInfo );
+void RecordingManagement::SaveDataAndIncreaseInputNumber( KinectRecording& RecordContext, const struct timeb& lTimestamp, char * SuppInfo /* = nullptr */ )
+{
+	SaveDataAndIncreaseInputNumber( RecordContext, KinectTimestamp::FromTimeb(lTimestamp), SuppInfo );
 }
@@ -9,8 +9,12 @@
 #define __RECORDING_MANAGEMENT_FACTORY_H__
 
 #include "RecordingContextFactory.h"
+#include "KinectStreamStatistics.h"
 #include <System/Mutex.h>
-#include <System/SimpleList.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
 
 #ifdef KINECT_2
 enum ToCompleteKinectFrameSourceTypes
@@ -38,40 +42,80 @@ enum ImgType {
 	KS_RGBA,		// RGBA, Kinect v1.x version
 	KS_YUV2,		// YUV2, Kinect 2 version
 	KS_UINT16_12,	// UINT12, generally depth data from the Kinect 1.x version
-	KS_UINT16		// UINT16, depth data from the Kinect 2 version
+	KS_UINT16,		// UINT16, depth data from the Kinect 2 version
+	KS_UINT8		// UINT8, body index data from the Kinect 2 version
 };
 
+// List of recording contexts, never modified once published (see RecordingManagement::GetRecContexts)
+typedef std::vector< std::shared_ptr<KinectRecording> > KinectRecordingList;
+
 class RecordingManagement
 {
 public:
-	RecordingManagement()
+	RecordingManagement() : StatisticsDumper(StatisticsRegistry)
 	{
 		IsRecording = false;
+		RecContexts = std::make_shared<const KinectRecordingList>();
 	};
 
 	virtual ~RecordingManagement() {};
+
+	// Statistics of all streams (lock-free snapshots)
+	const StreamStatisticsRegistry& GetStatistics() const
+	{
+		return StatisticsRegistry;
+	}
+
+	// Dump periodically statistics as JSON lines ("-" for stderr)
+	bool StartStatisticsDump(const char * FileName, unsigned int PeriodInMs = 1000)
+	{
+		return StatisticsDumper.Start( FileName, PeriodInMs );
+	}
+
+	void StopStatisticsDump()
+	{
+		StatisticsDumper.Stop();
+	}
 	
 	double GetCurrentTime()
 	{
-		struct timeb lTimestamp;
-		ftime(&lTimestamp);
-		return((double)lTimestamp.time + (lTimestamp.millitm / 1000.0));
+		KinectTimestamp lTimestamp;
+		KinectClock::GetTimestamp(lTimestamp);
+		return lTimestamp.GetWallClockInSeconds();
 	}
 	
 	bool StartRecording(const char* sessionFolder);
 	void StopRecording();
 
+	// Called (under ProtectAccess) when all recording contexts are started, to save session wide data
+	virtual void SessionStarted(const char * SessionFolder) {}
+
 	void SaveTimestamp( FILE* f, const struct timeb& lTimestamp, unsigned int numFrame, TIMESPAN FrameTime, char * SuppInfo /* = nullptr */ );
+	void SaveDataAndIncreaseInputNumber( KinectRecording& RecordContext, const KinectTimestamp& HostTimestamp, char * SuppInfo /* = nullptr */ );
 	void SaveDataAndIncreaseInputNumber( KinectRecording& RecordContext, const struct timeb& lTimestamp, char * SuppInfo /* = nullptr */ );
 
+	// Snapshot of recording contexts, can be used without lock from any thread. Contexts stay
+	// alive as long as a snapshot referencing them exists.
+	std::shared_ptr<const KinectRecordingList> GetRecContexts() const
+	{
+		return std::atomic_load( &RecContexts );
+	}
+
 // protected:
+	// Only protect start/stop and context list modifications, never taken while processing frames
 	Omiscid::ReentrantMutex ProtectAccess;
 
-	bool IsRecording;
+	std::atomic<bool> IsRecording;
 
-	Omiscid::SimpleList<KinectRecording *> RecContexts;
 	KinectRecording* AddRecContext(const Omiscid::SimpleString& Prefix, const Omiscid::SimpleString& _FrameType, int TypeOfContext);
 	void ClearRecContexts();
+
+protected:
+	// RCU like list: modified by copy under ProtectAccess and published atomically
+	std::shared_ptr<const KinectRecordingList> RecContexts;
+
+	StreamStatisticsRegistry StatisticsRegistry;
+	StreamStatisticsDumper StatisticsDumper;
 };
 
 
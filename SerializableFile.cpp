@@ -0,0 +1,58 @@
+/**
+ * @file SerializableFile.cpp
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#include "SerializableFile.h"
+
+#include <stdio.h>
+#include <string>
+
+/* static */ bool SerializableFile::Save(const char * FileName, const Omiscid::Serializable& Object)
+{
+	FILE * f = fopen( FileName, "wb" );
+	if ( f == (FILE*)nullptr )
+	{
+		fprintf( stderr, "Could not create '%s' file\n", FileName );
+		return false;
+	}
+
+	// Serialize declares the mapping on first call, it does not change values
+	Omiscid::SimpleString Description = Omiscid::StructuredMessage(const_cast<Omiscid::Serializable&>(Object).Serialize());
+	fprintf( f, "%s\n", Description.GetStr() );
+	fclose(f);
+
+	return true;
+}
+
+/* static */ bool SerializableFile::Load(const char * FileName, Omiscid::Serializable& Object)
+{
+	FILE * f = fopen( FileName, "rb" );
+	if ( f == (FILE*)nullptr )
+	{
+		return false;
+	}
+
+	std::string Content;
+	char Buffer[256];
+	size_t NbRead;
+	while( (NbRead = fread( Buffer, 1, sizeof(Buffer), f )) > 0 )
+	{
+		Content.append( Buffer, NbRead );
+	}
+	fclose(f);
+
+	try
+	{
+		Object.Unserialize( Omiscid::StructuredMessage( Omiscid::SimpleString(Content.c_str()) ) );
+		return true;
+	}
+	catch(Omiscid::SimpleException&)
+	{
+		// Not a JSON object or missing field
+	}
+
+	return false;
+}
@@ -0,0 +1,40 @@
+/**
+ * @file SerializableFile.h
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#ifndef __SERIALIZABLE_FILE_H__
+#define __SERIALIZABLE_FILE_H__
+
+// Add Serialization facilities
+#include <Messaging/Serializable.h>
+
+/**
+ * @class SerializableFile SerializableFile.cpp SerializableFile.h
+ * @brief Save/Load a serializable object as a JSON file, like ".desc" files of recordings.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class SerializableFile
+{
+public:
+	/** @brief Save an object.
+	 *
+	 * @param FileName [in] name of the file.
+	 * @param Object [in] object to save.
+	 * @return true if the file was written.
+	 */
+	static bool Save(const char * FileName, const Omiscid::Serializable& Object);
+
+	/** @brief Load an object. Values of Object may be partially changed if the file is not valid.
+	 *
+	 * @param FileName [in] name of the file.
+	 * @param Object [out] object to load, all its fields must be in the file.
+	 * @return true if the file was read.
+	 */
+	static bool Load(const char * FileName, Omiscid::Serializable& Object);
+};
+
+#endif // __SERIALIZABLE_FILE_H__
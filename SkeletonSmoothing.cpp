@@ -0,0 +1,254 @@
+/**
+ * @file SkeletonSmoothing.cpp
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#include "SkeletonSmoothing.h"
+
+#ifdef KINECT_2
+
+#include "KinectBody.h"
+
+#include <math.h>
+#include <string.h>
+
+using namespace MobileRGBD::Kinect2;
+
+namespace {
+
+const float NominalFrameDuration = 1.0f/30.0f;	// Kinect v2 body rate, used for the first frame of a body
+const float MaxFrameGap = 0.5f;					// Longer gaps restart filters of the body
+const float TwoPi = 6.283185307f;
+
+} // namespace
+
+SkeletonSmoothing::SkeletonSmoothing(const SkeletonSmoothingConfiguration& _Configuration /* = SkeletonSmoothingConfiguration() */)
+{
+	SetConfiguration( _Configuration );
+}
+
+void SkeletonSmoothing::SetConfiguration(const SkeletonSmoothingConfiguration& _Configuration)
+{
+	Configuration = _Configuration;
+	Reset();
+}
+
+void SkeletonSmoothing::Reset()
+{
+	States.Clear();
+}
+
+void SkeletonSmoothing::Filter(KinectBodies& Bodies, TIMESPAN RelativeTime)
+{
+	const int NbBodies = (int)(Bodies.ActualNbBody > (unsigned int)BODY_COUNT ? BODY_COUNT : Bodies.ActualNbBody);
+
+	// Forget bodies not in this frame first, their states are free for new bodies
+	States.ReleaseMissing( Bodies );
+
+	for( int b = 0; b < NbBodies; b++ )
+	{
+		KinectBody& Body = Bodies.BodiesInformation[b];
+		bool IsNew;
+		const int Slot = States.Acquire( *Body.trackingId, IsNew );
+		if ( Slot < 0 )
+		{
+			// No free state, leave it raw
+			continue;
+		}
+
+		BodyState * State = &States.Get(Slot);
+		if ( IsNew == true )
+		{
+			State->LastTime = 0;
+			memset( State->Initialized, 0, sizeof(State->Initialized) );
+		}
+
+		float dt = (float)((double)(RelativeTime - State->LastTime)*1e-7);
+		if ( State->LastTime == 0 || dt <= 0.0f || dt > MaxFrameGap )
+		{
+			memset( State->Initialized, 0, sizeof(State->Initialized) );
+			dt = NominalFrameDuration;
+		}
+		State->LastTime = RelativeTime;
+
+		// Gather joints as planes, padding lanes have no measure
+		float Raw[3][NumberOfLanes];
+		float Weight[NumberOfLanes];
+		for( int j = 0; j < NumberOfLanes; j++ )
+		{
+			if ( j >= JointType_Count )
+			{
+				Raw[0][j] = Raw[1][j] = Raw[2][j] = Weight[j] = 0.0f;
+				continue;
+			}
+			const Joint& CurrentJoint = Body.Joints[j];
+			Raw[0][j] = CurrentJoint.Position.X;
+			Raw[1][j] = CurrentJoint.Position.Y;
+			Raw[2][j] = CurrentJoint.Position.Z;
+			Weight[j] = CurrentJoint.TrackingState == TrackingState_Tracked ? 1.0f :
+				(CurrentJoint.TrackingState == TrackingState_Inferred ? Configuration.InferredConfidence : 0.0f);
+		}
+
+		for( int Axis = 0; Axis < 3; Axis++ )
+		{
+			FilterPlane( State->Position[Axis], State->Trend[Axis], State->Initialized, Raw[Axis], Weight, dt );
+		}
+
+		for( int j = 0; j < NumberOfLanes; j++ )
+		{
+			State->Initialized[j] = Weight[j] > 0.0f ? 1.0f : 0.0f;
+		}
+
+		for( int j = 0; j < JointType_Count; j++ )
+		{
+			Body.Joints[j].Position.X = Raw[0][j];
+			Body.Joints[j].Position.Y = Raw[1][j];
+			Body.Joints[j].Position.Z = Raw[2][j];
+		}
+	}
+}
+
+void SkeletonSmoothing::FilterPlane(float * Position, float * Trend, const float * Initialized, float * Raw, const float * Weight, float dt) const
+{
+	// Lanes with a state and a measure are filtered, others restart from the measure with no speed
+	const bool IsDoubleExponential = Configuration.Method == SkeletonSmoothingConfiguration::DoubleExponential;
+	const float InvDt = 1.0f/dt;
+	const float DataWeight = 1.0f - Configuration.Smoothing;
+	const float Correction = Configuration.Correction;
+	const float DerivativeX = TwoPi*Configuration.DerivativeCutoff*dt;
+	const float DerivativeAlpha = DerivativeX/(DerivativeX + 1.0f);
+
+	int j = 0;
+#ifdef KINECT_SSE2
+	const __m128 Zero = _mm_setzero_ps();
+	const __m128 One = _mm_set1_ps( 1.0f );
+	const __m128 SignMask = _mm_set1_ps( -0.0f );
+	const __m128 vDt = _mm_set1_ps( dt );
+	const __m128 vInvDt = _mm_set1_ps( InvDt );
+	for( ; j < NumberOfLanes; j += 4 )
+	{
+		__m128 r = _mm_loadu_ps( &Raw[j] );
+		__m128 w = _mm_loadu_ps( &Weight[j] );
+		__m128 p = _mm_loadu_ps( &Position[j] );
+		__m128 t = _mm_loadu_ps( &Trend[j] );
+		__m128 Mask = _mm_and_ps( _mm_cmpgt_ps(_mm_loadu_ps(&Initialized[j]), Zero), _mm_cmpgt_ps(w, Zero) );
+
+		__m128 NewP, NewT;
+		if ( IsDoubleExponential == true )
+		{
+			__m128 Prediction = _mm_add_ps( p, _mm_mul_ps(t, vDt) );
+			__m128 a = _mm_mul_ps( _mm_set1_ps(DataWeight), w );
+			NewP = _mm_add_ps( Prediction, _mm_mul_ps(a, _mm_sub_ps(r, Prediction)) );
+			NewT = _mm_add_ps( _mm_mul_ps(_mm_set1_ps(Correction), _mm_mul_ps(_mm_sub_ps(NewP, p), vInvDt)),
+				_mm_mul_ps(_mm_set1_ps(1.0f - Correction), t) );
+		}
+		else
+		{
+			__m128 dx = _mm_mul_ps( _mm_sub_ps(r, p), vInvDt );
+			NewT = _mm_add_ps( t, _mm_mul_ps(_mm_set1_ps(DerivativeAlpha), _mm_sub_ps(dx, t)) );
+			__m128 Cutoff = _mm_add_ps( _mm_set1_ps(Configuration.MinCutoff), _mm_mul_ps(_mm_set1_ps(Configuration.CutoffSlope), _mm_andnot_ps(SignMask, NewT)) );
+			__m128 x = _mm_mul_ps( _mm_set1_ps(TwoPi), _mm_mul_ps(Cutoff, vDt) );
+			__m128 a = _mm_mul_ps( _mm_div_ps(x, _mm_add_ps(x, One)), w );
+			NewP = _mm_add_ps( p, _mm_mul_ps(a, _mm_sub_ps(r, p)) );
+		}
+
+		NewP = _mm_or_ps( _mm_and_ps(Mask, NewP), _mm_andnot_ps(Mask, r) );
+		NewT = _mm_and_ps( Mask, NewT );
+		_mm_storeu_ps( &Position[j], NewP );
+		_mm_storeu_ps( &Trend[j], NewT );
+		_mm_storeu_ps( &Raw[j], NewP );
+	}
+#endif
+	for( ; j < NumberOfLanes; j++ )
+	{
+		const float r = Raw[j];
+		const float w = Weight[j];
+		const float p = Position[j];
+		const float t = Trend[j];
+		if ( Initialized[j] <= 0.0f || w <= 0.0f )
+		{
+			Position[j] = r;
+			Trend[j] = 0.0f;
+			continue;
+		}
+
+		float NewP, NewT;
+		if ( IsDoubleExponential == true )
+		{
+			const float Prediction = p + t*dt;
+			const float a = DataWeight*w;
+			NewP = Prediction + a*(r - Prediction);
+			NewT = Correction*((NewP - p)*InvDt) + (1.0f - Correction)*t;
+		}
+		else
+		{
+			const float dx = (r - p)*InvDt;
+			NewT = t + DerivativeAlpha*(dx - t);
+			const float Cutoff = Configuration.MinCutoff + Configuration.CutoffSlope*fabsf(NewT);
+			const float x = TwoPi*(Cutoff*dt);
+			const float a = (x/(x + 1.0f))*w;
+			NewP = p + a*(r - p);
+		}
+
+		Position[j] = Raw[j] = NewP;
+		Trend[j] = NewT;
+	}
+}
+
+int SkeletonSmoothing::FilterRawFile(const char * InputFileName, const std::vector<TimestampRecord>& Records, const char * OutputFileName)
+{
+	// KinectBodies computes KinectBody::BodySize
+	KinectBodies Bodies;
+
+	RecordStreamReader Stream;
+	if ( Stream.Open( InputFileName, Records, KinectBody::BodySize ) == false )
+	{
+		fprintf( stderr, "Could not open '%s' skeleton file\n", InputFileName );
+		return -1;
+	}
+
+	FILE * fOut = fopen( OutputFileName, "wb" );
+	if ( fOut == (FILE*)nullptr )
+	{
+		fprintf( stderr, "Could not create '%s' skeleton file\n", OutputFileName );
+		return -1;
+	}
+
+	Reset();
+
+	int NbFrames = 0;
+	int NbBodies;
+	while( Stream.ReadFrame( Bodies.BodyData, NbBodies ) == true )
+	{
+		Bodies.ActualNbBody = (unsigned int)NbBodies;
+		Filter( Bodies, Stream.GetRecord().RelativeTime );
+
+		if ( NbBodies != 0 && fwrite( Bodies.BodyData, KinectBody::BodySize, NbBodies, fOut ) != (size_t)NbBodies )
+		{
+			fprintf( stderr, "Could not write '%s' skeleton file\n", OutputFileName );
+			NbFrames = -1;
+			break;
+		}
+		NbFrames++;
+	}
+
+	fclose(fOut);
+
+	return NbFrames;
+}
+
+int SkeletonSmoothing::FilterSessionSkeleton(const char * SessionFolder, const char * OutputFileName)
+{
+	std::vector<TimestampRecord> Records;
+	if ( TimestampFileReader::Load( SessionFolder, "skeleton", Records ) == false )
+	{
+		fprintf( stderr, "Could not read skeleton timestamps of '%s'\n", SessionFolder );
+		return -1;
+	}
+
+	return FilterRawFile( TimestampFileReader::GetStreamFileName( SessionFolder, "skeleton", "raw" ).c_str(), Records, OutputFileName );
+}
+
+#endif // KINECT_2
@@ -0,0 +1,155 @@
+/**
+ * @file SkeletonSmoothing.h
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#ifndef __SKELETON_SMOOTHING_H__
+#define __SKELETON_SMOOTHING_H__
+
+#ifdef KINECT_2
+
+#include "KinectBasics.h"
+#include "TimestampFileReader.h"
+#include "TrackingIdSlotTable.h"
+
+#include <vector>
+
+namespace MobileRGBD { namespace Kinect2 {
+
+/**
+ * @class SkeletonSmoothingConfiguration SkeletonSmoothing.cpp SkeletonSmoothing.h
+ * @brief Filter and parameters of a SkeletonSmoothing. Positions are in meters, times in seconds.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class SkeletonSmoothingConfiguration
+{
+public:
+	enum { DoubleExponential, OneEuro };
+
+	/** @brief constructor. One-Euro filter with values suited to Kinect v2 bodies at 30 fps.
+	 */
+	SkeletonSmoothingConfiguration()
+	{
+		Method = OneEuro;
+
+		Smoothing = 0.5f;
+		Correction = 0.5f;
+
+		MinCutoff = 1.0f;
+		CutoffSlope = 10.0f;
+		DerivativeCutoff = 1.0f;
+
+		InferredConfidence = 0.5f;
+	}
+
+	int Method;							/*!< @brief DoubleExponential (Holt) or OneEuro. */
+
+	float Smoothing;					/*!< @brief DoubleExponential: weight of the prediction in [0;1[, higher is smoother. */
+	float Correction;					/*!< @brief DoubleExponential: weight of the new trend in ]0;1], lower is smoother. */
+
+	float MinCutoff;					/*!< @brief OneEuro: cutoff frequency (Hz) at rest, lower is smoother. */
+	float CutoffSlope;					/*!< @brief OneEuro: cutoff increase per m/s of joint speed, higher is less lag. */
+	float DerivativeCutoff;				/*!< @brief OneEuro: cutoff frequency (Hz) of the speed estimation. */
+
+	float InferredConfidence;			/*!< @brief Weight of an inferred joint measure relative to a tracked one, in [0;1]. */
+};
+
+/**
+ * @class SkeletonSmoothing SkeletonSmoothing.cpp SkeletonSmoothing.h
+ * @brief Smoothing of joint positions of KinectBodies, in place, with a double exponential (Holt) or a One-Euro
+ * filter. State is kept per tracking id as planes (X, Y and Z of all joints), each plane is filtered with SSE2 when
+ * available (define KINECT_NO_SSE2 to disable). Inferred joints are mixed with InferredConfidence, not tracked joints
+ * are left as is and restart their filter when tracked again. A body whose tracking id disappears is forgotten.
+ * Only Joints positions are changed, JointsInColorSpace/JointsInDepthSpace can be recomputed with
+ * KinectCoordinateMapper. Frames must be given in order, one smoothing is used by one thread.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class SkeletonSmoothing
+{
+public:
+	enum { NumberOfLanes = ((JointType_Count+3)/4)*4 };	/*!< @brief Joints per plane, padded for SSE. */
+
+	/** @brief constructor.
+	 *
+	 * @param Configuration [in] filter and parameters.
+	 */
+	SkeletonSmoothing(const SkeletonSmoothingConfiguration& Configuration = SkeletonSmoothingConfiguration());
+
+	/** @brief Virtual destructor, always.
+	 */
+	virtual ~SkeletonSmoothing() {}
+
+	/** @brief Change configuration and reset state.
+	 */
+	void SetConfiguration(const SkeletonSmoothingConfiguration& Configuration);
+
+	/** @brief Current configuration.
+	 */
+	const SkeletonSmoothingConfiguration& GetConfiguration() const
+	{
+		return Configuration;
+	}
+
+	/** @brief Forget all bodies.
+	 */
+	void Reset();
+
+	/** @brief Smooth joints of a body frame.
+	 *
+	 * @param Bodies [in,out] bodies of the frame (ActualNbBody bodies), joints positions are replaced.
+	 * @param RelativeTime [in] device time of the frame (100 ns ticks).
+	 */
+	void Filter(KinectBodies& Bodies, TIMESPAN RelativeTime);
+
+	/** @brief Smooth a whole skeleton file (as skeleton.raw), frame by frame after a Reset.
+	 *
+	 * @param InputFileName [in] raw skeleton file.
+	 * @param Records [in] records of its timestamp file, SuppInfo is the number of bodies of each frame.
+	 * @param OutputFileName [in] smoothed raw skeleton file to create (same layout).
+	 * @return number of smoothed frames, -1 if files cannot be opened.
+	 */
+	int FilterRawFile(const char * InputFileName, const std::vector<TimestampRecord>& Records, const char * OutputFileName);
+
+	/** @brief Smooth skeletons of a recorded session ("SessionFolder/skeleton/skeleton.raw").
+	 *
+	 * @param SessionFolder [in] session folder.
+	 * @param OutputFileName [in] smoothed raw skeleton file to create.
+	 * @return number of smoothed frames, -1 if files cannot be read.
+	 */
+	int FilterSessionSkeleton(const char * SessionFolder, const char * OutputFileName);
+
+protected:
+	/** @brief Filter state of one body.
+	 */
+	struct BodyState
+	{
+		TIMESPAN LastTime;						/*!< @brief Time of the last frame. */
+		float Position[3][NumberOfLanes];		/*!< @brief Filtered X, Y, Z of joints. */
+		float Trend[3][NumberOfLanes];			/*!< @brief Speed of joints (m/s): trend for Holt, filtered derivative for One-Euro. */
+		float Initialized[NumberOfLanes];		/*!< @brief 1 if a joint has a filter state, 0 otherwise. */
+	};
+
+	/** @brief Filter one plane of one body.
+	 *
+	 * @param Position [in,out] filtered values.
+	 * @param Trend [in,out] speeds.
+	 * @param Initialized [in] filter states, 1 or 0.
+	 * @param Raw [in,out] measures, replaced by filtered values.
+	 * @param Weight [in] confidence of measures (0 for not tracked joints).
+	 * @param dt [in] time since the previous frame (seconds).
+	 */
+	void FilterPlane(float * Position, float * Trend, const float * Initialized, float * Raw, const float * Weight, float dt) const;
+
+	SkeletonSmoothingConfiguration Configuration;	/*!< @brief Filter and parameters. */
+	TrackingIdSlotTable<BodyState> States;			/*!< @brief One state per tracked body. */
+};
+
+}} // namespace MobileRGBD::Kinect2
+
+#endif // KINECT_2
+
+#endif // __SKELETON_SMOOTHING_H__
@@ -0,0 +1,338 @@
+/**
+ * @file SkeletonStore.cpp
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#include "SkeletonStore.h"
+
+#ifdef KINECT_2
+
+#include "KinectBody.h"
+
+#include <math.h>
+#include <string.h>
+#include <unordered_map>
+
+using namespace MobileRGBD::Kinect2;
+
+namespace {
+
+/** @brief Reorder a column, NewColumn[i] = Column[Order[i]].
+ */
+template<typename T> static void Permute(std::vector<T>& Column, const std::vector<int>& Order)
+{
+	std::vector<T> NewColumn( Column.size() );
+	for( size_t i = 0; i < Order.size(); i++ )
+	{
+		NewColumn[i] = Column[Order[i]];
+	}
+	Column.swap( NewColumn );
+}
+
+#ifdef KINECT_SSE2
+
+// All lanes where the 4 tracking states are not TrackingState_NotTracked
+static inline __m128 IsTracked4(const unsigned char * States)
+{
+	int Packed;
+	memcpy( &Packed, States, sizeof(Packed) );
+	__m128i Values = _mm_unpacklo_epi8( _mm_cvtsi32_si128(Packed), _mm_setzero_si128() );
+	Values = _mm_unpacklo_epi16( Values, _mm_setzero_si128() );
+	return _mm_castsi128_ps( _mm_cmpgt_epi32(Values, _mm_setzero_si128()) );
+}
+
+#endif // KINECT_SSE2
+
+} // namespace
+
+SkeletonStore::SkeletonStore()
+{
+	Clear();
+}
+
+void SkeletonStore::Clear()
+{
+	for( int j = 0; j < JointType_Count; j++ )
+	{
+		X[j].clear();
+		Y[j].clear();
+		Z[j].clear();
+		TrackingStates[j].clear();
+	}
+	TrackingIds.clear();
+	FrameNumbers.clear();
+	RelativeTimes.clear();
+	Times.clear();
+	Tracks.clear();
+	NbFrames = 0;
+	HasDeviceTime = false;
+}
+
+int SkeletonStore::LoadSession(const char * SessionFolder)
+{
+	std::vector<TimestampRecord> Records;
+	if ( TimestampFileReader::Load( SessionFolder, "skeleton", Records ) == false )
+	{
+		fprintf( stderr, "Could not read skeleton timestamps of '%s'\n", SessionFolder );
+		Clear();
+		return -1;
+	}
+
+	return LoadRawFile( TimestampFileReader::GetStreamFileName( SessionFolder, "skeleton", "raw" ).c_str(), Records );
+}
+
+int SkeletonStore::LoadRawFile(const char * RawFileName, const std::vector<TimestampRecord>& Records)
+{
+	Clear();
+
+	// Compute KinectBody::BodySize and get a buffer for a full frame
+	KinectBody Body;
+	Body.Set( nullptr );
+	std::vector<unsigned char> Buffer( BODY_COUNT*KinectBody::BodySize );
+
+	RecordStreamReader Stream;
+	if ( Stream.Open( RawFileName, Records, KinectBody::BodySize ) == false )
+	{
+		fprintf( stderr, "Could not open '%s' skeleton file\n", RawFileName );
+		return -1;
+	}
+
+	// Device time if recorded, host time otherwise
+	const bool UseDeviceTime = Records.empty() == false && Records[0].RelativeTime != 0;
+	HasDeviceTime = UseDeviceTime;
+
+	// Stops at the end of the records or of a truncated file, keep what we have
+	int NbBodies;
+	while( Stream.ReadFrame( &Buffer[0], NbBodies ) == true )
+	{
+		const TimestampRecord& Record = Stream.GetRecord();
+		NbFrames++;
+
+		const float Time = UseDeviceTime == true ? (float)((double)(Record.RelativeTime - Records[0].RelativeTime)*1e-7) :
+			(float)(Record.WallClockTime - Records[0].WallClockTime);
+
+		for( int b = 0; b < NbBodies; b++ )
+		{
+			Body.Set( &Buffer[b*KinectBody::BodySize] );
+
+			for( int j = 0; j < JointType_Count; j++ )
+			{
+				X[j].push_back( Body.Joints[j].Position.X );
+				Y[j].push_back( Body.Joints[j].Position.Y );
+				Z[j].push_back( Body.Joints[j].Position.Z );
+				TrackingStates[j].push_back( (unsigned char)Body.Joints[j].TrackingState );
+			}
+			TrackingIds.push_back( *Body.trackingId );
+			FrameNumbers.push_back( Record.NumFrame );
+			RelativeTimes.push_back( Record.RelativeTime );
+			Times.push_back( Time );
+		}
+	}
+
+	GroupRowsByBody();
+
+	return GetNumberOfRows();
+}
+
+void SkeletonStore::GroupRowsByBody()
+{
+	const int NbRows = GetNumberOfRows();
+
+	// Bodies in order of first appearance and their number of rows
+	std::unordered_map<UINT64, int> TrackOfId;
+	std::vector<int> TrackOfRow( NbRows );
+	for( int i = 0; i < NbRows; i++ )
+	{
+		std::unordered_map<UINT64, int>::iterator It = TrackOfId.find( TrackingIds[i] );
+		if ( It == TrackOfId.end() )
+		{
+			SkeletonTrack NewTrack;
+			NewTrack.TrackingId = TrackingIds[i];
+			NewTrack.FirstRow = 0;
+			NewTrack.NbRows = 0;
+			It = TrackOfId.insert( std::make_pair( TrackingIds[i], (int)Tracks.size() ) ).first;
+			Tracks.push_back( NewTrack );
+		}
+		TrackOfRow[i] = It->second;
+		Tracks[It->second].NbRows++;
+	}
+
+	int FirstRow = 0;
+	for( size_t t = 0; t < Tracks.size(); t++ )
+	{
+		Tracks[t].FirstRow = FirstRow;
+		FirstRow += Tracks[t].NbRows;
+	}
+
+	// Counting sort, stable thus rows of a body stay in time order
+	std::vector<int> Order( NbRows );
+	std::vector<int> Next( Tracks.size() );
+	for( size_t t = 0; t < Tracks.size(); t++ )
+	{
+		Next[t] = Tracks[t].FirstRow;
+	}
+	for( int i = 0; i < NbRows; i++ )
+	{
+		Order[Next[TrackOfRow[i]]++] = i;
+	}
+
+	for( int j = 0; j < JointType_Count; j++ )
+	{
+		Permute( X[j], Order );
+		Permute( Y[j], Order );
+		Permute( Z[j], Order );
+		Permute( TrackingStates[j], Order );
+	}
+	Permute( TrackingIds, Order );
+	Permute( FrameNumbers, Order );
+	Permute( RelativeTimes, Order );
+	Permute( Times, Order );
+}
+
+int SkeletonStore::FindTrack(UINT64 TrackingId) const
+{
+	for( size_t t = 0; t < Tracks.size(); t++ )
+	{
+		if ( Tracks[t].TrackingId == TrackingId )
+		{
+			return (int)t;
+		}
+	}
+	return -1;
+}
+
+void SkeletonStore::GetJointDistance(int JointA, int JointB, std::vector<float>& Distances) const
+{
+	const int NbRows = GetNumberOfRows();
+	Distances.resize( NbRows );
+	if ( NbRows == 0 || JointA < 0 || JointA >= JointType_Count || JointB < 0 || JointB >= JointType_Count )
+	{
+		Distances.assign( NbRows, -1.0f );
+		return;
+	}
+
+	const float * Xa = &X[JointA][0], * Ya = &Y[JointA][0], * Za = &Z[JointA][0];
+	const float * Xb = &X[JointB][0], * Yb = &Y[JointB][0], * Zb = &Z[JointB][0];
+	const unsigned char * Sa = &TrackingStates[JointA][0];
+	const unsigned char * Sb = &TrackingStates[JointB][0];
+	float * Out = &Distances[0];
+
+	int i = 0;
+#ifdef KINECT_SSE2
+	const __m128 Invalid = _mm_set1_ps( -1.0f );
+	for( ; i + 4 <= NbRows; i += 4 )
+	{
+		__m128 dx = _mm_sub_ps( _mm_loadu_ps(&Xa[i]), _mm_loadu_ps(&Xb[i]) );
+		__m128 dy = _mm_sub_ps( _mm_loadu_ps(&Ya[i]), _mm_loadu_ps(&Yb[i]) );
+		__m128 dz = _mm_sub_ps( _mm_loadu_ps(&Za[i]), _mm_loadu_ps(&Zb[i]) );
+		__m128 Distance = _mm_sqrt_ps( _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)) );
+		__m128 Mask = _mm_and_ps( IsTracked4(&Sa[i]), IsTracked4(&Sb[i]) );
+		_mm_storeu_ps( &Out[i], _mm_or_ps(_mm_and_ps(Mask, Distance), _mm_andnot_ps(Mask, Invalid)) );
+	}
+#endif
+	for( ; i < NbRows; i++ )
+	{
+		if ( Sa[i] == TrackingState_NotTracked || Sb[i] == TrackingState_NotTracked )
+		{
+			Out[i] = -1.0f;
+			continue;
+		}
+		const float dx = Xa[i] - Xb[i];
+		const float dy = Ya[i] - Yb[i];
+		const float dz = Za[i] - Zb[i];
+		Out[i] = sqrtf( dx*dx + dy*dy + dz*dz );
+	}
+}
+
+int SkeletonStore::GetJointVelocity(int Track, int Joint, std::vector<float>& Vx, std::vector<float>& Vy, std::vector<float>& Vz) const
+{
+	if ( Track < 0 || Track >= (int)Tracks.size() || Joint < 0 || Joint >= JointType_Count )
+	{
+		Vx.clear();
+		Vy.clear();
+		Vz.clear();
+		return -1;
+	}
+
+	const int First = Tracks[Track].FirstRow;
+	const int NbRows = Tracks[Track].NbRows;
+	Vx.assign( NbRows, 0.0f );
+	Vy.assign( NbRows, 0.0f );
+	Vz.assign( NbRows, 0.0f );
+
+	// Time from previous row, from the exact device time difference as Times lose precision in long sessions
+	std::vector<float> Dt( NbRows, 0.0f );
+	for( int r = 1; r < NbRows; r++ )
+	{
+		Dt[r] = HasDeviceTime == true ? (float)(RelativeTimes[First+r] - RelativeTimes[First+r-1])*1.0e-7f : Times[First+r] - Times[First+r-1];
+	}
+
+	// Current row is i, previous one is i-1, both in the range of the body
+	const float * Xj = &X[Joint][First], * Yj = &Y[Joint][First], * Zj = &Z[Joint][First];
+	const unsigned char * S = &TrackingStates[Joint][First];
+
+	int NbValid = 0;
+	int i = 1;
+#ifdef KINECT_SSE2
+	const __m128 Zero = _mm_setzero_ps();
+	const __m128 One = _mm_set1_ps( 1.0f );
+	for( ; i + 4 <= NbRows; i += 4 )
+	{
+		__m128 dt = _mm_loadu_ps( &Dt[i] );
+		__m128 Mask = _mm_and_ps( _mm_and_ps(IsTracked4(&S[i]), IsTracked4(&S[i-1])), _mm_cmpgt_ps(dt, Zero) );
+		__m128 InvDt = _mm_and_ps( Mask, _mm_div_ps(One, _mm_or_ps(dt, _mm_andnot_ps(Mask, One))) );	// 1/dt or 0, never divide by 0
+		_mm_storeu_ps( &Vx[i], _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&Xj[i]), _mm_loadu_ps(&Xj[i-1])), InvDt) );
+		_mm_storeu_ps( &Vy[i], _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&Yj[i]), _mm_loadu_ps(&Yj[i-1])), InvDt) );
+		_mm_storeu_ps( &Vz[i], _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&Zj[i]), _mm_loadu_ps(&Zj[i-1])), InvDt) );
+
+		int Bits = _mm_movemask_ps( Mask );
+		NbValid += (Bits & 1) + ((Bits >> 1) & 1) + ((Bits >> 2) & 1) + ((Bits >> 3) & 1);
+	}
+#endif
+	for( ; i < NbRows; i++ )
+	{
+		const float dt = Dt[i];
+		if ( S[i] == TrackingState_NotTracked || S[i-1] == TrackingState_NotTracked || dt <= 0.0f )
+		{
+			continue;
+		}
+		Vx[i] = (Xj[i] - Xj[i-1])*(1.0f/dt);
+		Vy[i] = (Yj[i] - Yj[i-1])*(1.0f/dt);
+		Vz[i] = (Zj[i] - Zj[i-1])*(1.0f/dt);
+		NbValid++;
+	}
+
+	return NbValid;
+}
+
+int SkeletonStore::GetJointSpeed(int Track, int Joint, std::vector<float>& Speeds) const
+{
+	std::vector<float> Vx, Vy, Vz;
+	int NbValid = GetJointVelocity( Track, Joint, Vx, Vy, Vz );
+	if ( NbValid < 0 )
+	{
+		Speeds.clear();
+		return NbValid;
+	}
+
+	const int NbRows = (int)Vx.size();
+	Speeds.resize( NbRows );
+	int i = 0;
+#ifdef KINECT_SSE2
+	for( ; i + 4 <= NbRows; i += 4 )
+	{
+		__m128 x = _mm_loadu_ps( &Vx[i] ), y = _mm_loadu_ps( &Vy[i] ), z = _mm_loadu_ps( &Vz[i] );
+		_mm_storeu_ps( &Speeds[i], _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z))) );
+	}
+#endif
+	for( ; i < NbRows; i++ )
+	{
+		Speeds[i] = sqrtf( Vx[i]*Vx[i] + Vy[i]*Vy[i] + Vz[i]*Vz[i] );
+	}
+
+	return NbValid;
+}
+
+#endif // KINECT_2
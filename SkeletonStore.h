@@ -0,0 +1,169 @@
+/**
+ * @file SkeletonStore.h
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#ifndef __SKELETON_STORE_H__
+#define __SKELETON_STORE_H__
+
+#ifdef KINECT_2
+
+#include "KinectBasics.h"
+#include "TimestampFileReader.h"
+
+#include <vector>
+
+namespace MobileRGBD { namespace Kinect2 {
+
+/**
+ * @class SkeletonTrack SkeletonStore.cpp SkeletonStore.h
+ * @brief Rows of one body (one tracking id) in a SkeletonStore, contiguous and sorted by time.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class SkeletonTrack
+{
+public:
+	UINT64 TrackingId;		/*!< @brief Tracking id of the body. */
+	int FirstRow;			/*!< @brief First row of the body in the store. */
+	int NbRows;				/*!< @brief Number of rows (frames where the body is tracked). */
+};
+
+/**
+ * @class SkeletonStore SkeletonStore.cpp SkeletonStore.h
+ * @brief Whole session skeletons ("SessionFolder/skeleton/skeleton.raw") as columns (structure of arrays) instead of
+ * packed KinectBody buffers: one row per tracked body and per frame, one float array per joint and per coordinate,
+ * one tracking state array per joint, and time, frame number and tracking id arrays. Rows of a body are contiguous
+ * and sorted by time (see SkeletonTrack), thus per body time series are plain array ranges and queries (distance
+ * between joints, joint velocity) are linear passes over a few arrays, using SSE2 when available (define
+ * KINECT_NO_SSE2 to disable). The store is read only once loaded and can be shared between threads.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class SkeletonStore
+{
+public:
+	/** @brief constructor. Empty store.
+	 */
+	SkeletonStore();
+
+	/** @brief Virtual destructor, always.
+	 */
+	virtual ~SkeletonStore() {}
+
+	/** @brief Empty the store.
+	 */
+	void Clear();
+
+	/** @brief Load skeletons of a recorded session ("SessionFolder/skeleton/skeleton.raw" and its timestamp file).
+	 *
+	 * @param SessionFolder [in] session folder.
+	 * @return number of rows, -1 on error.
+	 */
+	int LoadSession(const char * SessionFolder);
+
+	/** @brief Load a skeleton raw file.
+	 *
+	 * @param RawFileName [in] skeleton raw file.
+	 * @param Records [in] records of its timestamp file, SuppInfo is the number of bodies of each frame.
+	 * @return number of rows, -1 on error.
+	 */
+	int LoadRawFile(const char * RawFileName, const std::vector<TimestampRecord>& Records);
+
+	/** @brief Number of rows (tracked body in one frame).
+	 */
+	int GetNumberOfRows() const
+	{
+		return (int)TrackingIds.size();
+	}
+
+	/** @brief Number of frames read, with or without bodies.
+	 */
+	int GetNumberOfFrames() const
+	{
+		return NbFrames;
+	}
+
+	/** @brief All bodies of the session, in order of first appearance.
+	 */
+	const std::vector<SkeletonTrack>& GetTracks() const
+	{
+		return Tracks;
+	}
+
+	/** @brief Find a body.
+	 *
+	 * @param TrackingId [in] tracking id of the body.
+	 * @return index in GetTracks(), -1 if not found.
+	 */
+	int FindTrack(UINT64 TrackingId) const;
+
+	/** @brief Columns, GetNumberOfRows() values each (nullptr if the store is empty).
+	 */
+	const float * GetX(int Joint) const { return Data(X[Joint]); }
+	const float * GetY(int Joint) const { return Data(Y[Joint]); }
+	const float * GetZ(int Joint) const { return Data(Z[Joint]); }
+	const unsigned char * GetTrackingState(int Joint) const { return Data(TrackingStates[Joint]); }
+	const UINT64 * GetTrackingId() const { return Data(TrackingIds); }
+	const unsigned int * GetFrameNumber() const { return Data(FrameNumbers); }		/*!< @brief NumFrame of the timestamp file. */
+	const TIMESPAN * GetRelativeTime() const { return Data(RelativeTimes); }		/*!< @brief Device time in 100 ns ticks. */
+	const float * GetTime() const { return Data(Times); }							/*!< @brief Seconds since the first frame of the session. */
+
+	/** @brief Distance between 2 joints for all rows.
+	 *
+	 * @param JointA [in] first joint.
+	 * @param JointB [in] second joint.
+	 * @param Distances [out] distance in meters for each row, -1 where one of the joints is not tracked.
+	 */
+	void GetJointDistance(int JointA, int JointB, std::vector<float>& Distances) const;
+
+	/** @brief Velocity of a joint along the time series of a body, by finite difference with the previous row. Time
+	 * difference is computed on device times (host times for old sessions without device time).
+	 *
+	 * @param Track [in] index in GetTracks().
+	 * @param Joint [in] joint.
+	 * @param Vx, Vy, Vz [out] velocity in m/s for each row of the body, 0 for the first row and where the joint is
+	 * not tracked in the row or in the previous one.
+	 * @return number of valid velocities, -1 on bad parameters.
+	 */
+	int GetJointVelocity(int Track, int Joint, std::vector<float>& Vx, std::vector<float>& Vy, std::vector<float>& Vz) const;
+
+	/** @brief Speed (norm of the velocity) of a joint along the time series of a body.
+	 *
+	 * @param Track [in] index in GetTracks().
+	 * @param Joint [in] joint.
+	 * @param Speeds [out] speed in m/s for each row of the body, 0 where not valid (see GetJointVelocity).
+	 * @return number of valid speeds, -1 on bad parameters.
+	 */
+	int GetJointSpeed(int Track, int Joint, std::vector<float>& Speeds) const;
+
+protected:
+	template<typename T> static const T * Data(const std::vector<T>& Column)
+	{
+		return Column.empty() ? (const T*)nullptr : &Column[0];
+	}
+
+	/** @brief Reorder all columns with rows of each body contiguous, fill Tracks.
+	 */
+	void GroupRowsByBody();
+
+	std::vector<float> X[JointType_Count];						/*!< @brief X of joints in camera space (meters). */
+	std::vector<float> Y[JointType_Count];						/*!< @brief Y of joints in camera space (meters). */
+	std::vector<float> Z[JointType_Count];						/*!< @brief Z of joints in camera space (meters). */
+	std::vector<unsigned char> TrackingStates[JointType_Count];	/*!< @brief Tracking state of joints. */
+	std::vector<UINT64> TrackingIds;							/*!< @brief Tracking id of each row. */
+	std::vector<unsigned int> FrameNumbers;						/*!< @brief Frame number of each row. */
+	std::vector<TIMESPAN> RelativeTimes;						/*!< @brief Device time of each row. */
+	std::vector<float> Times;									/*!< @brief Time of each row in seconds from the first frame. */
+	std::vector<SkeletonTrack> Tracks;							/*!< @brief Bodies of the session. */
+	int NbFrames;												/*!< @brief Number of frames read. */
+	bool HasDeviceTime;											/*!< @brief Are RelativeTimes recorded (not in old sessions)? */
+};
+
+}} // namespace MobileRGBD::Kinect2
+
+#endif // KINECT_2
+
+#endif // __SKELETON_STORE_H__
@@ -0,0 +1,195 @@
+/**
+ * @file SnapshotWorkQueue.h
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#ifndef __SNAPSHOT_WORK_QUEUE_H__
+#define __SNAPSHOT_WORK_QUEUE_H__
+
+#ifdef KINECT_2
+
+#include <System/Thread.h>
+#include <System/Event.h>
+#include <System/Mutex.h>
+#include <System/LockManagement.h>
+
+namespace MobileRGBD { namespace Kinect2 {
+
+/**
+ * @class SnapshotWorkQueue SnapshotWorkQueue.h
+ * @brief Worker thread processing copies of frames (snapshots) off the acquisition thread. Enqueue fills the next
+ * snapshot of a small ring: frames are dropped when the ring is full so acquisition is never slowed down, unless
+ * Enqueue is asked to wait for room. Snapshots are reused from a frame to another, so their buffers are allocated
+ * only once. The thread calls ProcessSnapshot for each queued snapshot, out of the lock. Snapshots remaining at
+ * StopQueue are processed before returning. Derived classes must call StopQueue in their destructor.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+template<typename SNAPSHOT_TYPE, int QUEUE_SIZE>
+class SnapshotWorkQueue : public Omiscid::Thread
+{
+public:
+	enum { QueueSize = QUEUE_SIZE };
+
+	/** @brief constructor. Queue is not started.
+	 */
+	SnapshotWorkQueue()
+	{
+		First = 0;
+		NbPending = 0;
+		NbDroppedFrames = 0;
+		IsStarted = false;
+	}
+
+	/** @brief Virtual destructor, always.
+	 */
+	virtual ~SnapshotWorkQueue() {}
+
+	/** @brief Number of frames dropped by Enqueue.
+	 */
+	int GetNbDroppedFrames() const { return NbDroppedFrames; }
+
+	virtual void FUNCTION_CALL_TYPE Run()
+	{
+		while( StopPending() == false )
+		{
+			// Wake up regularly to check StopPending
+			if ( SnapshotAvailable.Wait(100) == false )
+			{
+				continue;
+			}
+			SnapshotAvailable.Reset();
+
+			ProcessPendingSnapshots();
+		}
+	}
+
+protected:
+	/** @brief Process a queued snapshot. Called by the thread, or by StopQueue once the thread is stopped.
+	 */
+	virtual void ProcessSnapshot(SNAPSHOT_TYPE& Snapshot) = 0;
+
+	/** @brief Empty the queue and start the thread.
+	 */
+	bool StartQueue()
+	{
+		StopQueue();
+
+		First = 0;
+		NbPending = 0;
+		NbDroppedFrames = 0;
+		IsStarted = true;
+
+		return StartThread();
+	}
+
+	/** @brief Stop the thread and process remaining snapshots.
+	 */
+	void StopQueue()
+	{
+		if ( IsStarted == false )
+		{
+			return;
+		}
+
+		StopThread();
+
+		// Thread is stopped, process last snapshots from here
+		ProcessPendingSnapshots();
+
+		IsStarted = false;
+	}
+
+	/** @brief Queue a frame.
+	 *
+	 * @param WaitIfFull [in] wait for room instead of dropping the frame.
+	 * @param Fill [in] function called with the snapshot to fill (SNAPSHOT_TYPE&), under the lock of the queue.
+	 * @return false if the frame was dropped or queue is not started.
+	 */
+	template<typename FILL_FUNCTION>
+	bool Enqueue(bool WaitIfFull, FILL_FUNCTION Fill)
+	{
+		if ( IsStarted == false )
+		{
+			return false;
+		}
+
+		Omiscid::SmartLocker SL_Protection(Protection);
+		while( NbPending == QueueSize )
+		{
+			if ( WaitIfFull == false )
+			{
+				NbDroppedFrames++;
+				return false;
+			}
+
+			SL_Protection.Unlock();
+			if ( SnapshotProcessed.Wait(100) == true )
+			{
+				SnapshotProcessed.Reset();
+			}
+			SL_Protection.Lock();
+		}
+
+		// Snapshot after the queued ones is not used by the thread
+		Fill( Queue[(First + NbPending) % QueueSize] );
+		NbPending++;
+		SL_Protection.Unlock();
+
+		SnapshotAvailable.Signal();
+
+		return true;
+	}
+
+	/** @brief Process queued snapshots.
+	 *
+	 * @return number of processed snapshots.
+	 */
+	int ProcessPendingSnapshots()
+	{
+		Omiscid::SmartLocker SL_Protection(Protection, false);
+
+		int NbProcessed = 0;
+		for(;;)
+		{
+			SL_Protection.Lock();
+			const bool IsEmpty = NbPending == 0;
+			SNAPSHOT_TYPE& Snapshot = Queue[First];
+			SL_Protection.Unlock();
+			if ( IsEmpty == true )
+			{
+				break;
+			}
+
+			// Out of the lock, Enqueue does not touch this snapshot
+			ProcessSnapshot( Snapshot );
+			NbProcessed++;
+
+			SL_Protection.Lock();
+			First = (First + 1) % QueueSize;
+			NbPending--;
+			SL_Protection.Unlock();
+
+			SnapshotProcessed.Signal();
+		}
+
+		return NbProcessed;
+	}
+
+	SNAPSHOT_TYPE Queue[QUEUE_SIZE];			/*!< @brief Ring of queued snapshots, buffers are reused. */
+	int First;									/*!< @brief First queued snapshot. */
+	int NbPending;								/*!< @brief Number of queued snapshots. */
+	int NbDroppedFrames;						/*!< @brief Number of frames dropped by Enqueue. */
+	bool IsStarted;								/*!< @brief Is the queue started? */
+	Omiscid::Mutex Protection;					/*!< @brief Protect the queue. */
+	Omiscid::Event SnapshotAvailable;			/*!< @brief Signaled by Enqueue. */
+	Omiscid::Event SnapshotProcessed;			/*!< @brief Signaled after each processed snapshot. */
+};
+
+}} // namespace MobileRGBD::Kinect2
+
+#endif // KINECT_2
+
+#endif // __SNAPSHOT_WORK_QUEUE_H__
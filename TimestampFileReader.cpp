@@ -0,0 +1,252 @@
+/**
+ * @file TimestampFileReader.cpp
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#include "TimestampFileReader.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#ifdef KINECT_2
+using namespace MobileRGBD::Kinect2;
+#endif
+
+/* static */ bool TimestampFileReader::ParseLine(const char * Line, TimestampRecord& Record)
+{
+	// "sec.msec numFrame, RelativeTime" or "sec.msec numFrame, SuppInfo, RelativeTime"
+	char * End = nullptr;
+	long long int Seconds = strtoll(Line, &End, 10);
+	if ( End == Line || *End != '.' )
+	{
+		return false;
+	}
+	const char * Current = End+1;
+	long int Milliseconds = strtol(Current, &End, 10);
+	if ( End == Current )
+	{
+		return false;
+	}
+	Record.WallClockTime = (double)Seconds + (double)Milliseconds/1000.0;
+
+	Current = End;
+	unsigned long int NumFrame = strtoul(Current, &End, 10);
+	if ( End == Current || *End != ',' )
+	{
+		return false;
+	}
+	Record.NumFrame = (unsigned int)NumFrame;
+
+	// Read next value(s)
+	Current = End+1;
+	long long int FirstValue = strtoll(Current, &End, 10);
+	if ( End == Current )
+	{
+		return false;
+	}
+
+	if ( *End == ',' )
+	{
+		// we have a supplementary info
+		Record.SuppInfo = (int)FirstValue;
+		Current = End+1;
+		long long int SecondValue = strtoll(Current, &End, 10);
+		if ( End == Current )
+		{
+			return false;
+		}
+		Record.RelativeTime = (TIMESPAN)SecondValue;
+	}
+	else
+	{
+		Record.SuppInfo = -1;
+		Record.RelativeTime = (TIMESPAN)FirstValue;
+	}
+
+	return true;
+}
+
+/* static */ bool TimestampFileReader::Load(const char * FileName, std::vector<TimestampRecord>& Records)
+{
+	Records.clear();
+
+	FILE * fTimestamp = fopen( FileName, "rb" );
+	if ( fTimestamp == (FILE*)nullptr )
+	{
+		return false;
+	}
+
+	char Line[1024];
+	TimestampRecord Record;
+	while( fgets(Line, sizeof(Line), fTimestamp) != nullptr )
+	{
+		if ( ParseLine( Line, Record ) == true )
+		{
+			Records.push_back(Record);
+		}
+	}
+	fclose(fTimestamp);
+
+	// Add high resolution timestamp if any, "numFrame, monotonic, wallclock, RelativeTime"
+	std::string HighResFileName = FileName;
+	size_t Pos = HighResFileName.rfind(".timestamp");
+	if ( Pos == std::string::npos )
+	{
+		return true;
+	}
+	HighResFileName.replace(Pos, strlen(".timestamp"), ".hrtimestamp");
+
+	FILE * fHighRes = fopen( HighResFileName.c_str(), "rb" );
+	if ( fHighRes == (FILE*)nullptr )
+	{
+		return true;
+	}
+
+	// Lines are written in the same order in both files
+	size_t NumRecord = 0;
+	while( NumRecord < Records.size() && fgets(Line, sizeof(Line), fHighRes) != nullptr )
+	{
+		unsigned int NumFrame;
+		long long int MonotonicTime, WallClockTime, RelativeTime;
+		if ( sscanf( Line, "%u, %lld, %lld, %lld", &NumFrame, &MonotonicTime, &WallClockTime, &RelativeTime ) == 4 )
+		{
+			Records[NumRecord].MonotonicTime = MonotonicTime;
+			Records[NumRecord].WallClockTime = (double)WallClockTime/1.0e9;
+			NumRecord++;
+		}
+	}
+	fclose(fHighRes);
+
+	return true;
+}
+
+/* static */ bool TimestampFileReader::Load(const char * SessionFolder, const char * Prefix, std::vector<TimestampRecord>& Records)
+{
+	return Load( GetStreamFileName( SessionFolder, Prefix, "timestamp" ).c_str(), Records );
+}
+
+/* static */ long long int TimestampFileReader::GetFileSize(const char * FileName)
+{
+	FILE * f = fopen( FileName, "rb" );
+	if ( f == (FILE*)nullptr )
+	{
+		return -1;
+	}
+
+#if defined WIN32 || defined WIN64
+	_fseeki64( f, 0, SEEK_END );
+	long long int Size = _ftelli64( f );
+#else
+	fseeko( f, 0, SEEK_END );
+	long long int Size = (long long int)ftello( f );
+#endif
+	fclose(f);
+
+	return Size;
+}
+
+/* static */ std::string TimestampFileReader::GetStreamFileName(const char * SessionFolder, const char * Prefix, const char * Extension)
+{
+	std::string Res = SessionFolder;
+	Res += "/";
+	Res += Prefix;
+	Res += "/";
+	Res += Prefix;
+	Res += ".";
+	Res += Extension;
+	return Res;
+}
+
+#ifdef KINECT_2
+
+int TimestampRecord::GetNbRecords() const
+{
+	return SuppInfo < 0 ? BODY_COUNT : (SuppInfo > BODY_COUNT ? BODY_COUNT : SuppInfo);
+}
+
+RecordStreamReader::RecordStreamReader()
+{
+	fRaw = (FILE*)nullptr;
+	RecordSize = 0;
+	NumNextFrame = 0;
+	Records = &OwnRecords;
+}
+
+bool RecordStreamReader::Open(const char * SessionFolder, const char * Prefix, int _RecordSize)
+{
+	Close();
+
+	if ( TimestampFileReader::Load( SessionFolder, Prefix, OwnRecords ) == false )
+	{
+		return false;
+	}
+
+	return Open( TimestampFileReader::GetStreamFileName( SessionFolder, Prefix, "raw" ).c_str(), OwnRecords, _RecordSize );
+}
+
+bool RecordStreamReader::Open(const char * RawFileName, const std::vector<TimestampRecord>& _Records, int _RecordSize)
+{
+	Close();
+
+	if ( _RecordSize <= 0 )
+	{
+		return false;
+	}
+
+	fRaw = fopen( RawFileName, "rb" );
+	if ( fRaw == (FILE*)nullptr )
+	{
+		return false;
+	}
+
+	RecordSize = _RecordSize;
+	NumNextFrame = 0;
+	Records = &_Records;
+	return true;
+}
+
+void RecordStreamReader::Close()
+{
+	if ( fRaw != (FILE*)nullptr )
+	{
+		fclose(fRaw);
+		fRaw = (FILE*)nullptr;
+	}
+}
+
+bool RecordStreamReader::ReadFrame(unsigned char * Buffer, int& NbRecords)
+{
+	if ( HasNextFrame() == false )
+	{
+		return false;
+	}
+
+	const int NbRecordsInFrame = (*Records)[NumNextFrame].GetNbRecords();
+	if ( NbRecordsInFrame != 0 && fread( Buffer, RecordSize, NbRecordsInFrame, fRaw ) != (size_t)NbRecordsInFrame )
+	{
+		// Truncated file, Buffer is not valid anymore
+		NbRecords = 0;
+		Close();
+		return false;
+	}
+
+	NbRecords = NbRecordsInFrame;
+	NumNextFrame++;
+	return true;
+}
+
+int RecordStreamReader::ReadFramesNotAfter(TIMESPAN Time, unsigned char * Buffer, int& NbRecords)
+{
+	int NbFrames = 0;
+	while( IsNextFrameNotAfter(Time) == true && ReadFrame( Buffer, NbRecords ) == true )
+	{
+		NbFrames++;
+	}
+	return NbFrames;
+}
+
+#endif // KINECT_2
@@ -0,0 +1,211 @@
+/**
+ * @file TimestampFileReader.h
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#ifndef __TIMESTAMP_FILE_READER_H__
+#define __TIMESTAMP_FILE_READER_H__
+
+#include "KinectBasics.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * @class TimestampRecord TimestampFileReader.cpp TimestampFileReader.h
+ * @brief One line of a recorded timestamp file, i.e. "sec.msec numFrame, [SuppInfo, ]RelativeTime"
+ * completed with ".hrtimestamp" values when available.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class TimestampRecord
+{
+public:
+	TimestampRecord()
+	{
+		WallClockTime = 0.0;
+		NumFrame = 0;
+		SuppInfo = -1;
+		RelativeTime = 0;
+		MonotonicTime = 0;
+	}
+
+#ifdef KINECT_2
+	/** @brief Number of body/face records saved in the raw file for this frame. Old recordings did not have it
+	 * (no SuppInfo), all BODY_COUNT slots were saved.
+	 */
+	int GetNbRecords() const;
+#endif
+
+	double WallClockTime;			/*!< @brief Host time in seconds (ms resolution in legacy files). */
+	unsigned int NumFrame;			/*!< @brief Input number, i.e. frame number or record number for bodies/faces. */
+	int SuppInfo;					/*!< @brief Supplementary info (number of bodies/faces/samples), -1 if none. */
+	TIMESPAN RelativeTime;			/*!< @brief Device time in 100 ns ticks. */
+	long long int MonotonicTime;	/*!< @brief Host monotonic time in ns (0 if no .hrtimestamp file). */
+};
+
+/**
+ * @class TimestampFileReader TimestampFileReader.cpp TimestampFileReader.h
+ * @brief Read timestamp files of a recording, for instance "session/depth/depth.timestamp".
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class TimestampFileReader
+{
+public:
+	/** @brief Load all records of a timestamp file. If a ".hrtimestamp" file exists along with it,
+	 * monotonic times are loaded too.
+	 *
+	 * @param FileName [in] name of the ".timestamp" file.
+	 * @param Records [out] records of the file.
+	 * @return true if the file was read.
+	 */
+	static bool Load(const char * FileName, std::vector<TimestampRecord>& Records);
+
+	/** @brief Load timestamp of a stream in a session, i.e. SessionFolder/Prefix/Prefix.timestamp.
+	 *
+	 * @param SessionFolder [in] session folder.
+	 * @param Prefix [in] stream prefix ("depth", "video", "skeleton", "face", ...).
+	 * @param Records [out] records of the file.
+	 * @return true if the file was read.
+	 */
+	static bool Load(const char * SessionFolder, const char * Prefix, std::vector<TimestampRecord>& Records);
+
+	/** @brief Parse one line of a timestamp file.
+	 *
+	 * @param Line [in] line to parse.
+	 * @param Record [out] parsed record.
+	 * @return true if the line is valid.
+	 */
+	static bool ParseLine(const char * Line, TimestampRecord& Record);
+
+	/** @brief Get size of a file (64 bits).
+	 *
+	 * @param FileName [in] name of the file.
+	 * @return size of the file, -1 if it does not exist.
+	 */
+	static long long int GetFileSize(const char * FileName);
+
+	/** @brief Build file name of a stream in a session, i.e. SessionFolder/Prefix/Prefix.Extension.
+	 *
+	 * @param SessionFolder [in] session folder.
+	 * @param Prefix [in] stream prefix.
+	 * @param Extension [in] extension ("raw", "timestamp", ...).
+	 * @return the file name.
+	 */
+	static std::string GetStreamFileName(const char * SessionFolder, const char * Prefix, const char * Extension);
+};
+
+#ifdef KINECT_2
+
+/**
+ * @class RecordStreamReader TimestampFileReader.cpp TimestampFileReader.h
+ * @brief Read frame by frame a raw stream with a variable number of fixed size records per frame, i.e. skeleton
+ * (KinectBody::BodySize records) or face (KinectFace::FaceSize records) streams. The number of records of each frame
+ * is given by its timestamp record (see TimestampRecord::GetNbRecords). The stream is closed at the end of the records
+ * or if the raw file is truncated.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class RecordStreamReader
+{
+public:
+	/** @brief constructor. Stream is not opened.
+	 */
+	RecordStreamReader();
+
+	/** @brief Virtual destructor, always. Close the stream.
+	 */
+	virtual ~RecordStreamReader()
+	{
+		Close();
+	}
+
+	/** @brief Open a stream of a session, i.e. SessionFolder/Prefix/Prefix.timestamp and SessionFolder/Prefix/Prefix.raw.
+	 *
+	 * @param SessionFolder [in] session folder.
+	 * @param Prefix [in] stream prefix ("skeleton", "face").
+	 * @param RecordSize [in] size of one record in bytes.
+	 * @return true if both files were opened.
+	 */
+	bool Open(const char * SessionFolder, const char * Prefix, int RecordSize);
+
+	/** @brief Open a raw file with its timestamp records.
+	 *
+	 * @param RawFileName [in] raw file.
+	 * @param Records [in] timestamp records of the raw file, must outlive the reader (not copied).
+	 * @param RecordSize [in] size of one record in bytes.
+	 * @return true if the raw file was opened.
+	 */
+	bool Open(const char * RawFileName, const std::vector<TimestampRecord>& Records, int RecordSize);
+
+	/** @brief Close the stream.
+	 */
+	void Close();
+
+	/** @brief Are there frames left to read?
+	 */
+	bool HasNextFrame() const
+	{
+		return fRaw != (FILE*)nullptr && NumNextFrame < Records->size();
+	}
+
+	/** @brief Is there a frame left to read not after a device time?
+	 */
+	bool IsNextFrameNotAfter(TIMESPAN Time) const
+	{
+		return HasNextFrame() == true && (*Records)[NumNextFrame].RelativeTime <= Time;
+	}
+
+	/** @brief Read the next frame.
+	 *
+	 * @param Buffer [out] at least BODY_COUNT*RecordSize bytes.
+	 * @param NbRecords [out] number of records read in Buffer.
+	 * @return false at the end of the stream or if the raw file is truncated.
+	 */
+	bool ReadFrame(unsigned char * Buffer, int& NbRecords);
+
+	/** @brief Read all frames not after a device time, Buffer keeps the last one.
+	 *
+	 * @param Time [in] device time (100 ns ticks).
+	 * @param Buffer [in,out] at least BODY_COUNT*RecordSize bytes.
+	 * @param NbRecords [in,out] number of records of the last frame read in Buffer.
+	 * @return number of frames read.
+	 */
+	int ReadFramesNotAfter(TIMESPAN Time, unsigned char * Buffer, int& NbRecords);
+
+	/** @brief Timestamp record of the last read frame (ReadFrame must have succeeded once).
+	 */
+	const TimestampRecord& GetRecord() const
+	{
+		return (*Records)[NumNextFrame-1];
+	}
+
+	/** @brief Index in the timestamp records of the last read frame, -1 if none.
+	 */
+	int GetNumFrame() const
+	{
+		return (int)NumNextFrame - 1;
+	}
+
+	/** @brief Timestamp records of the stream.
+	 */
+	const std::vector<TimestampRecord>& GetRecords() const
+	{
+		return *Records;
+	}
+
+protected:
+	FILE * fRaw;									/*!< @brief Raw file, nullptr if closed. */
+	int RecordSize;									/*!< @brief Size of one record. */
+	size_t NumNextFrame;							/*!< @brief Index of the next frame to read. */
+	const std::vector<TimestampRecord> * Records;	/*!< @brief Timestamp records, OwnRecords or external ones. */
+	std::vector<TimestampRecord> OwnRecords;		/*!< @brief Timestamp records when opened from a session. */
+};
+
+#endif // KINECT_2
+
+#endif // __TIMESTAMP_FILE_READER_H__
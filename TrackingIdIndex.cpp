@@ -0,0 +1,392 @@
+/**
+ * @file TrackingIdIndex.cpp
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#include "TrackingIdIndex.h"
+
+#ifdef KINECT_2
+
+#include "KinectBody.h"
+#include "KinectFace.h"
+#include "LittleEndianRecord.h"
+
+#include <string.h>
+#include <unordered_map>
+
+using namespace MobileRGBD::Kinect2;
+
+namespace {
+
+const char IndexMagic[4] = { 'T', 'I', 'D', 'X' };
+const unsigned int IndexVersion = 2;
+
+// Little-endian layout of the sidecar file, whatever the platform:
+// - header: magic, version, record size, number of spans (32 bits), raw file size, number of occurrences (64 bits);
+// - spans: tracking id, first/last device times (64 bits), first/last host times (double), first/last frames,
+//   first occurrence, number of occurrences (32 bits);
+// - occurrences: offset (64 bits), frame, slot (32 bits).
+const size_t HeaderSize = 32;
+const size_t SpanSize = 56;
+const size_t OccurrenceSize = 16;
+
+/** @brief 64 bits seek.
+ */
+static bool SeekInFile(FILE * f, long long int Offset)
+{
+#if defined WIN32 || defined WIN64
+	return _fseeki64( f, Offset, SEEK_SET ) == 0;
+#else
+	return fseeko( f, (off_t)Offset, SEEK_SET ) == 0;
+#endif
+}
+
+} // namespace
+
+TrackingIdIndex::TrackingIdIndex()
+{
+	Clear();
+}
+
+void TrackingIdIndex::Clear()
+{
+	RecordSize = 0;
+	RawFileSize = 0;
+	Spans.clear();
+	Occurrences.clear();
+}
+
+/* static */ bool TrackingIdIndex::GetRecordLayout(const char * Prefix, int& RecordSize, int& TrackingIdOffset)
+{
+	if ( strcmp( Prefix, "skeleton" ) == 0 )
+	{
+		KinectBody Body;
+		Body.Set( nullptr );
+		std::vector<unsigned char> Record( KinectBody::BodySize );
+		Body.Set( &Record[0] );
+		RecordSize = KinectBody::BodySize;
+		TrackingIdOffset = (int)((unsigned char*)Body.trackingId - &Record[0]);
+		return true;
+	}
+
+	if ( strcmp( Prefix, "face" ) == 0 )
+	{
+		KinectFace Face;
+		Face.Set( nullptr );
+		std::vector<unsigned char> Record( KinectFace::FaceSize );
+		Face.Set( &Record[0] );
+		RecordSize = KinectFace::FaceSize;
+		TrackingIdOffset = (int)((unsigned char*)Face.TrackingId - &Record[0]);
+		return true;
+	}
+
+	return false;
+}
+
+bool TrackingIdIndex::Open(const char * SessionFolder, const char * Prefix)
+{
+	int ExpectedRecordSize, TrackingIdOffset;
+	if ( GetRecordLayout( Prefix, ExpectedRecordSize, TrackingIdOffset ) == false )
+	{
+		Clear();
+		return false;
+	}
+
+	long long int CurrentRawFileSize = TimestampFileReader::GetFileSize( TimestampFileReader::GetStreamFileName( SessionFolder, Prefix, "raw" ).c_str() );
+	if ( LoadFromSession( SessionFolder, Prefix ) == true && RawFileSize == CurrentRawFileSize && RecordSize == ExpectedRecordSize )
+	{
+		return true;
+	}
+
+	if ( Build( SessionFolder, Prefix ) == false )
+	{
+		return false;
+	}
+
+	// Index is usable even if the session folder is read only
+	SaveInSession( SessionFolder, Prefix );
+	return true;
+}
+
+bool TrackingIdIndex::Build(const char * SessionFolder, const char * Prefix)
+{
+	int lRecordSize, TrackingIdOffset;
+	std::vector<TimestampRecord> Records;
+	if ( GetRecordLayout( Prefix, lRecordSize, TrackingIdOffset ) == false || TimestampFileReader::Load( SessionFolder, Prefix, Records ) == false )
+	{
+		fprintf( stderr, "Could not read '%s' timestamps of '%s'\n", Prefix, SessionFolder );
+		Clear();
+		return false;
+	}
+
+	return Build( TimestampFileReader::GetStreamFileName( SessionFolder, Prefix, "raw" ).c_str(), Records, lRecordSize, TrackingIdOffset );
+}
+
+bool TrackingIdIndex::Build(const char * RawFileName, const std::vector<TimestampRecord>& Records, int _RecordSize, int TrackingIdOffset)
+{
+	Clear();
+
+	if ( _RecordSize <= 0 || TrackingIdOffset < 0 || TrackingIdOffset + (int)sizeof(UINT64) > _RecordSize )
+	{
+		return false;
+	}
+
+	RecordStreamReader Stream;
+	if ( Stream.Open( RawFileName, Records, _RecordSize ) == false )
+	{
+		fprintf( stderr, "Could not open '%s' raw file\n", RawFileName );
+		return false;
+	}
+
+	RecordSize = _RecordSize;
+	RawFileSize = TimestampFileReader::GetFileSize( RawFileName );
+
+	// One pass: occurrences in file order, spans in order of first appearance
+	std::unordered_map<UINT64, int> SpanOfId;
+	std::vector<int> SpanOfOccurrence;
+	std::vector<unsigned char> Buffer( BODY_COUNT*RecordSize );
+	long long int Offset = 0;
+
+	// Stops at the end of the records or of a truncated file, keep what we have
+	int NbRecords;
+	while( Stream.ReadFrame( &Buffer[0], NbRecords ) == true )
+	{
+		const TimestampRecord& Record = Stream.GetRecord();
+		const int f = Stream.GetNumFrame();
+
+		for( int r = 0; r < NbRecords; r++, Offset += RecordSize )
+		{
+			UINT64 TrackingId;
+			memcpy( &TrackingId, &Buffer[r*RecordSize + TrackingIdOffset], sizeof(TrackingId) );
+
+			std::unordered_map<UINT64, int>::iterator It = SpanOfId.find( TrackingId );
+			if ( It == SpanOfId.end() )
+			{
+				TrackingIdSpan NewSpan;
+				NewSpan.TrackingId = TrackingId;
+				NewSpan.FirstTime = Record.RelativeTime;
+				NewSpan.FirstWallClockTime = Record.WallClockTime;
+				NewSpan.FirstFrame = f;
+				NewSpan.FirstOccurrence = 0;
+				NewSpan.NbOccurrences = 0;
+				It = SpanOfId.insert( std::make_pair( TrackingId, (int)Spans.size() ) ).first;
+				Spans.push_back( NewSpan );
+			}
+
+			TrackingIdSpan& Span = Spans[It->second];
+			Span.LastTime = Record.RelativeTime;
+			Span.LastWallClockTime = Record.WallClockTime;
+			Span.LastFrame = f;
+			Span.NbOccurrences++;
+
+			TrackingIdOccurrence Occurrence;
+			Occurrence.Offset = Offset;
+			Occurrence.Frame = f;
+			Occurrence.Slot = r;
+			Occurrences.push_back( Occurrence );
+			SpanOfOccurrence.push_back( It->second );
+		}
+	}
+
+	// Group occurrences by span, stable thus still in time order
+	int FirstOccurrence = 0;
+	std::vector<int> Next( Spans.size() );
+	for( size_t s = 0; s < Spans.size(); s++ )
+	{
+		Spans[s].FirstOccurrence = Next[s] = FirstOccurrence;
+		FirstOccurrence += Spans[s].NbOccurrences;
+	}
+
+	std::vector<TrackingIdOccurrence> Grouped( Occurrences.size() );
+	for( size_t i = 0; i < Occurrences.size(); i++ )
+	{
+		Grouped[Next[SpanOfOccurrence[i]]++] = Occurrences[i];
+	}
+	Occurrences.swap( Grouped );
+
+	return true;
+}
+
+bool TrackingIdIndex::Save(const char * FileName) const
+{
+	if ( RecordSize == 0 )
+	{
+		return false;
+	}
+
+	std::vector<unsigned char> Content( HeaderSize + Spans.size()*SpanSize + Occurrences.size()*OccurrenceSize );
+	memcpy( &Content[0], IndexMagic, sizeof(IndexMagic) );
+	RecordWriter w = { &Content[sizeof(IndexMagic)] };
+	w.U32( IndexVersion );
+	w.U32( (unsigned int)RecordSize );
+	w.U32( (unsigned int)Spans.size() );
+	w.U64( (unsigned long long int)RawFileSize );
+	w.U64( (unsigned long long int)Occurrences.size() );
+	for( size_t s = 0; s < Spans.size(); s++ )
+	{
+		const TrackingIdSpan& Span = Spans[s];
+		w.U64( Span.TrackingId );
+		w.U64( (unsigned long long int)Span.FirstTime );
+		w.U64( (unsigned long long int)Span.LastTime );
+		w.F64( Span.FirstWallClockTime );
+		w.F64( Span.LastWallClockTime );
+		w.U32( (unsigned int)Span.FirstFrame );
+		w.U32( (unsigned int)Span.LastFrame );
+		w.U32( (unsigned int)Span.FirstOccurrence );
+		w.U32( (unsigned int)Span.NbOccurrences );
+	}
+	for( size_t i = 0; i < Occurrences.size(); i++ )
+	{
+		w.U64( (unsigned long long int)Occurrences[i].Offset );
+		w.U32( (unsigned int)Occurrences[i].Frame );
+		w.U32( (unsigned int)Occurrences[i].Slot );
+	}
+
+	FILE * f = fopen( FileName, "wb" );
+	if ( f == (FILE*)nullptr )
+	{
+		fprintf( stderr, "Could not create '%s' index file\n", FileName );
+		return false;
+	}
+	bool Res = fwrite( &Content[0], Content.size(), 1, f ) == 1;
+	fclose(f);
+
+	return Res;
+}
+
+bool TrackingIdIndex::SaveInSession(const char * SessionFolder, const char * Prefix) const
+{
+	return Save( TimestampFileReader::GetStreamFileName( SessionFolder, Prefix, "tidx" ).c_str() );
+}
+
+bool TrackingIdIndex::Load(const char * FileName)
+{
+	Clear();
+
+	FILE * f = fopen( FileName, "rb" );
+	if ( f == (FILE*)nullptr )
+	{
+		return false;
+	}
+
+	unsigned char Header[HeaderSize];
+	if ( fread( Header, HeaderSize, 1, f ) != 1 || memcmp( Header, IndexMagic, sizeof(IndexMagic) ) != 0 )
+	{
+		fclose(f);
+		return false;
+	}
+
+	RecordReader r = { Header + sizeof(IndexMagic) };
+	const unsigned int Version = r.U32();
+	const int lRecordSize = (int)r.U32();
+	const unsigned int NbSpans = r.U32();
+	const long long int lRawFileSize = (long long int)r.U64();
+	const unsigned long long int NbOccurrences = r.U64();
+	if ( Version != IndexVersion || NbSpans > 0x7fffffffU || NbOccurrences > 0x7fffffffULL ||
+		TimestampFileReader::GetFileSize( FileName ) != (long long int)(HeaderSize + NbSpans*(unsigned long long int)SpanSize + NbOccurrences*OccurrenceSize) )
+	{
+		fclose(f);
+		return false;
+	}
+
+	std::vector<unsigned char> Content( NbSpans*SpanSize + (size_t)NbOccurrences*OccurrenceSize );
+	bool Res = Content.empty() == true || fread( &Content[0], Content.size(), 1, f ) == 1;
+	fclose(f);
+
+	if ( Res == false )
+	{
+		return false;
+	}
+
+	Spans.resize( NbSpans );
+	Occurrences.resize( (size_t)NbOccurrences );
+	r.Buffer = Content.empty() == true ? (const unsigned char *)nullptr : &Content[0];
+	for( size_t s = 0; s < Spans.size(); s++ )
+	{
+		TrackingIdSpan& Span = Spans[s];
+		Span.TrackingId = r.U64();
+		Span.FirstTime = (TIMESPAN)r.U64();
+		Span.LastTime = (TIMESPAN)r.U64();
+		Span.FirstWallClockTime = r.F64();
+		Span.LastWallClockTime = r.F64();
+		Span.FirstFrame = (int)r.U32();
+		Span.LastFrame = (int)r.U32();
+		Span.FirstOccurrence = (int)r.U32();
+		Span.NbOccurrences = (int)r.U32();
+	}
+	for( size_t i = 0; i < Occurrences.size(); i++ )
+	{
+		Occurrences[i].Offset = (long long int)r.U64();
+		Occurrences[i].Frame = (int)r.U32();
+		Occurrences[i].Slot = (int)r.U32();
+	}
+
+	RecordSize = lRecordSize;
+	RawFileSize = lRawFileSize;
+	return true;
+}
+
+bool TrackingIdIndex::LoadFromSession(const char * SessionFolder, const char * Prefix)
+{
+	return Load( TimestampFileReader::GetStreamFileName( SessionFolder, Prefix, "tidx" ).c_str() );
+}
+
+int TrackingIdIndex::Find(UINT64 TrackingId) const
+{
+	for( size_t s = 0; s < Spans.size(); s++ )
+	{
+		if ( Spans[s].TrackingId == TrackingId )
+		{
+			return (int)s;
+		}
+	}
+	return -1;
+}
+
+int TrackingIdIndex::ReadRecords(const char * RawFileName, int Span, std::vector<unsigned char>& Buffer) const
+{
+	Buffer.clear();
+	if ( Span < 0 || Span >= (int)Spans.size() )
+	{
+		return -1;
+	}
+
+	FILE * fIn = fopen( RawFileName, "rb" );
+	if ( fIn == (FILE*)nullptr )
+	{
+		fprintf( stderr, "Could not open '%s' raw file\n", RawFileName );
+		return -1;
+	}
+
+	const int NbRecords = Spans[Span].NbOccurrences;
+	const TrackingIdOccurrence * SpanOccurrences = GetOccurrences( Span );
+	Buffer.resize( (size_t)NbRecords*RecordSize );
+
+	// Offsets are increasing, consecutive records are read in one call
+	int NbRead = 0;
+	while( NbRead < NbRecords )
+	{
+		int NbConsecutive = 1;
+		while( NbRead + NbConsecutive < NbRecords &&
+			SpanOccurrences[NbRead+NbConsecutive].Offset == SpanOccurrences[NbRead].Offset + (long long int)NbConsecutive*RecordSize )
+		{
+			NbConsecutive++;
+		}
+
+		if ( SeekInFile( fIn, SpanOccurrences[NbRead].Offset ) == false ||
+			fread( &Buffer[(size_t)NbRead*RecordSize], RecordSize, NbConsecutive, fIn ) != (size_t)NbConsecutive )
+		{
+			break;
+		}
+		NbRead += NbConsecutive;
+	}
+
+	fclose(fIn);
+
+	Buffer.resize( (size_t)NbRead*RecordSize );
+	return NbRead;
+}
+
+#endif // KINECT_2
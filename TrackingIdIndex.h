@@ -0,0 +1,182 @@
+/**
+ * @file TrackingIdIndex.h
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#ifndef __TRACKING_ID_INDEX_H__
+#define __TRACKING_ID_INDEX_H__
+
+#ifdef KINECT_2
+
+#include "KinectBasics.h"
+#include "TimestampFileReader.h"
+
+#include <vector>
+
+namespace MobileRGBD { namespace Kinect2 {
+
+/**
+ * @class TrackingIdOccurrence TrackingIdIndex.cpp TrackingIdIndex.h
+ * @brief Position of one record (body or face) of a tracking id in a raw file.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class TrackingIdOccurrence
+{
+public:
+	long long int Offset;	/*!< @brief Offset of the record in the raw file. */
+	int Frame;				/*!< @brief Index of the frame in the timestamp file. */
+	int Slot;				/*!< @brief Index of the record in the frame (0 to SuppInfo-1). */
+};
+
+/**
+ * @class TrackingIdSpan TrackingIdIndex.cpp TrackingIdIndex.h
+ * @brief Time span and records of one tracking id in a session.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class TrackingIdSpan
+{
+public:
+	UINT64 TrackingId;			/*!< @brief Tracking id. */
+	TIMESPAN FirstTime;			/*!< @brief Device time of the first record (100 ns ticks). */
+	TIMESPAN LastTime;			/*!< @brief Device time of the last record (100 ns ticks). */
+	double FirstWallClockTime;	/*!< @brief Host time of the first record (seconds). */
+	double LastWallClockTime;	/*!< @brief Host time of the last record (seconds). */
+	int FirstFrame;				/*!< @brief Index in the timestamp file of the first frame with this id. */
+	int LastFrame;				/*!< @brief Index in the timestamp file of the last frame with this id. */
+	int FirstOccurrence;		/*!< @brief First occurrence of this id in the index. */
+	int NbOccurrences;			/*!< @brief Number of records of this id. */
+};
+
+/**
+ * @class TrackingIdIndex TrackingIdIndex.cpp TrackingIdIndex.h
+ * @brief Index of the records of each tracking id in a body or face raw file ("skeleton" or "face" stream of a
+ * session), built in one pass over the raw file and its timestamp file (SuppInfo is the number of records of each
+ * frame) and persisted as a sidecar file ("SessionFolder/Prefix/Prefix.tidx"). Occurrences of an id are contiguous
+ * and in time order, thus the trajectory of a person is read directly with ReadRecords.
+ * Sidecar file has an explicit little-endian layout (header, spans then occurrences), whatever the platform. It is rebuilt by Open when the raw file size changed.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class TrackingIdIndex
+{
+public:
+	/** @brief constructor. Empty index.
+	 */
+	TrackingIdIndex();
+
+	/** @brief Virtual destructor, always.
+	 */
+	virtual ~TrackingIdIndex() {}
+
+	/** @brief Empty the index.
+	 */
+	void Clear();
+
+	/** @brief Load the index of a stream from its sidecar file, build and save it if missing or outdated.
+	 *
+	 * @param SessionFolder [in] session folder.
+	 * @param Prefix [in] "skeleton" or "face".
+	 * @return true if the index is available.
+	 */
+	bool Open(const char * SessionFolder, const char * Prefix);
+
+	/** @brief Build the index of a stream of a session.
+	 *
+	 * @param SessionFolder [in] session folder.
+	 * @param Prefix [in] "skeleton" or "face".
+	 * @return true if built.
+	 */
+	bool Build(const char * SessionFolder, const char * Prefix);
+
+	/** @brief Build the index of a raw file.
+	 *
+	 * @param RawFileName [in] raw file.
+	 * @param Records [in] records of its timestamp file.
+	 * @param RecordSize [in] size of one record (KinectBody::BodySize, KinectFace::FaceSize).
+	 * @param TrackingIdOffset [in] offset of the tracking id in a record.
+	 * @return true if built.
+	 */
+	bool Build(const char * RawFileName, const std::vector<TimestampRecord>& Records, int RecordSize, int TrackingIdOffset);
+
+	/** @brief Save index in a file.
+	 */
+	bool Save(const char * FileName) const;
+
+	/** @brief Save index in a session folder ("SessionFolder/Prefix/Prefix.tidx").
+	 */
+	bool SaveInSession(const char * SessionFolder, const char * Prefix) const;
+
+	/** @brief Load index from a file.
+	 */
+	bool Load(const char * FileName);
+
+	/** @brief Load index from a session folder ("SessionFolder/Prefix/Prefix.tidx").
+	 */
+	bool LoadFromSession(const char * SessionFolder, const char * Prefix);
+
+	/** @brief All tracking ids, in order of first appearance.
+	 */
+	const std::vector<TrackingIdSpan>& GetSpans() const
+	{
+		return Spans;
+	}
+
+	/** @brief Find a tracking id.
+	 *
+	 * @return index in GetSpans(), -1 if not found.
+	 */
+	int Find(UINT64 TrackingId) const;
+
+	/** @brief Occurrences of a span (GetSpans()[Span].NbOccurrences values).
+	 */
+	const TrackingIdOccurrence * GetOccurrences(int Span) const
+	{
+		return &Occurrences[Spans[Span].FirstOccurrence];
+	}
+
+	/** @brief Size of one record of the indexed raw file.
+	 */
+	int GetRecordSize() const
+	{
+		return RecordSize;
+	}
+
+	/** @brief Size of the indexed raw file.
+	 */
+	long long int GetRawFileSize() const
+	{
+		return RawFileSize;
+	}
+
+	/** @brief Read all records of a tracking id.
+	 *
+	 * @param RawFileName [in] indexed raw file.
+	 * @param Span [in] index in GetSpans().
+	 * @param Buffer [out] NbOccurrences*GetRecordSize() bytes, in time order.
+	 * @return number of records read, -1 on error.
+	 */
+	int ReadRecords(const char * RawFileName, int Span, std::vector<unsigned char>& Buffer) const;
+
+	/** @brief Get record size and tracking id offset of a stream.
+	 *
+	 * @param Prefix [in] "skeleton" or "face".
+	 * @return false if the stream has no tracking id.
+	 */
+	static bool GetRecordLayout(const char * Prefix, int& RecordSize, int& TrackingIdOffset);
+
+protected:
+	int RecordSize;									/*!< @brief Size of one record. */
+	long long int RawFileSize;						/*!< @brief Size of the raw file when indexed. */
+	std::vector<TrackingIdSpan> Spans;				/*!< @brief One span per tracking id. */
+	std::vector<TrackingIdOccurrence> Occurrences;	/*!< @brief Occurrences grouped by tracking id. */
+};
+
+}} // namespace MobileRGBD::Kinect2
+
+#endif // KINECT_2
+
+#endif // __TRACKING_ID_INDEX_H__
@@ -0,0 +1,186 @@
+/**
+ * @file TrackingIdSlotTable.h
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#ifndef __TRACKING_ID_SLOT_TABLE_H__
+#define __TRACKING_ID_SLOT_TABLE_H__
+
+#ifdef KINECT_2
+
+#include "KinectBasics.h"
+#include "KinectBody.h"
+
+namespace MobileRGBD { namespace Kinect2 {
+
+/**
+ * @class TrackingIdSlotTable TrackingIdSlotTable.h
+ * @brief Per tracking id state of bodies or faces, in BODY_COUNT slots. A tracking id keeps its slot until it is
+ * released, slot indexes can thus be used to keep more state elsewhere. States are not reset by the table: Acquire
+ * tells when a slot is given to a new tracking id. Not protected, callers lock it if it is shared between threads.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+template<typename STATE_TYPE>
+class TrackingIdSlotTable
+{
+public:
+	/** @brief constructor. All slots are free.
+	 */
+	TrackingIdSlotTable()
+	{
+		Clear();
+	}
+
+	/** @brief Virtual destructor, always.
+	 */
+	virtual ~TrackingIdSlotTable() {}
+
+	/** @brief Free all slots.
+	 */
+	void Clear()
+	{
+		for( int s = 0; s < BODY_COUNT; s++ )
+		{
+			SlotIsUsed[s] = false;
+			TrackingIds[s] = 0;
+		}
+	}
+
+	/** @brief Slot of a tracking id.
+	 *
+	 * @return slot, -1 if unknown.
+	 */
+	int Find(UINT64 TrackingId) const
+	{
+		for( int s = 0; s < BODY_COUNT; s++ )
+		{
+			if ( SlotIsUsed[s] == true && TrackingIds[s] == TrackingId )
+			{
+				return s;
+			}
+		}
+		return -1;
+	}
+
+	/** @brief Slot of a tracking id, the first free slot is given to it if unknown.
+	 *
+	 * @param TrackingId [in] tracking id.
+	 * @param IsNew [out] true if the slot was free, its state must be reset by the caller.
+	 * @return slot, -1 if unknown and no slot is free.
+	 */
+	int Acquire(UINT64 TrackingId, bool& IsNew)
+	{
+		int FreeSlot = -1;
+		for( int s = 0; s < BODY_COUNT; s++ )
+		{
+			if ( SlotIsUsed[s] == true && TrackingIds[s] == TrackingId )
+			{
+				IsNew = false;
+				return s;
+			}
+			if ( SlotIsUsed[s] == false && FreeSlot < 0 )
+			{
+				FreeSlot = s;
+			}
+		}
+
+		IsNew = FreeSlot >= 0;
+		if ( IsNew == true )
+		{
+			Assign( FreeSlot, TrackingId );
+		}
+		return FreeSlot;
+	}
+
+	/** @brief Give a slot to a tracking id, whatever its previous tracking id.
+	 */
+	void Assign(int Slot, UINT64 TrackingId)
+	{
+		SlotIsUsed[Slot] = true;
+		TrackingIds[Slot] = TrackingId;
+	}
+
+	/** @brief Free a slot. Its state and tracking id are kept until the slot is acquired again.
+	 */
+	void Release(int Slot)
+	{
+		SlotIsUsed[Slot] = false;
+	}
+
+	/** @brief Free slots of tracking ids not in a body frame.
+	 *
+	 * @param Bodies [in] bodies of the frame (ActualNbBody bodies).
+	 * @param ReleasedSlots [out] if not nullptr, freed slots (room for BODY_COUNT slots).
+	 * @return number of freed slots.
+	 */
+	int ReleaseMissing(const KinectBodies& Bodies, int * ReleasedSlots = nullptr)
+	{
+		const int NbBodies = (int)(Bodies.ActualNbBody > (unsigned int)BODY_COUNT ? BODY_COUNT : Bodies.ActualNbBody);
+
+		int NbReleased = 0;
+		for( int s = 0; s < BODY_COUNT; s++ )
+		{
+			if ( SlotIsUsed[s] == false )
+			{
+				continue;
+			}
+			bool IsSeen = false;
+			for( int b = 0; b < NbBodies && IsSeen == false; b++ )
+			{
+				IsSeen = *Bodies.BodiesInformation[b].trackingId == TrackingIds[s];
+			}
+			if ( IsSeen == false )
+			{
+				SlotIsUsed[s] = false;
+				if ( ReleasedSlots != nullptr )
+				{
+					ReleasedSlots[NbReleased] = s;
+				}
+				NbReleased++;
+			}
+		}
+		return NbReleased;
+	}
+
+	/** @brief Is a slot used?
+	 */
+	bool IsUsed(int Slot) const
+	{
+		return SlotIsUsed[Slot];
+	}
+
+	/** @brief Tracking id of a slot (last one if the slot is free).
+	 */
+	UINT64 GetTrackingId(int Slot) const
+	{
+		return TrackingIds[Slot];
+	}
+
+	/** @brief State of a slot.
+	 */
+	STATE_TYPE& Get(int Slot)
+	{
+		return States[Slot];
+	}
+
+	/** @brief State of a slot.
+	 */
+	const STATE_TYPE& Get(int Slot) const
+	{
+		return States[Slot];
+	}
+
+protected:
+	bool SlotIsUsed[BODY_COUNT];		/*!< @brief Is slot used? */
+	UINT64 TrackingIds[BODY_COUNT];		/*!< @brief Tracking id of each slot. */
+	STATE_TYPE States[BODY_COUNT];		/*!< @brief State of each slot. */
+};
+
+}} // namespace MobileRGBD::Kinect2
+
+#endif // KINECT_2
+
+#endif // __TRACKING_ID_SLOT_TABLE_H__
@@ -0,0 +1,249 @@
+/**
+ * @file VoxelGrid.cpp
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#include "VoxelGrid.h"
+
+#ifdef KINECT_2
+
+#include <math.h>
+
+using namespace MobileRGBD::Kinect2;
+
+namespace {
+
+static const unsigned long long int EmptyKey = ~0ULL;
+
+} // namespace
+
+VoxelGrid::VoxelGrid(const DepthFrameToCameraSpaceTable& _Table, float _VoxelSize /* = 0.05f */, unsigned short _MaxDepth /* = 8000 */) :
+	Table(_Table), VoxelSize(_VoxelSize), InvVoxelSize(1.0f/_VoxelSize), MaxDepth(_MaxDepth)
+{
+	Slot Free;
+	Free.Key = EmptyKey;
+	Free.VoxelIndex = -1;
+	Slots.assign( InitialCapacity, Free );
+
+	HashShift = 64;
+	for( size_t Capacity = InitialCapacity; Capacity > 1; Capacity >>= 1 )
+	{
+		HashShift--;
+	}
+
+	Voxels.reserve( InitialCapacity/2 );
+	UsedSlots.reserve( InitialCapacity/2 );
+}
+
+void VoxelGrid::Clear()
+{
+	if ( UsedSlots.size() > Slots.size()/4 )
+	{
+		for( size_t i = 0; i < Slots.size(); i++ )
+		{
+			Slots[i].Key = EmptyKey;
+		}
+	}
+	else
+	{
+		for( size_t i = 0; i < UsedSlots.size(); i++ )
+		{
+			Slots[UsedSlots[i]].Key = EmptyKey;
+		}
+	}
+	UsedSlots.clear();
+	Voxels.clear();
+}
+
+inline bool VoxelGrid::GetCoordinates(const CameraSpacePoint& Point, int& Ix, int& Iy, int& Iz) const
+{
+	const float Limit = (float)(1 << (CoordinateBits-1)) - 1.0f;
+	float fx = floorf( Point.X*InvVoxelSize );
+	float fy = floorf( Point.Y*InvVoxelSize );
+	float fz = floorf( Point.Z*InvVoxelSize );
+
+	// Also rejects NaN
+	if ( !(fabsf(fx) < Limit && fabsf(fy) < Limit && fabsf(fz) < Limit) )
+	{
+		return false;
+	}
+
+	Ix = (int)fx;
+	Iy = (int)fy;
+	Iz = (int)fz;
+	return true;
+}
+
+void VoxelGrid::AddPoint(const CameraSpacePoint& Point)
+{
+	int Ix, Iy, Iz;
+	if ( GetCoordinates( Point, Ix, Iy, Iz ) == false )
+	{
+		return;
+	}
+
+	const unsigned long long int Key = GetKey( Ix, Iy, Iz );
+	const size_t Mask = Slots.size() - 1;
+	size_t Pos = GetSlot( Key );
+	for(;;)
+	{
+		Slot& Current = Slots[Pos];
+		if ( Current.Key == Key )
+		{
+			// Running mean, stable when accumulating many frames
+			Voxel& v = Voxels[Current.VoxelIndex];
+			v.Count++;
+			float Weight = 1.0f/(float)v.Count;
+			v.Centroid.X += (Point.X - v.Centroid.X)*Weight;
+			v.Centroid.Y += (Point.Y - v.Centroid.Y)*Weight;
+			v.Centroid.Z += (Point.Z - v.Centroid.Z)*Weight;
+			return;
+		}
+
+		if ( Current.Key == EmptyKey )
+		{
+			Current.Key = Key;
+			Current.VoxelIndex = (int)Voxels.size();
+			UsedSlots.push_back( Pos );
+
+			Voxel v;
+			v.Ix = Ix;
+			v.Iy = Iy;
+			v.Iz = Iz;
+			v.Count = 1;
+			v.Centroid = Point;
+			Voxels.push_back( v );
+
+			// Keep load factor under 1/2, probing sequences stay short
+			if ( 2*Voxels.size() > Slots.size() )
+			{
+				Grow();
+			}
+			return;
+		}
+
+		Pos = (Pos + 1) & Mask;
+	}
+}
+
+void VoxelGrid::Grow()
+{
+	Slot Free;
+	Free.Key = EmptyKey;
+	Free.VoxelIndex = -1;
+	Slots.assign( 2*Slots.size(), Free );
+	HashShift--;
+
+	const size_t Mask = Slots.size() - 1;
+	for( size_t i = 0; i < Voxels.size(); i++ )
+	{
+		const unsigned long long int Key = GetKey( Voxels[i].Ix, Voxels[i].Iy, Voxels[i].Iz );
+		size_t Pos = GetSlot( Key );
+		while( Slots[Pos].Key != EmptyKey )
+		{
+			Pos = (Pos + 1) & Mask;
+		}
+		Slots[Pos].Key = Key;
+		Slots[Pos].VoxelIndex = (int)i;
+		UsedSlots[i] = Pos;
+	}
+}
+
+int VoxelGrid::Find(const CameraSpacePoint& Point) const
+{
+	int Ix, Iy, Iz;
+	if ( GetCoordinates( Point, Ix, Iy, Iz ) == false )
+	{
+		return -1;
+	}
+
+	const unsigned long long int Key = GetKey( Ix, Iy, Iz );
+	const size_t Mask = Slots.size() - 1;
+	for( size_t Pos = GetSlot( Key ); Slots[Pos].Key != EmptyKey; Pos = (Pos + 1) & Mask )
+	{
+		if ( Slots[Pos].Key == Key )
+		{
+			return Slots[Pos].VoxelIndex;
+		}
+	}
+	return -1;
+}
+
+void VoxelGrid::AddPoints(const CameraSpacePoint * Points, int NbPoints, const VoxelGridPose * Pose /* = nullptr */)
+{
+	if ( Points == nullptr )
+	{
+		return;
+	}
+
+	for( int i = 0; i < NbPoints; i++ )
+	{
+		if ( Pose == nullptr )
+		{
+			AddPoint( Points[i] );
+		}
+		else
+		{
+			CameraSpacePoint Point;
+			Pose->Transform( Points[i], Point );
+			AddPoint( Point );
+		}
+	}
+}
+
+int VoxelGrid::AddDepthFrame(const unsigned short * Depth, const VoxelGridPose * Pose /* = nullptr */, int SubSampling /* = 1 */)
+{
+	if ( Depth == nullptr || IsValid() == false || SubSampling < 1 )
+	{
+		return 0;
+	}
+
+	const PointF * Entries = Table.GetTable();
+	int NbPoints = 0;
+	for( int v = 0; v < DepthHeight; v += SubSampling )
+	{
+		for( int u = 0; u < DepthWidth; u += SubSampling )
+		{
+			int i = v*DepthWidth + u;
+			if ( Depth[i] == 0 || Depth[i] > MaxDepth )
+			{
+				continue;
+			}
+
+			CameraSpacePoint Point;
+			Point.Z = (float)Depth[i]*0.001f;
+			Point.X = Entries[i].X*Point.Z;
+			Point.Y = Entries[i].Y*Point.Z;
+
+			if ( Pose == nullptr )
+			{
+				AddPoint( Point );
+			}
+			else
+			{
+				CameraSpacePoint Transformed;
+				Pose->Transform( Point, Transformed );
+				AddPoint( Transformed );
+			}
+			NbPoints++;
+		}
+	}
+	return NbPoints;
+}
+
+void VoxelGrid::GetCentroids(std::vector<CameraSpacePoint>& Centroids, unsigned int MinCount /* = 1 */) const
+{
+	Centroids.clear();
+	Centroids.reserve( Voxels.size() );
+	for( size_t i = 0; i < Voxels.size(); i++ )
+	{
+		if ( Voxels[i].Count >= MinCount )
+		{
+			Centroids.push_back( Voxels[i].Centroid );
+		}
+	}
+}
+
+#endif // KINECT_2
@@ -0,0 +1,187 @@
+/**
+ * @file VoxelGrid.h
+ * @ingroup Kinect
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ * @copyright All right reserved.
+ */
+
+#ifndef __VOXEL_GRID_H__
+#define __VOXEL_GRID_H__
+
+#ifdef KINECT_2
+
+#include "KinectBasics.h"
+#include "DepthFrameToCameraSpaceTable.h"
+
+#include <vector>
+
+namespace MobileRGBD { namespace Kinect2 {
+
+/**
+ * @class VoxelGridPose VoxelGrid.h VoxelGrid.h
+ * @brief Rigid transformation from camera space to the grid frame (for instance the world frame given by the robot
+ * localisation recorded with the corpus): P = Rotation*Pc + Translation, meters.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class VoxelGridPose
+{
+public:
+	/** @brief constructor. Identity.
+	 */
+	VoxelGridPose()
+	{
+		for( int i = 0; i < 9; i++ )
+		{
+			Rotation[i] = (i % 4) == 0 ? 1.0f : 0.0f;
+		}
+		Translation[0] = Translation[1] = Translation[2] = 0.0f;
+	}
+
+	/** @brief Apply transformation.
+	 */
+	inline void Transform(const CameraSpacePoint& In, CameraSpacePoint& Out) const
+	{
+		Out.X = Rotation[0]*In.X + Rotation[1]*In.Y + Rotation[2]*In.Z + Translation[0];
+		Out.Y = Rotation[3]*In.X + Rotation[4]*In.Y + Rotation[5]*In.Z + Translation[1];
+		Out.Z = Rotation[6]*In.X + Rotation[7]*In.Y + Rotation[8]*In.Z + Translation[2];
+	}
+
+	float Rotation[9];		/*!< @brief Rotation, row major. */
+	float Translation[3];	/*!< @brief Translation in meters. */
+};
+
+/**
+ * @class VoxelGrid VoxelGrid.cpp VoxelGrid.h
+ * @brief Voxel grid downsampling of depth frames: each occupied voxel keeps the number of points that fell in it
+ * and their centroid. Voxels are stored densely (insertion order) and found through an open addressing hash
+ * table (linear probing on 64 bits packed voxel coordinates), both reused from one frame to the next: Clear only
+ * resets used slots. Frames can be accumulated with a pose each to build an obstacle map over several frames.
+ * One grid is used by one thread.
+ *
+ * @author Dominique Vaufreydaz, Grenoble Alpes University, Inria
+ */
+class VoxelGrid
+{
+public:
+	/** @brief One occupied voxel.
+	 */
+	class Voxel
+	{
+	public:
+		int Ix, Iy, Iz;				/*!< @brief Voxel coordinates (floor(P/VoxelSize)). */
+		unsigned int Count;			/*!< @brief Number of points. */
+		CameraSpacePoint Centroid;	/*!< @brief Mean of the points, in the grid frame. */
+	};
+
+	/** @brief constructor.
+	 *
+	 * @param Table [in] lookup table of the sensor/session to unproject depth frames.
+	 * @param VoxelSize [in] edge of voxels in meters.
+	 * @param MaxDepth [in] ignore depth above (mm).
+	 */
+	VoxelGrid(const DepthFrameToCameraSpaceTable& Table, float VoxelSize = 0.05f, unsigned short MaxDepth = 8000);
+
+	/** @brief Virtual destructor, always.
+	 */
+	virtual ~VoxelGrid() {}
+
+	/** @brief Is the grid ready (valid table)?
+	 */
+	bool IsValid() const
+	{
+		return Table.IsValid();
+	}
+
+	/** @brief Remove all voxels, keep memory.
+	 */
+	void Clear();
+
+	/** @brief Unproject a depth frame (as in depth.raw) and accumulate its points.
+	 *
+	 * @param Depth [in] depth frame (DepthWidth*DepthHeight values in mm).
+	 * @param Pose [in] camera pose in the grid frame, nullptr for camera space.
+	 * @param SubSampling [in] use 1 pixel every SubSampling in both directions.
+	 * @return number of points added.
+	 */
+	int AddDepthFrame(const unsigned short * Depth, const VoxelGridPose * Pose = nullptr, int SubSampling = 1);
+
+	/** @brief Accumulate camera space points.
+	 *
+	 * @param Points [in] points (meters), NaN points are ignored.
+	 * @param NbPoints [in] number of points.
+	 * @param Pose [in] camera pose in the grid frame, nullptr for camera space.
+	 */
+	void AddPoints(const CameraSpacePoint * Points, int NbPoints, const VoxelGridPose * Pose = nullptr);
+
+	/** @brief Occupied voxels, in insertion order.
+	 */
+	const std::vector<Voxel>& GetVoxels() const
+	{
+		return Voxels;
+	}
+
+	/** @brief Find the voxel containing a point.
+	 *
+	 * @return index in GetVoxels(), -1 if empty.
+	 */
+	int Find(const CameraSpacePoint& Point) const;
+
+	/** @brief Centroids of voxels with at least MinCount points (compact point cloud).
+	 */
+	void GetCentroids(std::vector<CameraSpacePoint>& Centroids, unsigned int MinCount = 1) const;
+
+protected:
+	enum { InitialCapacity = 1 << 16, CoordinateBits = 21 };
+
+	/** @brief Slot of the hash table, key and voxel side by side to touch one cache line per probe.
+	 */
+	class Slot
+	{
+	public:
+		unsigned long long int Key;		/*!< @brief Packed coordinates, EmptyKey if free. */
+		int VoxelIndex;					/*!< @brief Index in Voxels. */
+	};
+
+	/** @brief Voxel coordinates of a point, false if out of grid range.
+	 */
+	inline bool GetCoordinates(const CameraSpacePoint& Point, int& Ix, int& Iy, int& Iz) const;
+
+	/** @brief Pack voxel coordinates in a key.
+	 */
+	static inline unsigned long long int GetKey(int Ix, int Iy, int Iz)
+	{
+		const int Offset = 1 << (CoordinateBits-1);
+		return ((unsigned long long int)(Ix + Offset) << (2*CoordinateBits)) | ((unsigned long long int)(Iy + Offset) << CoordinateBits) | (unsigned long long int)(Iz + Offset);
+	}
+
+	/** @brief First slot of a key (Fibonacci hashing).
+	 */
+	inline size_t GetSlot(unsigned long long int Key) const
+	{
+		return (size_t)((Key*0x9E3779B97F4A7C15ULL) >> HashShift);
+	}
+
+	/** @brief Add one point in the grid frame.
+	 */
+	void AddPoint(const CameraSpacePoint& Point);
+
+	/** @brief Double hash table size.
+	 */
+	void Grow();
+
+	DepthFrameToCameraSpaceTable Table;		/*!< @brief Unprojection table. */
+	float VoxelSize;						/*!< @brief Voxel edge in meters. */
+	float InvVoxelSize;						/*!< @brief 1/VoxelSize. */
+	unsigned short MaxDepth;				/*!< @brief Max depth in mm. */
+	std::vector<Voxel> Voxels;				/*!< @brief Occupied voxels. */
+	std::vector<Slot> Slots;				/*!< @brief Hash table, size is a power of 2. */
+	std::vector<size_t> UsedSlots;			/*!< @brief Slot of each voxel, to clear quickly. */
+	int HashShift;							/*!< @brief 64 - log2(capacity). */
+};
+
+}} // namespace MobileRGBD::Kinect2
+
+#endif // KINECT_2
+
+#endif // __VOXEL_GRID_H__